@@ -18,6 +18,7 @@
 #define THIRD_PARTY_ZETASQL_ZETASQL_BASE_SIMPLE_REFERENCE_COUNTED_H_
 
 #include <stddef.h>
+#include <stdint.h>
 #include <atomic>
 
 namespace zetasql_base {
@@ -61,17 +62,35 @@ class SimpleReferenceCounted {
 
   // Take possession of a reference on this, which must eventually be released
   // with Unref().
-  void Ref() const { ref_count_.fetch_add(1, std::memory_order_relaxed); }
+  void Ref() const {
+    if (thread_confined_) {
+      ref_count_.store(ref_count_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+    } else {
+      ref_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
 
   // Drop a reference on this, which ought to have been owned by the caller.
   // WARNING: Unref() may delete the object and it should not be touched once
   // a reference is no longer held.
   void Unref() const {
-    if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) - 1 == 0) {
+    int32_t new_ref_count;
+    if (thread_confined_) {
+      new_ref_count = ref_count_.load(std::memory_order_relaxed) - 1;
+      ref_count_.store(new_ref_count, std::memory_order_relaxed);
+    } else {
+      new_ref_count = ref_count_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    }
+    if (new_ref_count == 0) {
       OnRefCountIsZero();
     }
   }
 
+  // Returns true if Ref() and Unref() do not use atomic read-modify-write
+  // operations. See set_thread_confined().
+  bool thread_confined() const { return thread_confined_; }
+
   // Returns true if the reference count is exactly 1
   //
   // Applications with a strong reference counting contract can use this value
@@ -163,8 +182,19 @@ class SimpleReferenceCounted {
     return ref_count_.load(std::memory_order_acquire);
   }
 
+  // If 'thread_confined' is true, Ref() and Unref() update the reference
+  // count with plain loads and stores instead of atomic read-modify-write
+  // operations, which are much more expensive. This is only correct if at most
+  // one thread at a time holds or manipulates references to this object, and
+  // threads that hand it over synchronize with each other (e.g., with a
+  // mutex). Must be called before the object is shared.
+  void set_thread_confined(bool thread_confined) {
+    thread_confined_ = thread_confined;
+  }
+
  private:
   mutable std::atomic<int32_t> ref_count_;
+  bool thread_confined_ = false;
 };
 
 }  // namespace zetasql_base
@@ -41,6 +41,7 @@ class TestRefCounted : public SimpleReferenceCounted {
   }
 
   size_t ref_count() const { return SimpleReferenceCounted::ref_count(); }
+  using SimpleReferenceCounted::set_thread_confined;
 
  private:
   int* const destruct_count_;
@@ -79,6 +80,28 @@ TEST(SimpleReferenceCounted, RefUnrefAndRefCount) {
   EXPECT_THAT(finalize_count, Eq(1));
 }
 
+// Tests that a thread confined object counts references like any other.
+TEST(SimpleReferenceCounted, ThreadConfined) {
+  int destruct_count = 0;
+  int finalize_count = 0;
+  TestRefCounted* rc = new TestRefCounted(&destruct_count, &finalize_count);
+  EXPECT_FALSE(rc->thread_confined());
+  rc->set_thread_confined(true);
+  EXPECT_TRUE(rc->thread_confined());
+
+  rc->Ref();
+  rc->Ref();
+  EXPECT_THAT(rc->ref_count(), Eq(3));
+  rc->Unref();
+  rc->Unref();
+  EXPECT_TRUE(rc->RefCountIsOne());
+  EXPECT_THAT(destruct_count, Eq(0));
+
+  rc->Unref();
+  EXPECT_THAT(destruct_count, Eq(1));
+  EXPECT_THAT(finalize_count, Eq(1));
+}
+
 // Test class that counts dtor and OnRefCountIsZero invocations, exposes
 // ref_count(), and consumes the first 8 OnRefCountIsZero() calls before calling
 // the default OnRefCountIsZero() on the 9th call.
@@ -0,0 +1,197 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/common/column_vector.h"
+
+#include <utility>
+
+#include "zetasql/base/logging.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+
+namespace zetasql {
+
+std::unique_ptr<const ColumnVector> ColumnVector::Create(
+    const Type* type, absl::Span<const Value> values) {
+  Encoding encoding;
+  switch (type->kind()) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_DATE:
+    case TYPE_ENUM:
+      encoding = Encoding::kInt64;
+      break;
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+      encoding = Encoding::kDouble;
+      break;
+    case TYPE_BOOL:
+      encoding = Encoding::kBool;
+      break;
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      encoding = Encoding::kString;
+      break;
+    default:
+      return CreateBoxed(type, std::make_shared<const std::vector<Value>>(
+                                   values.begin(), values.end()));
+  }
+
+  const int64_t size = values.size();
+  const int64_t num_words = (size + 63) / 64;
+  auto column = absl::WrapUnique(new ColumnVector(type, encoding, size));
+  column->validity_.resize(num_words);
+  switch (encoding) {
+    case Encoding::kInt64:
+      column->int64_values_.resize(size);
+      break;
+    case Encoding::kDouble:
+      column->double_values_.resize(size);
+      break;
+    case Encoding::kBool:
+      column->bool_values_.resize(num_words);
+      break;
+    case Encoding::kString:
+      column->string_codes_.resize(size);
+      break;
+    case Encoding::kBoxed:
+      LOG(FATAL) << "Unexpected encoding";
+  }
+
+  absl::flat_hash_map<absl::string_view, uint32_t> code_by_string;
+  for (int64_t i = 0; i < size; ++i) {
+    const Value& value = values[i];
+    DCHECK(value.type()->Equals(type));
+    if (value.is_null()) continue;
+    SetBit(i, &column->validity_);
+    switch (type->kind()) {
+      case TYPE_INT32:
+        column->int64_values_[i] = value.int32_value();
+        break;
+      case TYPE_INT64:
+        column->int64_values_[i] = value.int64_value();
+        break;
+      case TYPE_UINT32:
+        column->int64_values_[i] = value.uint32_value();
+        break;
+      case TYPE_UINT64:
+        column->int64_values_[i] = static_cast<int64_t>(value.uint64_value());
+        break;
+      case TYPE_DATE:
+        column->int64_values_[i] = value.date_value();
+        break;
+      case TYPE_ENUM:
+        column->int64_values_[i] = value.enum_value();
+        break;
+      case TYPE_FLOAT:
+        column->double_values_[i] = value.float_value();
+        break;
+      case TYPE_DOUBLE:
+        column->double_values_[i] = value.double_value();
+        break;
+      case TYPE_BOOL:
+        if (value.bool_value()) SetBit(i, &column->bool_values_);
+        break;
+      case TYPE_STRING:
+      case TYPE_BYTES: {
+        // The keys point into 'values', which outlive 'code_by_string'.
+        const absl::string_view str = type->kind() == TYPE_STRING
+                                          ? value.string_value()
+                                          : value.bytes_value();
+        const auto insert_result = code_by_string.emplace(
+            str, static_cast<uint32_t>(code_by_string.size()));
+        if (insert_result.second) {
+          // Copy the string rather than sharing the representation of
+          // 'value', which may belong to an evaluation's arena.
+          column->dictionary_.push_back(type->kind() == TYPE_STRING
+                                            ? Value::String(str)
+                                            : Value::Bytes(str));
+          column->dictionary_byte_size_ +=
+              column->dictionary_.back().physical_byte_size();
+        }
+        column->string_codes_[i] = insert_result.first->second;
+        break;
+      }
+      default:
+        LOG(FATAL) << "Unexpected type: " << type->DebugString();
+    }
+  }
+  column->dictionary_.shrink_to_fit();
+  return std::move(column);
+}
+
+std::unique_ptr<const ColumnVector> ColumnVector::CreateBoxed(
+    const Type* type, std::shared_ptr<const std::vector<Value>> values) {
+  auto column = absl::WrapUnique(
+      new ColumnVector(type, Encoding::kBoxed, values->size()));
+  column->boxed_values_ = std::move(values);
+  return std::move(column);
+}
+
+Value ColumnVector::GetValue(int64_t i) const {
+  DCHECK_LT(i, size_);
+  if (encoding_ == Encoding::kBoxed) {
+    return (*boxed_values_)[i];
+  }
+  if (!IsValid(i)) {
+    return Value::Null(type_);
+  }
+  switch (type_->kind()) {
+    case TYPE_INT32:
+      return Value::Int32(static_cast<int32_t>(int64_values_[i]));
+    case TYPE_INT64:
+      return Value::Int64(int64_values_[i]);
+    case TYPE_UINT32:
+      return Value::Uint32(static_cast<uint32_t>(int64_values_[i]));
+    case TYPE_UINT64:
+      return Value::Uint64(static_cast<uint64_t>(int64_values_[i]));
+    case TYPE_DATE:
+      return Value::Date(static_cast<int32_t>(int64_values_[i]));
+    case TYPE_ENUM:
+      return Value::Enum(type_->AsEnum(), int64_values_[i]);
+    case TYPE_FLOAT:
+      return Value::Float(static_cast<float>(double_values_[i]));
+    case TYPE_DOUBLE:
+      return Value::Double(double_values_[i]);
+    case TYPE_BOOL:
+      return Value::Bool(GetBit(bool_values_, i));
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return dictionary_[string_codes_[i]];
+    default:
+      LOG(FATAL) << "Unexpected type: " << type_->DebugString();
+  }
+}
+
+int64_t ColumnVector::GetPhysicalByteSize() const {
+  int64_t byte_size = sizeof(ColumnVector) +
+                      sizeof(uint64_t) * validity_.capacity() +
+                      sizeof(int64_t) * int64_values_.capacity() +
+                      sizeof(double) * double_values_.capacity() +
+                      sizeof(uint64_t) * bool_values_.capacity() +
+                      sizeof(uint32_t) * string_codes_.capacity() +
+                      sizeof(Value) * dictionary_.capacity() +
+                      dictionary_byte_size_;
+  if (boxed_values_ != nullptr) {
+    byte_size += sizeof(Value) * boxed_values_->capacity();
+  }
+  return byte_size;
+}
+
+}  // namespace zetasql
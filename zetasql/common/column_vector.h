@@ -0,0 +1,121 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_COMMON_COLUMN_VECTOR_H_
+#define ZETASQL_COMMON_COLUMN_VECTOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include <cstdint>
+#include "absl/types/span.h"
+
+namespace zetasql {
+
+// An immutable column of values, used to hold the contents of in-memory
+// tables. Values of simple types are stored unboxed:
+// - Integers, DATEs and ENUMs are stored in an array of int64_t.
+// - FLOATs and DOUBLEs are stored in an array of doubles.
+// - BOOLs are stored in a bitmap.
+// - STRINGs and BYTES are dictionary-encoded: each distinct value is stored
+//   once as a Value, and each row stores the index of its value.
+// NULLs are tracked by a separate validity bitmap. Values of the other types
+// are stored as a std::vector<Value> (which may be shared with the caller).
+//
+// Unboxed values are materialized as zetasql::Values by GetValue(). STRINGs
+// and BYTES share the representation of their dictionary entry, so GetValue()
+// never allocates.
+class ColumnVector {
+ public:
+  // Returns a column holding a copy of 'values', which must all have type
+  // 'type'.
+  static std::unique_ptr<const ColumnVector> Create(
+      const Type* type, absl::Span<const Value> values);
+
+  // Returns a column that refers to 'values' without copying them.
+  static std::unique_ptr<const ColumnVector> CreateBoxed(
+      const Type* type, std::shared_ptr<const std::vector<Value>> values);
+
+  ColumnVector(const ColumnVector&) = delete;
+  ColumnVector& operator=(const ColumnVector&) = delete;
+
+  const Type* type() const { return type_; }
+  int64_t size() const { return size_; }
+
+  // Returns true if the values are not stored as zetasql::Values, in which
+  // case GetBoxedValue() cannot be called.
+  bool is_unboxed() const { return encoding_ != Encoding::kBoxed; }
+
+  // Returns the value of row 'i', which must be less than size().
+  Value GetValue(int64_t i) const;
+
+  // Returns the value of row 'i' without copying it. REQUIRES: !is_unboxed().
+  const Value& GetBoxedValue(int64_t i) const { return (*boxed_values_)[i]; }
+
+  // Returns all the values without copying them. REQUIRES: !is_unboxed().
+  const std::shared_ptr<const std::vector<Value>>& boxed_values() const {
+    return boxed_values_;
+  }
+
+  // Returns the approximate number of bytes used by this column, not counting
+  // the memory owned by boxed Values. The contents of the dictionary of a
+  // STRING or BYTES column are counted.
+  int64_t GetPhysicalByteSize() const;
+
+ private:
+  enum class Encoding { kBoxed, kInt64, kDouble, kBool, kString };
+
+  ColumnVector(const Type* type, Encoding encoding, int64_t size)
+      : type_(type), encoding_(encoding), size_(size) {}
+
+  bool IsValid(int64_t i) const { return GetBit(validity_, i); }
+
+  static bool GetBit(const std::vector<uint64_t>& bitmap, int64_t i) {
+    return (bitmap[i / 64] >> (i % 64)) & 1;
+  }
+  static void SetBit(int64_t i, std::vector<uint64_t>* bitmap) {
+    (*bitmap)[i / 64] |= uint64_t{1} << (i % 64);
+  }
+
+  const Type* type_;
+  const Encoding encoding_;
+  const int64_t size_;
+
+  // Used iff 'encoding_' is kBoxed.
+  std::shared_ptr<const std::vector<Value>> boxed_values_;
+
+  // Bit i is set if the value of row i is not NULL. Only used for unboxed
+  // encodings.
+  std::vector<uint64_t> validity_;
+
+  // The value of row i is in element i of the vector for 'encoding_'. The
+  // elements for NULL values are unspecified.
+  std::vector<int64_t> int64_values_;
+  std::vector<double> double_values_;
+  std::vector<uint64_t> bool_values_;  // A bitmap.
+
+  // For kString, row i holds the value 'dictionary_[string_codes_[i]]'.
+  // 'dictionary_byte_size_' is the total physical size of the dictionary.
+  std::vector<uint32_t> string_codes_;
+  std::vector<Value> dictionary_;
+  int64_t dictionary_byte_size_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_COMMON_COLUMN_VECTOR_H_
@@ -0,0 +1,112 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/common/column_vector.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "zetasql/testdata/test_schema.pb.h"
+
+namespace zetasql {
+namespace {
+
+// Returns the values of 'column'.
+std::vector<Value> GetValues(const ColumnVector& column) {
+  std::vector<Value> values;
+  for (int64_t i = 0; i < column.size(); ++i) {
+    values.push_back(column.GetValue(i));
+  }
+  return values;
+}
+
+TEST(ColumnVectorTest, UnboxedTypes) {
+  TypeFactory type_factory;
+  const EnumType* enum_type;
+  ZETASQL_ASSERT_OK(type_factory.MakeEnumType(zetasql_test::TestEnum_descriptor(),
+                                      &enum_type));
+
+  const std::vector<std::vector<Value>> columns = {
+      {values::Int32(-1), values::NullInt32(), values::Int32(3)},
+      {values::Int64(-1), values::Int64(int64_t{1} << 40), values::NullInt64()},
+      {values::Uint32(4000000000u), values::NullUint32()},
+      {values::Uint64(~uint64_t{0}), values::Uint64(0)},
+      {values::Date(17000), values::NullDate()},
+      {values::Enum(enum_type, 1), Value::Null(enum_type)},
+      {values::Float(1.5), values::NullFloat(), values::Float(-0.0)},
+      {values::Double(2.5), values::Double(std::numeric_limits<double>::max()),
+       values::NullDouble()},
+      // More than 64 rows cover multiple words of the bitmaps.
+      std::vector<Value>(70, values::True()),
+      {values::Bool(false), values::NullBool(), values::Bool(true)},
+      {values::String("a"), values::String(""), values::NullString(),
+       values::String("a"), values::String("bc")},
+      {values::Bytes("\xff"), values::Bytes("\xff"), values::NullBytes()},
+      {}};
+  for (const std::vector<Value>& column_values : columns) {
+    const Type* type =
+        column_values.empty() ? types::Int64Type() : column_values[0].type();
+    std::unique_ptr<const ColumnVector> column =
+        ColumnVector::Create(type, column_values);
+    EXPECT_TRUE(column->is_unboxed()) << type->DebugString();
+    EXPECT_EQ(column->type(), type);
+    EXPECT_EQ(column->size(), column_values.size());
+    EXPECT_EQ(GetValues(*column), column_values) << type->DebugString();
+  }
+}
+
+TEST(ColumnVectorTest, DictionaryEncodedStrings) {
+  std::vector<Value> column_values;
+  for (int i = 0; i < 1000; ++i) {
+    column_values.push_back(values::String(i % 2 == 0 ? "even" : "odd"));
+  }
+  std::unique_ptr<const ColumnVector> column =
+      ColumnVector::Create(types::StringType(), column_values);
+  EXPECT_EQ(GetValues(*column), column_values);
+  // Each row only stores the code of its string.
+  EXPECT_LT(column->GetPhysicalByteSize(), 10 * column_values.size());
+  // Rows with the same string share its representation.
+  EXPECT_EQ(column->GetValue(0).string_value().data(),
+            column->GetValue(2).string_value().data());
+}
+
+TEST(ColumnVectorTest, BoxedTypes) {
+  const std::vector<Value> column_values = {
+      values::Array(types::Int64ArrayType(), {values::Int64(1)}),
+      values::Null(types::Int64ArrayType())};
+  std::unique_ptr<const ColumnVector> column =
+      ColumnVector::Create(types::Int64ArrayType(), column_values);
+  EXPECT_FALSE(column->is_unboxed());
+  EXPECT_EQ(GetValues(*column), column_values);
+  EXPECT_EQ(column->GetBoxedValue(0), column_values[0]);
+
+  auto shared_values = std::make_shared<const std::vector<Value>>(
+      std::vector<Value>{values::Int64(1)});
+  std::unique_ptr<const ColumnVector> boxed_column =
+      ColumnVector::CreateBoxed(types::Int64Type(), shared_values);
+  EXPECT_FALSE(boxed_column->is_unboxed());
+  EXPECT_EQ(&boxed_column->GetBoxedValue(0), &(*shared_values)[0]);
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -67,13 +67,16 @@ class EvaluatorTestTable : public SimpleTable {
   CreateEvaluatorTableIterator(
       absl::Span<const int> column_idxs) const override {
     std::vector<const Column*> columns;
-    std::vector<std::shared_ptr<const std::vector<Value>>> column_values;
-    column_values.reserve(column_idxs.size());
+    std::vector<std::shared_ptr<const ColumnVector>> column_data;
+    std::vector<std::shared_ptr<const ColumnStatistics>> statistics;
+    column_data.reserve(column_idxs.size());
+    statistics.reserve(column_idxs.size());
     absl::flat_hash_set<int> scan_column_filter_idxs;
     for (int i = 0; i < column_idxs.size(); ++i) {
       const int column_idx = column_idxs[i];
       columns.push_back(GetColumn(column_idx));
-      column_values.push_back(column_major_contents()[column_idx]);
+      column_data.push_back(column_vectors()[column_idx]);
+      statistics.push_back(column_statistics()[column_idx]);
 
       if (column_filter_idxs_.contains(column_idx)) {
         ZETASQL_RET_CHECK(scan_column_filter_idxs.insert(i).second);
@@ -81,8 +84,8 @@ class EvaluatorTestTable : public SimpleTable {
     }
 
     return absl::make_unique<SimpleEvaluatorTableIterator>(
-        columns, column_values, end_status_, scan_column_filter_idxs,
-        cancel_cb_, set_deadline_cb_, clock_);
+        columns, column_data, statistics, end_status_,
+        scan_column_filter_idxs, cancel_cb_, set_deadline_cb_, clock_);
   }
 
  private:
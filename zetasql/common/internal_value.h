@@ -60,6 +60,14 @@ class InternalValue {
                                 std::move(values));
   }
 
+  // Returns the array built by 'builder', with the given 'order_kind'.
+  static Value BuildArray(Value::ArrayBuilder* builder,
+                          OrderPreservationKind order_kind) {
+    Value array = builder->Build();
+    array.order_kind_ = order_kind;
+    return array;
+  }
+
   // DEPRECATED: use ArrayNotChecked/ArrayChecked() instead. (For some reason,
   // there are forks of the reference implementation outside zetasql code that
   // are allowed to call this class.)
@@ -94,6 +102,15 @@ class InternalValue {
     if (x.type_kind() != TYPE_PROTO) return nullptr;
     return x.proto_ptr_;
   }
+
+  // Returns true if 'x' refers to memory allocated from an arena by a
+  // internal::ValueArenaScope.
+  static bool IsInArena(const Value& x) { return x.IsInArena(); }
+
+  // Returns a copy of 'x' that does not refer to memory allocated from an
+  // arena, so that it remains valid after the arena is reset. Returns 'x'
+  // itself if it is not in an arena.
+  static Value CopyOutOfArena(const Value& x) { return x.CopyOutOfArena(); }
 };
 
 }  // namespace zetasql
@@ -16,29 +16,201 @@
 
 #include "zetasql/common/simple_evaluator_table_iterator.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 
 ABSL_FLAG(int64_t, zetasql_simple_iterator_call_time_now_rows_period, 1000,
           "Only call zetasql_base::Clock::TimeNow() every this many rows");
 
 namespace zetasql {
 
+// Returns true if the values of 'type' have a total order under
+// Value::SqlLessThan() once NULLs and NaNs are excluded.
+static bool SupportsColumnStatistics(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_BOOL:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_STRING:
+    case TYPE_BYTES:
+    case TYPE_DATE:
+    case TYPE_TIMESTAMP:
+    case TYPE_TIME:
+    case TYPE_DATETIME:
+    case TYPE_NUMERIC:
+    case TYPE_BIGNUMERIC:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if 'value' cannot satisfy any ColumnFilter.
+static bool IsNullOrNaN(const Value& value) {
+  if (value.is_null()) return true;
+  switch (value.type_kind()) {
+    case TYPE_FLOAT:
+      return std::isnan(value.float_value());
+    case TYPE_DOUBLE:
+      return std::isnan(value.double_value());
+    default:
+      return false;
+  }
+}
+
+// Returns true if 'lhs' is known to be less than 'rhs'.
+static bool IsLess(const Value& lhs, const Value& rhs) {
+  return lhs.SqlLessThan(rhs) == values::True();
+}
+
+std::unique_ptr<const ColumnStatistics> ColumnStatistics::Create(
+    const Type* type, absl::Span<const Value> values, int64_t chunk_size) {
+  if (!SupportsColumnStatistics(type) || chunk_size <= 0) {
+    return nullptr;
+  }
+  auto statistics = absl::WrapUnique(new ColumnStatistics(chunk_size));
+  statistics->chunks_.reserve((values.size() + chunk_size - 1) / chunk_size);
+  for (int64_t begin = 0; begin < values.size(); begin += chunk_size) {
+    const int64_t end = std::min<int64_t>(begin + chunk_size, values.size());
+    Chunk chunk;
+    for (int64_t i = begin; i < end; ++i) {
+      const Value& value = values[i];
+      if (IsNullOrNaN(value)) {
+        ++chunk.null_count;
+        continue;
+      }
+      if (!chunk.min.is_valid() || IsLess(value, chunk.min)) {
+        chunk.min = value;
+      }
+      if (!chunk.max.is_valid() || IsLess(chunk.max, value)) {
+        chunk.max = value;
+      }
+    }
+    statistics->chunks_.push_back(std::move(chunk));
+  }
+  return std::move(statistics);
+}
+
+bool ColumnStatistics::ChunkMayMatch(const Chunk& chunk,
+                                     const ColumnFilter& filter) {
+  // Filters never match NULLs or NaNs.
+  if (!chunk.min.is_valid()) return false;
+
+  switch (filter.kind()) {
+    case ColumnFilter::kRange: {
+      const Value& lower_bound = filter.lower_bound();
+      const Value& upper_bound = filter.upper_bound();
+      if (lower_bound.is_valid() && IsLess(chunk.max, lower_bound)) {
+        return false;
+      }
+      if (upper_bound.is_valid() && IsLess(upper_bound, chunk.min)) {
+        return false;
+      }
+      return true;
+    }
+    case ColumnFilter::kInList:
+      for (const Value& element : filter.in_list()) {
+        if (!IsLess(element, chunk.min) && !IsLess(chunk.max, element)) {
+          return true;
+        }
+      }
+      return false;
+    default:
+      // We don't know anything about this filter.
+      return true;
+  }
+}
+
+std::vector<std::shared_ptr<const ColumnVector>>
+SimpleEvaluatorTableIterator::BoxColumns(
+    const std::vector<const Column*>& columns,
+    const std::vector<std::shared_ptr<const std::vector<Value>>>&
+        column_major_values) {
+  CHECK_EQ(columns.size(), column_major_values.size());
+  std::vector<std::shared_ptr<const ColumnVector>> column_data;
+  column_data.reserve(columns.size());
+  for (int i = 0; i < columns.size(); ++i) {
+    column_data.push_back(ColumnVector::CreateBoxed(columns[i]->GetType(),
+                                                    column_major_values[i]));
+  }
+  return column_data;
+}
+
+const Value& SimpleEvaluatorTableIterator::GetValueLocked(int i) const {
+  const ColumnVector& column_vector = *column_data_[i];
+  if (!column_vector.is_unboxed()) {
+    return column_vector.GetBoxedValue(row_idx_);
+  }
+  if (current_row_idxs_[i] != row_idx_) {
+    current_row_[i] = column_vector.GetValue(row_idx_);
+    current_row_idxs_[i] = row_idx_;
+  }
+  return current_row_[i];
+}
+
 absl::Status SimpleEvaluatorTableIterator::SetColumnFilterMap(
     absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map) {
   filter_map_.clear();
+  chunk_filters_.clear();
   for (auto& entry : filter_map) {
     if (filter_column_idxs_.contains(entry.first)) {
       ZETASQL_RET_CHECK(filter_map_.insert(std::move(entry)).second);
     }
   }
+
+  for (const auto& entry : filter_map_) {
+    if (column_statistics_.empty()) break;
+    ZETASQL_RET_CHECK_LT(entry.first, column_statistics_.size());
+    const ColumnStatistics* statistics = column_statistics_[entry.first].get();
+    if (statistics == nullptr) continue;
+
+    ChunkFilter chunk_filter;
+    chunk_filter.chunk_size = statistics->chunk_size();
+    chunk_filter.chunk_may_match.reserve(statistics->chunks().size());
+    bool prunes_chunks = false;
+    for (const ColumnStatistics::Chunk& chunk : statistics->chunks()) {
+      const bool may_match =
+          ColumnStatistics::ChunkMayMatch(chunk, *entry.second);
+      chunk_filter.chunk_may_match.push_back(may_match);
+      prunes_chunks |= !may_match;
+    }
+    if (prunes_chunks) {
+      chunk_filters_.push_back(std::move(chunk_filter));
+    }
+  }
   return absl::OkStatus();
 }
 
+int64_t SimpleEvaluatorTableIterator::SkipPrunedChunksLocked(
+    int64_t row_idx) const {
+  bool skipped = !chunk_filters_.empty();
+  while (skipped && row_idx < num_rows_) {
+    skipped = false;
+    for (const ChunkFilter& chunk_filter : chunk_filters_) {
+      const int64_t chunk_idx = row_idx / chunk_filter.chunk_size;
+      if (chunk_idx < chunk_filter.chunk_may_match.size() &&
+          !chunk_filter.chunk_may_match[chunk_idx]) {
+        row_idx = (chunk_idx + 1) * chunk_filter.chunk_size;
+        skipped = true;
+      }
+    }
+  }
+  return std::min(row_idx, num_rows_);
+}
+
 bool SimpleEvaluatorTableIterator::NextRow() {
   absl::MutexLock l(&mutex_);
   if (cancelled_) return false;
 
-  for (++row_idx_; row_idx_ < num_rows_; ++row_idx_) {
+  for (row_idx_ = SkipPrunedChunksLocked(row_idx_ + 1); row_idx_ < num_rows_;
+       row_idx_ = SkipPrunedChunksLocked(row_idx_ + 1)) {
     if ((row_idx_ %
              absl::GetFlag(
                  FLAGS_zetasql_simple_iterator_call_time_now_rows_period) ==
@@ -55,7 +227,7 @@ bool SimpleEvaluatorTableIterator::NextRow() {
       const int column_idx = entry.first;
       const std::unique_ptr<ColumnFilter>& filter = entry.second;
 
-      const Value& value = (*column_major_values_[column_idx])[row_idx_];
+      const Value& value = GetValueLocked(column_idx);
       switch (filter->kind()) {
         case ColumnFilter::kRange: {
           const Value& lower_bound = filter->lower_bound();
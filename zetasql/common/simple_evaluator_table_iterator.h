@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "zetasql/base/logging.h"
+#include "zetasql/common/column_vector.h"
 #include "zetasql/public/catalog.h"
 #include "zetasql/public/evaluator_table_iterator.h"
 #include "zetasql/public/type.h"
@@ -42,6 +43,47 @@
 
 namespace zetasql {
 
+// Statistics about the values of a column in chunks of consecutive rows (also
+// known as a zone map). For each chunk, we record the range of the values that
+// a ColumnFilter can match, and the number of values that it cannot match
+// (NULLs and NaNs). This allows SimpleEvaluatorTableIterator to skip the chunks
+// that cannot contain any row that satisfies a filter.
+class ColumnStatistics {
+ public:
+  static constexpr int64_t kDefaultChunkSize = 1024;
+
+  struct Chunk {
+    // The minimum and maximum non-NULL, non-NaN values in the chunk. Invalid
+    // if there are no such values.
+    Value min;
+    Value max;
+    // The number of NULL or NaN values in the chunk.
+    int64_t null_count = 0;
+  };
+
+  // Returns the statistics of 'values', which must all have type 'type', or
+  // nullptr if the values of 'type' are not supported.
+  static std::unique_ptr<const ColumnStatistics> Create(
+      const Type* type, absl::Span<const Value> values,
+      int64_t chunk_size = kDefaultChunkSize);
+
+  ColumnStatistics(const ColumnStatistics&) = delete;
+  ColumnStatistics& operator=(const ColumnStatistics&) = delete;
+
+  // Chunk i covers the rows [i * chunk_size(), (i + 1) * chunk_size()).
+  int64_t chunk_size() const { return chunk_size_; }
+  const std::vector<Chunk>& chunks() const { return chunks_; }
+
+  // Returns false if no value in 'chunk' can satisfy 'filter'.
+  static bool ChunkMayMatch(const Chunk& chunk, const ColumnFilter& filter);
+
+ private:
+  explicit ColumnStatistics(int64_t chunk_size) : chunk_size_(chunk_size) {}
+
+  const int64_t chunk_size_;
+  std::vector<Chunk> chunks_;
+};
+
 class SimpleEvaluatorTableIterator : public EvaluatorTableIterator {
  public:
   // 'columns' is a list of the columns in the scan.
@@ -63,18 +105,43 @@ class SimpleEvaluatorTableIterator : public EvaluatorTableIterator {
       const std::function<void()>& cancel_cb,
       const std::function<void(absl::Time)>& set_deadline_cb,
       zetasql_base::Clock* clock)
+      : SimpleEvaluatorTableIterator(
+            columns, BoxColumns(columns, column_major_values),
+            /*column_statistics=*/{}, end_status, filter_column_idxs,
+            cancel_cb, set_deadline_cb, clock) {}
+
+  // Same as above, but 'column_data[j]' holds the values of 'columns[j]', and
+  // 'column_statistics[j]' (which may be NULL) is used to skip the chunks of
+  // rows in which the values of 'columns[j]' cannot satisfy a filter.
+  // 'column_statistics' may be empty, or have one entry per column. Unboxed
+  // values are only materialized for the columns passed to GetValue() (and
+  // the filtered columns).
+  SimpleEvaluatorTableIterator(
+      const std::vector<const Column*>& columns,
+      const std::vector<std::shared_ptr<const ColumnVector>>& column_data,
+      const std::vector<std::shared_ptr<const ColumnStatistics>>&
+          column_statistics,
+      const absl::Status& end_status,
+      const absl::flat_hash_set<int>& filter_column_idxs,
+      const std::function<void()>& cancel_cb,
+      const std::function<void(absl::Time)>& set_deadline_cb,
+      zetasql_base::Clock* clock)
       : columns_(columns),
+        column_statistics_(column_statistics),
         end_status_(end_status),
         filter_column_idxs_(filter_column_idxs),
         cancel_cb_(cancel_cb),
         set_deadline_cb_(set_deadline_cb),
-        column_major_values_(column_major_values),
-        num_rows_(
-            column_major_values_.empty() ? 0 : column_major_values_[0]->size()),
+        column_data_(column_data),
+        num_rows_(column_data_.empty() ? 0 : column_data_[0]->size()),
+        current_row_(column_data_.size()),
+        current_row_idxs_(column_data_.size(), -1),
         clock_(clock) {
-    CHECK_EQ(columns.size(), column_major_values_.size());
-    for (const auto& values_for_column : column_major_values_) {
-      CHECK_EQ(num_rows_, values_for_column->size());
+    CHECK_EQ(columns.size(), column_data_.size());
+    CHECK(column_statistics_.empty() ||
+          column_statistics_.size() == columns.size());
+    for (const auto& column_vector : column_data_) {
+      CHECK_EQ(num_rows_, column_vector->size());
     }
   }
 
@@ -99,8 +166,8 @@ class SimpleEvaluatorTableIterator : public EvaluatorTableIterator {
   bool NextRow() override;
 
   const Value& GetValue(int i) const override {
-    absl::ReaderMutexLock l(&mutex_);
-    return (*column_major_values_[i])[row_idx_];
+    absl::MutexLock l(&mutex_);
+    return GetValueLocked(i);
   }
 
   absl::Status Status() const override {
@@ -131,12 +198,33 @@ class SimpleEvaluatorTableIterator : public EvaluatorTableIterator {
   }
 
  private:
+  static std::vector<std::shared_ptr<const ColumnVector>> BoxColumns(
+      const std::vector<const Column*>& columns,
+      const std::vector<std::shared_ptr<const std::vector<Value>>>&
+          column_major_values);
+
   bool DoneLocked() const ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
-    if (column_major_values_.empty()) return true;
+    if (column_data_.empty()) return true;
     return row_idx_ >= num_rows_;
   }
 
+  // Returns the value of column 'i' in the current row, materializing it if
+  // necessary.
+  const Value& GetValueLocked(int i) const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns the first row at or after 'row_idx' that is not in a chunk ruled
+  // out by 'chunk_filters_'.
+  int64_t SkipPrunedChunksLocked(int64_t row_idx) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  // Records which chunks of a column may satisfy the filter on that column.
+  struct ChunkFilter {
+    int64_t chunk_size;
+    std::vector<bool> chunk_may_match;
+  };
+
   const std::vector<const Column*> columns_;
+  const std::vector<std::shared_ptr<const ColumnStatistics>> column_statistics_;
   const absl::Status end_status_;
   const absl::flat_hash_set<int> filter_column_idxs_;
   const std::function<void()> cancel_cb_;
@@ -144,10 +232,15 @@ class SimpleEvaluatorTableIterator : public EvaluatorTableIterator {
 
   mutable absl::Mutex mutex_;
 
-  std::vector<std::shared_ptr<const std::vector<Value>>> column_major_values_
+  std::vector<std::shared_ptr<const ColumnVector>> column_data_
       ABSL_GUARDED_BY(mutex_);
   int64_t num_rows_ ABSL_GUARDED_BY(mutex_);
 
+  // 'current_row_[i]' holds the materialized value of unboxed column i in row
+  // 'current_row_idxs_[i]'.
+  mutable std::vector<Value> current_row_ ABSL_GUARDED_BY(mutex_);
+  mutable std::vector<int64_t> current_row_idxs_ ABSL_GUARDED_BY(mutex_);
+
   int64_t row_idx_ ABSL_GUARDED_BY(mutex_) = -1;
   bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
   bool deadline_exceeded_ ABSL_GUARDED_BY(mutex_) = false;
@@ -157,6 +250,8 @@ class SimpleEvaluatorTableIterator : public EvaluatorTableIterator {
   // Contains the entries passed to 'filter_map' that are in
   // 'filter_column_idxs_'.
   absl::flat_hash_map<int, std::unique_ptr<ColumnFilter>> filter_map_;
+  // One entry for each filter in 'filter_map_' on a column with statistics.
+  std::vector<ChunkFilter> chunk_filters_;
 };
 
 }  // namespace zetasql
@@ -17,6 +17,7 @@
 #include "zetasql/common/simple_evaluator_table_iterator.h"
 
 #include <algorithm>
+#include <cmath>
 #include <tuple>
 #include <type_traits>
 
@@ -37,9 +38,13 @@ using testing::ElementsAre;
 using testing::IsEmpty;
 using zetasql_base::testing::IsOkAndHolds;
 
+using types::DoubleType;
 using types::Int64Type;
 
+using values::Double;
 using values::Int64;
+using values::NullDouble;
+using values::NullInt64;
 
 // Fixture for tests of SimpleEvaluatorTableIterator::SetColumnFilters().
 class ColumnFilterTest : public ::testing::Test {
@@ -65,16 +70,18 @@ class ColumnFilterTest : public ::testing::Test {
         {Int64(10), Int64(20), Int64(30), Int64(40)},
         {Int64(100), Int64(200), Int64(300), Int64(400)}};
 
-    std::vector<std::shared_ptr<const std::vector<Value>>>
-        column_major_values_for_iter;
-    column_major_values_for_iter.reserve(column_major_values.size());
+    std::vector<std::shared_ptr<const ColumnVector>> column_data;
+    std::vector<std::shared_ptr<const ColumnStatistics>> column_statistics;
+    column_data.reserve(column_major_values.size());
     for (const std::vector<Value>& values : column_major_values) {
-      column_major_values_for_iter.push_back(
-          std::make_shared<const std::vector<Value>>(values));
+      column_data.push_back(ColumnVector::Create(Int64Type(), values));
+      // Use small chunks so that the filters also skip whole chunks.
+      column_statistics.push_back(
+          ColumnStatistics::Create(Int64Type(), values, /*chunk_size=*/2));
     }
 
     iter_ = absl::WrapUnique(new SimpleEvaluatorTableIterator(
-        columns, column_major_values_for_iter,
+        columns, column_data, column_statistics,
         /*end_status=*/absl::OkStatus(), filter_column_idxs,
         /*cancel_cb=*/[]() {}, /*set_deadline_cb=*/[](absl::Time) {},
         zetasql_base::Clock::RealClock()));
@@ -200,5 +207,105 @@ TEST_F(ColumnFilterTest, DeletionsInThreeColumnsOnlyRespectTwo) {
                                ElementsAre(Int64(4), Int64(40), Int64(400)))));
 }
 
+TEST(SimpleEvaluatorTableIteratorTest, BoxedValues) {
+  const SimpleColumn column("TestTable", "column", Int64Type());
+  auto values = std::make_shared<const std::vector<Value>>(
+      std::vector<Value>{Int64(1), NullInt64()});
+  SimpleEvaluatorTableIterator iter(
+      {&column}, {values}, /*end_status=*/absl::OkStatus(),
+      /*filter_column_idxs=*/{}, /*cancel_cb=*/[]() {},
+      /*set_deadline_cb=*/[](absl::Time) {}, zetasql_base::Clock::RealClock());
+  ASSERT_TRUE(iter.NextRow());
+  // Boxed values are returned without copying them.
+  EXPECT_EQ(&iter.GetValue(0), &(*values)[0]);
+  ASSERT_TRUE(iter.NextRow());
+  EXPECT_EQ(iter.GetValue(0), NullInt64());
+  EXPECT_FALSE(iter.NextRow());
+  ZETASQL_EXPECT_OK(iter.Status());
+}
+
+// Exposes the protected accessors of SimpleTable.
+class SimpleTableWithContents : public SimpleTable {
+ public:
+  using SimpleTable::SimpleTable;
+  using SimpleTable::column_major_contents;
+  using SimpleTable::column_vectors;
+};
+
+TEST(SimpleEvaluatorTableIteratorTest, SimpleTableContents) {
+  SimpleTableWithContents table("TestTable", {{"column", Int64Type()}});
+  table.SetContents({{Int64(1)}, {NullInt64()}});
+  ASSERT_EQ(table.column_vectors().size(), 1);
+  EXPECT_TRUE(table.column_vectors()[0]->is_unboxed());
+  // The Values are materialized for subclasses that read them directly.
+  ASSERT_EQ(table.column_major_contents().size(), 1);
+  EXPECT_THAT(*table.column_major_contents()[0],
+              ElementsAre(Int64(1), NullInt64()));
+
+  table.SetContents({{Int64(2)}});
+  EXPECT_THAT(*table.column_major_contents()[0], ElementsAre(Int64(2)));
+}
+
+TEST(ColumnStatisticsTest, Chunks) {
+  const std::vector<Value> values = {Int64(3), Int64(1), NullInt64(),
+                                     NullInt64(), Int64(7)};
+  std::unique_ptr<const ColumnStatistics> statistics =
+      ColumnStatistics::Create(Int64Type(), values, /*chunk_size=*/2);
+  ASSERT_NE(statistics, nullptr);
+  EXPECT_EQ(statistics->chunk_size(), 2);
+  ASSERT_EQ(statistics->chunks().size(), 3);
+
+  const ColumnStatistics::Chunk& chunk0 = statistics->chunks()[0];
+  EXPECT_EQ(chunk0.min, Int64(1));
+  EXPECT_EQ(chunk0.max, Int64(3));
+  EXPECT_EQ(chunk0.null_count, 0);
+
+  const ColumnStatistics::Chunk& chunk1 = statistics->chunks()[1];
+  EXPECT_FALSE(chunk1.min.is_valid());
+  EXPECT_FALSE(chunk1.max.is_valid());
+  EXPECT_EQ(chunk1.null_count, 2);
+
+  const ColumnStatistics::Chunk& chunk2 = statistics->chunks()[2];
+  EXPECT_EQ(chunk2.min, Int64(7));
+  EXPECT_EQ(chunk2.max, Int64(7));
+
+  // Struct values are not ordered.
+  TypeFactory type_factory;
+  const StructType* struct_type;
+  ZETASQL_ASSERT_OK(
+      type_factory.MakeStructType({{"a", Int64Type()}}, &struct_type));
+  EXPECT_EQ(ColumnStatistics::Create(struct_type, {}), nullptr);
+}
+
+TEST(ColumnStatisticsTest, ChunkMayMatch) {
+  const std::vector<Value> values = {Double(1), Double(std::nan("")),
+                                     Double(5), NullDouble()};
+  std::unique_ptr<const ColumnStatistics> statistics =
+      ColumnStatistics::Create(DoubleType(), values, /*chunk_size=*/4);
+  ASSERT_NE(statistics, nullptr);
+  ASSERT_EQ(statistics->chunks().size(), 1);
+  const ColumnStatistics::Chunk& chunk = statistics->chunks()[0];
+  EXPECT_EQ(chunk.min, Double(1));
+  EXPECT_EQ(chunk.max, Double(5));
+  EXPECT_EQ(chunk.null_count, 2);
+
+  auto may_match = [&chunk](const ColumnFilter& filter) {
+    return ColumnStatistics::ChunkMayMatch(chunk, filter);
+  };
+  EXPECT_TRUE(may_match(ColumnFilter(Value(), Value())));
+  EXPECT_TRUE(may_match(ColumnFilter(Double(5), Value())));
+  EXPECT_FALSE(may_match(ColumnFilter(Double(5.5), Value())));
+  EXPECT_TRUE(may_match(ColumnFilter(Value(), Double(1))));
+  EXPECT_FALSE(may_match(ColumnFilter(Value(), Double(0.5))));
+  EXPECT_TRUE(may_match(ColumnFilter(Double(2), Double(3))));
+  // Comparisons between INT64 and DOUBLE are allowed.
+  EXPECT_FALSE(may_match(ColumnFilter(Int64(6), Int64(8))));
+
+  EXPECT_FALSE(may_match(ColumnFilter(std::vector<Value>{})));
+  EXPECT_TRUE(may_match(ColumnFilter(std::vector<Value>{Double(3)})));
+  EXPECT_FALSE(
+      may_match(ColumnFilter(std::vector<Value>{Double(0), Double(6)})));
+}
+
 }  // namespace
 }  // namespace zetasql
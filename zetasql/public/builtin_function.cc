@@ -19,6 +19,7 @@
 #include <ctype.h>
 
 #include <algorithm>
+#include <deque>
 #include <memory>
 #include <set>
 #include <utility>
@@ -35,10 +36,12 @@
 #include "zetasql/public/value.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
 #include "zetasql/base/case.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
@@ -125,6 +128,75 @@ void GetZetaSQLFunctions(TypeFactory* type_factory,
   }
 }
 
+BuiltinFunctionTable::BuiltinFunctionTable(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  GetZetaSQLFunctions(&type_factory_, options, &owned_functions_);
+  functions_.reserve(owned_functions_.size());
+  for (const auto& entry : owned_functions_) {
+    functions_.push_back(entry.second.get());
+  }
+}
+
+std::string BuiltinFunctionTable::Fingerprint(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  ZetaSQLBuiltinFunctionOptionsProto proto;
+  LanguageOptions language_options;
+  language_options.SetEnabledLanguageFeatures(
+      options.language_options.GetEnabledLanguageFeatures());
+  language_options.set_product_mode(options.language_options.product_mode());
+  language_options.Serialize(proto.mutable_language_options());
+  // The sets are unordered, so sort them to get the same fingerprint for
+  // equal sets.
+  std::vector<FunctionSignatureId> ids(options.include_function_ids.begin(),
+                                       options.include_function_ids.end());
+  std::sort(ids.begin(), ids.end());
+  for (FunctionSignatureId id : ids) {
+    proto.add_include_function_ids(id);
+  }
+  ids.assign(options.exclude_function_ids.begin(),
+             options.exclude_function_ids.end());
+  std::sort(ids.begin(), ids.end());
+  for (FunctionSignatureId id : ids) {
+    proto.add_exclude_function_ids(id);
+  }
+  return proto.SerializeAsString();
+}
+
+constexpr int BuiltinFunctionTable::kMaxCachedTables;
+
+std::shared_ptr<const BuiltinFunctionTable> BuiltinFunctionTable::Get(
+    const ZetaSQLBuiltinFunctionOptions& options) {
+  static absl::Mutex* mutex = new absl::Mutex;
+  static auto* tables =
+      new absl::flat_hash_map<std::string,
+                              std::shared_ptr<const BuiltinFunctionTable>>;
+  // The fingerprints in 'tables', from the oldest to the newest.
+  static auto* fingerprints = new std::deque<std::string>;
+  const std::string fingerprint = Fingerprint(options);
+  {
+    absl::ReaderMutexLock l(mutex);
+    auto it = tables->find(fingerprint);
+    if (it != tables->end()) {
+      return it->second;
+    }
+  }
+
+  // Build the table without holding the lock, so that lookups of other
+  // options are not blocked. If another thread builds the same table first,
+  // this one is discarded.
+  auto table = std::make_shared<const BuiltinFunctionTable>(options);
+  absl::MutexLock l(mutex);
+  auto result = tables->emplace(fingerprint, std::move(table));
+  if (result.second) {
+    fingerprints->push_back(fingerprint);
+    if (fingerprints->size() > static_cast<size_t>(kMaxCachedTables)) {
+      tables->erase(fingerprints->front());
+      fingerprints->pop_front();
+    }
+  }
+  return result.first->second;
+}
+
 bool FunctionMayHaveUnintendedArgumentCoercion(const Function* function) {
   if (function->NumSignatures() == 0 ||
       !function->ArgumentsAreCoercible()) {
@@ -20,7 +20,9 @@
 #include <stddef.h>
 
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "zetasql/proto/options.pb.h"
 #include "zetasql/public/builtin_function.pb.h"
@@ -48,6 +50,47 @@ void GetZetaSQLFunctions(
     TypeFactory* type_factory, const ZetaSQLBuiltinFunctionOptions& options,
     std::map<std::string, std::unique_ptr<Function>>* functions);
 
+// An immutable set of the built-in ZetaSQL functions for one
+// ZetaSQLBuiltinFunctionOptions, which can be shared by any number of
+// catalogs and threads. Building the functions and their signatures is
+// expensive, so processes that create many catalogs should share the table
+// returned by Get() instead of calling GetZetaSQLFunctions() for each one.
+// SimpleCatalog::AddZetaSQLFunctions() does this.
+class BuiltinFunctionTable {
+ public:
+  // Returns the table for 'options'. The table is built the first time it is
+  // requested for equivalent options, and kept in a process-wide cache of the
+  // kMaxCachedTables most recently built tables. Tables evicted from the cache
+  // live as long as the returned pointers, so callers that use many distinct
+  // options only retain the tables they still use. This is thread-safe.
+  static std::shared_ptr<const BuiltinFunctionTable> Get(
+      const ZetaSQLBuiltinFunctionOptions& options);
+
+  // The maximum number of tables kept by Get() for future calls.
+  static constexpr int kMaxCachedTables = 16;
+
+  // Builds a table that is not shared. Its types are owned by the table, so it
+  // must outlive every use of its functions.
+  explicit BuiltinFunctionTable(const ZetaSQLBuiltinFunctionOptions& options);
+  BuiltinFunctionTable(const BuiltinFunctionTable&) = delete;
+  BuiltinFunctionTable& operator=(const BuiltinFunctionTable&) = delete;
+
+  // Returns the functions, sorted by name.
+  const std::vector<const Function*>& functions() const { return functions_; }
+
+  // Returns the key that identifies equivalent 'options' in Get(). Only the
+  // parts of the LanguageOptions that affect which functions and signatures
+  // are built (the enabled features and the product mode) are included, so
+  // e.g. options that only differ in their supported statement kinds share a
+  // table.
+  static std::string Fingerprint(const ZetaSQLBuiltinFunctionOptions& options);
+
+ private:
+  TypeFactory type_factory_;
+  std::map<std::string, std::unique_ptr<Function>> owned_functions_;
+  std::vector<const Function*> functions_;
+};
+
 // If the function allows argument coercion, then checks the function
 // signatures to see if they are defined for floating point and
 // only one of signed/unsigned integer arguments (but not both integer
@@ -426,6 +426,60 @@ TEST(SimpleBuiltinFunctionTests, LanguageOptions) {
   EXPECT_FALSE(zetasql_base::ContainsKey(functions, FunctionSignatureIdToName(FN_LEAD)));
 }
 
+TEST(SimpleBuiltinFunctionTests, BuiltinFunctionTable) {
+  ZetaSQLBuiltinFunctionOptions options{LanguageOptions()};
+  options.include_function_ids.insert(FN_MAX);
+  options.include_function_ids.insert(FN_COUNT);
+  const std::shared_ptr<const BuiltinFunctionTable> table =
+      BuiltinFunctionTable::Get(options);
+
+  TypeFactory type_factory;
+  NameToFunctionMap functions;
+  GetZetaSQLFunctions(&type_factory, options, &functions);
+  std::vector<std::string> expected_names;
+  for (const auto& entry : functions) {
+    expected_names.push_back(entry.second->Name());
+  }
+  std::vector<std::string> names;
+  for (const Function* function : table->functions()) {
+    names.push_back(function->Name());
+  }
+  EXPECT_EQ(names, expected_names);
+
+  // Equivalent options share the table, regardless of the order of the ids.
+  ZetaSQLBuiltinFunctionOptions same_options{LanguageOptions()};
+  same_options.include_function_ids.insert(FN_COUNT);
+  same_options.include_function_ids.insert(FN_MAX);
+  EXPECT_EQ(BuiltinFunctionTable::Get(same_options), table);
+
+  // LanguageOptions that do not affect the functions are ignored.
+  same_options.language_options.SetSupportedStatementKinds(
+      {RESOLVED_QUERY_STMT, RESOLVED_INSERT_STMT});
+  same_options.language_options.set_error_on_deprecated_syntax(true);
+  EXPECT_EQ(BuiltinFunctionTable::Get(same_options), table);
+
+  ZetaSQLBuiltinFunctionOptions other_options{LanguageOptions()};
+  other_options.include_function_ids.insert(FN_MAX);
+  EXPECT_NE(BuiltinFunctionTable::Get(other_options), table);
+  other_options.include_function_ids.insert(FN_COUNT);
+  other_options.language_options.EnableLanguageFeature(
+      FEATURE_ANALYTIC_FUNCTIONS);
+  EXPECT_NE(BuiltinFunctionTable::Get(other_options), table);
+  other_options.language_options = LanguageOptions();
+  other_options.language_options.set_product_mode(PRODUCT_EXTERNAL);
+  EXPECT_NE(BuiltinFunctionTable::Get(other_options), table);
+
+  // The cache is bounded, but evicted tables stay alive while they are used.
+  for (int i = 0; i < BuiltinFunctionTable::kMaxCachedTables; ++i) {
+    ZetaSQLBuiltinFunctionOptions evicting_options{LanguageOptions()};
+    evicting_options.include_function_ids.insert(
+        static_cast<FunctionSignatureId>(FN_MAX + i + 1));
+    BuiltinFunctionTable::Get(evicting_options);
+  }
+  EXPECT_NE(BuiltinFunctionTable::Get(options), table);
+  EXPECT_EQ(table->functions().size(), 2);
+}
+
 TEST(SimpleBuiltinFunctionTests, NumericFunctions) {
   TypeFactory type_factory;
   NameToFunctionMap functions;
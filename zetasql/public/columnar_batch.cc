@@ -0,0 +1,285 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/columnar_batch.h"
+
+#include <limits>
+#include <string>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/numeric_value.h"
+#include "absl/base/casts.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "zetasql/base/endian.h"
+#include "zetasql/base/status_builder.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+namespace {
+
+// STRING and BYTES columns are full once they hold this many bytes, so that
+// the next value is very unlikely to overflow the int32 offsets.
+constexpr int64_t kMaxStringBytes = int64_t{1} << 30;
+
+// Sets bit 'row' of 'bitmap' to 'bit', growing the bitmap if needed. Rows must
+// be set in order.
+void AppendBit(int64_t row, bool bit, std::vector<uint8_t>* bitmap) {
+  if (row % 8 == 0) {
+    bitmap->push_back(0);
+  }
+  if (bit) {
+    bitmap->back() |= static_cast<uint8_t>(1 << (row % 8));
+  }
+}
+
+bool GetBit(const std::vector<uint8_t>& bitmap, int64_t row) {
+  return (bitmap[row / 8] >> (row % 8)) & 1;
+}
+
+void AppendUint32(uint32_t value, std::vector<uint8_t>* values) {
+  values->resize(values->size() + sizeof(value));
+  zetasql_base::LittleEndian::Store32(values->data() + values->size() - sizeof(value),
+                              value);
+}
+
+void AppendUint64(uint64_t value, std::vector<uint8_t>* values) {
+  values->resize(values->size() + sizeof(value));
+  zetasql_base::LittleEndian::Store64(values->data() + values->size() - sizeof(value),
+                              value);
+}
+
+uint32_t GetUint32(const std::vector<uint8_t>& values, int64_t row) {
+  return zetasql_base::LittleEndian::Load32(values.data() + row * sizeof(uint32_t));
+}
+
+uint64_t GetUint64(const std::vector<uint8_t>& values, int64_t row) {
+  return zetasql_base::LittleEndian::Load64(values.data() + row * sizeof(uint64_t));
+}
+
+bool IsStringLike(const Type* type) {
+  return type->kind() == TYPE_STRING || type->kind() == TYPE_BYTES;
+}
+
+}  // namespace
+
+bool ColumnarBatch::SupportsType(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_BOOL:
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_NUMERIC:
+    case TYPE_DATE:
+    case TYPE_TIMESTAMP:
+    case TYPE_STRING:
+    case TYPE_BYTES:
+    case TYPE_ENUM:
+      return true;
+    default:
+      return false;
+  }
+}
+
+absl::Status ColumnarBatch::Reset(absl::Span<const Type* const> types) {
+  for (const Type* type : types) {
+    if (!SupportsType(type)) {
+      return zetasql_base::UnimplementedErrorBuilder()
+             << "ColumnarBatch does not support type "
+             << type->ShortTypeName(PRODUCT_EXTERNAL);
+    }
+  }
+  columns_.resize(types.size());
+  for (int i = 0; i < types.size(); ++i) {
+    Column& column = columns_[i];
+    column.type = types[i];
+    column.null_count = 0;
+    column.validity.clear();
+    column.values.clear();
+    column.offsets.clear();
+    if (IsStringLike(column.type)) {
+      column.offsets.push_back(0);
+    }
+  }
+  num_rows_ = 0;
+  return absl::OkStatus();
+}
+
+absl::Status ColumnarBatch::Append(int i, const Value& value) {
+  Column& column = columns_[i];
+  DCHECK(value.type()->Equals(column.type));
+  const bool is_null = value.is_null();
+  // Check the values that cannot be stored before modifying the column.
+  int64_t timestamp = 0;
+  if (!is_null && column.type->kind() == TYPE_TIMESTAMP) {
+    if (timestamp_unit_ == kNanoseconds) {
+      ZETASQL_RETURN_IF_ERROR(value.ToUnixNanos(&timestamp));
+    } else {
+      timestamp = value.ToUnixMicros();
+    }
+  }
+  if (!is_null && IsStringLike(column.type)) {
+    const int64_t str_size = column.type->kind() == TYPE_STRING
+                                 ? value.string_value().size()
+                                 : value.bytes_value().size();
+    if (column.values.size() + str_size >
+        std::numeric_limits<int32_t>::max()) {
+      return zetasql_base::OutOfRangeErrorBuilder()
+             << "ColumnarBatch column " << i << " cannot hold more than "
+             << std::numeric_limits<int32_t>::max() << " bytes";
+    }
+  }
+  AppendBit(num_rows_, !is_null, &column.validity);
+  if (is_null) {
+    ++column.null_count;
+  }
+  switch (column.type->kind()) {
+    case TYPE_BOOL:
+      AppendBit(num_rows_, !is_null && value.bool_value(), &column.values);
+      break;
+    case TYPE_INT32:
+      AppendUint32(is_null ? 0 : value.int32_value(), &column.values);
+      break;
+    case TYPE_ENUM:
+      AppendUint32(is_null ? 0 : value.enum_value(), &column.values);
+      break;
+    case TYPE_DATE:
+      AppendUint32(is_null ? 0 : value.date_value(), &column.values);
+      break;
+    case TYPE_UINT32:
+      AppendUint32(is_null ? 0 : value.uint32_value(), &column.values);
+      break;
+    case TYPE_FLOAT:
+      AppendUint32(is_null ? 0 : absl::bit_cast<uint32_t>(value.float_value()),
+                   &column.values);
+      break;
+    case TYPE_INT64:
+      AppendUint64(is_null ? 0 : value.int64_value(), &column.values);
+      break;
+    case TYPE_TIMESTAMP:
+      AppendUint64(timestamp, &column.values);
+      break;
+    case TYPE_UINT64:
+      AppendUint64(is_null ? 0 : value.uint64_value(), &column.values);
+      break;
+    case TYPE_DOUBLE:
+      AppendUint64(is_null ? 0 : absl::bit_cast<uint64_t>(value.double_value()),
+                   &column.values);
+      break;
+    case TYPE_NUMERIC: {
+      // Arrow decimals are 128-bit two's complement integers, low word first.
+      const NumericValue numeric =
+          is_null ? NumericValue() : value.numeric_value();
+      AppendUint64(numeric.low_bits(), &column.values);
+      AppendUint64(numeric.high_bits(), &column.values);
+      break;
+    }
+    case TYPE_STRING:
+    case TYPE_BYTES: {
+      if (!is_null) {
+        const std::string& str = column.type->kind() == TYPE_STRING
+                                     ? value.string_value()
+                                     : value.bytes_value();
+        column.values.insert(column.values.end(), str.begin(), str.end());
+      }
+      column.offsets.push_back(column.values.size());
+      break;
+    }
+    default:
+      LOG(FATAL) << "Unsupported type in ColumnarBatch: "
+                 << column.type->DebugString();
+  }
+  return absl::OkStatus();
+}
+
+bool ColumnarBatch::IsFull() const {
+  for (const Column& column : columns_) {
+    if (IsStringLike(column.type) && column.values.size() >= kMaxStringBytes) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Value ColumnarBatch::GetValue(int i, int64_t row) const {
+  const Column& column = columns_[i];
+  if (!GetBit(column.validity, row)) {
+    return Value::Null(column.type);
+  }
+  switch (column.type->kind()) {
+    case TYPE_BOOL:
+      return Value::Bool(GetBit(column.values, row));
+    case TYPE_INT32:
+      return Value::Int32(GetUint32(column.values, row));
+    case TYPE_ENUM:
+      return Value::Enum(column.type->AsEnum(),
+                         static_cast<int32_t>(GetUint32(column.values, row)));
+    case TYPE_DATE:
+      return Value::Date(GetUint32(column.values, row));
+    case TYPE_UINT32:
+      return Value::Uint32(GetUint32(column.values, row));
+    case TYPE_FLOAT:
+      return Value::Float(absl::bit_cast<float>(GetUint32(column.values, row)));
+    case TYPE_INT64:
+      return Value::Int64(GetUint64(column.values, row));
+    case TYPE_TIMESTAMP: {
+      const int64_t timestamp = GetUint64(column.values, row);
+      return Value::Timestamp(timestamp_unit_ == kNanoseconds
+                                  ? absl::FromUnixNanos(timestamp)
+                                  : absl::FromUnixMicros(timestamp));
+    }
+    case TYPE_UINT64:
+      return Value::Uint64(GetUint64(column.values, row));
+    case TYPE_DOUBLE:
+      return Value::Double(
+          absl::bit_cast<double>(GetUint64(column.values, row)));
+    case TYPE_NUMERIC: {
+      zetasql_base::StatusOr<NumericValue> numeric = NumericValue::FromHighAndLowBits(
+          GetUint64(column.values, 2 * row + 1),
+          GetUint64(column.values, 2 * row));
+      DCHECK(numeric.ok()) << numeric.status();
+      return Value::Numeric(numeric.value());
+    }
+    case TYPE_STRING:
+    case TYPE_BYTES: {
+      const absl::string_view str(
+          reinterpret_cast<const char*>(column.values.data()) +
+              column.offsets[row],
+          column.offsets[row + 1] - column.offsets[row]);
+      return column.type->kind() == TYPE_STRING ? Value::String(str)
+                                                : Value::Bytes(str);
+    }
+    default:
+      LOG(FATAL) << "Unsupported type in ColumnarBatch: "
+                 << column.type->DebugString();
+  }
+}
+
+int64_t ColumnarBatch::GetByteSize() const {
+  int64_t size = 0;
+  for (const Column& column : columns_) {
+    size += column.validity.size() + column.values.size() +
+            column.offsets.size() * sizeof(int32_t);
+  }
+  return size;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,145 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_COLUMNAR_BATCH_H_
+#define ZETASQL_PUBLIC_COLUMNAR_BATCH_H_
+
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include <cstdint>
+#include "absl/types/span.h"
+#include "zetasql/base/status.h"
+
+namespace zetasql {
+
+// A batch of rows stored column by column, in the memory layout of the Apache
+// Arrow columnar format (https://arrow.apache.org/docs/format/Columnar.html).
+// The buffers of a column can be handed to an Arrow array, or written to
+// another process, without converting every Value.
+//
+// Each column has a validity bitmap and one or two data buffers. Bitmaps are
+// LSB-first: the bit for row i is (bitmap[i / 8] >> (i % 8)) & 1. All fixed
+// width values are little-endian. The supported types and their Arrow
+// equivalents are:
+//   BOOL               boolean      (bitmap in 'values')
+//   INT32, ENUM        int32        (the enum number)
+//   INT64              int64
+//   UINT32             uint32
+//   UINT64             uint64
+//   FLOAT              float32
+//   DOUBLE             float64
+//   NUMERIC            decimal128(38, 9)
+//   DATE               date32       (days since 1970-01-01)
+//   TIMESTAMP          timestamp[us, tz=UTC] by default, or
+//                      timestamp[ns, tz=UTC] (see set_timestamp_unit())
+//   STRING             utf8         (int32 offsets)
+//   BYTES              binary       (int32 offsets)
+// Other types cannot be stored in a ColumnarBatch.
+//
+// Example:
+//   ColumnarBatch batch;
+//   while (true) {
+//     ZETASQL_RETURN_IF_ERROR(iter->NextColumnarBatch(/*max_rows=*/4096, &batch));
+//     if (batch.num_rows() == 0) break;
+//     ... Send 'batch.column(i)' downstream ...
+//   }
+class ColumnarBatch {
+ public:
+  struct Column {
+    const Type* type = nullptr;
+    int64_t null_count = 0;
+    // Bit i is set if row i is not NULL.
+    std::vector<uint8_t> validity;
+    // For BOOL, a bitmap like 'validity'. For STRING and BYTES, the contents of
+    // all the rows, one after another. Otherwise, one fixed width value per
+    // row. NULL rows are zero or empty.
+    std::vector<uint8_t> values;
+    // Only used for STRING and BYTES. Row i is the bytes in 'values' from
+    // 'offsets[i]' up to 'offsets[i + 1]'. Has num_rows() + 1 elements.
+    std::vector<int32_t> offsets;
+  };
+
+  // The unit of the int64 values of TIMESTAMP columns.
+  enum TimestampUnit {
+    // Covers the whole TIMESTAMP range. Drops any nanoseconds.
+    kMicroseconds,
+    // Only covers the years 1677 to 2262.
+    kNanoseconds,
+  };
+
+  ColumnarBatch() {}
+  ColumnarBatch(const ColumnarBatch&) = delete;
+  ColumnarBatch& operator=(const ColumnarBatch&) = delete;
+
+  // Returns true if values of 'type' can be stored in a ColumnarBatch.
+  static bool SupportsType(const Type* type);
+
+  // Sets the unit of the TIMESTAMP columns. It is kept across calls to
+  // Reset(), so the owner of the batch can set it once before handing the
+  // batch to an iterator. The rows already in the batch are not converted, so
+  // Reset() must be called before appending more rows.
+  void set_timestamp_unit(TimestampUnit unit) { timestamp_unit_ = unit; }
+  TimestampUnit timestamp_unit() const { return timestamp_unit_; }
+
+  // Removes all the rows and sets up one empty column for each of 'types'.
+  // Returns an error if one of the types is not supported. The buffers of
+  // the previous columns are reused when the types are the same.
+  absl::Status Reset(absl::Span<const Type* const> types);
+
+  // Appends 'value' to the i-th column. Every column must be appended the same
+  // number of times before calling FinishRow(). REQUIRES: 'value' has the type
+  // of the column.
+  //
+  // Returns an OutOfRange error, without modifying the column, for a TIMESTAMP
+  // outside the years 1677 to 2262 when the unit is kNanoseconds, or for a
+  // STRING or BYTES value that would overflow the int32 offsets. The batch
+  // must then be Reset() before it is used again.
+  absl::Status Append(int i, const Value& value);
+
+  // Marks the end of the row that was appended to the columns.
+  void FinishRow() { ++num_rows_; }
+
+  // Returns true if no more rows should be appended, because the int32
+  // offsets of a STRING or BYTES column are close to overflowing.
+  bool IsFull() const;
+
+  int num_columns() const { return columns_.size(); }
+  int64_t num_rows() const { return num_rows_; }
+
+  const Column& column(int i) const { return columns_[i]; }
+
+  // Allows moving the buffers out of the batch. The batch must be Reset()
+  // before it is used again.
+  Column* mutable_column(int i) { return &columns_[i]; }
+
+  // Returns the value in row 'row' of the i-th column. This is mostly useful
+  // for tests, since it converts the value back to a Value.
+  Value GetValue(int i, int64_t row) const;
+
+  // Returns the total size of the buffers of all the columns, in bytes.
+  int64_t GetByteSize() const;
+
+ private:
+  std::vector<Column> columns_;
+  int64_t num_rows_ = 0;
+  TimestampUnit timestamp_unit_ = kMicroseconds;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_COLUMNAR_BATCH_H_
@@ -0,0 +1,167 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/columnar_batch.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/numeric_value.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/time/time.h"
+#include "zetasql/testdata/test_schema.pb.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::ElementsAre;
+using ::zetasql_base::testing::StatusIs;
+
+TEST(ColumnarBatchTest, RoundTripsValues) {
+  TypeFactory type_factory;
+  const EnumType* enum_type;
+  ZETASQL_ASSERT_OK(type_factory.MakeEnumType(zetasql_test::TestEnum_descriptor(),
+                                      &enum_type));
+
+  const std::vector<std::vector<Value>> columns = {
+      {Value::Bool(true), Value::NullBool(), Value::Bool(false)},
+      {Value::Int32(-1), Value::Int32(2), Value::NullInt32()},
+      {Value::Int64(-1), Value::NullInt64(), Value::Int64(int64_t{1} << 40)},
+      {Value::Uint32(1), Value::Uint32(2), Value::Uint32(3)},
+      {Value::Uint64(1), Value::NullUint64(), Value::Uint64(3)},
+      {Value::Float(1.5), Value::Float(-2), Value::NullFloat()},
+      {Value::Double(1.5), Value::NullDouble(), Value::Double(-2)},
+      {Value::Numeric(NumericValue(-3)), Value::NullNumeric(),
+       Value::Numeric(NumericValue::MaxValue())},
+      {Value::Date(-1), Value::Date(18000), Value::NullDate()},
+      {Value::Timestamp(absl::FromUnixMicros(-1)), Value::NullTimestamp(),
+       Value::Timestamp(absl::FromUnixMicros(1500000000123456))},
+      {Value::String("abc"), Value::NullString(), Value::String("")},
+      {Value::NullBytes(), Value::Bytes("d"), Value::Bytes("ef")},
+      {Value::Enum(enum_type, 1), Value::Enum(enum_type, 2),
+       Value::Null(enum_type)},
+  };
+
+  std::vector<const Type*> types;
+  for (const std::vector<Value>& column : columns) {
+    types.push_back(column[0].type());
+  }
+  ColumnarBatch batch;
+  ZETASQL_ASSERT_OK(batch.Reset(types));
+  for (int row = 0; row < 3; ++row) {
+    for (int i = 0; i < columns.size(); ++i) {
+      ZETASQL_ASSERT_OK(batch.Append(i, columns[i][row]));
+    }
+    batch.FinishRow();
+  }
+
+  ASSERT_EQ(batch.num_columns(), columns.size());
+  ASSERT_EQ(batch.num_rows(), 3);
+  for (int i = 0; i < columns.size(); ++i) {
+    for (int row = 0; row < 3; ++row) {
+      EXPECT_EQ(batch.GetValue(i, row), columns[i][row])
+          << "column " << i << ", row " << row;
+    }
+  }
+  EXPECT_GT(batch.GetByteSize(), 0);
+}
+
+TEST(ColumnarBatchTest, ArrowLayout) {
+  ColumnarBatch batch;
+  ZETASQL_ASSERT_OK(batch.Reset({types::Int32Type(), types::StringType(),
+                         types::BoolType()}));
+  for (int row = 0; row < 10; ++row) {
+    const bool is_null = row % 3 == 1;
+    ZETASQL_ASSERT_OK(
+        batch.Append(0, is_null ? Value::NullInt32() : Value::Int32(row)));
+    ZETASQL_ASSERT_OK(
+        batch.Append(1, is_null ? Value::NullString() : Value::String("ab")));
+    ZETASQL_ASSERT_OK(batch.Append(
+        2, is_null ? Value::NullBool() : Value::Bool(row % 2 == 0)));
+    batch.FinishRow();
+  }
+
+  // Rows 1, 4 and 7 are NULL.
+  const ColumnarBatch::Column& ints = batch.column(0);
+  EXPECT_EQ(ints.null_count, 3);
+  EXPECT_THAT(ints.validity, ElementsAre(0b01101101, 0b11));
+  ASSERT_EQ(ints.values.size(), 10 * sizeof(int32_t));
+  EXPECT_THAT(std::vector<uint8_t>(ints.values.begin() + 8,
+                                   ints.values.begin() + 12),
+              ElementsAre(2, 0, 0, 0));
+
+  const ColumnarBatch::Column& strings = batch.column(1);
+  EXPECT_THAT(strings.offsets,
+              ElementsAre(0, 2, 2, 4, 6, 6, 8, 10, 10, 12, 14));
+  EXPECT_EQ(strings.values.size(), 14);
+
+  const ColumnarBatch::Column& bools = batch.column(2);
+  EXPECT_THAT(bools.values, ElementsAre(0b01000101, 0b01));
+
+  // Reset() removes the rows and replaces the columns.
+  ZETASQL_ASSERT_OK(batch.Reset({types::Int32Type()}));
+  EXPECT_EQ(batch.num_columns(), 1);
+  EXPECT_EQ(batch.num_rows(), 0);
+  EXPECT_EQ(batch.GetByteSize(), 0);
+}
+
+TEST(ColumnarBatchTest, TimestampUnits) {
+  const Value min_timestamp =
+      Value::TimestampFromUnixMicros(types::kTimestampMin);
+  const Value max_timestamp =
+      Value::TimestampFromUnixMicros(types::kTimestampMax);
+  const Value nanos_timestamp =
+      Value::Timestamp(absl::FromUnixNanos(1500000000123456789));
+
+  // Microseconds cover the whole TIMESTAMP range.
+  ColumnarBatch batch;
+  EXPECT_EQ(batch.timestamp_unit(), ColumnarBatch::kMicroseconds);
+  ZETASQL_ASSERT_OK(batch.Reset({types::TimestampType()}));
+  for (const Value& value : {min_timestamp, max_timestamp, nanos_timestamp}) {
+    ZETASQL_ASSERT_OK(batch.Append(0, value));
+    batch.FinishRow();
+  }
+  EXPECT_EQ(batch.GetValue(0, 0), min_timestamp);
+  EXPECT_EQ(batch.GetValue(0, 1), max_timestamp);
+  EXPECT_EQ(batch.GetValue(0, 2), Value::TimestampFromUnixMicros(
+                                      int64_t{1500000000123456}));
+
+  // Nanoseconds cannot represent year 1, and the unit survives Reset().
+  batch.set_timestamp_unit(ColumnarBatch::kNanoseconds);
+  ZETASQL_ASSERT_OK(batch.Reset({types::TimestampType()}));
+  EXPECT_EQ(batch.timestamp_unit(), ColumnarBatch::kNanoseconds);
+  ZETASQL_ASSERT_OK(batch.Append(0, nanos_timestamp));
+  batch.FinishRow();
+  EXPECT_EQ(batch.GetValue(0, 0), nanos_timestamp);
+  EXPECT_THAT(batch.Append(0, min_timestamp),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_EQ(batch.num_rows(), 1);
+  EXPECT_EQ(batch.column(0).values.size(), sizeof(int64_t));
+}
+
+TEST(ColumnarBatchTest, UnsupportedType) {
+  ColumnarBatch batch;
+  EXPECT_FALSE(ColumnarBatch::SupportsType(types::Int64ArrayType()));
+  EXPECT_THAT(batch.Reset({types::Int64Type(), types::Int64ArrayType()}),
+              StatusIs(absl::StatusCode::kUnimplemented));
+}
+
+}  // namespace
+}  // namespace zetasql
@@ -16,6 +16,8 @@
 
 #include "zetasql/public/evaluator_base.h"
 
+#include <atomic>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <unordered_map>
@@ -23,8 +25,10 @@
 #include <vector>
 
 #include "zetasql/base/logging.h"
+#include "zetasql/common/internal_value.h"
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/catalog.h"
+#include "zetasql/public/columnar_batch.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/options.pb.h"
 #include "zetasql/public/simple_catalog.h"
@@ -32,6 +36,7 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/algebrizer.h"
+#include "zetasql/reference_impl/bytecode.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/operator.h"
 #include "zetasql/reference_impl/parameters.h"
@@ -211,18 +216,27 @@ class Evaluator {
                                      query_output_iterator);
   }
 
+  // If 'profile_relational_ops' is true, the returned 'query_output_iterator'
+  // supports ExplainAnalyze().
   absl::Status ExecuteAfterPrepareWithOrderedParams(
       const ParameterValueList& columns, const ParameterValueList& parameters,
       const SystemVariableValuesMap& system_variables,
       Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
-      ABSL_LOCKS_EXCLUDED(mutex_) {
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      bool profile_relational_ops = false) const ABSL_LOCKS_EXCLUDED(mutex_) {
     absl::ReaderMutexLock l(&mutex_);
     return ExecuteAfterPrepareWithOrderedParamsLocked(
         columns, parameters, system_variables, expression_output_value,
-        query_output_iterator);
+        query_output_iterator, profile_relational_ops);
   }
 
+  absl::Status ExecuteAfterPrepareBatch(
+      absl::Span<const absl::Span<const Value>> columns,
+      const ParameterValueList& parameters,
+      const SystemVariableValuesMap& system_variables,
+      std::vector<zetasql_base::StatusOr<Value>>* results) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
   zetasql_base::StatusOr<std::string> ExplainAfterPrepare() const
       ABSL_LOCKS_EXCLUDED(mutex_);
 
@@ -268,7 +282,7 @@ class Evaluator {
   }
 
   // For unit tests, it is possible to set a callback that is invoked every time
-  // an EvaluationContext is created.
+  // an EvaluationContext is created or reused from 'context_pool_'.
   void SetCreateEvaluationCallbackTestOnly(
       std::function<void(EvaluationContext*)> cb) ABSL_LOCKS_EXCLUDED(mutex_) {
     absl::MutexLock l(&mutex_);
@@ -321,7 +335,8 @@ class Evaluator {
       const ParameterValueList& columns, const ParameterValueList& parameters,
       const SystemVariableValuesMap& system_variables,
       Value* expression_output_value,
-      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const
+      std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+      bool profile_relational_ops = false) const
       ABSL_SHARED_LOCKS_REQUIRED(mutex_);
 
   // Checks if 'parameters_map' specifies valid values for all variables from
@@ -352,7 +367,8 @@ class Evaluator {
            compiled_relational_op_ != nullptr;
   }
 
-  std::unique_ptr<EvaluationContext> CreateEvaluationContext() const
+  std::unique_ptr<EvaluationContext> CreateEvaluationContext(
+      bool profile_relational_ops = false) const
       ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
     // Construct the EvaluationOptions for the internal evaluation API from the
     // user-provided EvaluatorOptions. These are two different struct types with
@@ -367,6 +383,8 @@ class Evaluator {
     evaluation_options.max_intermediate_byte_size =
         evaluator_options_.max_intermediate_byte_size;
     evaluation_options.return_all_rows_for_dml = false;
+    evaluation_options.profile_relational_ops = profile_relational_ops;
+    evaluation_options.use_value_arena = evaluator_options_.use_value_arena;
 
     auto context = absl::make_unique<EvaluationContext>(evaluation_options);
 
@@ -386,6 +404,45 @@ class Evaluator {
     return context;
   }
 
+  // Returns a context from 'context_pool_', or a new one if the pool is empty.
+  // Only for evaluations that do not keep the context after they return.
+  std::unique_ptr<EvaluationContext> AcquireEvaluationContext() const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_) {
+    {
+      absl::MutexLock l(&context_pool_mutex_);
+      if (!context_pool_.empty()) {
+        std::unique_ptr<EvaluationContext> context =
+            std::move(context_pool_.back());
+        context_pool_.pop_back();
+        if (create_evaluation_context_cb_test_only_ != nullptr) {
+          (*create_evaluation_context_cb_test_only_)(context.get());
+        }
+        return context;
+      }
+    }
+    return CreateEvaluationContext();
+  }
+
+  // Destroys the Values of an evaluation that may have been allocated from
+  // the arena of its context, which must happen before the context is reset.
+  // The proto field value maps of 'params_data' hold values read from the
+  // parameters during the evaluation.
+  static void ReleaseArenaValues(TupleData* params_data, TupleSlot* result) {
+    params_data->Clear();
+    *result = TupleSlot();
+  }
+
+  // Resets 'context' and returns it to 'context_pool_', unless the pool is
+  // full.
+  void ReleaseEvaluationContext(
+      std::unique_ptr<EvaluationContext> context) const {
+    context->Reset();
+    absl::MutexLock l(&context_pool_mutex_);
+    if (context_pool_.size() < kMaxPooledEvaluationContexts) {
+      context_pool_.push_back(std::move(context));
+    }
+  }
+
   void IncrementNumLiveIterators() const {
     absl::MutexLock l(&num_live_iterators_mutex_);
     ++num_live_iterators_;
@@ -431,6 +488,10 @@ class Evaluator {
   // populates compiled_relational_op.
   std::unique_ptr<ValueExpr> compiled_value_expr_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
+  // Bytecode for `compiled_value_expr_`, or NULL if the expression cannot be
+  // compiled. When present, it is tried before `compiled_value_expr_`.
+  std::unique_ptr<BytecodeProgram> value_expr_bytecode_
+      ABSL_GUARDED_BY(mutex_) ABSL_PT_GUARDED_BY(mutex_);
   std::unique_ptr<RelationalOp> compiled_relational_op_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
 
@@ -450,6 +511,14 @@ class Evaluator {
   mutable int num_live_iterators_ ABSL_GUARDED_BY(num_live_iterators_mutex_) =
       0;
 
+  // Contexts that were used to evaluate an expression and were reset, so they
+  // can be reused without allocating their members again. Roughly one context
+  // per thread that evaluates expressions concurrently is retained.
+  static constexpr int kMaxPooledEvaluationContexts = 16;
+  mutable absl::Mutex context_pool_mutex_;
+  mutable std::vector<std::unique_ptr<EvaluationContext>> context_pool_
+      ABSL_GUARDED_BY(context_pool_mutex_);
+
   // The last EvaluationContext that we created, only for use by unit tests. May
   // be NULL.
   std::unique_ptr<std::function<void(EvaluationContext*)>>
@@ -487,6 +556,9 @@ absl::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
   algebrizer_options.allow_hash_join = true;
   algebrizer_options.allow_order_by_limit_operator = true;
   algebrizer_options.push_down_filters = true;
+  algebrizer_options.optimize_expressions =
+      evaluator_options_.optimize_expressions;
+  algebrizer_options.cache_uncorrelated_subqueries = true;
 
   if (!is_expr_) {
     if (statement_ == nullptr) {
@@ -590,6 +662,15 @@ absl::Status Evaluator::PrepareLocked(const AnalyzerOptions& options,
   } else {
     ZETASQL_RETURN_IF_ERROR(
         compiled_value_expr_->SetSchemasForEvaluation({&params_schema}));
+    if (evaluator_options_.compile_expressions_to_bytecode) {
+      // The bytecode is only an optimization, so an expression that fails to
+      // compile for any reason is evaluated without it.
+      zetasql_base::StatusOr<std::unique_ptr<BytecodeProgram>> bytecode =
+          BytecodeProgram::Compile(compiled_value_expr_.get());
+      if (bytecode.ok()) {
+        value_expr_bytecode_ = std::move(bytecode).value();
+      }
+    }
   }
 
   return absl::OkStatus();
@@ -801,15 +882,17 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
   using NameAndType = PreparedQueryBase::NameAndType;
 
   // 'tuple_indexes[i]' is in the index in a TupleData returned by 'iter' of the
-  // value for 'columns[i]'.
+  // value for 'columns[i]'. 'op' is the operator that 'iter' evaluates.
   TupleIteratorAdaptor(const std::vector<NameAndType>& columns,
                        const std::vector<int>& tuple_indexes,
                        const std::function<void()>& deletion_cb,
+                       const RelationalOp* op,
                        std::unique_ptr<EvaluationContext> context,
                        std::unique_ptr<TupleIterator> iter)
       : columns_(columns),
         tuple_indexes_(tuple_indexes),
         deletion_cb_(deletion_cb),
+        op_(op),
         context_(std::move(context)),
         iter_(std::move(iter)) {}
 
@@ -826,43 +909,126 @@ class TupleIteratorAdaptor : public EvaluatorTableIterator {
 
   bool NextRow() override {
     absl::MutexLock l(&mutex_);
-    current_ = iter_->Next();
+    if (!status_.ok()) {
+      return false;
+    }
+    {
+      internal::ValueArenaScope arena_scope(
+          context_->value_arena_for_streaming(),
+          context_->value_arena_is_thread_confined());
+      current_ = iter_->Next();
+    }
     called_next_ = true;
+    if (current_ != nullptr && !context_->AccountForValueArena(&status_)) {
+      current_ = nullptr;
+    }
+    if (current_ != nullptr && context_->value_arena() != nullptr) {
+      // The caller may keep the values beyond the lifetime of this iterator.
+      current_row_.clear();
+      for (int tuple_index : tuple_indexes_) {
+        current_row_.push_back(InternalValue::CopyOutOfArena(
+            current_->slot(tuple_index).value()));
+      }
+    }
     return current_ != nullptr;
   }
 
+  // Appends the values straight from the tuples, so they are never copied out
+  // of the arena of 'context_', and 'mutex_' is locked once per batch instead
+  // of once per value.
+  absl::Status NextColumnarBatch(int64_t max_rows,
+                                 ColumnarBatch* batch) override {
+    std::vector<const Type*> types;
+    types.reserve(columns_.size());
+    for (const NameAndType& column : columns_) {
+      types.push_back(column.second);
+    }
+    ZETASQL_RETURN_IF_ERROR(batch->Reset(types));
+
+    absl::MutexLock l(&mutex_);
+    ZETASQL_RETURN_IF_ERROR(status_);
+    called_next_ = true;
+    current_ = nullptr;
+    while (batch->num_rows() < max_rows && !batch->IsFull()) {
+      const TupleData* data;
+      {
+        internal::ValueArenaScope arena_scope(
+            context_->value_arena_for_streaming(),
+            context_->value_arena_is_thread_confined());
+        data = iter_->Next();
+      }
+      if (data == nullptr) {
+        break;
+      }
+      if (!context_->AccountForValueArena(&status_)) {
+        return status_;
+      }
+      for (int i = 0; i < tuple_indexes_.size(); ++i) {
+        status_ = batch->Append(i, data->slot(tuple_indexes_[i]).value());
+        if (!status_.ok()) {
+          return status_;
+        }
+      }
+      batch->FinishRow();
+    }
+    return iter_->Status();
+  }
+
   const Value& GetValue(int i) const override {
     absl::ReaderMutexLock l(&mutex_);
+    if (context_->value_arena() != nullptr) {
+      return current_row_[i];
+    }
     return current_->slot(tuple_indexes_[i]).value();
   }
 
   absl::Status Status() const override {
     absl::MutexLock l(&mutex_);
+    if (!status_.ok()) {
+      return status_;
+    }
     return iter_->Status();
   }
 
-  absl::Status Cancel() override {
-    absl::MutexLock l(&mutex_);
-    return context_->CancelStatement();
-  }
+  // Does not lock 'mutex_', so that it can interrupt a concurrent NextRow().
+  // See 'context_'.
+  absl::Status Cancel() override { return context_->CancelStatement(); }
 
   void SetDeadline(absl::Time deadline) override {
     absl::MutexLock l(&mutex_);
     context_->SetStatementEvaluationDeadline(deadline);
   }
 
+  zetasql_base::StatusOr<std::string> ExplainAnalyze() const override {
+    absl::ReaderMutexLock l(&mutex_);
+    if (!context_->options().profile_relational_ops) {
+      return zetasql_base::FailedPreconditionErrorBuilder()
+             << "ExplainAnalyze() requires an iterator returned by "
+             << "PreparedQuery::ExecuteAfterPrepareWithProfiling()";
+    }
+    return RelationalOpProfileDebugString(*op_, *context_);
+  }
+
  private:
   const std::vector<NameAndType> columns_;
   const std::vector<int> tuple_indexes_;
   const std::function<void()> deletion_cb_;
+  const RelationalOp* op_;
   mutable absl::Mutex mutex_;
-  std::unique_ptr<EvaluationContext> context_ ABSL_GUARDED_BY(mutex_)
-      ABSL_PT_GUARDED_BY(mutex_);
+  // Set once by the constructor, so the pointer may be read from any thread.
+  // The context is only used with 'mutex_' held, except by Cancel(), since
+  // EvaluationContext::CancelStatement() is thread-safe.
+  const std::unique_ptr<EvaluationContext> context_;
   bool called_next_ ABSL_GUARDED_BY(mutex_) = false;
   std::unique_ptr<TupleIterator> iter_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_);
   const TupleData* current_ ABSL_GUARDED_BY(mutex_)
       ABSL_PT_GUARDED_BY(mutex_) = nullptr;
+  // The values of 'current_' copied out of the arena of 'context_'. Only used
+  // if it has one.
+  std::vector<Value> current_row_ ABSL_GUARDED_BY(mutex_);
+  // An error that stopped the iteration other than one of 'iter_', e.g. if the
+  // arena of 'context_' exceeds the memory limit.
   absl::Status status_ ABSL_GUARDED_BY(mutex_);
 };
 }  // namespace
@@ -871,7 +1037,8 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
     const ParameterValueList& columns, const ParameterValueList& parameters,
     const SystemVariableValuesMap& system_variables,
     Value* expression_output_value,
-    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator) const {
+    std::unique_ptr<EvaluatorTableIterator>* query_output_iterator,
+    bool profile_relational_ops) const {
   if (!has_prepare_succeeded()) {
     // Previous Prepare() failed with an analysis error or Prepare was never
     // called. Returns an error for consistency.
@@ -883,8 +1050,6 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
   ZETASQL_RETURN_IF_ERROR(ValidateParameters(parameters));
   ZETASQL_RETURN_IF_ERROR(ValidateSystemVariables(system_variables));
 
-  std::unique_ptr<EvaluationContext> context = CreateEvaluationContext();
-
   ParameterValueList params;
   params.reserve(columns.size() + parameters.size() + system_variables.size());
   params.insert(params.end(), columns.begin(), columns.end());
@@ -892,9 +1057,18 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
   for (const auto& algebrizer_sysvar : algebrizer_system_variables_) {
     params.push_back(system_variables.at(algebrizer_sysvar.first));
   }
-  const TupleData params_data = CreateTupleDataFromValues(params);
+  TupleData params_data = CreateTupleDataFromValues(params);
+
+  // The bytecode does not need an EvaluationContext, so try it before creating
+  // one. It returns false for anything it cannot evaluate, including errors.
+  if (value_expr_bytecode_ != nullptr &&
+      value_expr_bytecode_->Eval({&params_data}, expression_output_value)) {
+    return absl::OkStatus();
+  }
 
   if (compiled_relational_op_ != nullptr) {
+    std::unique_ptr<EvaluationContext> context =
+        CreateEvaluationContext(profile_relational_ops);
     ZETASQL_ASSIGN_OR_RETURN(
         std::unique_ptr<TupleIterator> tuple_iter,
         compiled_relational_op_->Eval({&params_data},
@@ -912,23 +1086,156 @@ absl::Status Evaluator::ExecuteAfterPrepareWithOrderedParamsLocked(
       DecrementNumLiveIterators();
     };
     *query_output_iterator = absl::make_unique<TupleIteratorAdaptor>(
-        output_columns_, tuple_indexes, deletion_cb, std::move(context),
+        output_columns_, tuple_indexes, deletion_cb,
+        compiled_relational_op_.get(), std::move(context),
         std::move(tuple_iter));
   } else {
     ZETASQL_RET_CHECK(compiled_value_expr_ != nullptr);
 
+    // The result does not refer to the context, so it can be reused.
+    std::unique_ptr<EvaluationContext> context = AcquireEvaluationContext();
     TupleSlot result;
     absl::Status status;
-    if (!compiled_value_expr_->EvalSimple({&params_data}, context.get(),
-                                          &result, &status)) {
+    bool success;
+    {
+      internal::ValueArenaScope arena_scope(
+          context->value_arena(), context->value_arena_is_thread_confined());
+      success = compiled_value_expr_->EvalSimple({&params_data}, context.get(),
+                                                 &result, &status) &&
+                context->AccountForValueArena(&status);
+    }
+    if (success) {
+      *expression_output_value =
+          context->value_arena() == nullptr
+              ? result.value()
+              : InternalValue::CopyOutOfArena(result.value());
+    }
+    if (context->value_arena() != nullptr) {
+      ReleaseArenaValues(&params_data, &result);
+    }
+    ReleaseEvaluationContext(std::move(context));
+    if (!success) {
       return status;
     }
-    *expression_output_value = result.value();
   }
 
   return absl::OkStatus();
 }
 
+absl::Status Evaluator::ExecuteAfterPrepareBatch(
+    absl::Span<const absl::Span<const Value>> columns,
+    const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables,
+    std::vector<zetasql_base::StatusOr<Value>>* results) const {
+  absl::ReaderMutexLock l(&mutex_);
+  if (!has_prepare_succeeded()) {
+    return ::zetasql_base::InvalidArgumentErrorBuilder()
+           << "Invalid prepared expression";
+  }
+  ZETASQL_RET_CHECK(compiled_value_expr_ != nullptr)
+      << "ExecuteAfterPrepareBatch() requires an expression";
+  if (columns.size() != algebrizer_column_map_.size()) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "Incorrect number of column parameters. Expected "
+           << algebrizer_column_map_.size() << " but found " << columns.size();
+  }
+  if (columns.empty()) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "ExecuteAfterPrepareBatch() requires an expression that "
+           << "references at least one column";
+  }
+  const int64_t num_rows = columns[0].size();
+  for (int i = 1; i < columns.size(); ++i) {
+    if (columns[i].size() != num_rows) {
+      return zetasql_base::InvalidArgumentErrorBuilder()
+             << "All columns must have the same number of rows. Column " << i
+             << " has " << columns[i].size() << " rows but column 0 has "
+             << num_rows;
+    }
+  }
+  ZETASQL_RETURN_IF_ERROR(ValidateParameters(parameters));
+  ZETASQL_RETURN_IF_ERROR(ValidateSystemVariables(system_variables));
+
+  results->clear();
+  if (num_rows == 0) return absl::OkStatus();
+
+  // Validate the column types against the first row, then check that every
+  // other row has the same types. This avoids looking up the expected types
+  // once per row.
+  ParameterValueList params;
+  params.reserve(columns.size() + parameters.size() + system_variables.size());
+  for (const absl::Span<const Value>& column : columns) {
+    params.push_back(column[0]);
+  }
+  ZETASQL_RETURN_IF_ERROR(ValidateColumns(params));
+  int i = 0;
+  for (const auto& entry : algebrizer_column_map_) {
+    const Type* expected_type = params[i].type();
+    for (int64_t row = 1; row < num_rows; ++row) {
+      const Type* type = columns[i][row].type();
+      if (type != expected_type && !type->Equals(expected_type)) {
+        return zetasql_base::InvalidArgumentErrorBuilder()
+               << "Expected column parameter '" << entry.first
+               << "' to be of type " << expected_type->DebugString()
+               << " but found " << type->DebugString() << " in row " << row;
+      }
+    }
+    ++i;
+  }
+
+  params.insert(params.end(), parameters.begin(), parameters.end());
+  for (const auto& algebrizer_sysvar : algebrizer_system_variables_) {
+    params.push_back(system_variables.at(algebrizer_sysvar.first));
+  }
+  // The parameters and system variables are the same for every row, so only
+  // the slots for the columns are overwritten below.
+  TupleData params_data = CreateTupleDataFromValues(params);
+  std::unique_ptr<EvaluationContext> context = AcquireEvaluationContext();
+
+  results->reserve(num_rows);
+  Value bytecode_output;
+  TupleSlot result;
+  for (int64_t row = 0; row < num_rows; ++row) {
+    if (row > 0 && context->value_arena() != nullptr) {
+      // The Values allocated from the arena for the previous row are not
+      // needed anymore. The data cached for uncorrelated subqueries does not
+      // depend on the row, but it may refer to the arena, so it goes too.
+      result = TupleSlot();
+      context->ClearCachedData();
+      context->ResetValueArena();
+    }
+    for (int col = 0; col < columns.size(); ++col) {
+      params_data.mutable_slot(col)->SetValue(columns[col][row]);
+    }
+    if (value_expr_bytecode_ != nullptr &&
+        value_expr_bytecode_->Eval({&params_data}, &bytecode_output)) {
+      results->push_back(std::move(bytecode_output));
+      continue;
+    }
+    absl::Status status;
+    bool success;
+    {
+      internal::ValueArenaScope arena_scope(
+          context->value_arena(), context->value_arena_is_thread_confined());
+      success = compiled_value_expr_->EvalSimple({&params_data}, context.get(),
+                                                 &result, &status) &&
+                context->AccountForValueArena(&status);
+    }
+    if (!success) {
+      results->push_back(status);
+    } else if (context->value_arena() == nullptr) {
+      results->push_back(result.value());
+    } else {
+      results->push_back(InternalValue::CopyOutOfArena(result.value()));
+    }
+  }
+  if (context->value_arena() != nullptr) {
+    ReleaseArenaValues(&params_data, &result);
+  }
+  ReleaseEvaluationContext(std::move(context));
+  return absl::OkStatus();
+}
+
 zetasql_base::StatusOr<std::string> Evaluator::ExplainAfterPrepare() const {
   absl::ReaderMutexLock l(&mutex_);
   ZETASQL_RET_CHECK(is_prepared()) << "Prepare must be called first";
@@ -1197,6 +1504,15 @@ PreparedExpressionBase::ExecuteAfterPrepareWithOrderedParams(
   return output;
 }
 
+absl::Status PreparedExpressionBase::ExecuteAfterPrepareBatch(
+    absl::Span<const absl::Span<const Value>> columns,
+    const ParameterValueList& parameters,
+    std::vector<zetasql_base::StatusOr<Value>>* results,
+    const SystemVariableValuesMap& system_variables) const {
+  return evaluator_->ExecuteAfterPrepareBatch(columns, parameters,
+                                              system_variables, results);
+}
+
 zetasql_base::StatusOr<std::string> PreparedExpressionBase::ExplainAfterPrepare()
     const {
   return evaluator_->ExplainAfterPrepare();
@@ -1248,6 +1564,227 @@ PreparedQueryBase::Execute(const ParameterValueMap& parameters,
   return output;
 }
 
+zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+PreparedQueryBase::ExecuteAfterPrepare(
+    const ParameterValueMap& parameters,
+    const SystemVariableValuesMap& system_variables) const {
+  std::unique_ptr<EvaluatorTableIterator> output;
+  ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepare(
+      /*columns=*/{}, ParameterValues(&parameters), system_variables,
+      /*expression_output_value=*/nullptr, &output));
+  return output;
+}
+
+struct AsyncQueryExecution::State {
+  State(int64_t batch_size, int max_buffered_batches,
+        std::function<void(const absl::Status&)> done_callback)
+      : batch_size(batch_size),
+        max_buffered_batches(max_buffered_batches),
+        done_callback(std::move(done_callback)) {}
+
+  // Evaluates the query and pushes its rows into 'batches'.
+  void Run();
+
+  // Fails the query with 'final_status' without running it. Called if the
+  // executor cannot run the task, so that NextBatch() and the destructor of
+  // AsyncQueryExecution do not wait forever.
+  void Fail(const absl::Status& final_status);
+
+  bool CanPush() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return cancelled ||
+           static_cast<int>(batches.size()) < max_buffered_batches;
+  }
+  bool CanPop() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return !batches.empty() || done;
+  }
+
+  const int64_t batch_size;
+  const int max_buffered_batches;
+
+  mutable absl::Mutex mutex;
+  // Only read by Run() and Cancel(), and destroyed by Run() when the query
+  // finishes. Run() does not need 'mutex' to use it, because only Run()
+  // modifies the pointer.
+  std::unique_ptr<EvaluatorTableIterator> iterator;
+  std::deque<std::vector<std::vector<Value>>> batches ABSL_GUARDED_BY(mutex);
+  bool cancelled ABSL_GUARDED_BY(mutex) = false;
+  // True if Run() will not push any more batches.
+  bool done ABSL_GUARDED_BY(mutex) = false;
+  absl::Status status ABSL_GUARDED_BY(mutex);
+  std::function<void(const absl::Status&)> done_callback
+      ABSL_GUARDED_BY(mutex);
+};
+
+void AsyncQueryExecution::State::Run() {
+  EvaluatorTableIterator* iter = iterator.get();
+  absl::Status final_status;
+  std::vector<std::vector<Value>> batch;
+  while (true) {
+    const bool has_row = iter->NextRow();
+    if (has_row) {
+      std::vector<Value> row;
+      row.reserve(iter->NumColumns());
+      for (int i = 0; i < iter->NumColumns(); ++i) {
+        row.push_back(iter->GetValue(i));
+      }
+      batch.push_back(std::move(row));
+      if (static_cast<int64_t>(batch.size()) < batch_size) continue;
+    } else {
+      final_status = iter->Status();
+    }
+
+    if (!batch.empty()) {
+      absl::MutexLock l(&mutex);
+      mutex.Await(absl::Condition(this, &State::CanPush));
+      if (cancelled) break;
+      batches.push_back(std::move(batch));
+      batch.clear();
+    }
+    if (!has_row) break;
+  }
+
+  std::function<void(const absl::Status&)> callback;
+  {
+    absl::MutexLock l(&mutex);
+    // Destroy the iterator before the PreparedQuery can be destroyed.
+    iterator.reset();
+    if (cancelled && final_status.ok()) {
+      final_status = zetasql_base::CancelledErrorBuilder()
+                     << "The statement has been cancelled";
+    }
+    status = final_status;
+    done = true;
+    callback = std::move(done_callback);
+  }
+  if (callback != nullptr) {
+    callback(final_status);
+  }
+}
+
+void AsyncQueryExecution::State::Fail(const absl::Status& final_status) {
+  std::function<void(const absl::Status&)> callback;
+  {
+    absl::MutexLock l(&mutex);
+    iterator.reset();
+    status = final_status;
+    done = true;
+    callback = std::move(done_callback);
+  }
+  if (callback != nullptr) {
+    callback(final_status);
+  }
+}
+
+AsyncQueryExecution::~AsyncQueryExecution() {
+  Cancel().IgnoreError();
+  {
+    absl::MutexLock l(&state_->mutex);
+    state_->mutex.Await(absl::Condition(&state_->done));
+  }
+  if (thread_.joinable()) {
+    // The 'done_callback' may destroy this object from the thread itself.
+    if (thread_.get_id() == std::this_thread::get_id()) {
+      thread_.detach();
+    } else {
+      thread_.join();
+    }
+  }
+}
+
+bool AsyncQueryExecution::NextBatch(std::vector<std::vector<Value>>* rows) {
+  absl::MutexLock l(&state_->mutex);
+  state_->mutex.Await(absl::Condition(state_.get(), &State::CanPop));
+  if (state_->batches.empty()) {
+    return false;
+  }
+  *rows = std::move(state_->batches.front());
+  state_->batches.pop_front();
+  return true;
+}
+
+absl::Status AsyncQueryExecution::Status() const {
+  absl::MutexLock l(&state_->mutex);
+  return state_->status;
+}
+
+absl::Status AsyncQueryExecution::Cancel() {
+  absl::MutexLock l(&state_->mutex);
+  if (state_->done) {
+    return absl::OkStatus();
+  }
+  state_->cancelled = true;
+  return state_->iterator->Cancel();
+}
+
+zetasql_base::StatusOr<std::unique_ptr<AsyncQueryExecution>>
+PreparedQueryBase::ExecuteAfterPrepareAsync(
+    const ParameterValueMap& parameters,
+    const SystemVariableValuesMap& system_variables,
+    AsyncExecutionOptions options) const {
+  if (options.batch_size <= 0 || options.max_buffered_batches <= 0) {
+    return zetasql_base::InvalidArgumentErrorBuilder()
+           << "batch_size and max_buffered_batches must be positive";
+  }
+  // Creating the iterator only validates the arguments. The query is
+  // evaluated by the first call to NextRow().
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iterator,
+                   ExecuteAfterPrepare(parameters, system_variables));
+  if (options.deadline != absl::InfiniteFuture()) {
+    iterator->SetDeadline(options.deadline);
+  }
+
+  auto state = std::make_shared<AsyncQueryExecution::State>(
+      options.batch_size, options.max_buffered_batches,
+      std::move(options.done_callback));
+  state->iterator = std::move(iterator);
+  auto execution = absl::WrapUnique(new AsyncQueryExecution(state));
+  // Shared by the copies of 'task' that the executor may make. Fails the
+  // query when the last copy is destroyed if none of them ran.
+  struct Task {
+    explicit Task(std::shared_ptr<AsyncQueryExecution::State> state)
+        : state(std::move(state)) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+      if (!ran) {
+        state->Fail(zetasql_base::InternalErrorBuilder()
+                    << "The executor destroyed the query task without "
+                       "running it");
+      }
+    }
+
+    const std::shared_ptr<AsyncQueryExecution::State> state;
+    bool ran = false;
+    // The thread that is calling the executor, if any.
+    std::atomic<bool> submitting{false};
+    std::thread::id submitting_thread;
+  };
+  auto shared_task = std::make_shared<Task>(state);
+  std::function<void()> task = [shared_task]() {
+    shared_task->ran = true;
+    if (shared_task->submitting &&
+        shared_task->submitting_thread == std::this_thread::get_id()) {
+      // Run() would wait for NextBatch() while the caller is still inside
+      // ExecuteAfterPrepareAsync(), and never return.
+      shared_task->state->Fail(
+          zetasql_base::InvalidArgumentErrorBuilder()
+          << "AsyncExecutionOptions::executor must not run the query task "
+             "before returning");
+      return;
+    }
+    shared_task->state->Run();
+  };
+  if (options.executor != nullptr) {
+    shared_task->submitting_thread = std::this_thread::get_id();
+    shared_task->submitting = true;
+    options.executor(std::move(task));
+    shared_task->submitting = false;
+  } else {
+    execution->thread_ = std::thread(std::move(task));
+  }
+  return execution;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
 PreparedQueryBase::ExecuteWithPositionalParams(
     const ParameterValueList& positional_parameters,
@@ -1270,6 +1807,18 @@ PreparedQueryBase::ExecuteAfterPrepareWithOrderedParams(
   return output;
 }
 
+zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+PreparedQueryBase::ExecuteAfterPrepareWithProfiling(
+    const ParameterValueList& parameters,
+    const SystemVariableValuesMap& system_variables) const {
+  std::unique_ptr<EvaluatorTableIterator> output;
+  ZETASQL_RETURN_IF_ERROR(evaluator_->ExecuteAfterPrepareWithOrderedParams(
+      /*columns=*/{}, parameters, system_variables,
+      /*expression_output_value=*/nullptr, &output,
+      /*profile_relational_ops=*/true));
+  return output;
+}
+
 zetasql_base::StatusOr<std::string> PreparedQueryBase::ExplainAfterPrepare() const {
   return evaluator_->ExplainAfterPrepare();
 }
@@ -163,9 +163,11 @@
 //     statement.Execute().ValueOrDie();
 //   ... Iterate over `result` (which lists deleted rows) ...
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -179,6 +181,8 @@
 #include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 #include "zetasql/base/clock.h"
@@ -244,6 +248,40 @@ struct EvaluatorOptions {
   // accounting charges each of them individually. In some cases, it is
   // necessary to set this option to a very large value.
   int64_t max_intermediate_byte_size = 128 * 1024 * 1024;
+
+  // If true, the intermediate STRING, BYTES, NUMERIC, BIGNUMERIC, ARRAY and
+  // STRUCT Values created during an evaluation are allocated from an arena
+  // owned by the evaluation, and released all at once when it ends, instead of
+  // being allocated and freed individually. This makes expression-heavy
+  // evaluations faster, at the cost of keeping the memory of dead
+  // intermediate Values until the end of the evaluation (for queries, until
+  // the iterator is destroyed; for ExecuteAfterPrepareBatch(), until the end
+  // of each row). The Values returned to the caller are copied out of the
+  // arena. The blocks of the arena after the first count against
+  // 'max_intermediate_byte_size'.
+  //
+  // The Values in the arena also use non-atomic reference counts, since an
+  // evaluation only runs on one thread at a time.
+  //
+  // Values created by callbacks while they evaluate on the evaluating thread,
+  // such as those of custom functions and table iterators, are also
+  // allocated from the arena, so those callbacks must not keep Values beyond
+  // the evaluation or share them with other threads.
+  bool use_value_arena = false;
+
+  // If true, Prepare() replaces deterministic builtin function calls over
+  // literals by their values, and computes the subexpressions that occur more
+  // than once in a projection or expression only once. Expressions that fail
+  // to fold are kept, so their errors are only raised if they are evaluated.
+  // This makes Prepare() slower, so it is only worthwhile for statements that
+  // are executed many times.
+  bool optimize_expressions = false;
+
+  // If true, Prepare() for a PreparedExpression also compiles the expression
+  // into bytecode, which evaluates the simple expressions it supports faster
+  // than the tree of operators. Expressions that cannot be compiled are
+  // evaluated as before, so turning this off only changes performance.
+  bool compile_expressions_to_bytecode = true;
 };
 
 class PreparedExpressionBase {
@@ -404,6 +442,29 @@ class PreparedExpressionBase {
       const ParameterValueList& columns, const ParameterValueList& parameters,
       const SystemVariableValuesMap& system_variables = {}) const;
 
+  // Evaluates the expression over many rows at once. <columns> holds one
+  // span per referenced column, in the order returned by
+  // GetReferencedColumns, and every span must have the same number of rows.
+  // <parameters> and <system_variables> are shared by all rows and are passed
+  // as in ExecuteAfterPrepareWithOrderedParams.
+  //
+  // The arguments are validated once for the whole batch, and all rows are
+  // evaluated with the same EvaluationContext, so this is cheaper than calling
+  // ExecuteAfterPrepareWithOrderedParams once per row. In particular,
+  // CURRENT_TIMESTAMP and friends return the same value for every row.
+  //
+  // Returns an error if the arguments are invalid. Otherwise, <results> is
+  // populated with one entry per row, holding either the value of the
+  // expression for that row or the error it produced. An error for one row
+  // does not prevent the other rows from being evaluated.
+  //
+  // REQUIRES: Prepare() has been called successfully.
+  absl::Status ExecuteAfterPrepareBatch(
+      absl::Span<const absl::Span<const Value>> columns,
+      const ParameterValueList& parameters,
+      std::vector<zetasql_base::StatusOr<Value>>* results,
+      const SystemVariableValuesMap& system_variables = {}) const;
+
   // Returns a human-readable representation of how this expression would
   // actually be executed. Do not try to interpret this string with code, as the
   // format can change at any time. Requires that Prepare has already been
@@ -417,6 +478,76 @@ class PreparedExpressionBase {
   std::unique_ptr<internal::Evaluator> evaluator_;
 };
 
+// Options for PreparedQuery::ExecuteAfterPrepareAsync().
+struct AsyncExecutionOptions {
+  // Runs 'task' exactly once, on any thread. 'task' evaluates the whole query,
+  // pausing whenever 'max_buffered_batches' batches are waiting to be read.
+  // If the executor destroys 'task' (and all its copies) without running it,
+  // e.g. because it is shutting down, the query fails with an internal error.
+  // The executor must not run 'task' before it returns: the task would wait
+  // for batches to be read while the caller is still blocked in
+  // ExecuteAfterPrepareAsync(). If it does, the query fails with an
+  // invalid argument error instead of running. If not set, each execution
+  // starts a new thread.
+  std::function<void(std::function<void()> task)> executor;
+
+  // The maximum number of rows in each batch returned by
+  // AsyncQueryExecution::NextBatch().
+  int64_t batch_size = 1024;
+
+  // The maximum number of batches produced ahead of
+  // AsyncQueryExecution::NextBatch().
+  int max_buffered_batches = 4;
+
+  // If the query is still running at this time, it is aborted with an error.
+  absl::Time deadline = absl::InfiniteFuture();
+
+  // If set, called with the final status of the query once it has produced
+  // its last batch, failed or been cancelled. It is called on the thread that
+  // runs the query, and it may destroy the AsyncQueryExecution.
+  std::function<void(const absl::Status& status)> done_callback;
+};
+
+// A query started by PreparedQuery::ExecuteAfterPrepareAsync(). The rows are
+// produced in batches by a task on the executor and buffered in a bounded
+// queue until they are read with NextBatch(). This class is thread-safe.
+class AsyncQueryExecution {
+ public:
+  AsyncQueryExecution(const AsyncQueryExecution&) = delete;
+  AsyncQueryExecution& operator=(const AsyncQueryExecution&) = delete;
+
+  // Cancels the query if it is still running, and waits for it to stop.
+  ~AsyncQueryExecution();
+
+  // Blocks until the next batch of rows is available and moves it into
+  // 'rows'. Each row holds one value per output column of the query. Returns
+  // false if there are no more rows, in which case Status() returns the final
+  // status of the query.
+  bool NextBatch(std::vector<std::vector<Value>>* rows);
+
+  // Returns the final status of the query, or OK if it is still running.
+  absl::Status Status() const;
+
+  // Requests the cancellation of the query. Long-running operators (e.g.,
+  // sorts, joins and aggregations) periodically check whether they were
+  // cancelled, after which the query stops and Status() returns an error.
+  // Does nothing if the query already finished.
+  absl::Status Cancel();
+
+ private:
+  friend class PreparedQueryBase;
+  struct State;
+
+  explicit AsyncQueryExecution(std::shared_ptr<State> state)
+      : state_(std::move(state)) {}
+
+  // Shared with the task running the query, which may outlive this object
+  // while it calls the 'done_callback'.
+  const std::shared_ptr<State> state_;
+  // Only used if no executor was provided.
+  std::thread thread_;
+};
+
 class PreparedQueryBase {
  public:
   // Constructor. Additional options can be provided by filling out the
@@ -498,6 +629,15 @@ class PreparedQueryBase {
       const ParameterValueList& positional_parameters,
       const SystemVariableValuesMap& system_variables = {});
 
+  // Same as Execute(), but can be called on a const PreparedQuery, for example
+  // one shared between threads.
+  //
+  // REQUIRES: Prepare() has been called successfully.
+  zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  ExecuteAfterPrepare(const ParameterValueMap& parameters = {},
+                      const SystemVariableValuesMap& system_variables = {})
+      const;
+
   // More efficient form of Execute that requires parameter values to be passed
   // in a particular order. If positional parameters are used, they are passed
   // in <parameters>. If named parameters are used, they are passed in
@@ -509,6 +649,31 @@ class PreparedQueryBase {
       const ParameterValueList& parameters,
       const SystemVariableValuesMap& system_variables = {}) const;
 
+  // Same as ExecuteAfterPrepare(), but evaluates the query on
+  // 'options.executor' instead of the calling thread, so that the caller does
+  // not have to block while the query runs. Errors in the arguments are
+  // returned directly. Errors during evaluation are reported by the returned
+  // object and the 'done_callback'. This object must outlive the returned
+  // object.
+  //
+  // REQUIRES: Prepare() has been called successfully.
+  zetasql_base::StatusOr<std::unique_ptr<AsyncQueryExecution>>
+  ExecuteAfterPrepareAsync(const ParameterValueMap& parameters,
+                           const SystemVariableValuesMap& system_variables,
+                           AsyncExecutionOptions options) const;
+
+  // Same as ExecuteAfterPrepareWithOrderedParams(), but the returned iterator
+  // records the rows, time and memory used by each step of the query, which
+  // can be retrieved at any time with its ExplainAnalyze() method. Profiling
+  // slows down evaluation, so this is only intended for diagnosing slow
+  // queries.
+  //
+  // REQUIRES: Prepare() has been called successfully.
+  zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
+  ExecuteAfterPrepareWithProfiling(
+      const ParameterValueList& parameters,
+      const SystemVariableValuesMap& system_variables = {}) const;
+
   // Returns a human-readable representation of how this query would actually
   // be executed. Do not try to interpret this string with code, as the
   // format can change at any time. Requires that Prepare has already been
@@ -19,9 +19,15 @@
 #ifndef ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
 #define ZETASQL_PUBLIC_EVALUATOR_TABLE_ITERATOR_H_
 
+#include <vector>
+
+#include "zetasql/public/columnar_batch.h"
 #include "zetasql/public/value.h"
+#include <cstdint>
 #include "zetasql/base/canonical_errors.h"
 #include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
 
 namespace zetasql {
 
@@ -151,6 +157,34 @@ class EvaluatorTableIterator {
   // returned true.
   virtual const Value& GetValue(int i) const = 0;
 
+  // Replaces the contents of 'batch' with the next 'max_rows' rows, in a
+  // columnar layout (see columnar_batch.h). The batch has fewer rows only if
+  // there are no more rows, or if the batch is full, so the caller can stop
+  // when it is empty. Returns an error if a column has a type that
+  // ColumnarBatch does not support, if a value cannot be stored in the batch
+  // (see ColumnarBatch::Append()), or if reading a row fails. Afterwards,
+  // GetValue() must not be called until NextRow() returns true again. The
+  // iterator cannot be used after an error from Append().
+  //
+  // The default implementation calls NextRow() and GetValue(). Iterators that
+  // can copy their values directly into 'batch' should override it.
+  virtual absl::Status NextColumnarBatch(int64_t max_rows,
+                                         ColumnarBatch* batch) {
+    std::vector<const Type*> types;
+    types.reserve(NumColumns());
+    for (int i = 0; i < NumColumns(); ++i) {
+      types.push_back(GetColumnType(i));
+    }
+    ZETASQL_RETURN_IF_ERROR(batch->Reset(types));
+    while (batch->num_rows() < max_rows && !batch->IsFull() && NextRow()) {
+      for (int i = 0; i < types.size(); ++i) {
+        ZETASQL_RETURN_IF_ERROR(batch->Append(i, GetValue(i)));
+      }
+      batch->FinishRow();
+    }
+    return Status();
+  }
+
   // Returns OK unless the last call to NextRow() returned false because of an
   // error (including cancellation).
   virtual absl::Status Status() const = 0;
@@ -168,6 +202,17 @@ class EvaluatorTableIterator {
   // set a deadline member and check for its expiration inside processing loops
   // or in NextRow().
   virtual void SetDeadline(absl::Time deadline) {}
+
+  // Returns a human-readable representation of how the rows of this iterator
+  // were computed, annotated with the work done by each step so far (e.g., the
+  // number of rows, time and memory used by each operator of a query). Only
+  // supported by iterators returned by
+  // PreparedQuery::ExecuteAfterPrepareWithProfiling(). Do not try to interpret
+  // this string with code, as the format can change at any time.
+  virtual zetasql_base::StatusOr<std::string> ExplainAnalyze() const {
+    return absl::UnimplementedError(
+        "EvaluatorTableIterator::ExplainAnalyze() not implemented");
+  }
 };
 
 // Represents a restriction of values needed by a scan for a particular
@@ -16,6 +16,7 @@
 
 #include "zetasql/public/evaluator.h"
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -31,6 +32,7 @@
 #include "zetasql/common/testing/testing_proto_util.h"
 #include "zetasql/public/analyzer.h"
 #include "zetasql/public/civil_time.h"
+#include "zetasql/public/columnar_batch.h"
 #include "zetasql/public/function.h"
 #include "zetasql/public/function.pb.h"
 #include "zetasql/public/functions/date_time_util.h"
@@ -58,6 +60,7 @@
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
 #include "zetasql/base/stl_util.h"
@@ -305,6 +308,19 @@ TEST(EvaluatorTest, ExpressionWithQueryParameters) {
   EXPECT_EQ(Value::Int64(15), result);
 }
 
+TEST(EvaluatorTest, ExpressionWithoutBytecode) {
+  for (bool compile_to_bytecode : {false, true}) {
+    EvaluatorOptions evaluator_options;
+    evaluator_options.compile_expressions_to_bytecode = compile_to_bytecode;
+    PreparedExpression expr("(@param1 + @param2) * col", evaluator_options);
+    Value result =
+        expr.Execute({{"col", Value::Int64(5)}},
+                     {{"param1", Value::Int64(1)}, {"param2", Value::Int64(2)}})
+            .value();
+    EXPECT_EQ(Value::Int64(15), result) << compile_to_bytecode;
+  }
+}
+
 TEST(EvaluatorTest, ExpressionWithPositionalQueryParameters) {
   PreparedExpression expr("(? + ?) * col");
   Value result = expr.ExecuteWithPositionalParams(
@@ -802,6 +818,89 @@ TEST(EvaluatorTest,
               IsOkAndHolds(Value::Int64(15)));
 }
 
+TEST(EvaluatorTest, ExecuteAfterPrepareBatch) {
+  PreparedExpression expr("@param / (col1 - col2)");
+
+  AnalyzerOptions options;
+  options.set_parameter_mode(PARAMETER_NAMED);
+  ZETASQL_ASSERT_OK(options.AddQueryParameter("param", types::DoubleType()));
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("col1", types::Int64Type()));
+  ZETASQL_ASSERT_OK(options.AddExpressionColumn("col2", types::Int64Type()));
+
+  ZETASQL_ASSERT_OK(expr.Prepare(options));
+  EXPECT_THAT(expr.GetReferencedColumns(),
+              IsOkAndHolds(ElementsAre("col1", "col2")));
+
+  const std::vector<Value> col1 = {Value::Int64(3), Value::Int64(5),
+                                   Value::NullInt64(), Value::Int64(1)};
+  const std::vector<Value> col2 = {Value::Int64(1), Value::Int64(5),
+                                   Value::Int64(1), Value::Int64(5)};
+  std::vector<zetasql_base::StatusOr<Value>> results;
+  ZETASQL_ASSERT_OK(expr.ExecuteAfterPrepareBatch({col1, col2}, {Value::Double(8)},
+                                          &results));
+  // The division by zero in the second row does not affect the other rows.
+  EXPECT_THAT(results,
+              ElementsAre(IsOkAndHolds(Value::Double(4)),
+                          StatusIs(absl::StatusCode::kOutOfRange,
+                                   HasSubstr("division by zero")),
+                          IsOkAndHolds(Value::NullDouble()),
+                          IsOkAndHolds(Value::Double(-2))));
+
+  const std::vector<Value> no_rows;
+  ZETASQL_ASSERT_OK(expr.ExecuteAfterPrepareBatch({no_rows, no_rows},
+                                          {Value::Double(8)}, &results));
+  EXPECT_THAT(results, IsEmpty());
+
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatch({col1}, {Value::Double(8)},
+                                            &results),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Incorrect number of column parameters")));
+  EXPECT_THAT(
+      expr.ExecuteAfterPrepareBatch({col1, absl::MakeConstSpan(col2).subspan(1)},
+                                    {Value::Double(8)}, &results),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("same number of rows")));
+  const std::vector<Value> bad_col2 = {Value::Int64(1), Value::Int64(2),
+                                       Value::Int32(3), Value::Int64(4)};
+  EXPECT_THAT(
+      expr.ExecuteAfterPrepareBatch({col1, bad_col2}, {Value::Double(8)},
+                                    &results),
+      StatusIs(absl::StatusCode::kInvalidArgument,
+               HasSubstr("Expected column parameter 'col2' to be of type "
+                         "INT64 but found INT32 in row 2")));
+  EXPECT_THAT(expr.ExecuteAfterPrepareBatch({col1, col2}, {Value::Int64(8)},
+                                            &results),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(EvaluatorTest, ExecuteAfterPrepareBatchWithSubqueries) {
+  // The subqueries over 'col' must be evaluated for every row. The
+  // uncorrelated IN subquery is evaluated once for the whole batch, unless
+  // the value arena that holds its values is reset for every row.
+  for (const bool use_value_arena : {false, true}) {
+    EvaluatorOptions evaluator_options;
+    evaluator_options.use_value_arena = use_value_arena;
+    PreparedExpression expr(
+        "CONCAT(CAST((SELECT col + 1) AS STRING), ':', "
+        "CAST(EXISTS(SELECT 1 FROM UNNEST([col]) x WHERE x > 2) AS STRING), "
+        "':', CAST(col IN (SELECT y FROM UNNEST([1, 3]) y) AS STRING))",
+        evaluator_options);
+
+    AnalyzerOptions options;
+    ZETASQL_ASSERT_OK(options.AddExpressionColumn("col", types::Int64Type()));
+    ZETASQL_ASSERT_OK(expr.Prepare(options));
+
+    const std::vector<Value> col = {Value::Int64(1), Value::Int64(2),
+                                    Value::Int64(3)};
+    std::vector<zetasql_base::StatusOr<Value>> results;
+    ZETASQL_ASSERT_OK(expr.ExecuteAfterPrepareBatch({col}, {}, &results));
+    EXPECT_THAT(results,
+                ElementsAre(IsOkAndHolds(Value::String("2:false:true")),
+                            IsOkAndHolds(Value::String("3:false:false")),
+                            IsOkAndHolds(Value::String("4:true:true"))));
+  }
+}
+
 TEST(EvaluatorTest, ExplainAfterPrepareWithoutPrepare) {
   PreparedExpression expr("@param + col");
   EXPECT_THAT(expr.ExplainAfterPrepare(),
@@ -1170,6 +1269,153 @@ TEST(EvaluatorTest, CurrentTimestamp) {
   EXPECT_EQ(test_time, value.ToTime());
 }
 
+TEST(EvaluatorTest, CurrentTimestampIsReadForEachExecution) {
+  const absl::Time test_time = absl::FromUnixMicros(1479885478000LL);
+  zetasql_base::SimulatedClock clock(test_time);
+  EvaluatorOptions evaluator_options;
+  evaluator_options.clock = &clock;
+
+  PreparedExpression expr("CURRENT_TIMESTAMP()", evaluator_options);
+  ZETASQL_ASSERT_OK(expr.Prepare(AnalyzerOptions()));
+  EXPECT_EQ(test_time, expr.ExecuteAfterPrepare().value().ToTime());
+  // The EvaluationContext is reused, but not the current timestamp.
+  clock.AdvanceTime(absl::Seconds(1));
+  EXPECT_EQ(test_time + absl::Seconds(1),
+            expr.ExecuteAfterPrepare().value().ToTime());
+}
+
+TEST(EvaluatorTest, UseValueArena) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.use_value_arena = true;
+  AnalyzerOptions analyzer_options;
+  ZETASQL_ASSERT_OK(analyzer_options.AddQueryParameter("p", types::StringType()));
+
+  PreparedExpression expr("[concat(@p, 'a'), upper(@p)]", evaluator_options);
+  ZETASQL_ASSERT_OK(expr.Prepare(analyzer_options));
+  // The results must stay valid after later evaluations reset the arena.
+  std::vector<Value> results;
+  for (const char* param : {"foo", "bar"}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        Value result, expr.ExecuteAfterPrepare({}, {{"p", String(param)}}));
+    results.push_back(result);
+  }
+  EXPECT_EQ(results[0], StringArray({"fooa", "FOO"}));
+  EXPECT_EQ(results[1], StringArray({"bara", "BAR"}));
+
+  PreparedQuery query(
+      "select concat('x', cast(n as string)) as s from unnest([1, 2, 3]) as n",
+      evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.ExecuteAfterPrepare());
+  std::vector<Value> rows;
+  while (iter->NextRow()) {
+    rows.push_back(iter->GetValue(0));
+  }
+  ZETASQL_ASSERT_OK(iter->Status());
+  iter.reset();
+  EXPECT_THAT(rows, UnorderedElementsAre(String("x1"), String("x2"),
+                                         String("x3")));
+}
+
+TEST(EvaluatorTest, ValueArenaCountsAgainstMemoryLimit) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.use_value_arena = true;
+  evaluator_options.max_intermediate_byte_size = 1024 * 1024;
+  // Each row allocates a few strings of more than 100 bytes, several MB in
+  // total. A query cannot release the arena between rows, so once the arena
+  // holds part of the memory limit, the later rows allocate their strings
+  // from the heap instead of running out of memory.
+  PreparedQuery query(
+      "select upper(concat(repeat('x', 100), cast(n as string))) as s "
+      "from unnest(generate_array(1, 10000)) as n",
+      evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.ExecuteAfterPrepare());
+  int64_t num_rows = 0;
+  Value last_value;
+  while (iter->NextRow()) {
+    ++num_rows;
+    last_value = iter->GetValue(0);
+  }
+  ZETASQL_EXPECT_OK(iter->Status());
+  EXPECT_EQ(num_rows, 10000);
+  EXPECT_EQ(last_value, String(std::string(100, 'X') + "10000"));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, query.ExecuteAfterPrepare());
+  ColumnarBatch batch;
+  num_rows = 0;
+  while (true) {
+    ZETASQL_ASSERT_OK(iter->NextColumnarBatch(/*max_rows=*/4096, &batch));
+    if (batch.num_rows() == 0) break;
+    num_rows += batch.num_rows();
+  }
+  EXPECT_EQ(num_rows, 10000);
+
+  // An expression releases the arena after every evaluation.
+  PreparedExpression expr(
+      "(select count(distinct concat('x', cast(n as string))) "
+      "from unnest(generate_array(1, 1000)) as n)",
+      evaluator_options);
+  ZETASQL_ASSERT_OK(expr.Prepare(AnalyzerOptions()));
+  for (int i = 0; i < 200; ++i) {
+    EXPECT_THAT(expr.ExecuteAfterPrepare(), IsOkAndHolds(Int64(1000)));
+  }
+}
+
+TEST(EvaluatorTest, NextColumnarBatch) {
+  EvaluatorOptions evaluator_options;
+  evaluator_options.use_value_arena = true;
+  PreparedQuery query(
+      "select n, if(n = 3, null, concat('x', cast(n as string))) as s "
+      "from unnest([1, 2, 3, 4, 5]) as n order by n",
+      evaluator_options);
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.ExecuteAfterPrepare());
+
+  ColumnarBatch batch;
+  std::vector<int64_t> batch_sizes;
+  std::vector<Value> strings;
+  while (true) {
+    ZETASQL_ASSERT_OK(iter->NextColumnarBatch(/*max_rows=*/2, &batch));
+    if (batch.num_rows() == 0) break;
+    ASSERT_EQ(batch.num_columns(), 2);
+    batch_sizes.push_back(batch.num_rows());
+    for (int64_t row = 0; row < batch.num_rows(); ++row) {
+      EXPECT_EQ(batch.GetValue(0, row), Int64(strings.size() + 1));
+      strings.push_back(batch.GetValue(1, row));
+    }
+  }
+  EXPECT_THAT(batch_sizes, ElementsAre(2, 2, 1));
+  EXPECT_THAT(strings, ElementsAre(String("x1"), String("x2"), NullString(),
+                                   String("x4"), String("x5")));
+
+  PreparedQuery array_query("select [1, 2] as a", EvaluatorOptions());
+  ZETASQL_ASSERT_OK(array_query.Prepare(AnalyzerOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, array_query.ExecuteAfterPrepare());
+  EXPECT_THAT(iter->NextColumnarBatch(/*max_rows=*/2, &batch),
+              StatusIs(absl::StatusCode::kUnimplemented));
+
+  // Year 1 fits in microseconds but not in nanoseconds. A failed Append()
+  // leaves the iterator failed.
+  PreparedQuery timestamp_query(
+      "select t from unnest([timestamp '0001-01-01 00:00:00+00']) as t",
+      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(timestamp_query.Prepare(AnalyzerOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, timestamp_query.ExecuteAfterPrepare());
+  ZETASQL_ASSERT_OK(iter->NextColumnarBatch(/*max_rows=*/2, &batch));
+  EXPECT_EQ(batch.num_rows(), 1);
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, timestamp_query.ExecuteAfterPrepare());
+  batch.set_timestamp_unit(ColumnarBatch::kNanoseconds);
+  EXPECT_THAT(iter->NextColumnarBatch(/*max_rows=*/2, &batch),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_FALSE(iter->NextRow());
+  EXPECT_THAT(iter->Status(), StatusIs(absl::StatusCode::kOutOfRange));
+}
+
 absl::Time GetTestTime() {
   absl::TimeZone gst;
   CHECK(absl::LoadTimeZone("America/Los_Angeles", &gst));
@@ -2061,6 +2307,36 @@ TEST(PreparedQuery, FromTableOnlySecondColumn) {
   ZETASQL_EXPECT_OK(iter->Status());
 }
 
+TEST(PreparedQuery, ExecuteAfterPrepareWithProfiling) {
+  SimpleTable test_table(
+      "TestTable", {{"a", types::Int64Type()}, {"b", types::StringType()}});
+  test_table.SetContents({{Int64(10), String("foo")},
+                          {Int64(20), String("bar")},
+                          {Int64(30), String("baz")}});
+
+  SimpleCatalog catalog("TestCatalog");
+  catalog.AddTable(test_table.Name(), &test_table);
+
+  PreparedQuery query("select b from TestTable", EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions(), &catalog));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       query.Execute());
+  EXPECT_THAT(iter->ExplainAnalyze(),
+              StatusIs(absl::StatusCode::kFailedPrecondition));
+  iter.reset();
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, query.ExecuteAfterPrepareWithProfiling({}));
+  while (iter->NextRow()) {
+  }
+  ZETASQL_ASSERT_OK(iter->Status());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(const std::string explain, iter->ExplainAnalyze());
+  EXPECT_THAT(explain, HasSubstr("RootOp: iterators=1 rows=3 time="));
+  EXPECT_THAT(explain,
+              HasSubstr("EvaluatorTableScanOp: iterators=1 rows=3 time="));
+  EXPECT_THAT(explain, HasSubstr("peak_memory_bytes="));
+}
+
 TEST(PreparedQuery, FromTableFailure) {
   const std::string error = "Failed to read row from TestTable";
   const absl::Status failure = zetasql_base::OutOfRangeErrorBuilder() << error;
@@ -2145,6 +2421,138 @@ TEST(PreparedQuery, FromTableDeadlineExceeded) {
   EXPECT_THAT(iter->Status(), StatusIs(absl::StatusCode::kDeadlineExceeded, _));
 }
 
+TEST(PreparedQuery, ExecuteAfterPrepareAsync) {
+  PreparedQuery query("select x from unnest(generate_array(1, 10)) as x",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+
+  AsyncExecutionOptions options;
+  options.batch_size = 0;
+  EXPECT_THAT(query.ExecuteAfterPrepareAsync({}, {}, options),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+
+  absl::Notification done;
+  absl::Status done_status = zetasql_base::UnknownErrorBuilder();
+  options.batch_size = 3;
+  options.max_buffered_batches = 1;
+  options.done_callback = [&done, &done_status](const absl::Status& status) {
+    done_status = status;
+    done.Notify();
+  };
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AsyncQueryExecution> execution,
+                       query.ExecuteAfterPrepareAsync({}, {}, options));
+
+  std::vector<std::vector<Value>> batch;
+  std::vector<int> batch_sizes;
+  std::vector<Value> values;
+  while (execution->NextBatch(&batch)) {
+    batch_sizes.push_back(batch.size());
+    for (const std::vector<Value>& row : batch) {
+      ASSERT_EQ(row.size(), 1);
+      values.push_back(row[0]);
+    }
+  }
+  ZETASQL_EXPECT_OK(execution->Status());
+  EXPECT_THAT(batch_sizes, ElementsAre(3, 3, 3, 1));
+  ASSERT_EQ(values.size(), 10);
+  for (int i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(values[i], Int64(i + 1));
+  }
+  done.WaitForNotification();
+  ZETASQL_EXPECT_OK(done_status);
+}
+
+TEST(PreparedQuery, ExecuteAfterPrepareAsyncCancellation) {
+  PreparedQuery query("select x from unnest(generate_array(1, 10)) as x",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+
+  // Defer the task, so that the query is cancelled before it starts.
+  std::function<void()> deferred_task;
+  absl::Status done_status;
+  AsyncExecutionOptions options;
+  options.executor = [&deferred_task](std::function<void()> task) {
+    deferred_task = std::move(task);
+  };
+  options.done_callback = [&done_status](const absl::Status& status) {
+    done_status = status;
+  };
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AsyncQueryExecution> execution,
+                       query.ExecuteAfterPrepareAsync({}, {}, options));
+  ZETASQL_EXPECT_OK(execution->Status());
+  ZETASQL_EXPECT_OK(execution->Cancel());
+  ASSERT_NE(deferred_task, nullptr);
+  deferred_task();
+
+  std::vector<std::vector<Value>> batch;
+  EXPECT_FALSE(execution->NextBatch(&batch));
+  EXPECT_THAT(execution->Status(), StatusIs(absl::StatusCode::kCancelled, _));
+  EXPECT_THAT(done_status, StatusIs(absl::StatusCode::kCancelled, _));
+  // Cancelling a finished query does nothing.
+  ZETASQL_EXPECT_OK(execution->Cancel());
+}
+
+TEST(PreparedQuery, ExecuteAfterPrepareAsyncTaskDropped) {
+  PreparedQuery query("select 1 as x", EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+
+  // The executor destroys the task without running it.
+  absl::Status done_status;
+  AsyncExecutionOptions options;
+  options.executor = [](std::function<void()> task) {};
+  options.done_callback = [&done_status](const absl::Status& status) {
+    done_status = status;
+  };
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AsyncQueryExecution> execution,
+                       query.ExecuteAfterPrepareAsync({}, {}, options));
+  std::vector<std::vector<Value>> batch;
+  EXPECT_FALSE(execution->NextBatch(&batch));
+  EXPECT_THAT(execution->Status(),
+              StatusIs(absl::StatusCode::kInternal,
+                       HasSubstr("without running it")));
+  EXPECT_THAT(done_status, StatusIs(absl::StatusCode::kInternal, _));
+  // The destructor does not wait for the task.
+  execution.reset();
+}
+
+TEST(PreparedQuery, ExecuteAfterPrepareAsyncInlineExecutor) {
+  PreparedQuery query("select x from unnest(generate_array(1, 100)) as x",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+
+  // The executor runs the task before returning, which would block forever
+  // once 'max_buffered_batches' batches are buffered.
+  AsyncExecutionOptions options;
+  options.batch_size = 1;
+  options.max_buffered_batches = 1;
+  options.executor = [](std::function<void()> task) { task(); };
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AsyncQueryExecution> execution,
+                       query.ExecuteAfterPrepareAsync({}, {}, options));
+  std::vector<std::vector<Value>> batch;
+  EXPECT_FALSE(execution->NextBatch(&batch));
+  EXPECT_THAT(execution->Status(),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("must not run the query task")));
+}
+
+TEST(PreparedQuery, ExecuteAfterPrepareAsyncDestroyedWhileRunning) {
+  PreparedQuery query("select x from unnest(generate_array(1, 100000)) as x",
+                      EvaluatorOptions());
+  ZETASQL_ASSERT_OK(query.Prepare(AnalyzerOptions()));
+
+  AsyncExecutionOptions options;
+  options.batch_size = 10;
+  options.max_buffered_batches = 1;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AsyncQueryExecution> execution,
+                       query.ExecuteAfterPrepareAsync({}, {}, options));
+  std::vector<std::vector<Value>> batch;
+  ASSERT_TRUE(execution->NextBatch(&batch));
+  EXPECT_EQ(batch.size(), 10);
+  // The producer is blocked on the full queue. Destroying the execution must
+  // cancel and wait for it.
+  execution.reset();
+}
+
 TEST(PreparedQuery, OutputIsValueTable) {
   PreparedQuery query("select as value 1 a", EvaluatorOptions());
   ZETASQL_EXPECT_OK(query.Prepare(AnalyzerOptions()));
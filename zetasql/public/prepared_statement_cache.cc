@@ -0,0 +1,300 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/prepared_statement_cache.h"
+
+#include <algorithm>
+
+#include "zetasql/proto/options.pb.h"
+#include "zetasql/public/options.pb.h"
+#include "zetasql/public/value.h"
+#include "zetasql/resolved_ast/resolved_ast.h"
+#include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+PreparedStatementCache::PreparedStatementCache(const Options& options)
+    : options_(options) {
+  // Every shard holds at least one entry, and the remainder of the division
+  // is spread over the first shards, so that the shards hold exactly
+  // 'max_entries' entries in total.
+  const int64_t max_entries = std::max<int64_t>(1, options.max_entries);
+  const int num_shards = static_cast<int>(
+      std::min<int64_t>(std::max(1, options.num_shards), max_entries));
+  shards_.reserve(num_shards);
+  for (int i = 0; i < num_shards; ++i) {
+    shards_.push_back(absl::make_unique<Shard>(
+        max_entries / num_shards + (i < max_entries % num_shards ? 1 : 0)));
+  }
+}
+
+zetasql_base::StatusOr<std::string>
+PreparedStatementCache::FingerprintAnalyzerOptions(
+    const AnalyzerOptions& analyzer_options) {
+  FileDescriptorSetMap file_descriptor_set_map;
+  AnalyzerOptionsProto options_proto;
+  ZETASQL_RETURN_IF_ERROR(
+      analyzer_options.Serialize(&file_descriptor_set_map, &options_proto));
+  return options_proto.SerializeAsString();
+}
+
+PreparedStatementCache::Key PreparedStatementCache::MakeKey(
+    StatementKind kind, const std::string& sql,
+    const std::string& options_fingerprint, const Catalog* catalog,
+    int64_t catalog_generation) {
+  Key key;
+  key.kind = kind;
+  key.sql = std::string(absl::StripAsciiWhitespace(sql));
+  key.options_fingerprint = options_fingerprint;
+  key.catalog = catalog;
+  key.catalog_generation = catalog_generation;
+  return key;
+}
+
+PreparedStatementCache::Shard* PreparedStatementCache::GetShard(
+    const Key& key) const {
+  return shards_[absl::Hash<Key>()(key) % shards_.size()].get();
+}
+
+const PreparedStatementCache::Entry* PreparedStatementCache::Lookup(
+    const Key& key, bool update_metrics, Shard* shard) const {
+  auto it = shard->entries.find(key);
+  if (it == shard->entries.end()) {
+    if (update_metrics) {
+      ++shard->misses;
+    }
+    return nullptr;
+  }
+  if (update_metrics) {
+    ++shard->hits;
+  }
+  shard->lru.splice(shard->lru.begin(), shard->lru, it->second);
+  return &*it->second;
+}
+
+const PreparedStatementCache::Entry& PreparedStatementCache::Insert(
+    Entry entry, Shard* shard) {
+  auto it = shard->entries.find(entry.key);
+  if (it != shard->entries.end()) {
+    return *it->second;
+  }
+  shard->lru.push_front(std::move(entry));
+  shard->entries.emplace(shard->lru.front().key, shard->lru.begin());
+  while (shard->lru.size() > shard->max_entries) {
+    shard->entries.erase(shard->lru.back().key);
+    shard->lru.pop_back();
+    ++shard->evictions;
+  }
+  return shard->lru.front();
+}
+
+zetasql_base::StatusOr<PreparedStatementCache::ExpressionHandle>
+PreparedStatementCache::GetOrPrepareExpression(
+    const std::string& sql, const AnalyzerOptions& analyzer_options,
+    Catalog* catalog, int64_t catalog_generation) {
+  ZETASQL_ASSIGN_OR_RETURN(const std::string options_fingerprint,
+                   FingerprintAnalyzerOptions(analyzer_options));
+  return GetOrPrepareExpression(sql, analyzer_options, options_fingerprint,
+                                catalog, catalog_generation);
+}
+
+zetasql_base::StatusOr<PreparedStatementCache::ExpressionHandle>
+PreparedStatementCache::GetOrPrepareExpression(
+    const std::string& sql, const AnalyzerOptions& analyzer_options,
+    const std::string& options_fingerprint, Catalog* catalog,
+    int64_t catalog_generation) {
+  Key key = MakeKey(StatementKind::kExpression, sql, options_fingerprint,
+                    catalog, catalog_generation);
+  Shard* shard = GetShard(key);
+  {
+    absl::MutexLock l(&shard->mutex);
+    const Entry* entry = Lookup(key, /*update_metrics=*/true, shard);
+    if (entry != nullptr) {
+      return ExpressionHandle{entry->expression};
+    }
+  }
+
+  // Prepare without holding the lock, so that lookups of other statements in
+  // the same shard are not blocked.
+  auto expression =
+      std::make_shared<PreparedExpression>(sql, options_.evaluator_options);
+  ZETASQL_RETURN_IF_ERROR(expression->Prepare(analyzer_options, catalog));
+
+  Entry entry;
+  entry.key = std::move(key);
+  entry.expression = std::move(expression);
+  absl::MutexLock l(&shard->mutex);
+  return ExpressionHandle{Insert(std::move(entry), shard).expression};
+}
+
+zetasql_base::StatusOr<PreparedStatementCache::QueryHandle>
+PreparedStatementCache::GetOrPrepareQuery(
+    const std::string& sql, const AnalyzerOptions& analyzer_options,
+    Catalog* catalog, int64_t catalog_generation) {
+  ZETASQL_ASSIGN_OR_RETURN(const std::string options_fingerprint,
+                   FingerprintAnalyzerOptions(analyzer_options));
+  return GetOrPrepareQuery(sql, analyzer_options, options_fingerprint,
+                           catalog, catalog_generation);
+}
+
+zetasql_base::StatusOr<PreparedStatementCache::QueryHandle>
+PreparedStatementCache::GetOrPrepareQuery(
+    const std::string& sql, const AnalyzerOptions& analyzer_options,
+    const std::string& options_fingerprint, Catalog* catalog,
+    int64_t catalog_generation) {
+  Key key = MakeKey(StatementKind::kQuery, sql, options_fingerprint, catalog,
+                    catalog_generation);
+  Shard* shard = GetShard(key);
+  {
+    absl::MutexLock l(&shard->mutex);
+    const Entry* entry = Lookup(key, /*update_metrics=*/true, shard);
+    if (entry != nullptr) {
+      return QueryHandle{entry->query, entry->literal_parameters};
+    }
+  }
+
+  if (options_.parameterize_literals && catalog != nullptr &&
+      analyzer_options.parameter_mode() == PARAMETER_NAMED) {
+    ZETASQL_ASSIGN_OR_RETURN(QueryHandle handle,
+                     GetOrPrepareParameterizedQuery(
+                         sql, analyzer_options, catalog, catalog_generation));
+    if (handle.query != nullptr) {
+      // Cache the text as well, so that the next lookup of the same text does
+      // not analyze it again.
+      Entry entry;
+      entry.key = std::move(key);
+      entry.query = handle.query;
+      entry.literal_parameters = handle.literal_parameters;
+      absl::MutexLock l(&shard->mutex);
+      const Entry& cached = Insert(std::move(entry), shard);
+      return QueryHandle{cached.query, cached.literal_parameters};
+    }
+  }
+
+  QueryHandle handle;
+  ZETASQL_ASSIGN_OR_RETURN(handle.query,
+                   GetOrPrepareQueryImpl(key, sql, analyzer_options, catalog,
+                                         /*update_metrics=*/false));
+  return handle;
+}
+
+zetasql_base::StatusOr<PreparedStatementCache::QueryHandle>
+PreparedStatementCache::GetOrPrepareParameterizedQuery(
+    const std::string& sql, const AnalyzerOptions& analyzer_options,
+    Catalog* catalog, int64_t catalog_generation) {
+  AnalyzerOptions literal_options = analyzer_options;
+  literal_options.set_record_parse_locations(true);
+  // Owns the types created by this analysis, which would otherwise
+  // accumulate for as long as the cache exists. Declared before
+  // 'analyzer_output', which refers to them.
+  TypeFactory type_factory;
+  std::unique_ptr<const AnalyzerOutput> analyzer_output;
+  ZETASQL_RETURN_IF_ERROR(AnalyzeStatement(sql, literal_options, catalog,
+                                   &type_factory, &analyzer_output));
+  LiteralReplacementMap literal_map;
+  GeneratedParameterMap generated_parameters;
+  std::string parameterized_sql;
+  if (analyzer_output->resolved_statement()->node_kind() ==
+      RESOLVED_QUERY_STMT) {
+    ZETASQL_RETURN_IF_ERROR(ReplaceLiteralsByParameters(
+        sql, literal_options, analyzer_output.get(), &literal_map,
+        &generated_parameters, &parameterized_sql));
+  }
+  // The parameters must not refer to 'type_factory', since they are
+  // returned to the caller and their types are used to prepare the query.
+  // Simple types are not owned by any TypeFactory. The queries with other
+  // literals (e.g., arrays and structs) are cached as they are.
+  const bool has_only_simple_types = std::all_of(
+      generated_parameters.begin(), generated_parameters.end(),
+      [](const GeneratedParameterMap::value_type& parameter) {
+        return parameter.second.type()->IsSimpleType();
+      });
+  QueryHandle handle;
+  if (parameterized_sql.empty() || !has_only_simple_types) {
+    return handle;
+  }
+  AnalyzerOptions parameterized_options = analyzer_options;
+  for (const auto& parameter : generated_parameters) {
+    ZETASQL_RETURN_IF_ERROR(parameterized_options.AddQueryParameter(
+        parameter.first, parameter.second.type()));
+  }
+  // This only runs when the text is not cached and has just been analyzed,
+  // so serializing the options again is comparatively cheap.
+  ZETASQL_ASSIGN_OR_RETURN(const std::string parameterized_fingerprint,
+                   FingerprintAnalyzerOptions(parameterized_options));
+  const Key key = MakeKey(StatementKind::kQuery, parameterized_sql,
+                          parameterized_fingerprint, catalog,
+                          catalog_generation);
+  zetasql_base::StatusOr<std::shared_ptr<const PreparedQuery>> query =
+      GetOrPrepareQueryImpl(key, parameterized_sql, parameterized_options,
+                            catalog, /*update_metrics=*/false);
+  if (query.ok()) {
+    handle.query = std::move(query).value();
+    handle.literal_parameters = std::move(generated_parameters);
+  }
+  // Otherwise not every literal can be replaced by a parameter, so the caller
+  // falls back to caching the query as it was written.
+  return handle;
+}
+
+zetasql_base::StatusOr<std::shared_ptr<const PreparedQuery>>
+PreparedStatementCache::GetOrPrepareQueryImpl(
+    const Key& key, const std::string& sql,
+    const AnalyzerOptions& analyzer_options, Catalog* catalog,
+    bool update_metrics) {
+  Shard* shard = GetShard(key);
+  {
+    absl::MutexLock l(&shard->mutex);
+    const Entry* entry = Lookup(key, update_metrics, shard);
+    if (entry != nullptr) {
+      return entry->query;
+    }
+  }
+
+  auto query = std::make_shared<PreparedQuery>(sql, options_.evaluator_options);
+  ZETASQL_RETURN_IF_ERROR(query->Prepare(analyzer_options, catalog));
+
+  Entry entry;
+  entry.key = key;
+  entry.query = std::move(query);
+  absl::MutexLock l(&shard->mutex);
+  return Insert(std::move(entry), shard).query;
+}
+
+void PreparedStatementCache::Clear() {
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    absl::MutexLock l(&shard->mutex);
+    shard->entries.clear();
+    shard->lru.clear();
+  }
+}
+
+PreparedStatementCache::Metrics PreparedStatementCache::GetMetrics() const {
+  Metrics metrics;
+  for (const std::unique_ptr<Shard>& shard : shards_) {
+    absl::MutexLock l(&shard->mutex);
+    metrics.hits += shard->hits;
+    metrics.misses += shard->misses;
+    metrics.evictions += shard->evictions;
+    metrics.entries += shard->lru.size();
+  }
+  return metrics;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,253 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_PUBLIC_PREPARED_STATEMENT_CACHE_H_
+#define ZETASQL_PUBLIC_PREPARED_STATEMENT_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/catalog.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/type.h"
+#include <cstdint>
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/synchronization/mutex.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+// A thread-safe cache of prepared expressions and queries, for services that
+// repeatedly evaluate the same SQL. Preparing a statement parses, analyzes
+// and algebrizes it, which is usually much more expensive than evaluating it.
+//
+// Entries are keyed by:
+// - the SQL text, with leading and trailing whitespace removed,
+// - the serialized AnalyzerOptions (which include the LanguageOptions), see
+//   FingerprintAnalyzerOptions(), and
+// - the Catalog and a caller-provided catalog generation. Callers must pass a
+//   new generation whenever the contents of the catalog change, so that
+//   statements prepared against the old contents are no longer returned.
+// AnalyzerOptions that cannot be serialized, like the
+// lookup_expression_column_callback, are not part of the key.
+//
+// The cache is split into shards with their own lock and LRU list, so that
+// lookups from different threads rarely contend. The entries are divided
+// among the shards so that there are never more than 'max_entries' of them.
+// Each shard evicts its least recently used entry when it is full.
+//
+// Example:
+//   PreparedStatementCache cache(PreparedStatementCache::Options{});
+//   ZETASQL_ASSIGN_OR_RETURN(PreparedStatementCache::QueryHandle handle,
+//                    cache.GetOrPrepareQuery(sql, analyzer_options, &catalog,
+//                                            catalog_generation));
+//   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<EvaluatorTableIterator> iter,
+//                    handle.query->ExecuteAfterPrepare(parameters));
+//
+// The returned statements are shared, so they can only be executed with the
+// thread-safe ExecuteAfterPrepare*() methods. They remain valid after they
+// are evicted, for as long as the caller holds on to them. The Catalog must
+// outlive every statement prepared with it.
+class PreparedStatementCache {
+ public:
+  struct Options {
+    // The maximum number of prepared statements in the cache.
+    int64_t max_entries = 1024;
+
+    // The number of independently locked shards. There are never more shards
+    // than 'max_entries'.
+    int num_shards = 16;
+
+    // If true, literals in queries are replaced by query parameters, so
+    // queries that only differ in their literals share a single prepared
+    // query. A query whose text is not in the cache is analyzed to find its
+    // literals, which skips the algebrizer if the parameterized query is
+    // cached. The text is then cached as a second entry that refers to the
+    // same prepared query, so repeating the same text does not analyze it
+    // again. Such a lookup counts as one miss. It only applies to queries
+    // that use named parameters and are prepared with a Catalog. Queries
+    // whose literals cannot all be replaced by parameters, or that have
+    // literals of types other than simple types (e.g., arrays and structs),
+    // are cached as they are.
+    bool parameterize_literals = false;
+
+    // The options used to construct every prepared statement.
+    EvaluatorOptions evaluator_options;
+  };
+
+  struct Metrics {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+    int64_t entries = 0;
+
+    // Returns the fraction of lookups that found their statement in the cache.
+    double hit_rate() const {
+      const int64_t lookups = hits + misses;
+      return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+    }
+  };
+
+  struct ExpressionHandle {
+    std::shared_ptr<const PreparedExpression> expression;
+  };
+
+  struct QueryHandle {
+    std::shared_ptr<const PreparedQuery> query;
+
+    // The values of the parameters that replaced literals in the query. They
+    // must be passed to ExecuteAfterPrepare() along with the caller's own
+    // parameters. Always empty unless 'parameterize_literals' is set.
+    ParameterValueMap literal_parameters;
+  };
+
+  explicit PreparedStatementCache(const Options& options);
+  PreparedStatementCache(const PreparedStatementCache&) = delete;
+  PreparedStatementCache& operator=(const PreparedStatementCache&) = delete;
+
+  // Returns the fingerprint of 'analyzer_options' that is part of the cache
+  // keys. Computing it serializes the options, so callers that look up many
+  // statements with the same options should compute it once and pass it to
+  // the overloads below that take it.
+  static zetasql_base::StatusOr<std::string> FingerprintAnalyzerOptions(
+      const AnalyzerOptions& analyzer_options);
+
+  // Returns the prepared expression for 'sql', preparing it with
+  // 'analyzer_options' and 'catalog' if it is not in the cache. Analysis
+  // errors are returned and are not cached. 'options_fingerprint' must be
+  // FingerprintAnalyzerOptions('analyzer_options').
+  zetasql_base::StatusOr<ExpressionHandle> GetOrPrepareExpression(
+      const std::string& sql, const AnalyzerOptions& analyzer_options,
+      const std::string& options_fingerprint, Catalog* catalog,
+      int64_t catalog_generation);
+
+  // Same as above, but computes the fingerprint of 'analyzer_options'.
+  zetasql_base::StatusOr<ExpressionHandle> GetOrPrepareExpression(
+      const std::string& sql, const AnalyzerOptions& analyzer_options,
+      Catalog* catalog, int64_t catalog_generation);
+
+  // Same as GetOrPrepareExpression(), but for queries.
+  zetasql_base::StatusOr<QueryHandle> GetOrPrepareQuery(
+      const std::string& sql, const AnalyzerOptions& analyzer_options,
+      const std::string& options_fingerprint, Catalog* catalog,
+      int64_t catalog_generation);
+
+  zetasql_base::StatusOr<QueryHandle> GetOrPrepareQuery(
+      const std::string& sql, const AnalyzerOptions& analyzer_options,
+      Catalog* catalog, int64_t catalog_generation);
+
+  // Removes all entries. Does not reset the metrics.
+  void Clear();
+
+  Metrics GetMetrics() const;
+
+ private:
+  enum class StatementKind { kExpression, kQuery };
+
+  struct Key {
+    StatementKind kind;
+    std::string sql;
+    // See FingerprintAnalyzerOptions().
+    std::string options_fingerprint;
+    const Catalog* catalog;
+    int64_t catalog_generation;
+
+    bool operator==(const Key& other) const {
+      return kind == other.kind && catalog == other.catalog &&
+             catalog_generation == other.catalog_generation &&
+             sql == other.sql &&
+             options_fingerprint == other.options_fingerprint;
+    }
+
+    template <typename H>
+    friend H AbslHashValue(H h, const Key& key) {
+      return H::combine(std::move(h), key.kind, key.sql,
+                        key.options_fingerprint, key.catalog,
+                        key.catalog_generation);
+    }
+  };
+
+  // Exactly one of 'expression' and 'query' is set, according to the kind of
+  // the key. 'literal_parameters' is only set for the text of a query whose
+  // literals were replaced by parameters.
+  struct Entry {
+    Key key;
+    std::shared_ptr<const PreparedExpression> expression;
+    std::shared_ptr<const PreparedQuery> query;
+    ParameterValueMap literal_parameters;
+  };
+
+  struct Shard {
+    explicit Shard(int64_t max_entries) : max_entries(max_entries) {}
+
+    const int64_t max_entries;
+    mutable absl::Mutex mutex;
+    // The most recently used entry is at the front.
+    std::list<Entry> lru ABSL_GUARDED_BY(mutex);
+    absl::flat_hash_map<Key, std::list<Entry>::iterator, absl::Hash<Key>>
+        entries ABSL_GUARDED_BY(mutex);
+    int64_t hits ABSL_GUARDED_BY(mutex) = 0;
+    int64_t misses ABSL_GUARDED_BY(mutex) = 0;
+    int64_t evictions ABSL_GUARDED_BY(mutex) = 0;
+  };
+
+  // Returns the key for 'sql' and the options with 'options_fingerprint'.
+  static Key MakeKey(StatementKind kind, const std::string& sql,
+                     const std::string& options_fingerprint,
+                     const Catalog* catalog, int64_t catalog_generation);
+
+  Shard* GetShard(const Key& key) const;
+
+  // Returns the entry for 'key' and marks it as most recently used, or returns
+  // nullptr if there is none. Updates the hit and miss counts if
+  // 'update_metrics' is true.
+  const Entry* Lookup(const Key& key, bool update_metrics, Shard* shard) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mutex);
+
+  // Inserts 'entry' unless another thread inserted an entry with the same key
+  // first, evicting the least recently used entry if the shard is full.
+  // Returns the entry that is in the cache.
+  const Entry& Insert(Entry entry, Shard* shard)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mutex);
+
+  // Prepares 'sql' as a query and caches it under 'key', unless an entry
+  // with 'key' is found. Only updates the hit and miss counts if
+  // 'update_metrics' is true.
+  zetasql_base::StatusOr<std::shared_ptr<const PreparedQuery>> GetOrPrepareQueryImpl(
+      const Key& key, const std::string& sql,
+      const AnalyzerOptions& analyzer_options, Catalog* catalog,
+      bool update_metrics);
+
+  // Replaces the literals of the query 'sql' by parameters, and returns the
+  // handle of the parameterized query. Returns a handle without a query if
+  // the literals cannot be replaced.
+  zetasql_base::StatusOr<QueryHandle> GetOrPrepareParameterizedQuery(
+      const std::string& sql, const AnalyzerOptions& analyzer_options,
+      Catalog* catalog, int64_t catalog_generation);
+
+  const Options options_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_PUBLIC_PREPARED_STATEMENT_CACHE_H_
@@ -0,0 +1,201 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/prepared_statement_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "zetasql/base/testing/status_matchers.h"
+#include "zetasql/public/analyzer.h"
+#include "zetasql/public/evaluator.h"
+#include "zetasql/public/language_options.h"
+#include "zetasql/public/simple_catalog.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace zetasql {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+using ::zetasql_base::testing::IsOkAndHolds;
+using ::zetasql_base::testing::StatusIs;
+
+TEST(PreparedStatementCacheTest, ExpressionHitsAndMisses) {
+  PreparedStatementCache cache(PreparedStatementCache::Options{});
+  AnalyzerOptions options;
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(PreparedStatementCache::ExpressionHandle first,
+                       cache.GetOrPrepareExpression("1 + 2", options,
+                                                    /*catalog=*/nullptr,
+                                                    /*catalog_generation=*/0));
+  EXPECT_THAT(first.expression->ExecuteAfterPrepare(),
+              IsOkAndHolds(Value::Int64(3)));
+
+  // Surrounding whitespace does not affect the key.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(PreparedStatementCache::ExpressionHandle second,
+                       cache.GetOrPrepareExpression("  1 + 2\n", options,
+                                                    /*catalog=*/nullptr,
+                                                    /*catalog_generation=*/0));
+  EXPECT_EQ(first.expression, second.expression);
+
+  // Different analyzer options and catalog generations are separate entries.
+  AnalyzerOptions other_options;
+  other_options.mutable_language()->EnableMaximumLanguageFeatures();
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::ExpressionHandle third,
+      cache.GetOrPrepareExpression("1 + 2", other_options, /*catalog=*/nullptr,
+                                   /*catalog_generation=*/0));
+  EXPECT_NE(first.expression, third.expression);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(PreparedStatementCache::ExpressionHandle fourth,
+                       cache.GetOrPrepareExpression("1 + 2", options,
+                                                    /*catalog=*/nullptr,
+                                                    /*catalog_generation=*/1));
+  EXPECT_NE(first.expression, fourth.expression);
+
+  // Analysis errors are not cached.
+  EXPECT_THAT(cache.GetOrPrepareExpression("1 +", options, /*catalog=*/nullptr,
+                                           /*catalog_generation=*/0),
+              StatusIs(absl::StatusCode::kInvalidArgument,
+                       HasSubstr("Syntax error")));
+
+  const PreparedStatementCache::Metrics metrics = cache.GetMetrics();
+  EXPECT_EQ(metrics.hits, 1);
+  EXPECT_EQ(metrics.misses, 4);
+  EXPECT_EQ(metrics.evictions, 0);
+  EXPECT_EQ(metrics.entries, 3);
+  EXPECT_DOUBLE_EQ(metrics.hit_rate(), 0.2);
+
+  cache.Clear();
+  EXPECT_EQ(cache.GetMetrics().entries, 0);
+}
+
+TEST(PreparedStatementCacheTest, EvictsLeastRecentlyUsed) {
+  PreparedStatementCache::Options cache_options;
+  cache_options.max_entries = 2;
+  cache_options.num_shards = 1;
+  PreparedStatementCache cache(cache_options);
+  AnalyzerOptions options;
+
+  for (const char* sql : {"1", "2", "1", "3", "1", "2"}) {
+    ZETASQL_ASSERT_OK(cache.GetOrPrepareExpression(sql, options, /*catalog=*/nullptr,
+                                           /*catalog_generation=*/0)
+                  .status());
+  }
+  // "1" stays in the cache because it is used repeatedly, while "2" is
+  // evicted by "3" and "3" is evicted by "2".
+  const PreparedStatementCache::Metrics metrics = cache.GetMetrics();
+  EXPECT_EQ(metrics.hits, 2);
+  EXPECT_EQ(metrics.misses, 4);
+  EXPECT_EQ(metrics.evictions, 2);
+  EXPECT_EQ(metrics.entries, 2);
+}
+
+TEST(PreparedStatementCacheTest, ShardsHoldExactlyMaxEntries) {
+  for (int num_shards : {1, 2, 3, 16}) {
+    PreparedStatementCache::Options cache_options;
+    cache_options.max_entries = 5;
+    cache_options.num_shards = num_shards;
+    PreparedStatementCache cache(cache_options);
+    AnalyzerOptions options;
+    ZETASQL_ASSERT_OK_AND_ASSIGN(
+        const std::string options_fingerprint,
+        PreparedStatementCache::FingerprintAnalyzerOptions(options));
+    for (int i = 0; i < 100; ++i) {
+      ZETASQL_ASSERT_OK(cache
+                    .GetOrPrepareExpression(std::to_string(i), options,
+                                            options_fingerprint,
+                                            /*catalog=*/nullptr,
+                                            /*catalog_generation=*/0)
+                    .status());
+      EXPECT_LE(cache.GetMetrics().entries, 5) << num_shards;
+    }
+  }
+}
+
+TEST(PreparedStatementCacheTest, ParameterizeLiterals) {
+  PreparedStatementCache::Options cache_options;
+  cache_options.parameterize_literals = true;
+  PreparedStatementCache cache(cache_options);
+  SimpleCatalog catalog("catalog");
+  catalog.AddZetaSQLFunctions();
+  AnalyzerOptions options;
+  ZETASQL_ASSERT_OK(options.AddQueryParameter("param", types::Int64Type()));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::QueryHandle first,
+      cache.GetOrPrepareQuery("SELECT 1 + @param AS x", options, &catalog,
+                              /*catalog_generation=*/0));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::QueryHandle second,
+      cache.GetOrPrepareQuery("SELECT 10 + @param AS x", options, &catalog,
+                              /*catalog_generation=*/0));
+  EXPECT_EQ(first.query, second.query);
+  EXPECT_THAT(first.literal_parameters, SizeIs(1));
+  // Each text is cached along with the parameterized query.
+  EXPECT_EQ(cache.GetMetrics().entries, 3);
+  EXPECT_EQ(cache.GetMetrics().hits, 0);
+
+  // The same text is found without analyzing it again.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::QueryHandle repeated,
+      cache.GetOrPrepareQuery("SELECT 10 + @param AS x", options, &catalog,
+                              /*catalog_generation=*/0));
+  EXPECT_EQ(repeated.query, second.query);
+  EXPECT_EQ(repeated.literal_parameters, second.literal_parameters);
+  EXPECT_EQ(cache.GetMetrics().hits, 1);
+  EXPECT_EQ(cache.GetMetrics().misses, 2);
+
+  ParameterValueMap parameters = second.literal_parameters;
+  parameters["param"] = Value::Int64(5);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<EvaluatorTableIterator> iter,
+                       second.query->ExecuteAfterPrepare(parameters));
+  ASSERT_TRUE(iter->NextRow());
+  EXPECT_EQ(iter->GetValue(0), Value::Int64(15));
+  EXPECT_FALSE(iter->NextRow());
+  ZETASQL_EXPECT_OK(iter->Status());
+
+  // A literal of a different type is a different parameter.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::QueryHandle third,
+      cache.GetOrPrepareQuery("SELECT 1.5 + @param AS x", options, &catalog,
+                              /*catalog_generation=*/0));
+  EXPECT_NE(first.query, third.query);
+
+  // Without literals there is nothing to replace.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::QueryHandle fourth,
+      cache.GetOrPrepareQuery("SELECT @param AS x", options, &catalog,
+                              /*catalog_generation=*/0));
+  EXPECT_THAT(fourth.literal_parameters, IsEmpty());
+  EXPECT_EQ(cache.GetMetrics().entries, 6);
+
+  // Queries with literals of types that a TypeFactory must own are cached as
+  // they are.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      PreparedStatementCache::QueryHandle fifth,
+      cache.GetOrPrepareQuery("SELECT ARRAY_LENGTH([1, 2]) + @param AS x",
+                              options, &catalog, /*catalog_generation=*/0));
+  EXPECT_THAT(fifth.literal_parameters, IsEmpty());
+  EXPECT_EQ(cache.GetMetrics().entries, 7);
+}
+
+}  // namespace
+}  // namespace zetasql
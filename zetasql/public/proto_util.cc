@@ -39,6 +39,7 @@
 #include "absl/base/optimization.h"
 #include "absl/container/inlined_vector.h"
 #include "absl/flags/flag.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/variant.h"
@@ -889,109 +890,88 @@ using ElementValueList = std::vector<std::vector<zetasql_base::StatusOr<Value>>>
 
 }  // namespace
 
-absl::Status ReadProtoFields(
-    absl::Span<const ProtoFieldInfo* const> field_infos,
-    const absl::Cord& bytes, ProtoFieldValueList* field_value_list) {
-  const bool use_optimization =
-      field_infos.size() == 1 &&
-      absl::GetFlag(FLAGS_zetasql_read_proto_field_optimized_path);
-
-  if (use_optimization) {
-    ZETASQL_ASSIGN_OR_RETURN(zetasql_base::StatusOr<Value> value,
-                     ReadSingularProtoField(*field_infos[0], bytes));
-    field_value_list->push_back(std::move(value));
-    return absl::OkStatus();
-  }
-
-  field_value_list->resize(field_infos.size());
-
+static FieldInfoMap MakeFieldInfoMap(
+    absl::Span<const ProtoFieldInfo* const> field_infos) {
   FieldInfoMap field_info_map;
   for (int i = 0; i < field_infos.size(); ++i) {
     const ProtoFieldInfo* field_info = field_infos[i];
     field_info_map[field_info->descriptor->number()].push_back(i);
   }
+  return field_info_map;
+}
 
-  // If get_has_bit is true, this is either empty or contains a single
-  // Value::Bool(true).
-  ElementValueList element_value_list(field_infos.size());
-  ZETASQL_RET_CHECK(!field_infos.empty());
-  const google::protobuf::FieldDescriptor* some_field = field_infos[0]->descriptor;
-    uint32_t tag_and_type;
-    std::string bytes_str(bytes);
-    google::protobuf::io::ArrayInputStream cord_stream(bytes_str.data(),
-    bytes_str.size());
-    google::protobuf::io::CodedInputStream in(&cord_stream);
-    while (0 < (tag_and_type = in.ReadTag())) {
-      const int tag_number = WireFormatLite::GetTagFieldNumber(tag_and_type);
-      const std::vector<int>* info_idxs =
-          zetasql_base::FindOrNull(field_info_map, tag_number);
-      if (info_idxs == nullptr) {
-        if (ABSL_PREDICT_TRUE(WireFormatLite::SkipField(&in, tag_and_type))) {
-          continue;
-        }
-        return ::zetasql_base::OutOfRangeErrorBuilder()
-               << "Corrupted protocol buffer: "
-               << "Failed to skip field with tag number " << tag_number
-               << " in " << some_field->containing_type()->full_name();
-      }
-      // All of the field descriptors must come from the same
-      // google::protobuf::Descriptor, so for a particular tag number, they are all the
-      // same.
-      ZETASQL_RET_CHECK(!info_idxs->empty());
-      const google::protobuf::FieldDescriptor* descriptor =
-          field_infos[(*info_idxs)[0]]->descriptor;
-
-      PackedValuesVector wire_values;
-      // Protocol buffer parsers must be able to parse repeated fields that were
-      // compiled as packed as if they were not packed, and vice versa.  Both
-      // packed and non-packed field occurrences may appear within the same
-      // message.
-      if (descriptor->is_packable() && IsPackedWireType(tag_and_type)) {
-        if (ABSL_PREDICT_FALSE(!ReadPackedWireValues(
-                descriptor->number(), descriptor->type(), &in, &wire_values))) {
-          return ::zetasql_base::OutOfRangeErrorBuilder()
-                 << "Corrupted protocol buffer: "
-                 << "Failed to read packed elements for field "
-                 << descriptor->full_name();
-        }
-      } else {
-        WireValueType wire_value;
-        if (ABSL_PREDICT_FALSE(!ReadWireValue(descriptor->type(), tag_and_type,
-                                              bytes, &in, &wire_value))) {
-          return zetasql_base::OutOfRangeErrorBuilder()
-                 << "Corrupted protocol buffer: Failed to read value for field "
-                 << descriptor->full_name();
-        }
-        wire_values.push_back(std::move(wire_value));
-      }
-      ZETASQL_RET_CHECK(!wire_values.empty());
+// Reads the value of the field at the front of 'in' (which is backed by
+// 'bytes'), whose tag 'tag_and_type' has already been consumed, and appends the
+// corresponding elements for the ProtoFieldInfos at 'info_idxs' to
+// 'element_value_list'.
+static absl::Status ReadFieldElements(
+    absl::Span<const ProtoFieldInfo* const> field_infos,
+    const std::vector<int>& info_idxs, uint32_t tag_and_type,
+    const absl::Cord& bytes, google::protobuf::io::CodedInputStream* in,
+    ElementValueList* element_value_list) {
+  // All of the field descriptors must come from the same
+  // google::protobuf::Descriptor, so for a particular tag number, they are all the
+  // same.
+  ZETASQL_RET_CHECK(!info_idxs.empty());
+  const google::protobuf::FieldDescriptor* descriptor =
+      field_infos[info_idxs[0]]->descriptor;
+
+  PackedValuesVector wire_values;
+  // Protocol buffer parsers must be able to parse repeated fields that were
+  // compiled as packed as if they were not packed, and vice versa.  Both
+  // packed and non-packed field occurrences may appear within the same
+  // message.
+  if (descriptor->is_packable() && IsPackedWireType(tag_and_type)) {
+    if (ABSL_PREDICT_FALSE(!ReadPackedWireValues(
+            descriptor->number(), descriptor->type(), in, &wire_values))) {
+      return ::zetasql_base::OutOfRangeErrorBuilder()
+             << "Corrupted protocol buffer: "
+             << "Failed to read packed elements for field "
+             << descriptor->full_name();
+    }
+  } else {
+    WireValueType wire_value;
+    if (ABSL_PREDICT_FALSE(!ReadWireValue(descriptor->type(), tag_and_type,
+                                          bytes, in, &wire_value))) {
+      return zetasql_base::OutOfRangeErrorBuilder()
+             << "Corrupted protocol buffer: Failed to read value for field "
+             << descriptor->full_name();
+    }
+    wire_values.push_back(std::move(wire_value));
+  }
+  ZETASQL_RET_CHECK(!wire_values.empty());
 
-      for (int i = 0; i < info_idxs->size(); ++i) {
-        const int idx = (*info_idxs)[i];
-        const ProtoFieldInfo* info = field_infos[idx];
-        std::vector<zetasql_base::StatusOr<Value>>& elements = element_value_list[idx];
+  for (const int idx : info_idxs) {
+    const ProtoFieldInfo* info = field_infos[idx];
+    std::vector<zetasql_base::StatusOr<Value>>& elements = (*element_value_list)[idx];
 
-        if (info->get_has_bit) {
-          if (elements.empty()) {
-            elements.push_back(Value::Bool(true));
-          }
-        } else {
-          const Type* element_type = info->type->IsArray()
-                                         ? info->type->AsArray()->element_type()
-                                         : info->type;
-          for (const WireValueType& wire_value : wire_values) {
-            elements.push_back(TranslateWireValue(wire_value, descriptor,
-                                                  info->format, element_type));
-          }
-        }
+    if (info->get_has_bit) {
+      if (elements.empty()) {
+        elements.push_back(Value::Bool(true));
+      }
+    } else {
+      const Type* element_type = info->type->IsArray()
+                                     ? info->type->AsArray()->element_type()
+                                     : info->type;
+      for (const WireValueType& wire_value : wire_values) {
+        elements.push_back(TranslateWireValue(wire_value, descriptor,
+                                              info->format, element_type));
       }
     }
+  }
+  return absl::OkStatus();
+}
 
-  // Now that we have read all of the values we care about, use them to populate
-  // 'field_value_list'.
+// Populates 'field_value_list' from the values we have read for each of the
+// 'field_infos'.
+static absl::Status PopulateFieldValueList(
+    absl::Span<const ProtoFieldInfo* const> field_infos,
+    ElementValueList* element_value_list,
+    ProtoFieldValueList* field_value_list) {
+  field_value_list->resize(field_infos.size());
   for (int i = 0; i < field_infos.size(); ++i) {
     const ProtoFieldInfo* info = field_infos[i];
-    std::vector<zetasql_base::StatusOr<Value>>& values = element_value_list[i];
+    std::vector<zetasql_base::StatusOr<Value>>& values = (*element_value_list)[i];
     if (info->get_has_bit) {
       (*field_value_list)[i] = Value::Bool(!values.empty());
     } else {
@@ -1032,6 +1012,124 @@ absl::Status ReadProtoFields(
   return absl::OkStatus();
 }
 
+absl::Status ReadProtoFields(
+    absl::Span<const ProtoFieldInfo* const> field_infos,
+    const absl::Cord& bytes, ProtoFieldValueList* field_value_list) {
+  const bool use_optimization =
+      field_infos.size() == 1 &&
+      absl::GetFlag(FLAGS_zetasql_read_proto_field_optimized_path);
+
+  if (use_optimization) {
+    ZETASQL_ASSIGN_OR_RETURN(zetasql_base::StatusOr<Value> value,
+                     ReadSingularProtoField(*field_infos[0], bytes));
+    field_value_list->push_back(std::move(value));
+    return absl::OkStatus();
+  }
+
+  const FieldInfoMap field_info_map = MakeFieldInfoMap(field_infos);
+
+  // If get_has_bit is true, this is either empty or contains a single
+  // Value::Bool(true).
+  ElementValueList element_value_list(field_infos.size());
+  ZETASQL_RET_CHECK(!field_infos.empty());
+  const google::protobuf::FieldDescriptor* some_field = field_infos[0]->descriptor;
+    uint32_t tag_and_type;
+    std::string bytes_str(bytes);
+    google::protobuf::io::ArrayInputStream cord_stream(bytes_str.data(),
+    bytes_str.size());
+    google::protobuf::io::CodedInputStream in(&cord_stream);
+    while (0 < (tag_and_type = in.ReadTag())) {
+      const int tag_number = WireFormatLite::GetTagFieldNumber(tag_and_type);
+      const std::vector<int>* info_idxs =
+          zetasql_base::FindOrNull(field_info_map, tag_number);
+      if (info_idxs == nullptr) {
+        if (ABSL_PREDICT_TRUE(WireFormatLite::SkipField(&in, tag_and_type))) {
+          continue;
+        }
+        return ::zetasql_base::OutOfRangeErrorBuilder()
+               << "Corrupted protocol buffer: "
+               << "Failed to skip field with tag number " << tag_number
+               << " in " << some_field->containing_type()->full_name();
+      }
+      ZETASQL_RETURN_IF_ERROR(ReadFieldElements(field_infos, *info_idxs,
+                                        tag_and_type, bytes, &in,
+                                        &element_value_list));
+    }
+
+  // Now that we have read all of the values we care about, use them to populate
+  // 'field_value_list'.
+  return PopulateFieldValueList(field_infos, &element_value_list,
+                                field_value_list);
+}
+
+zetasql_base::StatusOr<std::unique_ptr<const ProtoFieldOffsetIndex>>
+ProtoFieldOffsetIndex::Create(const google::protobuf::Descriptor* descriptor,
+                              const absl::Cord& bytes) {
+  auto index = absl::WrapUnique(new ProtoFieldOffsetIndex(bytes));
+  const std::string& bytes_str = index->flat_bytes_;
+  google::protobuf::io::ArrayInputStream stream(bytes_str.data(), bytes_str.size());
+  google::protobuf::io::CodedInputStream in(&stream);
+  int offset = in.CurrentPosition();
+  uint32_t tag_and_type;
+  while (0 < (tag_and_type = in.ReadTag())) {
+    const int tag_number = WireFormatLite::GetTagFieldNumber(tag_and_type);
+    if (ABSL_PREDICT_FALSE(!WireFormatLite::SkipField(&in, tag_and_type))) {
+      return ::zetasql_base::OutOfRangeErrorBuilder()
+             << "Corrupted protocol buffer: "
+             << "Failed to skip field with tag number " << tag_number << " in "
+             << descriptor->full_name();
+    }
+    index->offsets_by_field_number_[tag_number].push_back(offset);
+    offset = in.CurrentPosition();
+  }
+  return std::move(index);
+}
+
+const std::vector<int>* ProtoFieldOffsetIndex::FindField(
+    int field_number) const {
+  return zetasql_base::FindOrNull(offsets_by_field_number_, field_number);
+}
+
+int64_t ProtoFieldOffsetIndex::GetPhysicalByteSize() const {
+  int64_t byte_size = sizeof(ProtoFieldOffsetIndex) + flat_bytes_.capacity();
+  for (const auto& entry : offsets_by_field_number_) {
+    byte_size += sizeof(entry) + sizeof(int) * entry.second.capacity();
+  }
+  return byte_size;
+}
+
+absl::Status ReadProtoFields(
+    absl::Span<const ProtoFieldInfo* const> field_infos,
+    const ProtoFieldOffsetIndex& index, ProtoFieldValueList* field_value_list) {
+  ZETASQL_RET_CHECK(!field_infos.empty());
+  const FieldInfoMap field_info_map = MakeFieldInfoMap(field_infos);
+
+  // If get_has_bit is true, this is either empty or contains a single
+  // Value::Bool(true).
+  ElementValueList element_value_list(field_infos.size());
+  const absl::string_view bytes_str = index.flat_bytes();
+  for (const auto& entry : field_info_map) {
+    const std::vector<int>* offsets = index.FindField(entry.first);
+    if (offsets == nullptr) continue;
+    // Positions are relative to the start of the proto, which is required to
+    // extract groups from index.bytes().
+    google::protobuf::io::ArrayInputStream stream(bytes_str.data(), bytes_str.size());
+    google::protobuf::io::CodedInputStream in(&stream);
+    for (const int offset : *offsets) {
+      ZETASQL_RET_CHECK(in.Skip(offset - in.CurrentPosition()));
+      const uint32_t tag_and_type = in.ReadTag();
+      ZETASQL_RET_CHECK_EQ(WireFormatLite::GetTagFieldNumber(tag_and_type),
+                   entry.first);
+      ZETASQL_RETURN_IF_ERROR(ReadFieldElements(field_infos, entry.second,
+                                        tag_and_type, index.bytes(), &in,
+                                        &element_value_list));
+    }
+  }
+
+  return PopulateFieldValueList(field_infos, &element_value_list,
+                                field_value_list);
+}
+
 absl::Status ReadProtoField(const google::protobuf::FieldDescriptor* field_descr,
                             FieldFormat::Format format, const Type* type,
                             const Value& default_value, bool get_has_bit,
@@ -17,6 +17,8 @@
 #ifndef ZETASQL_PUBLIC_PROTO_UTIL_H_
 #define ZETASQL_PUBLIC_PROTO_UTIL_H_
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "google/protobuf/descriptor.h"
@@ -27,6 +29,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/flags/declare.h"
 #include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
 
@@ -126,6 +129,50 @@ absl::Status ReadProtoFields(
     absl::Span<const ProtoFieldInfo* const> field_infos,
     const absl::Cord& bytes, ProtoFieldValueList* field_value_list);
 
+// Records where each field occurs in a serialized proto. The index is built in
+// a single pass that skips over the (tag, value) pairs without decoding them,
+// after which ReadProtoFields() can decode just the requested fields instead of
+// scanning the whole proto again. This pays off when the same proto is read
+// more than once, e.g., by several lists of ProtoFieldInfos.
+class ProtoFieldOffsetIndex {
+ public:
+  // Builds the index for 'bytes', which is a serialized proto of 'descriptor'.
+  // Returns an error if 'bytes' is corrupted.
+  static zetasql_base::StatusOr<std::unique_ptr<const ProtoFieldOffsetIndex>> Create(
+      const google::protobuf::Descriptor* descriptor, const absl::Cord& bytes);
+
+  ProtoFieldOffsetIndex(const ProtoFieldOffsetIndex&) = delete;
+  ProtoFieldOffsetIndex& operator=(const ProtoFieldOffsetIndex&) = delete;
+
+  // Returns the offsets into flat_bytes() of the (tag, value) pairs with field
+  // number 'field_number', in wire order, or NULL if the field does not occur.
+  // A packed repeated field has one offset per run of packed elements.
+  const std::vector<int>* FindField(int field_number) const;
+
+  const absl::Cord& bytes() const { return bytes_; }
+  absl::string_view flat_bytes() const { return flat_bytes_; }
+
+  // Returns an approximation of the memory used by this object.
+  int64_t GetPhysicalByteSize() const;
+
+ private:
+  explicit ProtoFieldOffsetIndex(const absl::Cord& bytes)
+      : bytes_(bytes), flat_bytes_(bytes) {}
+
+  const absl::Cord bytes_;
+  // The contents of 'bytes_', flattened once so that fields can be read by
+  // offset.
+  const std::string flat_bytes_;
+  absl::flat_hash_map<int, std::vector<int>> offsets_by_field_number_;
+};
+
+// Same as above, except that the fields are read from the proto indexed by
+// 'index'. Only the (tag, value) pairs of the fields in 'field_infos' are
+// decoded.
+absl::Status ReadProtoFields(
+    absl::Span<const ProtoFieldInfo* const> field_infos,
+    const ProtoFieldOffsetIndex& index, ProtoFieldValueList* field_value_list);
+
 // Convenience form of ReadProtoFields() for reading a single field. Reads the
 // proto field matching tag and type of 'field_descr' from 'bytes' and returns
 // the result in 'output_value'. If 'tag' is missing in 'bytes', returns
@@ -16,8 +16,10 @@
 
 #include "zetasql/public/proto_util.h"
 
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "google/protobuf/io/coded_stream.h"
@@ -75,6 +77,24 @@ class ReadProtoFieldsTest : public ::testing::TestWithParam<bool> {
     Value value;
     ZETASQL_RETURN_IF_ERROR(ReadProtoField(field_descriptor, format, type,
                                    default_value, get_has_bit, bytes, &value));
+
+    // Reading the field through a ProtoFieldOffsetIndex must give the same
+    // result.
+    ProtoFieldInfo info;
+    info.descriptor = field_descriptor;
+    info.format = format;
+    info.type = type;
+    info.default_value = default_value;
+    info.get_has_bit = get_has_bit;
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<const ProtoFieldOffsetIndex> index,
+        ProtoFieldOffsetIndex::Create(kitchen_sink_.GetDescriptor(), bytes));
+    ProtoFieldValueList value_list;
+    ZETASQL_RETURN_IF_ERROR(ReadProtoFields({&info}, *index, &value_list));
+    ZETASQL_RET_CHECK_EQ(value_list.size(), 1);
+    ZETASQL_RETURN_IF_ERROR(value_list[0].status());
+    ZETASQL_RET_CHECK(value_list[0].value().Equals(value))
+        << value_list[0].value() << " vs " << value;
     return value;
   }
 
@@ -760,6 +780,72 @@ TEST_P(ReadProtoFieldsTest, SameFieldWithTwoFormats) {
   EXPECT_THAT(value_list[1], IsOkAndHolds(values::Date(10)));
 }
 
+TEST_P(ReadProtoFieldsTest, ReadFieldsWithOffsetIndex) {
+  kitchen_sink_.set_int64_key_1(1);
+  kitchen_sink_.set_int64_key_2(2);
+  kitchen_sink_.add_repeated_int32_val(10);
+  kitchen_sink_.add_repeated_int32_val(20);
+  kitchen_sink_.set_string_val("foo");
+  kitchen_sink_.mutable_nested_value()->set_nested_int64(30);
+  kitchen_sink_.mutable_optionalgroup()->set_int64_val(40);
+
+  const absl::Cord bytes = SerializePartialToCord(kitchen_sink_);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<const ProtoFieldOffsetIndex> index,
+      ProtoFieldOffsetIndex::Create(kitchen_sink_.GetDescriptor(), bytes));
+
+  const google::protobuf::Descriptor* descriptor = kitchen_sink_.GetDescriptor();
+  const google::protobuf::FieldDescriptor* repeated_field =
+      descriptor->FindFieldByName("repeated_int32_val");
+  ASSERT_TRUE(repeated_field != nullptr);
+  const std::vector<int>* offsets = index->FindField(repeated_field->number());
+  ASSERT_TRUE(offsets != nullptr);
+  EXPECT_EQ(offsets->size(), 2);
+  const google::protobuf::FieldDescriptor* missing_field =
+      descriptor->FindFieldByName("int32_val");
+  ASSERT_TRUE(missing_field != nullptr);
+  EXPECT_EQ(index->FindField(missing_field->number()), nullptr);
+
+  std::vector<ProtoFieldInfo> infos;
+  for (const char* name : {"int64_key_2", "repeated_int32_val", "string_val",
+                           "int32_val", "nested_value", "optionalgroup"}) {
+    ProtoFieldInfo info;
+    info.descriptor = descriptor->FindFieldByName(name);
+    ASSERT_TRUE(info.descriptor != nullptr) << name;
+    ZETASQL_ASSERT_OK(GetProtoFieldTypeAndDefault(info.descriptor, &type_factory_,
+                                          &info.type, &info.default_value));
+    infos.push_back(info);
+    info.get_has_bit = true;
+    infos.push_back(info);
+  }
+  std::vector<const ProtoFieldInfo*> info_ptrs;
+  for (const ProtoFieldInfo& info : infos) {
+    info_ptrs.push_back(&info);
+  }
+
+  ProtoFieldValueList expected_value_list;
+  ZETASQL_ASSERT_OK(ReadProtoFields(info_ptrs, bytes, &expected_value_list));
+  ProtoFieldValueList value_list;
+  ZETASQL_ASSERT_OK(ReadProtoFields(info_ptrs, *index, &value_list));
+  ASSERT_EQ(value_list.size(), expected_value_list.size());
+  for (int i = 0; i < value_list.size(); ++i) {
+    ZETASQL_ASSERT_OK(expected_value_list[i].status());
+    EXPECT_THAT(value_list[i], IsOkAndHolds(expected_value_list[i].value()))
+        << infos[i].descriptor->name();
+  }
+  EXPECT_THAT(value_list[2], IsOkAndHolds(values::Int32Array({10, 20})));
+  EXPECT_THAT(value_list[7], IsOkAndHolds(values::Bool(false)));
+}
+
+TEST_P(ReadProtoFieldsTest, OffsetIndexOfCorruptedProto) {
+  // A varint field whose value is truncated.
+  const absl::Cord bytes("\x08\xff");
+  EXPECT_THAT(
+      ProtoFieldOffsetIndex::Create(kitchen_sink_.GetDescriptor(), bytes),
+      StatusIs(absl::StatusCode::kOutOfRange,
+               HasSubstr("Corrupted protocol buffer")));
+}
+
 INSTANTIATE_TEST_SUITE_P(ReadProtoFieldsTestInstantiation, ReadProtoFieldsTest,
                          ::testing::Values(false, true));
 
@@ -663,13 +663,18 @@ void SimpleCatalog::SetOwnedDescriptorPool(const google::protobuf::DescriptorPoo
 
 void SimpleCatalog::AddZetaSQLFunctions(
     const ZetaSQLBuiltinFunctionOptions& options) {
-  std::map<std::string, std::unique_ptr<Function>> function_map;
+  // The functions are shared with other catalogs, and their types are owned by
+  // the table.
+  std::shared_ptr<const BuiltinFunctionTable> table =
+      BuiltinFunctionTable::Get(options);
   // We have to call type_factory() while not holding mutex_.
   TypeFactory* type_factory = this->type_factory();
-  GetZetaSQLFunctions(type_factory, options, &function_map);
-  for (auto& function_pair : function_map) {
-    const std::vector<std::string>& path =
-        function_pair.second->FunctionNamePath();
+  {
+    absl::MutexLock l(&mutex_);
+    builtin_function_tables_.push_back(table);
+  }
+  for (const Function* function : table->functions()) {
+    const std::vector<std::string>& path = function->FunctionNamePath();
     SimpleCatalog* catalog = this;
     if (path.size() > 1) {
       CHECK_LE(path.size(), 2);
@@ -689,7 +694,7 @@ void SimpleCatalog::AddZetaSQLFunctions(
                 .second);
       }
     }
-    catalog->AddOwnedFunction(path.back(), std::move(function_pair.second));
+    catalog->AddFunction(path.back(), function);
   }
 }
 
@@ -697,6 +702,7 @@ void SimpleCatalog::ClearFunctions() {
   absl::MutexLock l(&mutex_);
   functions_.clear();
   owned_functions_.clear();
+  builtin_function_tables_.clear();
   for (const auto& pair : owned_zetasql_subcatalogs_) {
     catalogs_.erase(pair.first);
   }
@@ -1177,30 +1183,44 @@ absl::Status SimpleTable::InsertColumnToColumnMap(const Column* column) {
 }
 
 void SimpleTable::SetContents(const std::vector<std::vector<Value>>& rows) {
-  column_major_contents_.clear();
-  column_major_contents_.resize(NumColumns());
+  column_vectors_.clear();
+  column_vectors_.resize(NumColumns());
+  column_statistics_.clear();
+  column_statistics_.resize(NumColumns());
+  std::vector<Value> column_values;
+  column_values.reserve(rows.size());
   for (int i = 0; i < NumColumns(); ++i) {
-    auto column_values = std::make_shared<std::vector<Value>>();
-    column_values->reserve(rows.size());
+    column_values.clear();
     for (int j = 0; j < rows.size(); ++j) {
-      column_values->push_back(rows[j][i]);
+      column_values.push_back(rows[j][i]);
     }
-    column_major_contents_[i] = column_values;
+    const Type* type = GetColumn(i)->GetType();
+    column_statistics_[i] = ColumnStatistics::Create(type, column_values);
+    column_vectors_[i] = ColumnVector::Create(type, column_values);
   }
 
-  auto factory = [this, rows](absl::Span<const int> column_idxs)
+  auto factory = [this](absl::Span<const int> column_idxs)
       -> zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>> {
     std::vector<const Column*> columns;
-    std::vector<std::shared_ptr<const std::vector<Value>>> column_values;
-    column_values.reserve(column_idxs.size());
-    for (const int column_idx : column_idxs) {
+    std::vector<std::shared_ptr<const ColumnVector>> column_data;
+    std::vector<std::shared_ptr<const ColumnStatistics>> column_statistics;
+    absl::flat_hash_set<int> filter_column_idxs;
+    column_data.reserve(column_idxs.size());
+    column_statistics.reserve(column_idxs.size());
+    for (int i = 0; i < column_idxs.size(); ++i) {
+      const int column_idx = column_idxs[i];
       columns.push_back(GetColumn(column_idx));
-      column_values.push_back(column_major_contents_[column_idx]);
+      column_data.push_back(column_vectors_[column_idx]);
+      column_statistics.push_back(column_statistics_[column_idx]);
+      // Filtering is only worthwhile if we can skip chunks of rows.
+      if (column_statistics_[column_idx] != nullptr) {
+        filter_column_idxs.insert(i);
+      }
     }
     std::unique_ptr<EvaluatorTableIterator> iter(
         new SimpleEvaluatorTableIterator(
-            columns, column_values,
-            /*end_status=*/absl::OkStatus(), /*filter_column_idxs=*/{},
+            columns, column_data, column_statistics,
+            /*end_status=*/absl::OkStatus(), filter_column_idxs,
             /*cancel_cb=*/[]() {},
             /*set_deadline_cb=*/[](absl::Time t) {}, zetasql_base::Clock::RealClock()));
     return iter;
@@ -1209,6 +1229,25 @@ void SimpleTable::SetContents(const std::vector<std::vector<Value>>& rows) {
   SetEvaluatorTableIteratorFactory(factory);
 }
 
+std::vector<std::shared_ptr<const std::vector<Value>>>
+SimpleTable::column_major_contents() const {
+  std::vector<std::shared_ptr<const std::vector<Value>>> contents;
+  contents.reserve(column_vectors_.size());
+  for (const std::shared_ptr<const ColumnVector>& column : column_vectors_) {
+    if (!column->is_unboxed()) {
+      contents.push_back(column->boxed_values());
+      continue;
+    }
+    auto values = std::make_shared<std::vector<Value>>();
+    values->reserve(column->size());
+    for (int64_t i = 0; i < column->size(); ++i) {
+      values->push_back(column->GetValue(i));
+    }
+    contents.push_back(std::move(values));
+  }
+  return contents;
+}
+
 zetasql_base::StatusOr<std::unique_ptr<EvaluatorTableIterator>>
 SimpleTable::CreateEvaluatorTableIterator(
     absl::Span<const int> column_idxs) const {
@@ -263,6 +263,10 @@ class SimpleCatalog : public EnumerableCatalog {
   // namespaces. If any of the selected functions are in namespaces,
   // sub-Catalogs will be created and the appropriate functions will be added in
   // those sub-Catalogs.
+  // The functions are not copied into this catalog. They are shared with all
+  // other catalogs that use equivalent <options>, through
+  // BuiltinFunctionTable::Get(), so usually only the first call builds them.
+  // This catalog keeps the shared functions alive until ClearFunctions().
   // Also: Functions and Catalogs with the same names must not already exist.
   void AddZetaSQLFunctions(const ZetaSQLBuiltinFunctionOptions& options =
                                  ZetaSQLBuiltinFunctionOptions())
@@ -437,6 +441,10 @@ class SimpleCatalog : public EnumerableCatalog {
   std::vector<std::unique_ptr<const Constant>> owned_constants_
       ABSL_GUARDED_BY(mutex_);
 
+  // The tables of the functions added by AddZetaSQLFunctions().
+  std::vector<std::shared_ptr<const BuiltinFunctionTable>>
+      builtin_function_tables_ ABSL_GUARDED_BY(mutex_);
+
   // Subcatalogs added for zetasql function namespaces. Kept separate from
   // owned_catalogs_ to keep them as SimpleCatalog types.
   absl::flat_hash_map<std::string, std::unique_ptr<SimpleCatalog>>
@@ -583,10 +591,23 @@ class SimpleTable : public Table {
 
  protected:
   // Returns the current contents (passed to the last call to SetContents()) in
-  // column-major order.
-  const std::vector<std::shared_ptr<const std::vector<Value>>>&
-  column_major_contents() const {
-    return column_major_contents_;
+  // column-major order. Values of simple types are stored unboxed.
+  const std::vector<std::shared_ptr<const ColumnVector>>& column_vectors()
+      const {
+    return column_vectors_;
+  }
+
+  // Returns the current contents (passed to the last call to SetContents()) in
+  // column-major order, as Values. Unboxed columns are materialized on every
+  // call, so column_vectors() should be preferred.
+  std::vector<std::shared_ptr<const std::vector<Value>>>
+  column_major_contents() const;
+
+  // Returns the statistics of the columns in column_vectors(). An entry
+  // is NULL if the type of the column does not support statistics.
+  const std::vector<std::shared_ptr<const ColumnStatistics>>&
+  column_statistics() const {
+    return column_statistics_;
   }
 
  private:
@@ -611,7 +632,8 @@ class SimpleTable : public Table {
 
   // We use shared_ptrs to handle calls to SetContets() while there are
   // iterators outstanding.
-  std::vector<std::shared_ptr<const std::vector<Value>>> column_major_contents_;
+  std::vector<std::shared_ptr<const ColumnVector>> column_vectors_;
+  std::vector<std::shared_ptr<const ColumnStatistics>> column_statistics_;
   std::unique_ptr<EvaluatorTableIteratorFactory>
       evaluator_table_iterator_factory_;
 
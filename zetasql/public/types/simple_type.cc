@@ -187,7 +187,7 @@ void SimpleType::InitializeValueContent(ValueContent* value) const {
   switch (kind_) {
     case TYPE_STRING:
     case TYPE_BYTES:
-      value->set(new internal::StringRef());
+      value->set(internal::StringRef::Create(std::string()));
       break;
     case TYPE_GEOGRAPHY:
       value->set(new internal::GeographyRef());
@@ -0,0 +1,77 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/public/types/value_representations.h"
+
+#include <string>
+
+#include "absl/hash/hash.h"
+#include "absl/strings/string_view.h"
+
+namespace zetasql {
+namespace internal {
+
+namespace {
+
+// A direct-mapped cache of the StringRefs of short strings. Each thread has
+// its own cache, so lookups need no lock. A miss replaces the entry with the
+// same hash. The StringRefs are allocated from the heap even inside a
+// ValueArenaScope, because the cache outlives the arena.
+class SharedStringRefCache {
+ public:
+  SharedStringRefCache() = default;
+  SharedStringRefCache(const SharedStringRefCache&) = delete;
+  SharedStringRefCache& operator=(const SharedStringRefCache&) = delete;
+
+  ~SharedStringRefCache() {
+    for (StringRef* entry : entries_) {
+      if (entry != nullptr) {
+        entry->Unref();
+      }
+    }
+  }
+
+  // Returns a new reference to a StringRef holding 'value'.
+  StringRef* Get(absl::string_view value) {
+    StringRef*& entry =
+        entries_[absl::Hash<absl::string_view>()(value) % kNumEntries];
+    if (entry == nullptr || entry->value() != value) {
+      if (entry != nullptr) {
+        entry->Unref();
+      }
+      ValueArenaScope heap_scope(/*arena=*/nullptr);
+      entry = new StringRef(std::string(value));
+    }
+    entry->Ref();
+    return entry;
+  }
+
+ private:
+  static constexpr int kNumEntries = 256;
+
+  // Each entry holds a reference.
+  StringRef* entries_[kNumEntries] = {};
+};
+
+}  // namespace
+
+StringRef* StringRef::GetShared(absl::string_view value) {
+  static thread_local SharedStringRefCache cache;
+  return cache.Get(value);
+}
+
+}  // namespace internal
+}  // namespace zetasql
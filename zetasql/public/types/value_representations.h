@@ -17,7 +17,12 @@
 #ifndef ZETASQL_PUBLIC_TYPES_VALUE_REPRESENTATIONS_H_
 #define ZETASQL_PUBLIC_TYPES_VALUE_REPRESENTATIONS_H_
 
+#include <cstddef>
+#include <string>
+
 #include "zetasql/public/numeric_value.h"
+#include "absl/strings/string_view.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/simple_reference_counted.h"
 
 // This file contains classes that are used to represent values of ZetaSQL
@@ -37,6 +42,98 @@ class ProtoType;
 
 namespace internal {  // For ZetaSQL internal use only
 
+// -------------------------------------------------------
+// ValueArenaScope
+// -------------------------------------------------------
+// While a ValueArenaScope is active on a thread, the representations of the
+// STRING, BYTES, NUMERIC, BIGNUMERIC, ARRAY and STRUCT Values created on that
+// thread are allocated from its arena instead of the heap. They are still
+// destroyed when their last reference is dropped, but their memory is only
+// released in bulk when the arena is reset or destroyed. That must not happen
+// while any Value allocated from the arena is alive, so such Values must be
+// copied out with InternalValue::CopyOutOfArena() before they are handed to
+// code that may keep them.
+//
+// If 'thread_confined' is true, the Values allocated from the arena also use
+// non-atomic reference counts (see
+// zetasql_base::SimpleReferenceCounted::set_thread_confined()). Then they must
+// only be used by one thread at a time, and CopyOutOfArena() is also what
+// makes them safe to share between threads.
+//
+// Scopes nest. A scope with a null arena allocates from the heap again.
+class ValueArenaScope {
+ public:
+  explicit ValueArenaScope(zetasql_base::UnsafeArena* arena,
+                           bool thread_confined = false)
+      : previous_(Current()) {
+    Current() = {arena, arena != nullptr && thread_confined};
+  }
+  ValueArenaScope(const ValueArenaScope&) = delete;
+  ValueArenaScope& operator=(const ValueArenaScope&) = delete;
+  ~ValueArenaScope() { Current() = previous_; }
+
+  // Returns the arena of the innermost scope on this thread, or nullptr.
+  static zetasql_base::UnsafeArena* arena() { return Current().arena; }
+
+  // Returns true if the innermost scope on this thread allocates Values with
+  // non-atomic reference counts.
+  static bool thread_confined() { return Current().thread_confined; }
+
+ private:
+  struct State {
+    zetasql_base::UnsafeArena* arena;
+    bool thread_confined;
+  };
+
+  static State& Current() {
+    static thread_local State state = {nullptr, false};
+    return state;
+  }
+
+  const State previous_;
+};
+
+// -------------------------------------------------------
+// ArenaReferenceCounted
+// -------------------------------------------------------
+// Base class of the reference counted value representations that are
+// allocated from the arena of the current ValueArenaScope, if there is one.
+// They must only be created with 'new'.
+class ArenaReferenceCounted : public zetasql_base::SimpleReferenceCounted {
+ public:
+  static void* operator new(size_t size) {
+    zetasql_base::UnsafeArena* arena = ValueArenaScope::arena();
+    if (arena == nullptr) {
+      return ::operator new(size);
+    }
+    return arena->AllocAligned(size, alignof(std::max_align_t));
+  }
+  // Only called for objects allocated from the heap, see OnRefCountIsZero().
+  static void operator delete(void* ptr) { ::operator delete(ptr); }
+
+  // Returns true if this object was allocated from an arena.
+  bool in_arena() const { return in_arena_; }
+
+ protected:
+  // The scope that operator new() used is still current when the constructor
+  // runs.
+  ArenaReferenceCounted() : in_arena_(ValueArenaScope::arena() != nullptr) {
+    set_thread_confined(ValueArenaScope::thread_confined());
+  }
+
+  void OnRefCountIsZero() const override {
+    if (in_arena_) {
+      // The memory is owned by the arena.
+      this->~ArenaReferenceCounted();
+    } else {
+      delete this;
+    }
+  }
+
+ private:
+  const bool in_arena_;
+};
+
 // -------------------------------------------------------
 // ProtoRep
 // -------------------------------------------------------
@@ -76,7 +173,7 @@ class GeographyRef final : public zetasql_base::SimpleReferenceCounted {
 // -------------------------------------------------------
 // NumericRef is ref count wrapper around NumericValue.
 // -------------------------------------------------------
-class NumericRef : public zetasql_base::SimpleReferenceCounted {
+class NumericRef : public ArenaReferenceCounted {
  public:
   NumericRef() {}
   explicit NumericRef(const NumericValue& value) : value_(value) {}
@@ -93,7 +190,7 @@ class NumericRef : public zetasql_base::SimpleReferenceCounted {
 // -------------------------------------------------------------
 // BigNumericRef is ref count wrapper around BigNumericValue.
 // -------------------------------------------------------------
-class BigNumericRef : public zetasql_base::SimpleReferenceCounted {
+class BigNumericRef : public ArenaReferenceCounted {
  public:
   BigNumericRef() {}
   explicit BigNumericRef(const BigNumericValue& value) : value_(value) {}
@@ -110,14 +207,28 @@ class BigNumericRef : public zetasql_base::SimpleReferenceCounted {
 // -------------------------------------------------------
 // StringRef is ref count wrapper around string.
 // -------------------------------------------------------
-class StringRef : public zetasql_base::SimpleReferenceCounted {
+class StringRef : public ArenaReferenceCounted {
  public:
+  // Strings of up to this many bytes are shared by Create().
+  static constexpr size_t kMaxSharedSize = 15;
+
   StringRef() {}
   explicit StringRef(std::string value) : value_(std::move(value)) {}
 
   StringRef(const StringRef&) = delete;
   StringRef& operator=(const StringRef&) = delete;
 
+  // Returns a new reference to a StringRef holding 'value'. Short strings are
+  // looked up in a small per-thread cache first, so that the many Values of a
+  // low-cardinality column of short strings (like country codes) share a few
+  // StringRefs instead of allocating one each.
+  static StringRef* Create(std::string value) {
+    if (value.size() <= kMaxSharedSize) {
+      return GetShared(value);
+    }
+    return new StringRef(std::move(value));
+  }
+
   const std::string& value() const { return value_; }
 
   uint64_t physical_byte_size() const {
@@ -125,6 +236,8 @@ class StringRef : public zetasql_base::SimpleReferenceCounted {
   }
 
  private:
+  static StringRef* GetShared(absl::string_view value);
+
   const std::string value_;
 };
 
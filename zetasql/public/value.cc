@@ -291,6 +291,59 @@ const std::vector<Value>& Value::elements() const {
   return list_ptr_->values();
 }
 
+bool Value::IsInArena() const {
+  if (!is_valid()) return false;
+  switch (type_kind()) {
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return string_ptr_->in_arena();
+    case TYPE_NUMERIC:
+      return numeric_ptr_->in_arena();
+    case TYPE_BIGNUMERIC:
+      return bignumeric_ptr_->in_arena();
+    case TYPE_ARRAY:
+    case TYPE_STRUCT:
+      if (list_ptr_->in_arena()) return true;
+      for (const Value& value : list_ptr_->values()) {
+        if (value.IsInArena()) return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+Value Value::CopyOutOfArena() const {
+  if (!IsInArena()) return *this;
+  internal::ValueArenaScope heap_scope(/*arena=*/nullptr);
+  if (is_null()) return Value::Null(type());
+  switch (type_kind()) {
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return Value(type_kind(), string_ptr_->value());
+    case TYPE_NUMERIC:
+      return Value(numeric_ptr_->value());
+    case TYPE_BIGNUMERIC:
+      return Value(bignumeric_ptr_->value());
+    case TYPE_ARRAY:
+    case TYPE_STRUCT: {
+      std::vector<Value> values;
+      values.reserve(list_ptr_->values().size());
+      for (const Value& value : list_ptr_->values()) {
+        values.push_back(value.CopyOutOfArena());
+      }
+      if (type_kind() == TYPE_ARRAY) {
+        return ArrayInternal(/*safe=*/false, list_ptr_->type()->AsArray(),
+                             order_kind(), std::move(values));
+      }
+      return StructInternal(/*safe=*/false, list_ptr_->type()->AsStruct(),
+                            std::move(values));
+    }
+    default:
+      LOG(FATAL) << "Unexpected type in arena: " << type_kind();
+  }
+}
+
 Value Value::TimestampFromUnixMicros(int64_t v) {
   CHECK(functions::IsValidTimestamp(v, functions::kMicroseconds)) << v;
   return Value(absl::FromUnixMicros(v));
@@ -394,6 +394,9 @@ class Value {
 #ifndef SWIG
   static Value UnsafeArray(const ArrayType* array_type,
                            std::vector<Value>&& values);
+#endif
+#ifndef SWIG
+  class ArrayBuilder;  // Defined below.
 #endif
   // Creates a null of the given 'type'.
   static Value Null(const Type* type);
@@ -488,6 +491,15 @@ class Value {
   // by test code; public arrays are always ordered.
   bool order_kind() const;
 
+  // Returns true if the representation of this value, or of one of its
+  // elements or fields, was allocated from an arena (see
+  // internal::ValueArenaScope).
+  bool IsInArena() const;
+
+  // Returns this value, with every part that was allocated from an arena
+  // copied to the heap.
+  Value CopyOutOfArena() const;
+
   // When comparing two deeply nested Values with the same type, we want to
   // treat descendant ArrayValues that have the same relationship to the root
   // with the same ordering requirements. This struct is used to build a map
@@ -615,6 +627,41 @@ class Value {
 static_assert(sizeof(Value) == sizeof(int64_t) * 2, "Value size mismatch");
 #endif
 
+#ifndef SWIG
+// Builds an array Value by moving elements directly into the list that backs
+// the result, instead of collecting them in a std::vector<Value> that Array()
+// then copies. The type of each element must be array_type->element_type(), but
+// this is only CHECK'd in debug mode.
+//
+// Example:
+//   Value::ArrayBuilder builder(array_type, /*capacity_hint=*/n);
+//   for (...) {
+//     builder.Add(std::move(element));
+//   }
+//   Value array = builder.Build();
+class Value::ArrayBuilder {
+ public:
+  // 'capacity_hint' is the expected number of elements, if it is known.
+  explicit ArrayBuilder(const ArrayType* array_type,
+                        int64_t capacity_hint = 0);
+  ArrayBuilder(const ArrayBuilder&) = delete;
+  ArrayBuilder& operator=(const ArrayBuilder&) = delete;
+
+  // Appends 'element' to the array.
+  void Add(Value element);
+
+  // Returns the number of elements added so far.
+  int64_t size() const;
+
+  // Returns the array. The builder must not be used afterwards.
+  Value Build();
+
+ private:
+  // A NULL array that owns the elements until Build() is called.
+  Value array_;
+};
+#endif
+
 // Allow Value to be logged.
 std::ostream& operator<<(std::ostream& out, const Value& value);
 
@@ -50,7 +50,7 @@
 
 namespace zetasql {
 
-class Value::TypedList : public zetasql_base::SimpleReferenceCounted {
+class Value::TypedList : public internal::ArenaReferenceCounted {
  public:
   explicit TypedList(const Type* type) : type_(type) { CHECK(type != nullptr); }
 
@@ -187,7 +187,7 @@ inline Value::Value(double value)
 
 inline Value::Value(TypeKind type_kind, std::string value)
     : type_kind_(static_cast<int16_t>(type_kind)),
-      string_ptr_(new internal::StringRef(std::move(value))) {
+      string_ptr_(internal::StringRef::Create(std::move(value))) {
   CHECK(type_kind == TYPE_STRING ||
         type_kind == TYPE_BYTES);
 }
@@ -228,6 +228,30 @@ inline Value Value::EmptyArray(const ArrayType* array_type) {
   return Array(array_type, {});
 }
 
+inline Value::ArrayBuilder::ArrayBuilder(const ArrayType* array_type,
+                                         int64_t capacity_hint)
+    : array_(array_type) {
+  if (capacity_hint > 0) {
+    array_.list_ptr_->values().reserve(capacity_hint);
+  }
+}
+
+inline void Value::ArrayBuilder::Add(Value element) {
+  DCHECK(element.type()->Equals(array_.type()->AsArray()->element_type()))
+      << "Array element " << element << " must be of type "
+      << array_.type()->AsArray()->element_type()->DebugString();
+  array_.list_ptr_->values().push_back(std::move(element));
+}
+
+inline int64_t Value::ArrayBuilder::size() const {
+  return array_.list_ptr_->values().size();
+}
+
+inline Value Value::ArrayBuilder::Build() {
+  array_.is_null_ = false;
+  return std::move(array_);
+}
+
 inline Value Value::Int32(int32_t v) { return Value(v); }
 inline Value Value::Int64(int64_t v) { return Value(v); }
 inline Value Value::Uint32(uint32_t v) { return Value(v); }
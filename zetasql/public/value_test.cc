@@ -21,6 +21,7 @@
 #include <time.h>
 
 #include <limits>
+#include <thread>
 #include <type_traits>
 #include <utility>
 
@@ -56,6 +57,7 @@
 #include "zetasql/common/testing/proto_matchers.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "zetasql/public/types/value_representations.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/statusor.h"
 
 namespace zetasql {
@@ -373,6 +375,31 @@ TEST_F(ValueTest, StringNonNull) {
   EXPECT_EQ("foo", value_copy.string_value());
 }
 
+TEST_F(ValueTest, ShortStringsAreShared) {
+  const Value us1 = Value::String("US");
+  const Value us2 = Value::String(std::string("U") + "S");
+  const Value us_bytes = Value::Bytes("US");
+  EXPECT_EQ(&us1.string_value(), &us2.string_value());
+  EXPECT_EQ(us1, us2);
+  EXPECT_EQ(absl::Hash<Value>()(us1), absl::Hash<Value>()(us2));
+  // BYTES and STRING values share the representation too, but not the type.
+  EXPECT_EQ(&us1.string_value(), &us_bytes.bytes_value());
+  EXPECT_FALSE(us1.Equals(us_bytes));
+
+  const std::string long_string(internal::StringRef::kMaxSharedSize + 1, 'x');
+  const Value long1 = Value::String(long_string);
+  const Value long2 = Value::String(long_string);
+  EXPECT_NE(&long1.string_value(), &long2.string_value());
+  EXPECT_EQ(long1, long2);
+
+  // Values created by another thread remain valid after it exits.
+  Value from_thread;
+  std::thread thread([&from_thread]() { from_thread = Value::String("CH"); });
+  thread.join();
+  EXPECT_EQ("CH", from_thread.string_value());
+  EXPECT_EQ(Value::String("CH"), from_thread);
+}
+
 void disguised_move(Value& o1, Value& o2) {  // NOLINT
   o1 = std::move(o2);
 }
@@ -2357,6 +2384,132 @@ static void DeserializeSerialize(const std::string& value_proto_str,
   EXPECT_THAT(value_proto, testing::EqualsProto(roundtrip_value_proto));
 }
 
+TEST_F(ValueTest, ArrayBuilder) {
+  Value::ArrayBuilder builder(types::StringArrayType(), /*capacity_hint=*/3);
+  builder.Add(Value::String("a"));
+  const Value element = Value::String("b");
+  builder.Add(element);
+  builder.Add(Value::NullString());
+  EXPECT_EQ(builder.size(), 3);
+  EXPECT_EQ(builder.Build(),
+            Value::Array(types::StringArrayType(),
+                         {Value::String("a"), Value::String("b"),
+                          Value::NullString()}));
+  EXPECT_EQ(element, Value::String("b"));
+
+  Value::ArrayBuilder empty_builder(types::Int64ArrayType());
+  EXPECT_EQ(empty_builder.Build(), Value::EmptyArray(types::Int64ArrayType()));
+
+  Value::ArrayBuilder unordered_builder(types::Int64ArrayType());
+  unordered_builder.Add(Value::Int64(1));
+  const Value unordered = InternalValue::BuildArray(
+      &unordered_builder, InternalValue::kIgnoresOrder);
+  EXPECT_EQ(InternalValue::GetOrderKind(unordered),
+            InternalValue::kIgnoresOrder);
+  EXPECT_EQ(unordered.num_elements(), 1);
+}
+
+TEST_F(ValueTest, CopyOutOfArena) {
+  const std::string kLongString = "a string that is not shared";
+  const Value string_value = Value::String("baz");
+  EXPECT_FALSE(InternalValue::IsInArena(string_value));
+
+  Value copied_string;
+  Value copied_numeric;
+  Value copied_array;
+  Value copied_struct;
+  Value copied_null_array;
+  {
+    zetasql_base::UnsafeArena arena(/*block_size=*/1024);
+    {
+      internal::ValueArenaScope arena_scope(&arena);
+      // Short strings are shared through a cache instead.
+      EXPECT_FALSE(InternalValue::IsInArena(Value::String("foo")));
+      const Value string_in_arena = Value::String(kLongString);
+      const Value numeric_in_arena =
+          Value::Numeric(NumericValue::FromStringStrict("1.5").value());
+      const Value array_in_arena = Value::Array(
+          MakeArrayType(StringType()), {string_in_arena, Value::NullString()});
+      const Value struct_in_arena =
+          Value::Struct(MakeStructType({{"a", StringType()}}), {string_value});
+      const Value null_array_in_arena =
+          Value::Null(MakeArrayType(Int64Type()));
+      {
+        internal::ValueArenaScope heap_scope(/*arena=*/nullptr);
+        EXPECT_FALSE(InternalValue::IsInArena(Value::String(kLongString)));
+      }
+      EXPECT_TRUE(InternalValue::IsInArena(string_in_arena));
+      EXPECT_TRUE(InternalValue::IsInArena(array_in_arena));
+      // A struct created in the arena is in the arena even if its fields are
+      // not.
+      EXPECT_TRUE(InternalValue::IsInArena(struct_in_arena));
+
+      copied_string = InternalValue::CopyOutOfArena(string_in_arena);
+      copied_numeric = InternalValue::CopyOutOfArena(numeric_in_arena);
+      copied_array = InternalValue::CopyOutOfArena(array_in_arena);
+      copied_struct = InternalValue::CopyOutOfArena(struct_in_arena);
+      copied_null_array = InternalValue::CopyOutOfArena(null_array_in_arena);
+    }
+    // Values outside of an arena are returned as they are.
+    EXPECT_TRUE(InternalValue::CopyOutOfArena(string_value)
+                    .Equals(string_value));
+  }
+
+  // The copies remain valid after the arena is destroyed.
+  for (const Value& value : {copied_string, copied_numeric, copied_array,
+                             copied_struct, copied_null_array}) {
+    EXPECT_FALSE(InternalValue::IsInArena(value)) << value;
+  }
+  EXPECT_EQ(copied_string, Value::String(kLongString));
+  EXPECT_EQ(copied_numeric,
+            Value::Numeric(NumericValue::FromStringStrict("1.5").value()));
+  EXPECT_EQ(copied_array,
+            Value::Array(MakeArrayType(StringType()),
+                         {Value::String(kLongString), Value::NullString()}));
+  EXPECT_EQ(copied_struct, Value::Struct(MakeStructType({{"a", StringType()}}),
+                                         {string_value}));
+  EXPECT_TRUE(copied_null_array.is_null());
+  EXPECT_TRUE(copied_null_array.type()->Equals(MakeArrayType(Int64Type())));
+}
+
+TEST_F(ValueTest, ThreadConfinedArena) {
+  const std::string long_string = "a string that is not shared";
+  Value copied_array;
+  {
+    zetasql_base::UnsafeArena arena(/*block_size=*/1024);
+    internal::ValueArenaScope arena_scope(&arena, /*thread_confined=*/true);
+    EXPECT_TRUE(internal::ValueArenaScope::thread_confined());
+    {
+      internal::ValueArenaScope heap_scope(/*arena=*/nullptr,
+                                           /*thread_confined=*/true);
+      // Only arena values can be thread confined.
+      EXPECT_FALSE(internal::ValueArenaScope::thread_confined());
+    }
+    const Value array = Value::Array(MakeArrayType(StringType()),
+                                     {Value::String(long_string)});
+    std::vector<Value> copies(10, array);
+    copies.clear();
+    EXPECT_EQ(array.element(0).string_value(), long_string);
+    copied_array = InternalValue::CopyOutOfArena(array);
+  }
+  EXPECT_FALSE(internal::ValueArenaScope::thread_confined());
+
+  // The copy uses atomic reference counts, so it can be shared by threads.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&copied_array]() {
+      for (int j = 0; j < 1000; ++j) {
+        Value copy = copied_array;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(copied_array, Value::Array(MakeArrayType(StringType()),
+                                       {Value::String(long_string)}));
+}
+
 TEST_F(ValueTest, Serialize) {
   // Scalar types.
   SerializeDeserialize(NullInt32());
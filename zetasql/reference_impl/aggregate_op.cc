@@ -318,9 +318,8 @@ class TopNAccumulator : public IntermediateAggregateAccumulator {
                   std::unique_ptr<TupleComparator> tuple_comparator,
                   std::unique_ptr<IntermediateAggregateAccumulator> accumulator,
                   EvaluationContext* context)
-      : n_(n),
-        tuple_comparator_(std::move(tuple_comparator)),
-        top_n_(*tuple_comparator_, context->memory_accountant()),
+      : tuple_comparator_(std::move(tuple_comparator)),
+        top_n_(n, *tuple_comparator_, context->memory_accountant()),
         accumulator_(std::move(accumulator)) {}
 
   absl::Status Reset() override {
@@ -339,22 +338,14 @@ class TopNAccumulator : public IntermediateAggregateAccumulator {
     input->AddSlots(1);
     input->mutable_slot(input->num_slots() - 1)->SetValue(value);
 
-    if (!top_n_.Insert(std::move(input), status)) return false;
-
-    // 'if' should be good enough; 'while' is for paranoia.
-    while (top_n_.GetSize() > n_) {
-      top_n_.PopBack();
-    }
-
-    return true;
+    return top_n_.Insert(std::move(input), status);
   }
 
   ::zetasql_base::StatusOr<Value> GetFinalResult(
       bool /* inputs_in_defined_order */) override {
     bool stop_accumulation;
     absl::Status status;
-    while (!top_n_.IsEmpty()) {
-      std::unique_ptr<TupleData> input_row = top_n_.PopFront();
+    for (std::unique_ptr<TupleData>& input_row : top_n_.ExtractSorted()) {
       ZETASQL_RET_CHECK(!input_row->slots().empty());
       const Value value = input_row->slots().back().value();
       input_row->RemoveSlots(1);
@@ -375,11 +366,10 @@ class TopNAccumulator : public IntermediateAggregateAccumulator {
   }
 
  private:
-  const int64_t n_;
   const std::unique_ptr<TupleComparator> tuple_comparator_;
-  // The last slot of each TupleData in this queue is the Value passed to the
+  // The last slot of each TupleData in this object is the Value passed to the
   // corresponding call to Accumulate().
-  TupleDataOrderedQueue top_n_;
+  TupleDataTopN top_n_;
   std::unique_ptr<IntermediateAggregateAccumulator> accumulator_;
 };
 
@@ -1113,7 +1103,7 @@ class GroupValue {
 
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AggregateOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AggregateOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
@@ -1124,7 +1114,12 @@ class GroupValue {
   absl::flat_hash_map<TupleDataPtr, std::unique_ptr<GroupValue>> group_map;
 
   absl::Status status;
-  while (true) {
+  const int64_t verify_not_aborted_period =
+      absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period);
+  for (int64_t num_inputs = 0;; ++num_inputs) {
+    if (num_inputs % verify_not_aborted_period == 0) {
+      ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+    }
     const TupleData* next_input = input_iter->Next();
     if (next_input == nullptr) {
       ZETASQL_RETURN_IF_ERROR(input_iter->Status());
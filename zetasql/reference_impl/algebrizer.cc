@@ -35,6 +35,7 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/value.h"
 #include "zetasql/reference_impl/common.h"
+#include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/function.h"
 #include "zetasql/reference_impl/proto_util.h"
 #include "zetasql/reference_impl/tuple.h"
@@ -43,6 +44,7 @@
 #include "zetasql/resolved_ast/resolved_ast_visitor.h"
 #include "zetasql/resolved_ast/resolved_column.h"
 #include "zetasql/resolved_ast/resolved_node_kind.pb.h"
+#include "absl/hash/hash.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/span.h"
@@ -838,7 +840,13 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
   const ResolvedScan* scan = subquery_expr->subquery();
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<RelationalOp> relation, AlgebrizeScan(scan));
 
+  bool memoize = false;
+  if (algebrizer_options_.cache_uncorrelated_subqueries) {
+    ZETASQL_ASSIGN_OR_RETURN(memoize, IsUncorrelatedSubquery(subquery_expr));
+  }
+
   const ResolvedColumnList& output_columns = scan->column_list();
+  std::unique_ptr<ValueExpr> result;
   switch (subquery_expr->subquery_type()) {
     case ResolvedSubqueryExpr::EXISTS: {
       // In theory, we don't need a new expression for this, and can instead do
@@ -846,9 +854,8 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       // problem is that if the relation has more than one row, the LimitOp will
       // mark the operation as non-deterministic which will prevent random query
       // testing of this feature.
-      ZETASQL_ASSIGN_OR_RETURN(auto subquery_valueop,
-                       ExistsExpr::Create(std::move(relation)));
-      return std::unique_ptr<ValueExpr>(std::move(subquery_valueop));
+      ZETASQL_ASSIGN_OR_RETURN(result, ExistsExpr::Create(std::move(relation)));
+      break;
     }
     case ResolvedSubqueryExpr::SCALAR: {
       // A single column which may be a struct or an array.
@@ -859,18 +866,16 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
                        DerefExpr::Create(var, output_columns[0].type()));
       column_to_variable_->set_map(original_column_to_variable);
       ZETASQL_ASSIGN_OR_RETURN(
-          auto single_value_expr,
-          SingleValueExpr::Create(std::move(deref), std::move(relation)));
-      return std::unique_ptr<ValueExpr>(std::move(single_value_expr));
+          result, SingleValueExpr::Create(std::move(deref), std::move(relation)));
+      break;
     }
     case ResolvedSubqueryExpr::ARRAY: {
       // Either a single scalar column or a struct column.
       ZETASQL_ASSIGN_OR_RETURN(
-          std::unique_ptr<ValueExpr> nest_expr,
-          NestSingleColumnRelation(output_columns, std::move(relation),
-                                   /*is_with_table=*/false));
+          result, NestSingleColumnRelation(output_columns, std::move(relation),
+                                           /*is_with_table=*/false));
       column_to_variable_->set_map(original_column_to_variable);
-      return std::move(nest_expr);
+      break;
     }
     case ResolvedSubqueryExpr::IN: {
       ZETASQL_RET_CHECK_EQ(1, scan->column_list().size());
@@ -883,6 +888,17 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
       column_to_variable_->set_map(original_column_to_variable);
       ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> in_value,
                        AlgebrizeExpression(subquery_expr->in_expr()));
+      const Type* haystack_type = scan->column_list()[0].type();
+      if (memoize && HashInExpr::SupportsType(in_value->output_type()) &&
+          in_value->output_type()->Equals(haystack_type)) {
+        // The IN list is collected into a hash set once, instead of being
+        // scanned for every value of 'in_value'.
+        ZETASQL_ASSIGN_OR_RETURN(auto deref_haystack,
+                         DerefExpr::Create(haystack_var, haystack_type));
+        return HashInExpr::Create(std::move(in_value),
+                                  std::move(deref_haystack),
+                                  std::move(relation));
+      }
       return AlgebrizeInRelation(std::move(in_value), haystack_var,
                                  std::move(relation));
     }
@@ -891,6 +907,10 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeSubquery
              << "Unknown type of resolved subquery: "
              << subquery_expr->subquery_type();
   }
+  if (memoize) {
+    return MemoizedExpr::Create(std::move(result));
+  }
+  return result;
 }
 
 zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeInArray(
@@ -967,8 +987,18 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeInRelati
 
 zetasql_base::StatusOr<std::unique_ptr<ValueExpr>>
 Algebrizer::AlgebrizeStandaloneExpression(const ResolvedExpr* expr) {
+  std::vector<std::unique_ptr<ExprArg>> common_subexpressions;
+  std::vector<const ResolvedExpr*> common_subexpression_occurrences;
+  ZETASQL_RETURN_IF_ERROR(HoistCommonSubexpressions(
+      {expr}, &common_subexpressions, &common_subexpression_occurrences));
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> value_expr,
                    AlgebrizeExpression(expr));
+  ForgetCommonSubexpressions(common_subexpression_occurrences);
+  if (!common_subexpressions.empty()) {
+    ZETASQL_ASSIGN_OR_RETURN(value_expr,
+                     LetExpr::Create(std::move(common_subexpressions),
+                                     std::move(value_expr)));
+  }
 
   // If we have any WITH clauses, create a LetExpr that binds the names of
   // subqueries to array expressions.  WITH subqueries cannot be correlated so
@@ -993,6 +1023,18 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeExpressi
            << expr->type()->TypeName(language_options_.product_mode());
   }
 
+  // Occurrences of a common subexpression read the variable computed by
+  // HoistCommonSubexpressions(), which algebrized an equal expression, so they
+  // are not algebrized again.
+  const VariableId* common_subexpression =
+      zetasql_base::FindOrNull(common_subexpressions_, expr);
+  if (common_subexpression != nullptr) {
+    expr->MarkFieldsAccessed();
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<DerefExpr> deref,
+                     DerefExpr::Create(*common_subexpression, expr->type()));
+    return std::unique_ptr<ValueExpr>(std::move(deref));
+  }
+
   std::unique_ptr<ValueExpr> val_op;
   switch (expr->node_kind()) {
     case RESOLVED_LITERAL: {
@@ -1154,6 +1196,10 @@ zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> Algebrizer::AlgebrizeExpressi
              << "Unhandled node type algebrizing an expression: "
              << expr->node_kind_string();
   }
+  if (algebrizer_options_.optimize_expressions) {
+    ZETASQL_ASSIGN_OR_RETURN(val_op,
+                     MaybeFoldConstantExpression(expr, std::move(val_op)));
+  }
   return val_op;
 }
 
@@ -1187,6 +1233,86 @@ static zetasql_base::StatusOr<absl::flat_hash_set<ResolvedColumn>> GetReferenced
   return visitor.columns();
 }
 
+// Returns true if 'subquery_expr' has the same value every time it is
+// evaluated in a query, so that it only has to be evaluated once. This is the
+// case if the subquery does not reference any outer column, SQL function
+// argument, expression column, query parameter or WITH table (which may itself
+// be correlated) and does not call a volatile function. Expression columns and
+// parameters are excluded because an evaluation may be run for several rows
+// with different values for them (e.g., PreparedExpression::ExecuteBatch()).
+static zetasql_base::StatusOr<bool> IsUncorrelatedSubquery(
+    const ResolvedSubqueryExpr* subquery_expr) {
+  if (!subquery_expr->parameter_list().empty()) {
+    return false;
+  }
+
+  // ResolvedASTVisitor that records whether a subquery may have different
+  // values in different evaluations.
+  class CorrelationVisitor : public ResolvedASTVisitor {
+   public:
+    CorrelationVisitor() {}
+    CorrelationVisitor(const CorrelationVisitor&) = delete;
+    CorrelationVisitor& operator=(const CorrelationVisitor&) = delete;
+
+    bool is_uncorrelated() const { return is_uncorrelated_; }
+
+    absl::Status VisitResolvedFunctionCall(
+        const ResolvedFunctionCall* node) override {
+      RecordFunction(node->function());
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedAggregateFunctionCall(
+        const ResolvedAggregateFunctionCall* node) override {
+      RecordFunction(node->function());
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedAnalyticFunctionCall(
+        const ResolvedAnalyticFunctionCall* node) override {
+      RecordFunction(node->function());
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedArgumentRef(
+        const ResolvedArgumentRef* node) override {
+      is_uncorrelated_ = false;
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedExpressionColumn(
+        const ResolvedExpressionColumn* node) override {
+      is_uncorrelated_ = false;
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedParameter(
+        const ResolvedParameter* node) override {
+      is_uncorrelated_ = false;
+      return DefaultVisit(node);
+    }
+
+    absl::Status VisitResolvedWithRefScan(
+        const ResolvedWithRefScan* node) override {
+      is_uncorrelated_ = false;
+      return DefaultVisit(node);
+    }
+
+   private:
+    void RecordFunction(const Function* function) {
+      if (function->function_options().volatility == FunctionEnums::VOLATILE) {
+        is_uncorrelated_ = false;
+      }
+    }
+
+    bool is_uncorrelated_ = true;
+  };
+
+  CorrelationVisitor visitor;
+  ZETASQL_RETURN_IF_ERROR(subquery_expr->subquery()->Accept(&visitor));
+  return visitor.is_uncorrelated();
+}
+
 // Returns true if 'expr' is known to be non-volatile (per
 // FunctionEnums::VOLATILE).
 static bool IsNonVolatile(const ResolvedExpr* expr) {
@@ -1241,6 +1367,548 @@ static bool IsNonVolatile(const ResolvedExpr* expr) {
   }
 }
 
+// Returns true if the builtin function with signature 'function_id' computes
+// its result from its arguments alone, i.e., not from the EvaluationContext
+// (default time zone, current timestamp, etc.). Calls to such functions over
+// literals are folded by MaybeFoldConstantExpression().
+static bool IsContextIndependentFunction(FunctionSignatureId function_id) {
+  switch (function_id) {
+    case FN_ADD_DOUBLE:
+    case FN_ADD_INT64:
+    case FN_ADD_UINT64:
+    case FN_ADD_NUMERIC:
+    case FN_ADD_BIGNUMERIC:
+    case FN_SUBTRACT_DOUBLE:
+    case FN_SUBTRACT_INT64:
+    case FN_SUBTRACT_UINT64:
+    case FN_SUBTRACT_NUMERIC:
+    case FN_SUBTRACT_BIGNUMERIC:
+    case FN_MULTIPLY_DOUBLE:
+    case FN_MULTIPLY_INT64:
+    case FN_MULTIPLY_UINT64:
+    case FN_MULTIPLY_NUMERIC:
+    case FN_MULTIPLY_BIGNUMERIC:
+    case FN_DIVIDE_DOUBLE:
+    case FN_DIVIDE_NUMERIC:
+    case FN_DIVIDE_BIGNUMERIC:
+    case FN_DIV_INT64:
+    case FN_DIV_UINT64:
+    case FN_DIV_NUMERIC:
+    case FN_SAFE_ADD_INT64:
+    case FN_SAFE_ADD_UINT64:
+    case FN_SAFE_ADD_DOUBLE:
+    case FN_SAFE_ADD_NUMERIC:
+    case FN_SAFE_ADD_BIGNUMERIC:
+    case FN_SAFE_SUBTRACT_INT64:
+    case FN_SAFE_SUBTRACT_UINT64:
+    case FN_SAFE_SUBTRACT_DOUBLE:
+    case FN_SAFE_SUBTRACT_NUMERIC:
+    case FN_SAFE_SUBTRACT_BIGNUMERIC:
+    case FN_SAFE_MULTIPLY_INT64:
+    case FN_SAFE_MULTIPLY_UINT64:
+    case FN_SAFE_MULTIPLY_DOUBLE:
+    case FN_SAFE_MULTIPLY_NUMERIC:
+    case FN_SAFE_MULTIPLY_BIGNUMERIC:
+    case FN_SAFE_DIVIDE_DOUBLE:
+    case FN_SAFE_DIVIDE_NUMERIC:
+    case FN_SAFE_DIVIDE_BIGNUMERIC:
+    case FN_MOD_INT64:
+    case FN_MOD_UINT64:
+    case FN_MOD_NUMERIC:
+    case FN_UNARY_MINUS_INT32:
+    case FN_UNARY_MINUS_INT64:
+    case FN_UNARY_MINUS_FLOAT:
+    case FN_UNARY_MINUS_DOUBLE:
+    case FN_UNARY_MINUS_NUMERIC:
+    case FN_UNARY_MINUS_BIGNUMERIC:
+    case FN_SAFE_UNARY_MINUS_INT32:
+    case FN_SAFE_UNARY_MINUS_INT64:
+    case FN_SAFE_UNARY_MINUS_FLOAT:
+    case FN_SAFE_UNARY_MINUS_DOUBLE:
+    case FN_SAFE_UNARY_MINUS_NUMERIC:
+    case FN_SAFE_UNARY_MINUS_BIGNUMERIC:
+    case FN_EQUAL:
+    case FN_EQUAL_INT64_UINT64:
+    case FN_EQUAL_UINT64_INT64:
+    case FN_NOT_EQUAL:
+    case FN_NOT_EQUAL_INT64_UINT64:
+    case FN_NOT_EQUAL_UINT64_INT64:
+    case FN_LESS:
+    case FN_LESS_INT64_UINT64:
+    case FN_LESS_UINT64_INT64:
+    case FN_LESS_OR_EQUAL:
+    case FN_LESS_OR_EQUAL_INT64_UINT64:
+    case FN_LESS_OR_EQUAL_UINT64_INT64:
+    case FN_GREATER:
+    case FN_GREATER_INT64_UINT64:
+    case FN_GREATER_UINT64_INT64:
+    case FN_GREATER_OR_EQUAL:
+    case FN_GREATER_OR_EQUAL_INT64_UINT64:
+    case FN_GREATER_OR_EQUAL_UINT64_INT64:
+    case FN_AND:
+    case FN_NOT:
+    case FN_OR:
+    case FN_IS_NULL:
+    case FN_IS_TRUE:
+    case FN_IS_FALSE:
+    case FN_BITWISE_NOT_INT32:
+    case FN_BITWISE_NOT_INT64:
+    case FN_BITWISE_NOT_UINT32:
+    case FN_BITWISE_NOT_UINT64:
+    case FN_BITWISE_NOT_BYTES:
+    case FN_BITWISE_OR_INT32:
+    case FN_BITWISE_OR_INT64:
+    case FN_BITWISE_OR_UINT32:
+    case FN_BITWISE_OR_UINT64:
+    case FN_BITWISE_OR_BYTES:
+    case FN_BITWISE_XOR_INT32:
+    case FN_BITWISE_XOR_INT64:
+    case FN_BITWISE_XOR_UINT32:
+    case FN_BITWISE_XOR_UINT64:
+    case FN_BITWISE_XOR_BYTES:
+    case FN_BITWISE_AND_INT32:
+    case FN_BITWISE_AND_INT64:
+    case FN_BITWISE_AND_UINT32:
+    case FN_BITWISE_AND_UINT64:
+    case FN_BITWISE_AND_BYTES:
+    case FN_BITWISE_LEFT_SHIFT_INT32:
+    case FN_BITWISE_LEFT_SHIFT_INT64:
+    case FN_BITWISE_LEFT_SHIFT_UINT32:
+    case FN_BITWISE_LEFT_SHIFT_UINT64:
+    case FN_BITWISE_LEFT_SHIFT_BYTES:
+    case FN_BITWISE_RIGHT_SHIFT_INT32:
+    case FN_BITWISE_RIGHT_SHIFT_INT64:
+    case FN_BITWISE_RIGHT_SHIFT_UINT32:
+    case FN_BITWISE_RIGHT_SHIFT_UINT64:
+    case FN_BITWISE_RIGHT_SHIFT_BYTES:
+    case FN_ABS_INT32:
+    case FN_ABS_INT64:
+    case FN_ABS_UINT32:
+    case FN_ABS_UINT64:
+    case FN_ABS_FLOAT:
+    case FN_ABS_DOUBLE:
+    case FN_ABS_NUMERIC:
+    case FN_SIGN_INT32:
+    case FN_SIGN_INT64:
+    case FN_SIGN_UINT32:
+    case FN_SIGN_UINT64:
+    case FN_SIGN_FLOAT:
+    case FN_SIGN_DOUBLE:
+    case FN_SIGN_NUMERIC:
+    case FN_ROUND_DOUBLE:
+    case FN_ROUND_FLOAT:
+    case FN_ROUND_NUMERIC:
+    case FN_ROUND_WITH_DIGITS_DOUBLE:
+    case FN_ROUND_WITH_DIGITS_FLOAT:
+    case FN_ROUND_WITH_DIGITS_NUMERIC:
+    case FN_TRUNC_DOUBLE:
+    case FN_TRUNC_FLOAT:
+    case FN_TRUNC_NUMERIC:
+    case FN_TRUNC_WITH_DIGITS_DOUBLE:
+    case FN_TRUNC_WITH_DIGITS_FLOAT:
+    case FN_TRUNC_WITH_DIGITS_NUMERIC:
+    case FN_CEIL_DOUBLE:
+    case FN_CEIL_FLOAT:
+    case FN_CEIL_NUMERIC:
+    case FN_FLOOR_DOUBLE:
+    case FN_FLOOR_FLOAT:
+    case FN_FLOOR_NUMERIC:
+    case FN_IS_NAN:
+    case FN_IS_INF:
+    case FN_IEEE_DIVIDE_DOUBLE:
+    case FN_IEEE_DIVIDE_FLOAT:
+    case FN_SQRT_DOUBLE:
+    case FN_POW_DOUBLE:
+    case FN_POW_NUMERIC:
+    case FN_LEAST:
+    case FN_GREATEST:
+    case FN_CONCAT_STRING:
+    case FN_CONCAT_BYTES:
+    case FN_CONCAT_OP_STRING:
+    case FN_CONCAT_OP_BYTES:
+    case FN_ENDS_WITH_STRING:
+    case FN_ENDS_WITH_BYTES:
+    case FN_LENGTH_STRING:
+    case FN_LENGTH_BYTES:
+    case FN_LOWER_STRING:
+    case FN_LOWER_BYTES:
+    case FN_LTRIM_STRING:
+    case FN_LTRIM_BYTES:
+    case FN_STARTS_WITH_STRING:
+    case FN_STARTS_WITH_BYTES:
+    case FN_STRPOS_STRING:
+    case FN_STRPOS_BYTES:
+    case FN_SUBSTR_STRING:
+    case FN_SUBSTR_BYTES:
+    case FN_TRIM_STRING:
+    case FN_TRIM_BYTES:
+    case FN_UPPER_STRING:
+    case FN_UPPER_BYTES:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if casts from and to 'type' do not depend on the
+// EvaluationContext.
+static bool IsContextIndependentCastType(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_BOOL:
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_NUMERIC:
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if 'expr' only depends on literals, so that it can be evaluated
+// by the algebrizer. The result for each node is memoized in 'memo', so that
+// asking about every node of an expression takes linear time.
+static bool IsConstantFoldable(
+    const ResolvedExpr* expr,
+    absl::flat_hash_map<const ResolvedExpr*, bool>* memo) {
+  const bool* memoized = zetasql_base::FindOrNull(*memo, expr);
+  if (memoized != nullptr) return *memoized;
+
+  bool foldable = false;
+  switch (expr->node_kind()) {
+    case RESOLVED_LITERAL:
+      foldable = true;
+      break;
+    case RESOLVED_FUNCTION_CALL: {
+      const ResolvedFunctionCall* function_call =
+          expr->GetAs<ResolvedFunctionCall>();
+      const Function* function = function_call->function();
+      foldable =
+          function->IsZetaSQLBuiltin() &&
+          function->function_options().volatility != FunctionEnums::VOLATILE &&
+          IsContextIndependentFunction(static_cast<FunctionSignatureId>(
+              function_call->signature().context_id()));
+      for (int i = 0; foldable && i < function_call->argument_list_size();
+           ++i) {
+        foldable = IsConstantFoldable(function_call->argument_list(i), memo);
+      }
+      break;
+    }
+    case RESOLVED_CAST: {
+      const ResolvedCast* cast = expr->GetAs<ResolvedCast>();
+      foldable = IsContextIndependentCastType(cast->type()) &&
+                 IsContextIndependentCastType(cast->expr()->type()) &&
+                 IsConstantFoldable(cast->expr(), memo);
+      break;
+    }
+    default:
+      break;
+  }
+  memo->emplace(expr, foldable);
+  return foldable;
+}
+
+zetasql_base::StatusOr<std::unique_ptr<ValueExpr>>
+Algebrizer::MaybeFoldConstantExpression(const ResolvedExpr* expr,
+                                        std::unique_ptr<ValueExpr> val_op) {
+  if (expr->node_kind() == RESOLVED_LITERAL ||
+      !IsConstantFoldable(expr, &constant_foldable_exprs_)) {
+    return std::move(val_op);
+  }
+  // The expression is evaluated without any parameters, so every leaf of it
+  // must be a literal. The arguments were checked when they were algebrized,
+  // so only the direct children are checked here.
+  std::vector<const ResolvedNode*> children;
+  expr->GetChildNodes(&children);
+  for (const ResolvedNode* child : children) {
+    ZETASQL_RET_CHECK(child->IsExpression() &&
+              IsConstantFoldable(child->GetAs<ResolvedExpr>(),
+                                 &constant_foldable_exprs_))
+        << "Cannot fold an expression that depends on "
+        << child->DebugString();
+  }
+  ZETASQL_RETURN_IF_ERROR(val_op->SetSchemasForEvaluation(/*params_schemas=*/{}));
+  EvaluationContext context((EvaluationOptions()));
+  context.SetLanguageOptions(language_options_);
+  TupleSlot result;
+  absl::Status status;
+  if (!val_op->EvalSimple(/*params=*/{}, &context, &result, &status) ||
+      !context.IsDeterministicOutput()) {
+    // Keep the expression so that the error is only raised if the expression
+    // is actually evaluated (e.g., not in an untaken branch of an IF).
+    return std::move(val_op);
+  }
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ConstExpr> const_expr,
+                   ConstExpr::Create(result.value()));
+  return std::unique_ptr<ValueExpr>(std::move(const_expr));
+}
+
+// Returns true if 'expr' only consists of non-volatile builtin function calls,
+// casts and struct constructors and field accesses over columns, parameters
+// and literals. Such an expression has the same value for all of its
+// occurrences in a projection. The result for each node is memoized in 'memo'.
+static bool IsPureExpression(
+    const ResolvedExpr* expr,
+    absl::flat_hash_map<const ResolvedExpr*, bool>* memo) {
+  const bool* memoized = zetasql_base::FindOrNull(*memo, expr);
+  if (memoized != nullptr) return *memoized;
+
+  bool pure = false;
+  switch (expr->node_kind()) {
+    case RESOLVED_FUNCTION_CALL: {
+      const ResolvedFunctionCall* function_call =
+          expr->GetAs<ResolvedFunctionCall>();
+      const Function* function = function_call->function();
+      pure =
+          function->IsZetaSQLBuiltin() &&
+          function->function_options().volatility != FunctionEnums::VOLATILE;
+      for (int i = 0; pure && i < function_call->argument_list_size(); ++i) {
+        pure = IsPureExpression(function_call->argument_list(i), memo);
+      }
+      break;
+    }
+    case RESOLVED_CAST:
+      pure = IsPureExpression(expr->GetAs<ResolvedCast>()->expr(), memo);
+      break;
+    case RESOLVED_GET_STRUCT_FIELD:
+      pure = IsPureExpression(expr->GetAs<ResolvedGetStructField>()->expr(),
+                              memo);
+      break;
+    case RESOLVED_MAKE_STRUCT: {
+      pure = true;
+      for (const auto& field_expr :
+           expr->GetAs<ResolvedMakeStruct>()->field_list()) {
+        if (!IsPureExpression(field_expr.get(), memo)) {
+          pure = false;
+          break;
+        }
+      }
+      break;
+    }
+    case RESOLVED_EXPRESSION_COLUMN:
+    case RESOLVED_LITERAL:
+    case RESOLVED_CONSTANT:
+    case RESOLVED_COLUMN_REF:
+    case RESOLVED_PARAMETER:
+      pure = true;
+      break;
+    default:
+      break;
+  }
+  memo->emplace(expr, pure);
+  return pure;
+}
+
+// Returns true if evaluating 'function_call' always evaluates all of its
+// arguments. The conditional functions are algebrized into IfExprs, and
+// hoisting a subexpression out of one of their branches could raise an error
+// that the branch would not have raised.
+static bool EvaluatesAllArguments(const ResolvedFunctionCall* function_call) {
+  if (!function_call->function()->IsZetaSQLBuiltin()) {
+    return true;
+  }
+  switch (function_call->signature().context_id()) {
+    case FN_IF:
+    case FN_IFNULL:
+    case FN_NULLIF:
+    case FN_COALESCE:
+    case FN_CASE_NO_VALUE:
+    case FN_CASE_WITH_VALUE:
+      return false;
+    default:
+      return true;
+  }
+}
+
+namespace {
+
+template <typename T>
+size_t CombineHash(size_t hash, const T& value) {
+  return absl::Hash<std::pair<size_t, T>>()(std::make_pair(hash, value));
+}
+
+// Groups the structurally equal pure subexpressions of a list of expressions.
+// Only positions that are evaluated whenever the containing expression is
+// evaluated are considered.
+class CommonSubexpressionCollector {
+ public:
+  // 'constant_foldable_exprs' memoizes IsConstantFoldable().
+  explicit CommonSubexpressionCollector(
+      absl::flat_hash_map<const ResolvedExpr*, bool>* constant_foldable_exprs)
+      : constant_foldable_exprs_(constant_foldable_exprs) {}
+  CommonSubexpressionCollector(const CommonSubexpressionCollector&) = delete;
+  CommonSubexpressionCollector& operator=(const CommonSubexpressionCollector&) =
+      delete;
+
+  void Collect(const ResolvedExpr* expr) {
+    const bool is_candidate = (expr->node_kind() == RESOLVED_FUNCTION_CALL ||
+                               expr->node_kind() == RESOLVED_CAST ||
+                               expr->node_kind() == RESOLVED_GET_STRUCT_FIELD) &&
+                              IsPureExpression(expr, &pure_exprs_) &&
+                              !IsConstantFoldable(expr,
+                                                  constant_foldable_exprs_);
+    size_t hash = 0;
+    if (is_candidate) {
+      hash = Hash(expr);
+      for (int group : zetasql_base::FindWithDefault(groups_by_hash_, hash)) {
+        if (IsSameExpressionForGroupBy(groups_[group].front(), expr)) {
+          // The subexpressions of 'expr' are computed along with the first
+          // occurrence.
+          groups_[group].push_back(expr);
+          return;
+        }
+      }
+    }
+    switch (expr->node_kind()) {
+      case RESOLVED_FUNCTION_CALL: {
+        const ResolvedFunctionCall* function_call =
+            expr->GetAs<ResolvedFunctionCall>();
+        if (EvaluatesAllArguments(function_call)) {
+          for (int i = 0; i < function_call->argument_list_size(); ++i) {
+            Collect(function_call->argument_list(i));
+          }
+        }
+        break;
+      }
+      case RESOLVED_CAST:
+        Collect(expr->GetAs<ResolvedCast>()->expr());
+        break;
+      case RESOLVED_GET_STRUCT_FIELD:
+        Collect(expr->GetAs<ResolvedGetStructField>()->expr());
+        break;
+      case RESOLVED_MAKE_STRUCT:
+        for (const auto& field_expr :
+             expr->GetAs<ResolvedMakeStruct>()->field_list()) {
+          Collect(field_expr.get());
+        }
+        break;
+      default:
+        break;
+    }
+    // Groups are created after the groups of the subexpressions of 'expr'.
+    if (is_candidate) {
+      groups_by_hash_[hash].push_back(groups_.size());
+      groups_.push_back({expr});
+    }
+  }
+
+  // Returns the groups with more than one occurrence. A group comes after the
+  // groups of its subexpressions.
+  std::vector<std::vector<const ResolvedExpr*>> RepeatedGroups() const {
+    std::vector<std::vector<const ResolvedExpr*>> repeated_groups;
+    for (const std::vector<const ResolvedExpr*>& group : groups_) {
+      if (group.size() > 1) {
+        repeated_groups.push_back(group);
+      }
+    }
+    return repeated_groups;
+  }
+
+ private:
+  // Returns a hash of 'expr' that is the same for expressions that
+  // IsSameExpressionForGroupBy() considers equal. The hashes of the
+  // subexpressions are memoized, so that hashing every subexpression of an
+  // expression takes linear time.
+  size_t Hash(const ResolvedExpr* expr) {
+    const size_t* memoized_hash = zetasql_base::FindOrNull(hashes_, expr);
+    if (memoized_hash != nullptr) return *memoized_hash;
+
+    size_t hash = absl::Hash<std::pair<int, int>>()(
+        {expr->node_kind(), expr->type()->kind()});
+    switch (expr->node_kind()) {
+      case RESOLVED_LITERAL:
+        hash = CombineHash(hash, expr->GetAs<ResolvedLiteral>()->value());
+        break;
+      case RESOLVED_PARAMETER: {
+        const ResolvedParameter* parameter = expr->GetAs<ResolvedParameter>();
+        hash = CombineHash(CombineHash(hash, parameter->name()),
+                           parameter->position());
+        break;
+      }
+      case RESOLVED_EXPRESSION_COLUMN:
+        hash = CombineHash(hash,
+                           expr->GetAs<ResolvedExpressionColumn>()->name());
+        break;
+      case RESOLVED_COLUMN_REF:
+        hash = CombineHash(
+            hash, expr->GetAs<ResolvedColumnRef>()->column().column_id());
+        break;
+      case RESOLVED_GET_STRUCT_FIELD: {
+        const ResolvedGetStructField* get_field =
+            expr->GetAs<ResolvedGetStructField>();
+        hash = CombineHash(CombineHash(hash, get_field->field_idx()),
+                           Hash(get_field->expr()));
+        break;
+      }
+      case RESOLVED_CAST:
+        hash = CombineHash(hash, Hash(expr->GetAs<ResolvedCast>()->expr()));
+        break;
+      case RESOLVED_FUNCTION_CALL: {
+        const ResolvedFunctionCall* function_call =
+            expr->GetAs<ResolvedFunctionCall>();
+        hash = CombineHash(hash, function_call->function());
+        for (int i = 0; i < function_call->argument_list_size(); ++i) {
+          hash = CombineHash(hash, Hash(function_call->argument_list(i)));
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    hashes_.emplace(expr, hash);
+    return hash;
+  }
+
+  absl::flat_hash_map<const ResolvedExpr*, bool>* constant_foldable_exprs_;
+  // Memoizes IsPureExpression().
+  absl::flat_hash_map<const ResolvedExpr*, bool> pure_exprs_;
+  absl::flat_hash_map<const ResolvedExpr*, size_t> hashes_;
+  // The indexes in 'groups_' of the groups whose first occurrence has a given
+  // hash.
+  absl::flat_hash_map<size_t, std::vector<int>> groups_by_hash_;
+  std::vector<std::vector<const ResolvedExpr*>> groups_;
+};
+
+}  // namespace
+
+absl::Status Algebrizer::HoistCommonSubexpressions(
+    absl::Span<const ResolvedExpr* const> exprs,
+    std::vector<std::unique_ptr<ExprArg>>* hoisted,
+    std::vector<const ResolvedExpr*>* occurrences) {
+  if (!algebrizer_options_.optimize_expressions) {
+    return absl::OkStatus();
+  }
+  CommonSubexpressionCollector collector(&constant_foldable_exprs_);
+  for (const ResolvedExpr* expr : exprs) {
+    collector.Collect(expr);
+  }
+  for (const std::vector<const ResolvedExpr*>& group :
+       collector.RepeatedGroups()) {
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> value_expr,
+                     AlgebrizeExpression(group.front()));
+    const VariableId variable = variable_gen_->GetNewVariableName("_cse");
+    hoisted->push_back(
+        absl::make_unique<ExprArg>(variable, std::move(value_expr)));
+    for (const ResolvedExpr* occurrence : group) {
+      ZETASQL_RET_CHECK(common_subexpressions_.emplace(occurrence, variable).second);
+      occurrences->push_back(occurrence);
+    }
+  }
+  return absl::OkStatus();
+}
+
+void Algebrizer::ForgetCommonSubexpressions(
+    absl::Span<const ResolvedExpr* const> occurrences) {
+  for (const ResolvedExpr* occurrence : occurrences) {
+    common_subexpressions_.erase(occurrence);
+  }
+}
+
 zetasql_base::StatusOr<std::unique_ptr<Algebrizer::FilterConjunctInfo>>
 Algebrizer::FilterConjunctInfo::Create(const ResolvedExpr* conjunct) {
   auto info = absl::make_unique<FilterConjunctInfo>();
@@ -1944,13 +2612,16 @@ Algebrizer::AlgebrizeJoinScanInternal(
 
   // Algebrize the join.
   ZETASQL_ASSIGN_OR_RETURN(
-      std::unique_ptr<RelationalOp> join_op,
+      std::unique_ptr<JoinOp> join_op,
       JoinOp::Create(join_kind, std::move(hash_join_equality_exprs),
                      std::move(remaining_join_expr), std::move(left),
                      std::move(right), std::move(left_output),
                      std::move(right_output)));
+  if (algebrizer_options_.allow_merge_join && join_op->CanUseMergeJoin()) {
+    ZETASQL_RETURN_IF_ERROR(join_op->set_use_merge_join(true));
+  }
 
-  return join_op;
+  return std::unique_ptr<RelationalOp>(std::move(join_op));
 }
 
 absl::Status Algebrizer::NarrowJoinKindForFilterConjunct(
@@ -3113,9 +3784,20 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeProje
       std::unique_ptr<RelationalOp> input,
       AlgebrizeScan(resolved_project->input_scan(), &input_active_conjuncts));
 
-  // Assign variables to the new columns and algebrize their definitions.
+  // Compute the subexpressions that are shared by several definitions first,
+  // so that the definitions can refer to them.
+  std::vector<const ResolvedExpr*> defined_exprs;
+  defined_exprs.reserve(defined_columns_and_exprs.size());
+  for (const auto& entry : defined_columns_and_exprs) {
+    defined_exprs.push_back(entry.second);
+  }
   std::vector<std::unique_ptr<ExprArg>> arguments;
-  arguments.reserve(defined_columns_and_exprs.size());
+  std::vector<const ResolvedExpr*> common_subexpression_occurrences;
+  ZETASQL_RETURN_IF_ERROR(HoistCommonSubexpressions(
+      defined_exprs, &arguments, &common_subexpression_occurrences));
+
+  // Assign variables to the new columns and algebrize their definitions.
+  arguments.reserve(arguments.size() + defined_columns_and_exprs.size());
   for (const auto& entry : defined_columns_and_exprs) {
     const ResolvedColumn& column = entry.first;
     const ResolvedExpr* expr = entry.second;
@@ -3126,6 +3808,7 @@ zetasql_base::StatusOr<std::unique_ptr<RelationalOp>> Algebrizer::AlgebrizeProje
     arguments.push_back(
         absl::make_unique<ExprArg>(variable, std::move(argument)));
   }
+  ForgetCommonSubexpressions(common_subexpression_occurrences);
 
   // If no columns were defined by this project then just drop it.
   if (!arguments.empty()) {
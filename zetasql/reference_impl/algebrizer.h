@@ -46,6 +46,7 @@
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "absl/types/variant.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/statusor.h"
@@ -68,6 +69,12 @@ struct AlgebrizerOptions {
   // compatible filter immediately above the join.
   bool allow_hash_join = false;
 
+  // If true, the algebrizer uses a sort-merge join instead of a hash join when
+  // 'allow_hash_join' is true and the equality expressions of the join
+  // condition have matching types that are simple and support equality. This
+  // is cheaper when the inputs are already ordered on the join keys.
+  bool allow_merge_join = false;
+
   // If true, the algebrizer attempts to use a single operator for ORDER BY
   // LIMIT instead of LimitOp(SortOp), which saves memory.
   bool allow_order_by_limit_operator = false;
@@ -77,6 +84,19 @@ struct AlgebrizerOptions {
   // latter case, the filter remains in its original location because
   // EvaluatorTableIterator does not have to honor the filter.
   bool push_down_filters = false;
+
+  // If true, the algebrizer replaces deterministic function calls over
+  // literals by their values, and computes subexpressions that occur more than
+  // once in a projection (or a standalone expression) only once. Folding leaves
+  // expressions that fail to evaluate alone so that the error is still only
+  // raised if the expression is evaluated.
+  bool optimize_expressions = false;
+
+  // If true, uncorrelated EXISTS, scalar and ARRAY subqueries are evaluated
+  // only once per query, and uncorrelated IN subqueries over simple types
+  // collect their values into a hash set once instead of being scanned for
+  // every row.
+  bool cache_uncorrelated_subqueries = false;
 };
 
 class Algebrizer {
@@ -218,6 +238,29 @@ class Algebrizer {
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> AlgebrizeExpression(
       const ResolvedExpr* expr);
 
+  // If 'expr' is a deterministic function of literals that evaluates without
+  // error, returns a ConstExpr with its value. Otherwise returns 'val_op',
+  // which must be the algebrized form of 'expr'. Since the arguments of 'expr'
+  // have already been algebrized, whether they can be folded is known.
+  zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> MaybeFoldConstantExpression(
+      const ResolvedExpr* expr, std::unique_ptr<ValueExpr> val_op);
+
+  // If 'algebrizer_options_.optimize_expressions' is true, finds the
+  // subexpressions that occur more than once in 'exprs' and can be computed
+  // up front, algebrizes each of them once into an assignment to a new
+  // variable, and appends the assignments (in dependency order) to 'hoisted'.
+  // Until ForgetCommonSubexpressions() is called, AlgebrizeExpression()
+  // returns a DerefExpr of the new variable for every occurrence, without
+  // algebrizing it again. The occurrences are appended to 'occurrences'.
+  absl::Status HoistCommonSubexpressions(
+      absl::Span<const ResolvedExpr* const> exprs,
+      std::vector<std::unique_ptr<ExprArg>>* hoisted,
+      std::vector<const ResolvedExpr*>* occurrences);
+
+  // Undoes the effect of HoistCommonSubexpressions() for 'occurrences'.
+  void ForgetCommonSubexpressions(
+      absl::Span<const ResolvedExpr* const> occurrences);
+
   // Wraps 'value_expr' in a RootExpr to manage ownership of some objects
   // required by the algebrized tree.
   zetasql_base::StatusOr<std::unique_ptr<ValueExpr>> WrapWithRootExpr(
@@ -802,6 +845,14 @@ class Algebrizer {
   // the query.
   std::vector<std::unique_ptr<ExprArg>> with_subquery_let_assignments_;
 
+  // Maps each occurrence of a subexpression hoisted by
+  // HoistCommonSubexpressions() to the variable that holds its value.
+  absl::flat_hash_map<const ResolvedExpr*, VariableId> common_subexpressions_;
+
+  // Memoizes whether each expression only depends on literals, for
+  // MaybeFoldConstantExpression() and HoistCommonSubexpressions().
+  absl::flat_hash_map<const ResolvedExpr*, bool> constant_foldable_exprs_;
+
   // Owns all the ProtoFieldRegistries created by the algebrizer.
   std::vector<std::unique_ptr<ProtoFieldRegistry>> proto_field_registries_;
 
@@ -54,6 +54,7 @@ namespace zetasql {
 
 using testing::HasSubstr;
 using testing::MatchesRegex;
+using testing::Not;
 using testing::TestWithParam;
 using testing::ValuesIn;
 using zetasql_base::testing::StatusIs;
@@ -1018,6 +1019,117 @@ TEST_F(ExpressionAlgebrizerTest, UnknownFunction) {
   ASSERT_FALSE(fct.ok());
 }
 
+TEST_F(ExpressionAlgebrizerTest, OptimizeExpressions) {
+  AlgebrizerOptions algebrizer_options;
+  algebrizer_options.optimize_expressions = true;
+  FunctionSignature int64_int64_int64(Int64Type(), {Int64Type(), Int64Type()},
+                                      FN_ADD_INT64);
+
+  // 13 + 7 is folded.
+  auto constant_sum = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+      AlgebrizerTestFunctions::TwoInt64Literals(), DEFAULT_ERROR_MODE);
+  std::unique_ptr<ValueExpr> output;
+  ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeExpression(
+      LanguageOptions(), algebrizer_options, &type_factory_,
+      constant_sum.get(), &output, &parameters_, &column_map_,
+      &system_variables_map_));
+  EXPECT_EQ("RootExpr(ConstExpr(20))", output->DebugString());
+
+  // (13 + 7) + 1 is folded level by level.
+  auto nested_sum = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+      MakeNodeVectorP<const ResolvedExpr>(
+          MakeResolvedFunctionCall(Int64Type(),
+                                   AlgebrizerTestFunctions::fn_add,
+                                   int64_int64_int64,
+                                   AlgebrizerTestFunctions::TwoInt64Literals(),
+                                   DEFAULT_ERROR_MODE),
+          MakeResolvedLiteral(Value::Int64(1))),
+      DEFAULT_ERROR_MODE);
+  ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeExpression(
+      LanguageOptions(), algebrizer_options, &type_factory_, nested_sum.get(),
+      &output, &parameters_, &column_map_, &system_variables_map_));
+  EXPECT_EQ("RootExpr(ConstExpr(21))", output->DebugString());
+
+  // Functions are folded according to their signature, so a call whose
+  // signature is not known to be context-independent is kept.
+  FunctionSignature unknown_signature(
+      Int64Type(), {Int64Type(), Int64Type()}, -1 /* context_id */);
+  auto unknown_sum = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, unknown_signature,
+      AlgebrizerTestFunctions::TwoInt64Literals(), DEFAULT_ERROR_MODE);
+  ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeExpression(
+      LanguageOptions(), algebrizer_options, &type_factory_,
+      unknown_sum.get(), &output, &parameters_, &column_map_,
+      &system_variables_map_));
+  EXPECT_EQ("RootExpr(Add(ConstExpr(13), ConstExpr(7)))",
+            output->DebugString());
+
+  // An overflow is left to evaluation time.
+  auto overflowing_sum = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+      MakeNodeVectorP<const ResolvedExpr>(
+          MakeResolvedLiteral(
+              Value::Int64(std::numeric_limits<int64_t>::max())),
+          MakeResolvedLiteral(Value::Int64(1))),
+      DEFAULT_ERROR_MODE);
+  ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeExpression(
+      LanguageOptions(), algebrizer_options, &type_factory_,
+      overflowing_sum.get(), &output, &parameters_, &column_map_,
+      &system_variables_map_));
+  EXPECT_EQ("RootExpr(Add(ConstExpr(9223372036854775807), ConstExpr(1)))",
+            output->DebugString());
+
+  // (@p1 + @p2) + (@p1 + @p2) computes @p1 + @p2 once.
+  auto make_param_sum = [&int64_int64_int64]() {
+    return MakeResolvedFunctionCall(
+        Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+        MakeNodeVectorP<const ResolvedExpr>(
+            MakeResolvedParameter(Int64Type(), "", /*position=*/1,
+                                  /*is_untyped=*/false),
+            MakeResolvedParameter(Int64Type(), "", /*position=*/2,
+                                  /*is_untyped=*/false)),
+        DEFAULT_ERROR_MODE);
+  };
+  auto repeated_sum = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+      MakeNodeVectorP<const ResolvedExpr>(make_param_sum(), make_param_sum()),
+      DEFAULT_ERROR_MODE);
+  Parameters parameters(ParameterList{});
+  ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeExpression(
+      LanguageOptions(), algebrizer_options, &type_factory_,
+      repeated_sum.get(), &output, &parameters, &column_map_,
+      &system_variables_map_));
+  const std::string debug_string = output->DebugString();
+  EXPECT_THAT(debug_string,
+              HasSubstr("$_cse := Add($positional_param_1, "
+                        "$positional_param_2)"));
+  EXPECT_THAT(debug_string, HasSubstr("Add($_cse, $_cse)"));
+  // The second occurrence is not algebrized, but its fields count as accessed.
+  ZETASQL_EXPECT_OK(repeated_sum->CheckFieldsAccessed());
+
+  // @p1 + @p2 and @p2 + @p1 are not the same expression.
+  auto swapped_param_sum = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+      MakeNodeVectorP<const ResolvedExpr>(
+          MakeResolvedParameter(Int64Type(), "", /*position=*/2,
+                                /*is_untyped=*/false),
+          MakeResolvedParameter(Int64Type(), "", /*position=*/1,
+                                /*is_untyped=*/false)),
+      DEFAULT_ERROR_MODE);
+  auto distinct_sums = MakeResolvedFunctionCall(
+      Int64Type(), AlgebrizerTestFunctions::fn_add, int64_int64_int64,
+      MakeNodeVectorP<const ResolvedExpr>(make_param_sum(),
+                                          std::move(swapped_param_sum)),
+      DEFAULT_ERROR_MODE);
+  ZETASQL_ASSERT_OK(Algebrizer::AlgebrizeExpression(
+      LanguageOptions(), algebrizer_options, &type_factory_,
+      distinct_sums.get(), &output, &parameters, &column_map_,
+      &system_variables_map_));
+  EXPECT_THAT(output->DebugString(), Not(HasSubstr("$_cse")));
+}
+
 // Algebrizer::Parameters used for a single filter test.
 struct FilterTest {
   FunctionSignature signature;  // Test input
@@ -1326,6 +1438,59 @@ TEST_P(AlgebrizerTestJoins, InnerJoin) {
 INSTANTIATE_TEST_SUITE_P(InnerJoin, AlgebrizerTestJoins,
                          ValuesIn(AlgebrizerTestJoins::AllJoinTests()));
 
+class MergeJoinAlgebrizerTest : public StatementAlgebrizerTest {
+ protected:
+  void SetUp() override {
+    algebrizer_options_.allow_hash_join = true;
+    algebrizer_options_.allow_merge_join = true;
+    StatementAlgebrizerTest::SetUp();
+  }
+};
+
+TEST_F(MergeJoinAlgebrizerTest, InnerJoin) {
+  // Build a resolved AST for a join of table_all_types with table_all_types_2
+  // on their INT64 columns.
+  int column_id = 1;
+  std::unique_ptr<const ResolvedTableScan> left_table_scan =
+      ScanTableAllTypes(&column_id);
+  std::unique_ptr<const ResolvedTableScan> right_table_scan =
+      ScanTableAllTypes2(&column_id);
+  ResolvedColumnList join_output_columns = left_table_scan->column_list();
+  for (const ResolvedColumn& column : right_table_scan->column_list()) {
+    join_output_columns.push_back(column);
+  }
+  std::unique_ptr<const Function> equal_function(
+      new Function("$equal", Function::kZetaSQLFunctionGroupName,
+                   Function::SCALAR));
+  FunctionSignature signature(ARG_TYPE_ANY_1,
+                              {ARG_TYPE_ANY_1, ARG_TYPE_ANY_1},
+                              -1);
+  std::vector<std::unique_ptr<const ResolvedExpr>> arguments;
+  arguments.push_back(MakeResolvedColumnRef(
+      Int64Type(),
+      ResolvedColumn(kInt64ColId, kAllTypesTable, kInt64Col, Int64Type()),
+      kNonCorrelated));
+  arguments.push_back(MakeResolvedColumnRef(
+      Int64Type(),
+      ResolvedColumn(kInt64ColId2, kAllTypesTable2, kInt64Col2, Int64Type()),
+      kNonCorrelated));
+  auto join_expr =
+      MakeResolvedFunctionCall(BoolType(), equal_function.get(), signature,
+                               std::move(arguments), DEFAULT_ERROR_MODE);
+  auto join_scan = MakeResolvedJoinScan(
+      join_output_columns, ResolvedJoinScan::INNER, std::move(left_table_scan),
+      std::move(right_table_scan), std::move(join_expr));
+
+  // The equality becomes the key of a merge join.
+  std::unique_ptr<const AlgebraNode> algebrized_join(
+      algebrizer_->AlgebrizeScan(join_scan.get()).value());
+  const std::string debug_string = algebrized_join->DebugString();
+  EXPECT_THAT(debug_string, HasSubstr("JoinOp(INNER MERGE\n"));
+  EXPECT_THAT(debug_string, HasSubstr("$col_int64"));
+  EXPECT_THAT(debug_string, HasSubstr("$col_int64.2"));
+  EXPECT_THAT(debug_string, HasSubstr("remaining_condition: ConstExpr(true)"));
+}
+
 TEST_P(AlgebrizerTestJoins, CorrelatedInnerJoin) {
   FilterTest parameters = GetParam();
   // Build a resolved AST for a join of table_all_types with table_all_types_2
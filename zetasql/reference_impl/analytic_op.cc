@@ -2302,7 +2302,7 @@ class AnalyticTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AnalyticOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> AnalyticOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
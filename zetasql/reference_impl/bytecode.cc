@@ -0,0 +1,496 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/bytecode.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "zetasql/base/logging.h"
+#include "zetasql/public/functions/arithmetics.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "zetasql/reference_impl/operator.h"
+#include "zetasql/reference_impl/tuple.h"
+#include <cstdint>
+#include "absl/container/inlined_vector.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status_macros.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+namespace {
+
+// Programs with at most this many registers evaluate without allocating.
+constexpr int kMaxInlineRegisters = 16;
+
+std::string OpcodeName(BytecodeOpcode opcode) {
+  switch (opcode) {
+    case BytecodeOpcode::kLoadInt64:
+      return "LoadInt64";
+    case BytecodeOpcode::kLoadDouble:
+      return "LoadDouble";
+    case BytecodeOpcode::kLoadBool:
+      return "LoadBool";
+    case BytecodeOpcode::kMove:
+      return "Move";
+    case BytecodeOpcode::kAddInt64:
+      return "AddInt64";
+    case BytecodeOpcode::kSubtractInt64:
+      return "SubtractInt64";
+    case BytecodeOpcode::kMultiplyInt64:
+      return "MultiplyInt64";
+    case BytecodeOpcode::kAddDouble:
+      return "AddDouble";
+    case BytecodeOpcode::kSubtractDouble:
+      return "SubtractDouble";
+    case BytecodeOpcode::kMultiplyDouble:
+      return "MultiplyDouble";
+    case BytecodeOpcode::kDivideDouble:
+      return "DivideDouble";
+    case BytecodeOpcode::kEqualInt64:
+      return "EqualInt64";
+    case BytecodeOpcode::kLessInt64:
+      return "LessInt64";
+    case BytecodeOpcode::kLessOrEqualInt64:
+      return "LessOrEqualInt64";
+    case BytecodeOpcode::kEqualDouble:
+      return "EqualDouble";
+    case BytecodeOpcode::kLessDouble:
+      return "LessDouble";
+    case BytecodeOpcode::kLessOrEqualDouble:
+      return "LessOrEqualDouble";
+    case BytecodeOpcode::kEqualBool:
+      return "EqualBool";
+    case BytecodeOpcode::kLessBool:
+      return "LessBool";
+    case BytecodeOpcode::kLessOrEqualBool:
+      return "LessOrEqualBool";
+    case BytecodeOpcode::kAnd:
+      return "And";
+    case BytecodeOpcode::kOr:
+      return "Or";
+    case BytecodeOpcode::kNot:
+      return "Not";
+    case BytecodeOpcode::kIsNull:
+      return "IsNull";
+    case BytecodeOpcode::kJumpIfNotTrue:
+      return "JumpIfNotTrue";
+    case BytecodeOpcode::kJump:
+      return "Jump";
+  }
+  return absl::StrCat("Opcode(", static_cast<int>(opcode), ")");
+}
+
+// Loads 'value' into 'dst'. Returns false if 'value' does not have 'kind'.
+template <typename T, T BytecodeRegister::*field>
+inline bool Load(const Value& value, TypeKind kind, T (Value::*getter)() const,
+                 BytecodeRegister* dst) {
+  if (ABSL_PREDICT_FALSE(value.type_kind() != kind)) return false;
+  dst->is_null = value.is_null();
+  if (!dst->is_null) dst->*field = (value.*getter)();
+  return true;
+}
+
+// Sets 'dst' to fn(x, y), or NULL if either input is NULL. Returns false if
+// 'fn' fails. The error itself is discarded, since the caller falls back to the
+// tree interpreter to reproduce it.
+template <typename T, T BytecodeRegister::*field>
+inline bool ApplyArithmetic(bool (*fn)(T, T, T*, absl::Status*),
+                            const BytecodeRegister& x,
+                            const BytecodeRegister& y, BytecodeRegister* dst) {
+  if (x.is_null || y.is_null) {
+    dst->is_null = true;
+    return true;
+  }
+  T out;
+  absl::Status status;
+  if (!fn(x.*field, y.*field, &out, &status)) return false;
+  dst->is_null = false;
+  dst->*field = out;
+  return true;
+}
+
+template <typename T, T BytecodeRegister::*field, typename Compare>
+inline void ApplyComparison(const BytecodeRegister& x,
+                            const BytecodeRegister& y, BytecodeRegister* dst) {
+  if (x.is_null || y.is_null) {
+    dst->is_null = true;
+    return;
+  }
+  dst->is_null = false;
+  dst->bool_value = Compare()(x.*field, y.*field);
+}
+
+}  // namespace
+
+// -------------------------------------------------------
+// BytecodeBuilder
+// -------------------------------------------------------
+
+bool BytecodeBuilder::IsSupportedType(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT64:
+    case TYPE_DOUBLE:
+    case TYPE_BOOL:
+      return true;
+    default:
+      return false;
+  }
+}
+
+int BytecodeBuilder::AllocateRegister(TypeKind kind) {
+  register_kinds_.push_back(kind);
+  initial_registers_.emplace_back();
+  return register_kinds_.size() - 1;
+}
+
+int BytecodeBuilder::AddConstant(const Value& value) {
+  if (!IsSupportedType(value.type())) return -1;
+  const int reg = AllocateRegister(value.type_kind());
+  BytecodeRegister& initial = initial_registers_[reg];
+  initial.is_null = value.is_null();
+  if (!initial.is_null) {
+    switch (value.type_kind()) {
+      case TYPE_INT64:
+        initial.int64_value = value.int64_value();
+        break;
+      case TYPE_DOUBLE:
+        initial.double_value = value.double_value();
+        break;
+      case TYPE_BOOL:
+        initial.bool_value = value.bool_value();
+        break;
+      default:
+        LOG(DFATAL) << "Unexpected constant type: " << value.DebugString();
+        return -1;
+    }
+  }
+  return reg;
+}
+
+int BytecodeBuilder::Emit(BytecodeOpcode opcode, int dst, int src1, int src2) {
+  BytecodeInstruction instruction;
+  instruction.opcode = opcode;
+  instruction.dst = dst;
+  instruction.src1 = src1;
+  instruction.src2 = src2;
+  instructions_.push_back(instruction);
+  return instructions_.size() - 1;
+}
+
+int BytecodeBuilder::EmitLoad(TypeKind kind, int idx_in_params, int slot) {
+  BytecodeOpcode opcode;
+  switch (kind) {
+    case TYPE_INT64:
+      opcode = BytecodeOpcode::kLoadInt64;
+      break;
+    case TYPE_DOUBLE:
+      opcode = BytecodeOpcode::kLoadDouble;
+      break;
+    case TYPE_BOOL:
+      opcode = BytecodeOpcode::kLoadBool;
+      break;
+    default:
+      LOG(DFATAL) << "Unexpected load type: " << TypeKind_Name(kind);
+      return -1;
+  }
+  const int dst = AllocateRegister(kind);
+  const int instruction = Emit(opcode, dst);
+  instructions_[instruction].a = idx_in_params;
+  instructions_[instruction].b = slot;
+  return dst;
+}
+
+int BytecodeBuilder::EmitJump(BytecodeOpcode opcode, int src) {
+  DCHECK(opcode == BytecodeOpcode::kJump ||
+         opcode == BytecodeOpcode::kJumpIfNotTrue);
+  return Emit(opcode, /*dst=*/-1, src);
+}
+
+void BytecodeBuilder::BindJumpToNextInstruction(int instruction) {
+  instructions_[instruction].a = instructions_.size();
+}
+
+// -------------------------------------------------------
+// BytecodeProgram
+// -------------------------------------------------------
+
+zetasql_base::StatusOr<std::unique_ptr<BytecodeProgram>> BytecodeProgram::Compile(
+    const ValueExpr* expr) {
+  ZETASQL_RET_CHECK(expr != nullptr);
+  if (!BytecodeBuilder::IsSupportedType(expr->output_type())) {
+    return std::unique_ptr<BytecodeProgram>();
+  }
+  BytecodeBuilder builder;
+  int result_reg = -1;
+  if (!expr->AppendBytecode(&builder, &result_reg)) {
+    return std::unique_ptr<BytecodeProgram>();
+  }
+  ZETASQL_RET_CHECK_GE(result_reg, 0);
+  ZETASQL_RET_CHECK_EQ(builder.register_kind(result_reg),
+               expr->output_type()->kind());
+  return absl::WrapUnique(
+      new BytecodeProgram(&builder, result_reg, expr->output_type()));
+}
+
+BytecodeProgram::BytecodeProgram(BytecodeBuilder* builder, int result_reg,
+                                 const Type* output_type)
+    : instructions_(std::move(builder->instructions_)),
+      register_kinds_(std::move(builder->register_kinds_)),
+      initial_registers_(std::move(builder->initial_registers_)),
+      result_reg_(result_reg),
+      output_type_(output_type) {}
+
+bool BytecodeProgram::Eval(absl::Span<const TupleData* const> params,
+                           Value* result) const {
+  absl::InlinedVector<BytecodeRegister, kMaxInlineRegisters> regs(
+      initial_registers_.begin(), initial_registers_.end());
+  const int num_instructions = instructions_.size();
+  for (int pc = 0; pc < num_instructions;) {
+    const BytecodeInstruction& instruction = instructions_[pc++];
+    BytecodeRegister* dst =
+        instruction.dst >= 0 ? &regs[instruction.dst] : nullptr;
+    switch (instruction.opcode) {
+      case BytecodeOpcode::kLoadInt64:
+        if (!Load<int64_t, &BytecodeRegister::int64_value>(
+                params[instruction.a]->slot(instruction.b).value(),
+                TYPE_INT64, &Value::int64_value, dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kLoadDouble:
+        if (!Load<double, &BytecodeRegister::double_value>(
+                params[instruction.a]->slot(instruction.b).value(),
+                TYPE_DOUBLE, &Value::double_value, dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kLoadBool:
+        if (!Load<bool, &BytecodeRegister::bool_value>(
+                params[instruction.a]->slot(instruction.b).value(), TYPE_BOOL,
+                &Value::bool_value, dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kMove:
+        *dst = regs[instruction.src1];
+        break;
+      case BytecodeOpcode::kAddInt64:
+        if (!ApplyArithmetic<int64_t, &BytecodeRegister::int64_value>(
+                &functions::Add<int64_t>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kSubtractInt64:
+        if (!ApplyArithmetic<int64_t, &BytecodeRegister::int64_value>(
+                &functions::Subtract<int64_t>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kMultiplyInt64:
+        if (!ApplyArithmetic<int64_t, &BytecodeRegister::int64_value>(
+                &functions::Multiply<int64_t>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kAddDouble:
+        if (!ApplyArithmetic<double, &BytecodeRegister::double_value>(
+                &functions::Add<double>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kSubtractDouble:
+        if (!ApplyArithmetic<double, &BytecodeRegister::double_value>(
+                &functions::Subtract<double>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kMultiplyDouble:
+        if (!ApplyArithmetic<double, &BytecodeRegister::double_value>(
+                &functions::Multiply<double>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kDivideDouble:
+        if (!ApplyArithmetic<double, &BytecodeRegister::double_value>(
+                &functions::Divide<double>, regs[instruction.src1],
+                regs[instruction.src2], dst)) {
+          return false;
+        }
+        break;
+      case BytecodeOpcode::kEqualInt64:
+        ApplyComparison<int64_t, &BytecodeRegister::int64_value,
+                        std::equal_to<int64_t>>(regs[instruction.src1],
+                                                regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kLessInt64:
+        ApplyComparison<int64_t, &BytecodeRegister::int64_value,
+                        std::less<int64_t>>(regs[instruction.src1],
+                                            regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kLessOrEqualInt64:
+        ApplyComparison<int64_t, &BytecodeRegister::int64_value,
+                        std::less_equal<int64_t>>(regs[instruction.src1],
+                                                  regs[instruction.src2], dst);
+        break;
+      // The built-in floating point comparisons are false if either input is
+      // NaN, which matches Value::SqlEquals() and Value::SqlLessThan().
+      case BytecodeOpcode::kEqualDouble:
+        ApplyComparison<double, &BytecodeRegister::double_value,
+                        std::equal_to<double>>(regs[instruction.src1],
+                                               regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kLessDouble:
+        ApplyComparison<double, &BytecodeRegister::double_value,
+                        std::less<double>>(regs[instruction.src1],
+                                           regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kLessOrEqualDouble:
+        ApplyComparison<double, &BytecodeRegister::double_value,
+                        std::less_equal<double>>(regs[instruction.src1],
+                                                 regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kEqualBool:
+        ApplyComparison<bool, &BytecodeRegister::bool_value,
+                        std::equal_to<bool>>(regs[instruction.src1],
+                                             regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kLessBool:
+        ApplyComparison<bool, &BytecodeRegister::bool_value, std::less<bool>>(
+            regs[instruction.src1], regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kLessOrEqualBool:
+        ApplyComparison<bool, &BytecodeRegister::bool_value,
+                        std::less_equal<bool>>(regs[instruction.src1],
+                                               regs[instruction.src2], dst);
+        break;
+      case BytecodeOpcode::kAnd: {
+        const BytecodeRegister& x = regs[instruction.src1];
+        const BytecodeRegister& y = regs[instruction.src2];
+        BytecodeRegister out;
+        if ((!x.is_null && !x.bool_value) || (!y.is_null && !y.bool_value)) {
+          out.bool_value = false;
+        } else if (x.is_null || y.is_null) {
+          out.is_null = true;
+        } else {
+          out.bool_value = true;
+        }
+        *dst = out;
+        break;
+      }
+      case BytecodeOpcode::kOr: {
+        const BytecodeRegister& x = regs[instruction.src1];
+        const BytecodeRegister& y = regs[instruction.src2];
+        BytecodeRegister out;
+        if ((!x.is_null && x.bool_value) || (!y.is_null && y.bool_value)) {
+          out.bool_value = true;
+        } else if (x.is_null || y.is_null) {
+          out.is_null = true;
+        } else {
+          out.bool_value = false;
+        }
+        *dst = out;
+        break;
+      }
+      case BytecodeOpcode::kNot: {
+        const BytecodeRegister& x = regs[instruction.src1];
+        dst->is_null = x.is_null;
+        dst->bool_value = !x.is_null && !x.bool_value;
+        break;
+      }
+      case BytecodeOpcode::kIsNull: {
+        const bool is_null = regs[instruction.src1].is_null;
+        dst->is_null = false;
+        dst->bool_value = is_null;
+        break;
+      }
+      case BytecodeOpcode::kJumpIfNotTrue: {
+        const BytecodeRegister& condition = regs[instruction.src1];
+        if (condition.is_null || !condition.bool_value) pc = instruction.a;
+        break;
+      }
+      case BytecodeOpcode::kJump:
+        pc = instruction.a;
+        break;
+    }
+  }
+
+  const BytecodeRegister& out = regs[result_reg_];
+  if (out.is_null) {
+    *result = Value::Null(output_type_);
+    return true;
+  }
+  switch (register_kinds_[result_reg_]) {
+    case TYPE_INT64:
+      *result = Value::Int64(out.int64_value);
+      return true;
+    case TYPE_DOUBLE:
+      *result = Value::Double(out.double_value);
+      return true;
+    case TYPE_BOOL:
+      *result = Value::Bool(out.bool_value);
+      return true;
+    default:
+      return false;
+  }
+}
+
+std::string BytecodeProgram::DebugString() const {
+  std::string str;
+  for (int i = 0; i < instructions_.size(); ++i) {
+    const BytecodeInstruction& instruction = instructions_[i];
+    absl::StrAppend(&str, i, ": ", OpcodeName(instruction.opcode));
+    switch (instruction.opcode) {
+      case BytecodeOpcode::kLoadInt64:
+      case BytecodeOpcode::kLoadDouble:
+      case BytecodeOpcode::kLoadBool:
+        absl::StrAppend(&str, " r", instruction.dst, ", params[",
+                        instruction.a, "][", instruction.b, "]");
+        break;
+      case BytecodeOpcode::kJump:
+        absl::StrAppend(&str, " @", instruction.a);
+        break;
+      case BytecodeOpcode::kJumpIfNotTrue:
+        absl::StrAppend(&str, " r", instruction.src1, ", @", instruction.a);
+        break;
+      default:
+        absl::StrAppend(&str, " r", instruction.dst, ", r", instruction.src1);
+        if (instruction.src2 >= 0) {
+          absl::StrAppend(&str, ", r", instruction.src2);
+        }
+        break;
+    }
+    absl::StrAppend(&str, "\n");
+  }
+  absl::StrAppend(&str, "result: r", result_reg_);
+  return str;
+}
+
+}  // namespace zetasql
@@ -0,0 +1,192 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_REFERENCE_IMPL_BYTECODE_H_
+#define ZETASQL_REFERENCE_IMPL_BYTECODE_H_
+
+// Register-based bytecode for small ValueExpr trees.
+//
+// A ValueExpr tree built from DerefExpr, ConstExpr, IfExpr, RootExpr and
+// ScalarFunctionCallExpr nodes over INT64, DOUBLE and BOOL values can be
+// lowered into a flat sequence of instructions that operate on unboxed,
+// typed registers. This avoids a virtual call, a VirtualTupleSlot and a Value
+// construction per node and per row.
+//
+// The bytecode never reports errors. Any condition that would produce an error
+// in the tree interpreter (e.g., overflow or division by zero), as well as any
+// unexpected runtime type, makes BytecodeProgram::Eval() return false. The
+// caller is then expected to evaluate the original ValueExpr tree, which
+// produces the exact result or error (including SAFE error mode handling).
+//
+// Example usage:
+//   ZETASQL_RETURN_IF_ERROR(expr->SetSchemasForEvaluation(params_schemas));
+//   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<BytecodeProgram> program,
+//                    BytecodeProgram::Compile(expr));
+//   ...
+//   Value result;
+//   if (program == nullptr || !program->Eval(params, &result)) {
+//     // Fall back to expr->EvalSimple(params, context, ...).
+//   }
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include "absl/types/span.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+class TupleData;
+class ValueExpr;
+
+// A typed register. Only the member matching the kind of the register (as
+// returned by BytecodeBuilder::register_kind()) is meaningful.
+struct BytecodeRegister {
+  union {
+    int64_t int64_value = 0;
+    double double_value;
+    bool bool_value;
+  };
+  bool is_null = false;
+};
+
+enum class BytecodeOpcode {
+  // Loads slot 'b' of params['a'] into register 'dst'.
+  kLoadInt64,
+  kLoadDouble,
+  kLoadBool,
+  // dst := src1
+  kMove,
+  // dst := src1 <op> src2 with SQL NULL semantics.
+  kAddInt64,
+  kSubtractInt64,
+  kMultiplyInt64,
+  kAddDouble,
+  kSubtractDouble,
+  kMultiplyDouble,
+  kDivideDouble,
+  kEqualInt64,
+  kLessInt64,
+  kLessOrEqualInt64,
+  kEqualDouble,
+  kLessDouble,
+  kLessOrEqualDouble,
+  kEqualBool,
+  kLessBool,
+  kLessOrEqualBool,
+  // Three-valued logic on BOOL registers.
+  kAnd,
+  kOr,
+  kNot,
+  // dst := src1 IS NULL
+  kIsNull,
+  // Continues at instruction 'a' unless register 'src1' is TRUE.
+  kJumpIfNotTrue,
+  // Continues at instruction 'a'.
+  kJump,
+};
+
+struct BytecodeInstruction {
+  BytecodeOpcode opcode;
+  int dst = -1;
+  int src1 = -1;
+  int src2 = -1;
+  // Operands for loads and jumps.
+  int a = -1;
+  int b = -1;
+};
+
+// Used by ValueExpr::AppendBytecode() implementations to lower a tree.
+class BytecodeBuilder {
+ public:
+  BytecodeBuilder() {}
+  BytecodeBuilder(const BytecodeBuilder&) = delete;
+  BytecodeBuilder& operator=(const BytecodeBuilder&) = delete;
+
+  // Returns true if values of 'type' can live in a register.
+  static bool IsSupportedType(const Type* type);
+
+  // Allocates a new register for values of 'kind'. Requires that 'kind' is a
+  // supported type kind.
+  int AllocateRegister(TypeKind kind);
+
+  // Allocates a register that holds 'value' for every evaluation. Returns -1 if
+  // the type of 'value' is not supported.
+  int AddConstant(const Value& value);
+
+  TypeKind register_kind(int reg) const { return register_kinds_[reg]; }
+
+  // Appends an instruction and returns its index.
+  int Emit(BytecodeOpcode opcode, int dst, int src1 = -1, int src2 = -1);
+
+  // Appends a load of 'slot' in params['idx_in_params'] into a new register of
+  // 'kind' and returns that register.
+  int EmitLoad(TypeKind kind, int idx_in_params, int slot);
+
+  // Appends a jump with an unresolved target and returns its index. The target
+  // must be set with BindJumpToNextInstruction().
+  int EmitJump(BytecodeOpcode opcode, int src = -1);
+
+  // Makes the jump at 'instruction' continue at the next appended instruction.
+  void BindJumpToNextInstruction(int instruction);
+
+ private:
+  friend class BytecodeProgram;
+
+  std::vector<BytecodeInstruction> instructions_;
+  std::vector<TypeKind> register_kinds_;
+  std::vector<BytecodeRegister> initial_registers_;
+};
+
+// A compiled ValueExpr. Thread-safe.
+class BytecodeProgram {
+ public:
+  BytecodeProgram(const BytecodeProgram&) = delete;
+  BytecodeProgram& operator=(const BytecodeProgram&) = delete;
+
+  // Compiles 'expr', which must have had SetSchemasForEvaluation() called on
+  // it. Returns nullptr if 'expr' contains a node that cannot be lowered.
+  // 'expr' must outlive the returned program.
+  static zetasql_base::StatusOr<std::unique_ptr<BytecodeProgram>> Compile(
+      const ValueExpr* expr);
+
+  // Evaluates the program on 'params' and returns true on success. Returns
+  // false, leaving 'result' unspecified, if the original ValueExpr must be
+  // evaluated instead.
+  bool Eval(absl::Span<const TupleData* const> params, Value* result) const;
+
+  int num_instructions() const { return instructions_.size(); }
+
+  std::string DebugString() const;
+
+ private:
+  BytecodeProgram(BytecodeBuilder* builder, int result_reg,
+                  const Type* output_type);
+
+  const std::vector<BytecodeInstruction> instructions_;
+  const std::vector<TypeKind> register_kinds_;
+  const std::vector<BytecodeRegister> initial_registers_;
+  const int result_reg_;
+  const Type* output_type_;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_BYTECODE_H_
@@ -16,6 +16,7 @@
 
 #include "zetasql/reference_impl/evaluation.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -44,6 +45,18 @@ ABSL_FLAG(
 
 namespace zetasql {
 
+namespace {
+// The size of the blocks allocated by EvaluationContext::value_arena().
+constexpr size_t kValueArenaBlockSize = 64 * 1024;
+// EvaluationContext::regexp_cache() holds at most this fraction of
+// EvaluationOptions::max_intermediate_byte_size.
+constexpr int64_t kRegexpCacheMemoryFraction = 16;
+// EvaluationContext::value_arena_for_streaming() returns nullptr once the
+// arena holds more than this fraction of
+// EvaluationOptions::max_intermediate_byte_size.
+constexpr int64_t kStreamingValueArenaMemoryFraction = 8;
+}  // namespace
+
 absl::Status ValidateFirstColumnPrimaryKey(
     const std::string& table_name, const Value& array,
     const LanguageOptions& language_options) {
@@ -82,9 +95,53 @@ absl::Status ValidateFirstColumnPrimaryKey(
 
 EvaluationContext::EvaluationContext(const EvaluationOptions& options)
     : options_(options),
-      memory_accountant_(options.max_intermediate_byte_size),
+      value_arena_(options.use_value_arena
+                       ? absl::make_unique<zetasql_base::UnsafeArena>(
+                             kValueArenaBlockSize)
+                       : nullptr),
+      memory_accountant_(std::make_shared<MemoryAccountant>(
+          options.max_intermediate_byte_size)),
+      regexp_cache_(options.max_regexp_cache_entries,
+                    options.max_intermediate_byte_size /
+                        kRegexpCacheMemoryFraction,
+                    memory_accountant_.get()),
       deterministic_output_(true) {}
 
+EvaluationContext::~EvaluationContext() {
+  for (const auto& entry : cached_data_) {
+    memory_accountant_->ReturnBytes(entry.second.byte_size);
+  }
+  memory_accountant_->ReturnBytes(value_arena_bytes_);
+}
+
+bool EvaluationContext::AccountForValueArena(absl::Status* status) {
+  if (value_arena_ == nullptr) return true;
+  const int64_t arena_bytes =
+      value_arena_->status().bytes_allocated() - value_arena_->block_size();
+  if (arena_bytes <= value_arena_bytes_) return true;
+  if (!memory_accountant_->RequestBytes(arena_bytes - value_arena_bytes_,
+                                        status)) {
+    return false;
+  }
+  value_arena_bytes_ = arena_bytes;
+  return true;
+}
+
+zetasql_base::UnsafeArena* EvaluationContext::value_arena_for_streaming() {
+  if (value_arena_bytes_ > options_.max_intermediate_byte_size /
+                               kStreamingValueArenaMemoryFraction) {
+    return nullptr;
+  }
+  return value_arena_.get();
+}
+
+void EvaluationContext::ResetValueArena() {
+  if (value_arena_ == nullptr) return;
+  value_arena_->Reset();
+  memory_accountant_->ReturnBytes(value_arena_bytes_);
+  value_arena_bytes_ = 0;
+}
+
 absl::Status EvaluationContext::AddTableAsArray(
     const std::string& table_name, bool is_value_table, Value array,
     const LanguageOptions& language_options) {
@@ -108,6 +165,9 @@ absl::Status EvaluationContext::VerifyNotAborted() const {
   if (cancelled_) {
     return zetasql_base::CancelledErrorBuilder() << "The statement has been cancelled";
   }
+  if (parent_ != nullptr) {
+    ZETASQL_RETURN_IF_ERROR(parent_->VerifyNotAborted());
+  }
   if (clock_->TimeNow() > statement_eval_deadline_) {
     return zetasql_base::ResourceExhaustedErrorBuilder()
            << "The statement has been aborted because the statement deadline ("
@@ -117,6 +177,70 @@ absl::Status EvaluationContext::VerifyNotAborted() const {
   return absl::OkStatus();
 }
 
+void EvaluationContext::ClearCachedData() {
+  for (const auto& entry : cached_data_) {
+    memory_accountant_->ReturnBytes(entry.second.byte_size);
+  }
+  cached_data_.clear();
+}
+
+void EvaluationContext::Reset() {
+  DCHECK(parent_ == nullptr);
+  DCHECK(active_profile_scope_ == nullptr);
+  ClearCachedData();
+  regexp_cache_.Clear();
+  parallel_ops_.clear();
+  relational_op_profiles_.clear();
+  tables_.clear();
+  deterministic_output_ = true;
+  ClearDeadlineAndCancellationState();
+  current_timestamp_.reset();
+  num_proto_deserializations_ = 0;
+  last_get_field_value_call_read_fields_from_proto_map_.clear();
+  used_top_n_accumulator_ = false;
+  used_partitioned_hash_join_ = false;
+  ResetValueArena();
+}
+
+std::unique_ptr<EvaluationContext> EvaluationContext::MakeChildContext(
+    int64_t max_intermediate_byte_size) {
+  // Initialize the current timestamp here so that all the children agree on
+  // it.
+  LazilyInitializeCurrentTimestamp();
+
+  // Children evaluate on other threads, which do not install the arena.
+  EvaluationOptions child_options = options_;
+  child_options.use_value_arena = false;
+  child_options.max_intermediate_byte_size = max_intermediate_byte_size;
+  auto child = absl::make_unique<EvaluationContext>(child_options);
+  child->parent_ = this;
+  child->tables_ = tables_;
+  child->language_options_ = language_options_;
+  child->statement_eval_deadline_ = statement_eval_deadline_;
+  child->clock_ = clock_;
+  child->default_timezone_ = default_timezone_;
+  child->current_timestamp_ = current_timestamp_;
+  child->current_date_in_default_timezone_ = current_date_in_default_timezone_;
+  child->current_datetime_in_default_timezone_ =
+      current_datetime_in_default_timezone_;
+  child->current_time_in_default_timezone_ = current_time_in_default_timezone_;
+  child->populate_last_get_field_value_call_read_fields_from_proto_map_ =
+      populate_last_get_field_value_call_read_fields_from_proto_map_;
+  return child;
+}
+
+void EvaluationContext::MergeChildContext(const EvaluationContext& child) {
+  if (!child.IsDeterministicOutput()) {
+    SetNonDeterministicOutput();
+  }
+  num_proto_deserializations_ += child.num_proto_deserializations_;
+  used_top_n_accumulator_ |= child.used_top_n_accumulator_;
+  used_partitioned_hash_join_ |= child.used_partitioned_hash_join_;
+  for (const auto& entry : child.relational_op_profiles_) {
+    relational_op_profiles_[entry.first].MergeFrom(entry.second);
+  }
+}
+
 void EvaluationContext::InitializeDefaultTimeZone() {
   absl::TimeZone timezone;
   CHECK(absl::LoadTimeZone("America/Los_Angeles", &timezone));
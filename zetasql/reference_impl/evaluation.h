@@ -17,8 +17,11 @@
 #ifndef ZETASQL_REFERENCE_IMPL_EVALUATION_H_
 #define ZETASQL_REFERENCE_IMPL_EVALUATION_H_
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -26,14 +29,20 @@
 #include "zetasql/public/civil_time.h"
 #include "zetasql/public/language_options.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/regexp_cache.h"
 #include "zetasql/reference_impl/tuple.h"
 #include "zetasql/resolved_ast/resolved_ast.h"
 #include <cstdint>
+#include "absl/base/thread_annotations.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/container/node_hash_map.h"
 #include "absl/flags/declare.h"
 #include "absl/random/random.h"
+#include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "zetasql/base/arena.h"
 #include "zetasql/base/map_util.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/clock.h"
@@ -75,7 +84,8 @@ struct EvaluationOptions {
   bool always_use_stable_sort = false;
 
   // If true, the reference implementation will store proto field values in
-  // TupleSlots (to avoid extra deserialization).
+  // TupleSlots (to avoid extra deserialization), along with an index of where
+  // each field of the proto occurs in its wire format.
   bool store_proto_field_value_maps = false;
 
   // If true, the reference implementation will use the TopNAccumulator instead
@@ -94,6 +104,35 @@ struct EvaluationOptions {
   // limit results in an error.
   int64_t max_intermediate_byte_size = 128 * 1024 * 1024;
 
+  // The maximum number of regexps compiled for non-constant LIKE and REGEXP_*
+  // patterns that are kept for reuse by later rows. The memory used by the
+  // cached regexps counts against 'max_intermediate_byte_size', and is capped
+  // at a small fraction of it so that the cache does not take the memory
+  // needed by sorts and hash tables.
+  int max_regexp_cache_entries = 64;
+
+  // If true, every iterator created by RelationalOp::CreateIterator() records
+  // its work in the RelationalOpProfile for its operator (see
+  // EvaluationContext::GetRelationalOpProfile()). This adds a clock read to
+  // every row, so it is only intended for diagnosing slow queries.
+  bool profile_relational_ops = false;
+
+  // The maximum number of threads used to evaluate a single relation. If
+  // greater than 1, the inputs of a UNION ALL are evaluated concurrently, each
+  // with its own child EvaluationContext (see
+  // EvaluationContext::MakeChildContext()) and an equal share of the memory
+  // that is left for the statement. The inputs are still returned one after
+  // another, so the output order is the same as with sequential evaluation.
+  int max_parallelism = 1;
+
+  // If true, EvaluationContext::value_arena() returns an arena that the caller
+  // can install with an internal::ValueArenaScope while it evaluates, so that
+  // the intermediate STRING, BYTES, NUMERIC, BIGNUMERIC, ARRAY and STRUCT
+  // Values are not allocated from the heap one by one. The arena is released
+  // by Reset() and by the destructor. The caller must copy out the Values it
+  // returns with InternalValue::CopyOutOfArena().
+  bool use_value_arena = false;
+
   // If true, the results of DML statements will include all rows in the
   // modified table; otherwise, only modified rows (i.e. those matching the
   // WHERE clause) are included. For DELETE, 'modified rows' means the rows to
@@ -101,11 +140,57 @@ struct EvaluationOptions {
   //
   // Note that rows are considered modified even if the new row happens to be
   // the same as the old as long as they match the WHERE clause.
+  //
+  // When false, the rows of the table are streamed rather than copied, so the
+  // time and memory used by a DML statement beyond the table scan is
+  // proportional to the number of modified rows. In that mode, an INSERT only
+  // detects duplicate primary keys in the original table for the keys it
+  // inserts.
   bool return_all_rows_for_dml = true;
 };
 
 class ProtoFieldReader;
 
+// The work done by the iterators of a RelationalOp during an evaluation. Only
+// collected if EvaluationOptions::profile_relational_ops is true.
+struct RelationalOpProfile {
+  // The number of iterators created for the operator (e.g., once per outer row
+  // for a correlated subquery).
+  int64_t num_iterators = 0;
+  // The number of rows returned by those iterators.
+  int64_t num_rows = 0;
+  // The time spent creating the iterators and calling Next() on them,
+  // including ('inclusive_time') or excluding ('exclusive_time') the time spent
+  // in the iterators of other operators.
+  absl::Duration inclusive_time;
+  absl::Duration exclusive_time;
+  // The bytes requested from the MemoryAccountant of the EvaluationContext,
+  // net of the bytes returned, while creating the iterators and calling Next()
+  // on them, excluding the bytes charged to the iterators of other operators.
+  // This approximates the memory held by the operator itself, e.g., the rows
+  // buffered by a SortOp. 'peak_memory_bytes' is the largest value it had when
+  // one of those calls returned.
+  int64_t memory_bytes = 0;
+  int64_t peak_memory_bytes = 0;
+
+  // Adds the work recorded by 'other'.
+  void MergeFrom(const RelationalOpProfile& other) {
+    num_iterators += other.num_iterators;
+    num_rows += other.num_rows;
+    inclusive_time += other.inclusive_time;
+    exclusive_time += other.exclusive_time;
+    memory_bytes += other.memory_bytes;
+    peak_memory_bytes = std::max(peak_memory_bytes, other.peak_memory_bytes);
+  }
+};
+
+// Data that an algebra node computes at most once per evaluation, such as the
+// result of an uncorrelated subquery. See EvaluationContext::AddCachedData().
+class EvaluationCacheEntry {
+ public:
+  virtual ~EvaluationCacheEntry() {}
+};
+
 // Contains state about the evaluation in progress.
 class EvaluationContext {
  public:
@@ -117,10 +202,113 @@ class EvaluationContext {
   explicit EvaluationContext(const EvaluationOptions& options);
   EvaluationContext(const EvaluationContext&) = delete;
   EvaluationContext& operator=(const EvaluationContext&) = delete;
+  ~EvaluationContext();
 
   const EvaluationOptions& options() const { return options_; }
 
-  MemoryAccountant* memory_accountant() { return &memory_accountant_; }
+  MemoryAccountant* memory_accountant() { return memory_accountant_.get(); }
+
+  // Returns memory_accountant() for objects that may outlive this context and
+  // return bytes to it when they are destroyed (e.g., the
+  // ProtoFieldOffsetIndexes in TupleSlot::SharedProtoState).
+  const std::shared_ptr<MemoryAccountant>& shared_memory_accountant() {
+    return memory_accountant_;
+  }
+
+  // Caches the regexps compiled for non-constant LIKE and REGEXP_* patterns.
+  RegexpCache* regexp_cache() { return &regexp_cache_; }
+
+  // Returns the arena for the Values created during evaluation, or nullptr if
+  // EvaluationOptions::use_value_arena is false.
+  zetasql_base::UnsafeArena* value_arena() { return value_arena_.get(); }
+
+  // Requests the bytes of the blocks that value_arena() allocated after its
+  // first block since the last call from memory_accountant(). Values are
+  // allocated from the arena where errors cannot be returned, so the callers
+  // that install the arena call this after each row they evaluate. Returns
+  // false and sets 'status' if the arena exceeds the remaining memory.
+  bool AccountForValueArena(absl::Status* status);
+
+  // Returns value_arena(), or nullptr once the arena has grown past a fraction
+  // of EvaluationOptions::max_intermediate_byte_size. For callers that cannot
+  // call ResetValueArena() between rows, like query iterators, whose
+  // operators may keep the Values of earlier rows: they allocate the Values
+  // of the later rows from the heap instead, so that streaming a large
+  // table does not run out of memory. value_arena() is still non-NULL, so
+  // the Values that reach the caller must still be copied out of the arena.
+  zetasql_base::UnsafeArena* value_arena_for_streaming();
+
+  // Releases value_arena() and returns its bytes to memory_accountant(). No
+  // Value allocated from the arena may be alive.
+  void ResetValueArena();
+
+  // Returns true if the Values allocated from value_arena() are only used by
+  // the thread that evaluates with this context, so that they can use
+  // non-atomic reference counts. That is not the case if relations may be
+  // evaluated in parallel, because the other threads copy the Values of the
+  // outer rows.
+  bool value_arena_is_thread_confined() const {
+    return options_.max_parallelism <= 1;
+  }
+
+  // Returns the entry passed to AddCachedData() for 'node', or nullptr.
+  const EvaluationCacheEntry* GetCachedData(const void* node) const {
+    const CachedData* cached_data = zetasql_base::FindOrNull(cached_data_, node);
+    return cached_data == nullptr ? nullptr : cached_data->entry.get();
+  }
+
+  // Keeps 'entry' for 'node' until this object is destroyed. 'byte_size' must
+  // have been requested from memory_accountant(); it is returned when this
+  // object is destroyed. 'node' must not have an entry yet.
+  void AddCachedData(const void* node,
+                     std::unique_ptr<EvaluationCacheEntry> entry,
+                     int64_t byte_size) {
+    CachedData& cached_data = cached_data_[node];
+    DCHECK(cached_data.entry == nullptr);
+    cached_data.entry = std::move(entry);
+    cached_data.byte_size = byte_size;
+  }
+
+  // Removes the entries added by AddCachedData() and returns their memory to
+  // memory_accountant(). Called between evaluations that share this context
+  // but may have different values for the expression columns.
+  void ClearCachedData();
+
+  // Returns true the first time it is called for 'op' (usually a RelationalOp)
+  // during this evaluation. Operators that evaluate their inputs on other
+  // threads call this to start threads at most once per evaluation, rather
+  // than once per outer row when they are in a correlated subquery.
+  bool ClaimParallelExecution(const void* op) {
+    return parallel_ops_.insert(op).second;
+  }
+
+  // Returns the profile of the RelationalOp 'op', or nullptr if none of its
+  // iterators was created with this context.
+  const RelationalOpProfile* GetRelationalOpProfile(const void* op) const {
+    return zetasql_base::FindOrNull(relational_op_profiles_, op);
+  }
+
+  // Returns the profile of the RelationalOp 'op', adding it if necessary. The
+  // returned pointer is valid for the lifetime of this object.
+  RelationalOpProfile* GetMutableRelationalOpProfile(const void* op) {
+    return &relational_op_profiles_[op];
+  }
+
+  // The innermost operator whose iterator is doing work on behalf of this
+  // context, used to compute RelationalOpProfile::exclusive_time. Maintained
+  // by RelationalOp::CreateIterator() and the iterators it returns.
+  struct ActiveProfileScope {
+    // The time spent in nested scopes so far.
+    absl::Duration nested_time;
+    // The change in the bytes in use during nested scopes so far.
+    int64_t nested_memory_bytes = 0;
+  };
+  ActiveProfileScope* active_profile_scope() const {
+    return active_profile_scope_;
+  }
+  void set_active_profile_scope(ActiveProfileScope* scope) {
+    active_profile_scope_ = scope;
+  }
 
   // Returns the contents of table 'table_name' or Value::Invalid().
   Value GetTableAsArray(const std::string& table_name) {
@@ -237,12 +425,12 @@ class EvaluationContext {
     return statement_eval_deadline_;
   }
 
-  // Register a callback to be notified when CancelStatement() is called. As
-  // with all non-const methods in this thread compatible class, using this
-  // method in a multithreaded setting requires external synchronization of
-  // this object. In practice, this is called by iterators that need to
-  // propagate the cancellation request to user code.
+  // Register a callback to be notified when CancelStatement() is called. In
+  // practice, this is called by iterators that need to propagate the
+  // cancellation request to user code. May be called concurrently with
+  // CancelStatement().
   void RegisterCancelCallback(const CancelCallback& cb) {
+    absl::MutexLock l(&cancel_mutex_);
     cancel_cbs_.push_back(cb);
   }
 
@@ -252,11 +440,23 @@ class EvaluationContext {
   // and cancelling if they discover the statement has been cancelled. The
   // callbacks are just a way of notifying user code that the statement has been
   // cancelled if we are stuck in a user's EvaluatorTableIterator.
+  //
+  // Unlike the other non-const methods, this may be called from another thread
+  // while the statement is being evaluated, which is how long-running
+  // operators (e.g., sorts, joins and aggregations) are interrupted.
+  //
+  // The callbacks are invoked without holding the lock that protects them, so
+  // they may call RegisterCancelCallback().
   absl::Status CancelStatement() {
     cancelled_ = true;
+    std::vector<CancelCallback> cancel_cbs;
+    {
+      absl::MutexLock l(&cancel_mutex_);
+      cancel_cbs = cancel_cbs_;
+    }
     // Call all the callbacks, returning the first non-OK error code.
     absl::Status ret = absl::OkStatus();
-    for (const CancelCallback& cb : cancel_cbs_) {
+    for (const CancelCallback& cb : cancel_cbs) {
       absl::Status status = cb();
       if (ret.ok() && !status.ok()) {
         ret = status;
@@ -270,13 +470,45 @@ class EvaluationContext {
   void ClearDeadlineAndCancellationState() {
     SetStatementEvaluationDeadline(absl::InfiniteFuture());
     cancelled_ = false;
+    absl::MutexLock l(&cancel_mutex_);
     cancel_cbs_.clear();
   }
 
-  // Returns an error if the statement has been aborted. This function is
-  // expensive (it gets the current time).
+  // Prepares this object for evaluating another statement with the same
+  // options, language options, clock and default time zone. Clears the state
+  // of the previous evaluation (cached data, regexps, tables, profiles, the
+  // current timestamp, the deterministic output flag, the deadline and the
+  // cancellation state) and returns its memory to memory_accountant(). The
+  // random number generator and the loaded time zone are kept, which makes
+  // this cheaper than creating a new EvaluationContext. Must not be called on
+  // a context returned by MakeChildContext() or while it has children.
+  //
+  // Also calls ResetValueArena(), so no Value allocated from value_arena() may
+  // be alive.
+  void Reset();
+
+  // Returns an error if the statement (or the statement of the parent context)
+  // has been aborted. This function is expensive (it gets the current time).
+  // Unlike the other methods, this may be called concurrently with
+  // CancelStatement().
   absl::Status VerifyNotAborted() const;
 
+  // Returns a context for evaluating part of the current statement on another
+  // thread. The child shares the options, tables, language options, clock,
+  // deadline and current timestamp of this context, but has its own caches and
+  // a memory accountant that allows 'max_intermediate_byte_size' bytes. The
+  // caller should request those bytes from memory_accountant() for the
+  // lifetime of the child, so that the memory limit of the statement holds.
+  // The child is aborted whenever this context is. This object must outlive
+  // the child, and must not be modified while the child is in use except by
+  // CancelStatement().
+  std::unique_ptr<EvaluationContext> MakeChildContext(
+      int64_t max_intermediate_byte_size);
+
+  // Propagates the state that a child returned by MakeChildContext() recorded
+  // about its evaluation (e.g., non-deterministic output) to this object.
+  void MergeChildContext(const EvaluationContext& child);
+
   int num_proto_deserializations() const { return num_proto_deserializations_; }
 
   void set_num_proto_deserializations(int n) {
@@ -289,6 +521,14 @@ class EvaluationContext {
     used_top_n_accumulator_ = value;
   }
 
+  bool used_partitioned_hash_join() const {
+    return used_partitioned_hash_join_;
+  }
+
+  void set_used_partitioned_hash_join(bool value) {
+    used_partitioned_hash_join_ = value;
+  }
+
   bool populate_last_get_field_value_call_read_fields_from_proto_map() const {
     return populate_last_get_field_value_call_read_fields_from_proto_map_;
   }
@@ -330,7 +570,29 @@ class EvaluationContext {
   void InitializeCurrentTimestamp();
 
   const EvaluationOptions options_;
-  MemoryAccountant memory_accountant_;
+  // Declared before every member that may hold Values allocated from it, so
+  // that it is destroyed after them.
+  const std::unique_ptr<zetasql_base::UnsafeArena> value_arena_;
+  // Shared with the objects that hold on to bytes after this context is
+  // destroyed (see shared_memory_accountant()).
+  const std::shared_ptr<MemoryAccountant> memory_accountant_;
+  // The bytes of 'value_arena_' requested by AccountForValueArena().
+  int64_t value_arena_bytes_ = 0;
+  // Must be destroyed before 'memory_accountant_'.
+  RegexpCache regexp_cache_;
+
+  struct CachedData {
+    std::unique_ptr<EvaluationCacheEntry> entry;
+    // The number of bytes to return to 'memory_accountant_'.
+    int64_t byte_size = 0;
+  };
+  // Added by AddCachedData().
+  absl::flat_hash_map<const void*, CachedData> cached_data_;
+  // Added by ClaimParallelExecution().
+  absl::flat_hash_set<const void*> parallel_ops_;
+  // Keyed by RelationalOp. node_hash_map for pointer stability.
+  absl::node_hash_map<const void*, RelationalOpProfile> relational_op_profiles_;
+  ActiveProfileScope* active_profile_scope_ = nullptr;
   // Tables added by AddTableAsArray().
   std::map<std::string, Value> tables_;
   // Indicates that the result of evaluation is non-deterministic.
@@ -338,8 +600,13 @@ class EvaluationContext {
   LanguageOptions language_options_;
   // Default is no deadline.
   absl::Time statement_eval_deadline_ = absl::InfiniteFuture();
-  bool cancelled_ = false;
-  std::vector<CancelCallback> cancel_cbs_;
+  // Atomic because children returned by MakeChildContext() read it from other
+  // threads.
+  std::atomic<bool> cancelled_{false};
+  // The context whose MakeChildContext() created this object, if any.
+  const EvaluationContext* parent_ = nullptr;
+  absl::Mutex cancel_mutex_;
+  std::vector<CancelCallback> cancel_cbs_ ABSL_GUARDED_BY(cancel_mutex_);
 
   // Used to obtain the current timestamp.
   zetasql_base::Clock* clock_ = zetasql_base::Clock::RealClock();
@@ -369,6 +636,10 @@ class EvaluationContext {
 
   // Records whether a TopNAccumulator was used. Only for unit tests.
   bool used_top_n_accumulator_ = false;
+
+  // Records whether a JoinOp used normalized join keys in a partitioned hash
+  // table. Only for unit tests.
+  bool used_partitioned_hash_join_ = false;
 };
 
 // Returns true if we should suppress 'error' (which must not be OK) in
@@ -64,6 +64,7 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/bytecode.h"
 #include "zetasql/reference_impl/common.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/proto_util.h"
@@ -717,19 +718,13 @@ struct ValueTraits<TYPE_BYTES> {
 // RE2 pattern is not known at Prepare time) or initialize the RE2 expression
 // and directly pass back the function.
 template <TypeKind type>
-static RegexpFunction::EvalFunction WrapOrInitRegexpFunction(
+static RegexpFunction::EvalFunction InitRegexpFunction(
     RegexpFunction::EvalFunction func, const ConstExpr* pattern,
     functions::RegExp* regexp, absl::Status* status) {
-  if (pattern && !pattern->value().is_null()) {
+  if (pattern != nullptr) {
     *status = ValueTraits<type>::InitializePattern(pattern->value(), regexp);
-    return func;
-  } else {
-    return [func](const absl::Span<const Value>& x,
-                  functions::RegExp* regexp) -> zetasql_base::StatusOr<Value> {
-      ZETASQL_RETURN_IF_ERROR(ValueTraits<type>::InitializePattern(x[1], regexp));
-      return func(x, regexp);
-    };
   }
+  return func;
 }
 
 // Helper function for regexp_contains.
@@ -920,7 +915,9 @@ ABSL_CONST_INIT absl::Mutex BuiltinFunctionRegistry::mu_(absl::kConstInit);
 /* static */ zetasql_base::StatusOr<BuiltinScalarFunction*>
 BuiltinFunctionRegistry::GetScalarFunction(FunctionKind kind,
                                            const Type* output_type) {
-  absl::MutexLock lock(&mu_);
+  // Functions are registered at startup and looked up by every algebrized
+  // query, so lookups only take a reader lock.
+  absl::ReaderMutexLock lock(&mu_);
   auto it = GetFunctionMap().find(kind);
   if (it != GetFunctionMap().end()) {
     return it->second(output_type);
@@ -1019,6 +1016,120 @@ std::string BuiltinScalarFunction::debug_name() const {
   return BuiltinFunctionCatalog::GetDebugNameByKind(kind());
 }
 
+bool BuiltinScalarFunction::AppendBytecode(absl::Span<const int> arg_regs,
+                                           BytecodeBuilder* builder,
+                                           int* result_reg) const {
+  if (arg_regs.empty() || !BytecodeBuilder::IsSupportedType(output_type())) {
+    return false;
+  }
+  const TypeKind arg_kind = builder->register_kind(arg_regs[0]);
+  for (int reg : arg_regs) {
+    if (builder->register_kind(reg) != arg_kind) return false;
+  }
+  const TypeKind output_kind = output_type()->kind();
+
+  switch (FCT(kind(), arg_kind)) {
+    case FCT(FunctionKind::kIsNull, TYPE_INT64):
+    case FCT(FunctionKind::kIsNull, TYPE_DOUBLE):
+    case FCT(FunctionKind::kIsNull, TYPE_BOOL):
+    case FCT(FunctionKind::kNot, TYPE_BOOL): {
+      if (arg_regs.size() != 1 || output_kind != TYPE_BOOL) return false;
+      *result_reg = builder->AllocateRegister(TYPE_BOOL);
+      builder->Emit(kind() == FunctionKind::kNot ? BytecodeOpcode::kNot
+                                                 : BytecodeOpcode::kIsNull,
+                    *result_reg, arg_regs[0]);
+      return true;
+    }
+    case FCT(FunctionKind::kAnd, TYPE_BOOL):
+    case FCT(FunctionKind::kOr, TYPE_BOOL): {
+      if (output_kind != TYPE_BOOL) return false;
+      // Three-valued AND and OR are associative, so an n-ary call becomes a
+      // chain of binary instructions.
+      const BytecodeOpcode opcode = kind() == FunctionKind::kAnd
+                                        ? BytecodeOpcode::kAnd
+                                        : BytecodeOpcode::kOr;
+      *result_reg = builder->AllocateRegister(TYPE_BOOL);
+      builder->Emit(BytecodeOpcode::kMove, *result_reg, arg_regs[0]);
+      for (int i = 1; i < arg_regs.size(); ++i) {
+        builder->Emit(opcode, *result_reg, *result_reg, arg_regs[i]);
+      }
+      return true;
+    }
+    default:
+      break;
+  }
+
+  if (arg_regs.size() != 2) return false;
+  BytecodeOpcode opcode;
+  // Arithmetic functions return their input type, comparisons return BOOL.
+  TypeKind result_kind = arg_kind;
+  switch (FCT(kind(), arg_kind)) {
+    case FCT(FunctionKind::kAdd, TYPE_INT64):
+      opcode = BytecodeOpcode::kAddInt64;
+      break;
+    case FCT(FunctionKind::kSubtract, TYPE_INT64):
+      opcode = BytecodeOpcode::kSubtractInt64;
+      break;
+    case FCT(FunctionKind::kMultiply, TYPE_INT64):
+      opcode = BytecodeOpcode::kMultiplyInt64;
+      break;
+    case FCT(FunctionKind::kAdd, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kAddDouble;
+      break;
+    case FCT(FunctionKind::kSubtract, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kSubtractDouble;
+      break;
+    case FCT(FunctionKind::kMultiply, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kMultiplyDouble;
+      break;
+    case FCT(FunctionKind::kDivide, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kDivideDouble;
+      break;
+    case FCT(FunctionKind::kEqual, TYPE_INT64):
+      opcode = BytecodeOpcode::kEqualInt64;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kLess, TYPE_INT64):
+      opcode = BytecodeOpcode::kLessInt64;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kLessOrEqual, TYPE_INT64):
+      opcode = BytecodeOpcode::kLessOrEqualInt64;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kEqual, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kEqualDouble;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kLess, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kLessDouble;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kLessOrEqual, TYPE_DOUBLE):
+      opcode = BytecodeOpcode::kLessOrEqualDouble;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kEqual, TYPE_BOOL):
+      opcode = BytecodeOpcode::kEqualBool;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kLess, TYPE_BOOL):
+      opcode = BytecodeOpcode::kLessBool;
+      result_kind = TYPE_BOOL;
+      break;
+    case FCT(FunctionKind::kLessOrEqual, TYPE_BOOL):
+      opcode = BytecodeOpcode::kLessOrEqualBool;
+      result_kind = TYPE_BOOL;
+      break;
+    default:
+      return false;
+  }
+  if (output_kind != result_kind) return false;
+  *result_reg = builder->AllocateRegister(result_kind);
+  builder->Emit(opcode, *result_reg, arg_regs[0], arg_regs[1]);
+  return true;
+}
+
 static absl::Status ValidateInputTypesSupportEqualityComparison(
     FunctionKind kind, absl::Span<const Type* const> input_types) {
   for (auto type : input_types) {
@@ -1370,43 +1481,43 @@ static RegexpFunction::EvalFunction CreateEvalFunction(
     functions::RegExp* regexp, absl::Status* status) {
   switch (FCT(kind, input_kind)) {
     case FCT(FunctionKind::kRegexpContains, TYPE_STRING): {
-      return WrapOrInitRegexpFunction<TYPE_STRING>(&Contains<TYPE_STRING>,
+      return InitRegexpFunction<TYPE_STRING>(&Contains<TYPE_STRING>,
                                                    pattern, regexp, status);
     }
     case FCT(FunctionKind::kRegexpContains, TYPE_BYTES): {
-      return WrapOrInitRegexpFunction<TYPE_BYTES>(&Contains<TYPE_BYTES>,
+      return InitRegexpFunction<TYPE_BYTES>(&Contains<TYPE_BYTES>,
                                                   pattern, regexp, status);
     }
     case FCT(FunctionKind::kRegexpMatch, TYPE_STRING): {
-      return WrapOrInitRegexpFunction<TYPE_STRING>(&Match<TYPE_STRING>, pattern,
+      return InitRegexpFunction<TYPE_STRING>(&Match<TYPE_STRING>, pattern,
                                                    regexp, status);
     }
     case FCT(FunctionKind::kRegexpMatch, TYPE_BYTES): {
-      return WrapOrInitRegexpFunction<TYPE_BYTES>(&Match<TYPE_BYTES>, pattern,
+      return InitRegexpFunction<TYPE_BYTES>(&Match<TYPE_BYTES>, pattern,
                                                   regexp, status);
     }
     case FCT(FunctionKind::kRegexpExtract, TYPE_STRING): {
-      return WrapOrInitRegexpFunction<TYPE_STRING>(&Extract<TYPE_STRING>,
+      return InitRegexpFunction<TYPE_STRING>(&Extract<TYPE_STRING>,
                                                    pattern, regexp, status);
     }
     case FCT(FunctionKind::kRegexpExtract, TYPE_BYTES): {
-      return WrapOrInitRegexpFunction<TYPE_BYTES>(&Extract<TYPE_BYTES>, pattern,
+      return InitRegexpFunction<TYPE_BYTES>(&Extract<TYPE_BYTES>, pattern,
                                                   regexp, status);
     }
     case FCT(FunctionKind::kRegexpExtractAll, TYPE_STRING): {
-      return WrapOrInitRegexpFunction<TYPE_STRING>(&ExtractAll<TYPE_STRING>,
+      return InitRegexpFunction<TYPE_STRING>(&ExtractAll<TYPE_STRING>,
                                                    pattern, regexp, status);
     }
     case FCT(FunctionKind::kRegexpExtractAll, TYPE_BYTES): {
-      return WrapOrInitRegexpFunction<TYPE_BYTES>(&ExtractAll<TYPE_BYTES>,
+      return InitRegexpFunction<TYPE_BYTES>(&ExtractAll<TYPE_BYTES>,
                                                   pattern, regexp, status);
     }
     case FCT(FunctionKind::kRegexpReplace, TYPE_STRING): {
-      return WrapOrInitRegexpFunction<TYPE_STRING>(&Replace<TYPE_STRING>,
+      return InitRegexpFunction<TYPE_STRING>(&Replace<TYPE_STRING>,
                                                    pattern, regexp, status);
     }
     case FCT(FunctionKind::kRegexpReplace, TYPE_BYTES): {
-      return WrapOrInitRegexpFunction<TYPE_BYTES>(&Replace<TYPE_BYTES>, pattern,
+      return InitRegexpFunction<TYPE_BYTES>(&Replace<TYPE_BYTES>, pattern,
                                                   regexp, status);
     }
   }
@@ -1454,16 +1565,21 @@ BuiltinScalarFunction::CreateRegexpFunction(
   }
   auto regexp = absl::make_unique<functions::RegExp>();
   TypeKind input_kind = input_types[0]->kind();
-  // Pattern is either nullptr or constant expression.
-  const ConstExpr* pattern =
-      arguments[1]->IsConstant()
-          ? static_cast<const ConstExpr*>(arguments[1].get())
-          : nullptr;
+  // Pattern is either nullptr or a non-NULL constant expression.
+  const ConstExpr* pattern = nullptr;
+  if (arguments[1]->IsConstant()) {
+    pattern = static_cast<const ConstExpr*>(arguments[1].get());
+    if (pattern->value().is_null()) pattern = nullptr;
+  }
 
   absl::Status status;
   RegexpFunction::EvalFunction eval_func =
       CreateEvalFunction(kind, input_kind, pattern, regexp.get(), &status);
   ZETASQL_RETURN_IF_ERROR(status);
+  if (pattern == nullptr) {
+    // The regexp is compiled at evaluation time.
+    regexp.reset();
+  }
   return std::unique_ptr<BuiltinScalarFunction>(
       new RegexpFunction(std::move(regexp), eval_func, kind, output_type));
 }
@@ -1662,7 +1778,8 @@ zetasql_base::StatusOr<Value> GenerateArrayFunction::Eval(
       return ::zetasql_base::UnimplementedErrorBuilder()
              << "Unsupported argument type for generate_array.";
   }
-  Value array_value = Value::Array(output_type()->AsArray(), range_values);
+  Value array_value =
+      Value::UnsafeArray(output_type()->AsArray(), std::move(range_values));
   if (array_value.physical_byte_size() >
       context->options().max_value_byte_size) {
     return MakeMaxArrayValueByteSizeExceededError(
@@ -2090,20 +2207,18 @@ bool ArrayConcatFunction::Eval(absl::Span<const Value> args,
     }
     num_values += input_array.num_elements();
   }
-  std::vector<Value> values;
-  values.reserve(num_values);
+  Value::ArrayBuilder builder(output_type()->AsArray(), num_values);
   auto is_ordered = InternalValue::kPreservesOrder;
   for (const Value& input_array : args) {
     if (InternalValue::GetOrderKind(input_array) ==
         InternalValue::kIgnoresOrder) {
       is_ordered = InternalValue::kIgnoresOrder;
     }
-    for (int i = 0; i < input_array.num_elements(); ++i) {
-      values.push_back(input_array.element(i));
+    for (const Value& element : input_array.elements()) {
+      builder.Add(element);
     }
   }
-  *result = InternalValue::ArrayNotChecked(output_type()->AsArray(), is_ordered,
-                                           std::move(values));
+  *result = InternalValue::BuildArray(&builder, is_ordered);
   return true;
 }
 
@@ -2203,9 +2318,12 @@ zetasql_base::StatusOr<Value> ArrayReverseFunction::Eval(
 
   MaybeSetNonDeterministicArrayOutput(args[0], context);
 
-  std::vector<Value> elements = args[0].elements();
-  std::reverse(elements.begin(), elements.end());
-  return Value::Array(output_type()->AsArray(), elements);
+  const std::vector<Value>& elements = args[0].elements();
+  Value::ArrayBuilder builder(output_type()->AsArray(), elements.size());
+  for (auto it = elements.rbegin(); it != elements.rend(); ++it) {
+    builder.Add(*it);
+  }
+  return builder.Build();
 }
 
 bool IsFunction::Eval(absl::Span<const Value> args, EvaluationContext* context,
@@ -3439,14 +3557,14 @@ zetasql_base::StatusOr<Value> LikeFunction::Eval(absl::Span<const Value> args,
     // Regexp is precompiled
     return Value::Bool(RE2::FullMatch(text, *regexp_));
   } else {
-    // Regexp is not precompiled, compile it on the fly
+    // Regexp is not precompiled, reuse the one compiled for an earlier row or
+    // compile it on the fly.
     const std::string& pattern = args[1].type_kind() == TYPE_STRING
                                      ? args[1].string_value()
                                      : args[1].bytes_value();
-    std::unique_ptr<RE2> regexp;
-    ZETASQL_RETURN_IF_ERROR(functions::CreateLikeRegexp(
-        pattern, args[0].type_kind(),
-        &regexp));
+    ZETASQL_ASSIGN_OR_RETURN(
+        const RE2* regexp,
+        context->regexp_cache()->GetLikeRegexp(pattern, args[0].type_kind()));
     return Value::Bool(RE2::FullMatch(text, *regexp));
   }
 }
@@ -3977,7 +4095,12 @@ bool StringFunction::Eval(absl::Span<const Value> args,
 zetasql_base::StatusOr<Value> RegexpFunction::Eval(absl::Span<const Value> args,
                                            EvaluationContext* context) const {
   if (HasNulls(args)) return Value::Null(output_type());
-  return func_(args, regexp_.get());
+  if (regexp_ != nullptr) {
+    return func_(args, regexp_.get());
+  }
+  ZETASQL_ASSIGN_OR_RETURN(functions::RegExp * regexp,
+                   context->regexp_cache()->GetRegExp(args[1]));
+  return func_(args, regexp);
 }
 
 zetasql_base::StatusOr<Value> SplitFunction::Eval(absl::Span<const Value> args,
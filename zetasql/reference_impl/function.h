@@ -325,6 +325,11 @@ class BuiltinScalarFunction : public ScalarFunctionBody {
 
   std::string debug_name() const override;
 
+  // Supports arithmetic, comparison and logical functions over the register
+  // types in bytecode.h.
+  bool AppendBytecode(absl::Span<const int> arg_regs, BytecodeBuilder* builder,
+                      int* result_reg) const override;
+
   // Returns true if any of the input values is null.
   static bool HasNulls(absl::Span<const Value> args);
 
@@ -584,7 +589,8 @@ class LikeFunction : public SimpleBuiltinScalarFunction {
   LikeFunction& operator=(const LikeFunction&) = delete;
 
  private:
-  // Regexp precompiled at prepare time; null if cannot be precompiled.
+  // Regexp precompiled at prepare time; null if cannot be precompiled, in which
+  // case the regexp comes from EvaluationContext::regexp_cache().
   std::unique_ptr<RE2> regexp_;
 };
 
@@ -718,6 +724,8 @@ class RegexpFunction : public SimpleBuiltinScalarFunction {
                              EvaluationContext* context) const override;
 
  private:
+  // Regexp precompiled at prepare time; null if the pattern is not a constant,
+  // in which case the regexp comes from EvaluationContext::regexp_cache().
   std::unique_ptr<functions::RegExp> regexp_;
   EvalFunction func_;
 };
@@ -43,6 +43,7 @@
 #include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -81,6 +82,7 @@ class AggregateFunctionCallExpr;
 class AlgebraNode;
 class AnalyticFunctionBody;
 class AnalyticFunctionCallExpr;
+class BytecodeBuilder;
 class ExprArg;
 class KeyArg;
 class RelationalArg;
@@ -1100,6 +1102,15 @@ class ValueExpr : public AlgebraNode {
 
   virtual bool IsConstant() const { return false; }
 
+  // Appends instructions that compute this expression to 'builder' and sets
+  // 'result_reg' to the register that holds the result. Returns false if the
+  // expression cannot be compiled to bytecode, in which case it must be
+  // evaluated with Eval(). Requires that SetSchemasForEvaluation() has already
+  // been called. See bytecode.h.
+  virtual bool AppendBytecode(BytecodeBuilder* builder, int* result_reg) const {
+    return false;
+  }
+
  private:
   const Type* output_type_;
 };
@@ -1133,9 +1144,19 @@ class RelationalOp : public AlgebraNode {
   // wraps it in a PassThroughTupleIterator to allow for cancellation while it
   // is running. This method is only public for internal purposes. Users should
   // call Eval() instead.
-  virtual ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  //
+  // If EvaluationOptions::profile_relational_ops is true, records the work
+  // done by the returned iterator (and by this call) in the
+  // RelationalOpProfile for this operator in 'context'.
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
       absl::Span<const TupleData* const> params, int num_extra_slots,
-      EvaluationContext* context) const = 0;
+      EvaluationContext* context) const;
+
+  // Implements CreateIterator().
+  virtual ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
+  CreateIteratorInternal(absl::Span<const TupleData* const> params,
+                         int num_extra_slots,
+                         EvaluationContext* context) const = 0;
 
   // Returns a copy of the output schema of the TupleIterator corresponding to
   // this operator.
@@ -1147,6 +1168,9 @@ class RelationalOp : public AlgebraNode {
   // returns an approximation.
   virtual std::string IteratorDebugString() const = 0;
 
+  // Returns the name of the operator, which begins its debug string.
+  virtual std::string OpName() const = 0;
+
   const RelationalOp* AsRelationalOp() const override { return this; }
   RelationalOp* AsMutableRelationalOp() override { return this; }
 
@@ -1175,6 +1199,14 @@ class RelationalOp : public AlgebraNode {
   bool is_order_preserving_ = false;
 };
 
+// Returns a tree of the RelationalOps in 'root' (including those nested in
+// subquery expressions) annotated with their RelationalOpProfiles from
+// 'context', which must have been used to evaluate 'root' with
+// EvaluationOptions::profile_relational_ops set. Do not try to interpret this
+// string with code, as the format can change at any time.
+std::string RelationalOpProfileDebugString(const AlgebraNode& root,
+                                           const EvaluationContext& context);
+
 // -------------------------------------------------------
 // Relational operators
 // -------------------------------------------------------
@@ -1204,7 +1236,7 @@ class EvaluatorTableScanOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1213,6 +1245,7 @@ class EvaluatorTableScanOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "EvaluatorTableScanOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1252,7 +1285,7 @@ class LetOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1260,6 +1293,7 @@ class LetOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "LetOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1347,7 +1381,7 @@ class JoinOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1357,10 +1391,26 @@ class JoinOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "JoinOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
+  // Returns true if there are HashJoinEqualityExprs, and the type of each left
+  // expression is a simple type that supports equality and equals the type of
+  // the corresponding right expression.
+  bool CanUseMergeJoin() const;
+
+  // If 'use_merge_join' is true, the join algorithm is a sort-merge join
+  // instead of a hash join: the right-hand side is sorted on the
+  // HashJoinEqualityExprs, and each left tuple is merged into it. This is
+  // cheaper than a hash join when the left-hand side is already ordered on the
+  // join keys. The output is the same as for a hash join. Requires
+  // CanUseMergeJoin().
+  absl::Status set_use_merge_join(bool use_merge_join);
+
+  bool use_merge_join() const { return use_merge_join_; }
+
  private:
   enum ArgKind {
     kLeftOutput,
@@ -1403,6 +1453,11 @@ class JoinOp : public RelationalOp {
   absl::Span<ExprArg* const> mutable_right_outputs();
 
   const JoinKind join_kind_;
+  bool use_merge_join_ = false;
+  // Only populated if 'use_merge_join_' is true. Ascending keys used to build a
+  // TupleComparator over the values of the HashJoinEqualityExprs. The key
+  // expressions are never evaluated.
+  std::vector<std::unique_ptr<KeyArg>> merge_join_keys_;
 };
 
 // Partitions the input using 'keys' and returns tuples constructed from
@@ -1425,7 +1480,7 @@ class AggregateOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1434,6 +1489,7 @@ class AggregateOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "AggregateOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1483,7 +1539,7 @@ class AnalyticOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1492,6 +1548,7 @@ class AnalyticOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "AnalyticOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1550,7 +1607,7 @@ class SortOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1558,6 +1615,7 @@ class SortOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "SortOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1635,7 +1693,7 @@ class ArrayScanOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1645,6 +1703,7 @@ class ArrayScanOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "ArrayScanOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1687,7 +1746,7 @@ class UnionAllOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1696,6 +1755,7 @@ class UnionAllOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "UnionAllOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1733,7 +1793,7 @@ class ComputeOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1742,6 +1802,7 @@ class ComputeOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "ComputeOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1775,7 +1836,7 @@ class FilterOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1783,6 +1844,7 @@ class FilterOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "FilterOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1817,7 +1879,7 @@ class LimitOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1825,6 +1887,7 @@ class LimitOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "LimitOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1866,7 +1929,7 @@ class EnumerateOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
@@ -1874,6 +1937,7 @@ class EnumerateOp : public RelationalOp {
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "EnumerateOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -1936,6 +2000,9 @@ class DerefExpr : public ValueExpr {
             EvaluationContext* context, VirtualTupleSlot* result,
             absl::Status* status) const override;
 
+  bool AppendBytecode(BytecodeBuilder* builder,
+                      int* result_reg) const override;
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
@@ -2005,10 +2072,11 @@ class ProtoFieldReader {
   // 'proto_slot', which must have a proto Value. If the field values
   // (corresponding to 'registry_') have not been stored in the
   // ProtoFieldValueList in 'proto_slot', reads all of them. If
-  // EvaluationOptions::store_proto_field_value_maps is true, also stores
-  // them in 'proto_slot'. On failure, returns false and populates
-  // 'status'. (This method does not return ::zetasql_base::StatusOr<Value> for
-  // performance reasons.)
+  // EvaluationOptions::store_proto_field_value_maps is true, also stores them
+  // in 'proto_slot', and reads them using a ProtoFieldOffsetIndex if the proto
+  // was already read through another registry (see GetOffsetIndex()). On
+  // failure, returns false and populates 'status'. (This method does not return
+  // ::zetasql_base::StatusOr<Value> for performance reasons.)
   bool GetFieldValue(const TupleSlot& proto_slot, EvaluationContext* context,
                      Value* field_value, absl::Status* status) const;
 
@@ -2019,6 +2087,20 @@ class ProtoFieldReader {
   int registry_id() const { return registry_->id(); }
 
  private:
+  // Sets 'offset_index' to the ProtoFieldOffsetIndex of 'proto_value' in
+  // 'shared_state'. Builds the index, and charges it to the memory accountant
+  // of 'context', if the proto was already read through a registry other than
+  // the one of 'value_map_key'. Sets 'offset_index' to NULL if the proto should
+  // be read without an index: on its first read, which scans the proto only
+  // once anyway, or if there is no memory left for the index. On failure,
+  // returns false and populates 'status'.
+  static bool GetOffsetIndex(const Value& proto_value,
+                             const ProtoFieldValueMapKey& value_map_key,
+                             EvaluationContext* context,
+                             TupleSlot::SharedProtoState* shared_state,
+                             const ProtoFieldOffsetIndex** offset_index,
+                             absl::Status* status);
+
   const int id_;
   const ProtoFieldAccessInfo access_info_;
   const ProtoFieldRegistry* registry_;
@@ -2231,6 +2313,9 @@ class ConstExpr : public ValueExpr {
             EvaluationContext* context, VirtualTupleSlot* result,
             absl::Status* status) const override;
 
+  bool AppendBytecode(BytecodeBuilder* builder,
+                      int* result_reg) const override;
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
@@ -2310,6 +2395,82 @@ class ExistsExpr : public ValueExpr {
   RelationalOp* mutable_input();
 };
 
+// Evaluates 'value' at most once per EvaluationContext and returns the cached
+// result afterwards. Used for uncorrelated subqueries, whose value does not
+// change during an evaluation. If there is not enough memory to cache the
+// result, 'value' is evaluated again.
+class MemoizedExpr : public ValueExpr {
+ public:
+  MemoizedExpr(const MemoizedExpr&) = delete;
+  MemoizedExpr& operator=(const MemoizedExpr&) = delete;
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<MemoizedExpr>> Create(
+      std::unique_ptr<ValueExpr> value);
+
+  absl::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            absl::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kValue };
+
+  explicit MemoizedExpr(std::unique_ptr<ValueExpr> value);
+
+  const ValueExpr* value() const;
+  ValueExpr* mutable_value();
+};
+
+// Returns 'needle' IN (the values of 'haystack' over the rows of 'input'),
+// with the same semantics as OR_AGG(needle = haystack). The distinct values of
+// 'haystack' are collected into a hash set once per EvaluationContext, so
+// 'input' must be uncorrelated, and the type of 'needle' and 'haystack' must
+// satisfy SupportsType().
+class HashInExpr : public ValueExpr {
+ public:
+  HashInExpr(const HashInExpr&) = delete;
+  HashInExpr& operator=(const HashInExpr&) = delete;
+
+  // Returns true if Value equality for 'type' agrees with SQL equality, so
+  // that hash lookups give the same result as comparisons.
+  static bool SupportsType(const Type* type);
+
+  static ::zetasql_base::StatusOr<std::unique_ptr<HashInExpr>> Create(
+      std::unique_ptr<ValueExpr> needle, std::unique_ptr<ValueExpr> haystack,
+      std::unique_ptr<RelationalOp> input);
+
+  absl::Status SetSchemasForEvaluation(
+      absl::Span<const TupleSchema* const> params_schemas) override;
+
+  bool Eval(absl::Span<const TupleData* const> params,
+            EvaluationContext* context, VirtualTupleSlot* result,
+            absl::Status* status) const override;
+
+  std::string DebugInternal(const std::string& indent,
+                            bool verbose) const override;
+
+ private:
+  enum ArgKind { kNeedle, kHaystack, kInput };
+
+  HashInExpr(std::unique_ptr<ValueExpr> needle,
+             std::unique_ptr<ValueExpr> haystack,
+             std::unique_ptr<RelationalOp> input);
+
+  const ValueExpr* needle() const;
+  ValueExpr* mutable_needle();
+
+  const ValueExpr* haystack() const;
+  ValueExpr* mutable_haystack();
+
+  const RelationalOp* input() const;
+  RelationalOp* mutable_input();
+};
+
 // Defines an executable function.
 class FunctionBody {
  public:
@@ -2351,6 +2512,15 @@ class ScalarFunctionBody : public FunctionBody {
   // returning ::zetasql_base::StatusOr<Value> for performance reasons.
   virtual bool Eval(absl::Span<const Value> args, EvaluationContext* context,
                     Value* result, absl::Status* status) const = 0;
+
+  // Appends instructions that apply the function to the registers 'arg_regs'
+  // to 'builder' and sets 'result_reg' to the register that holds the result.
+  // Returns false if the call cannot be compiled to bytecode.
+  virtual bool AppendBytecode(absl::Span<const int> arg_regs,
+                              BytecodeBuilder* builder,
+                              int* result_reg) const {
+    return false;
+  }
 };
 
 // Accumulator interface for aggregating a bunch of values.
@@ -2439,6 +2609,9 @@ class ScalarFunctionCallExpr : public ValueExpr {
             EvaluationContext* context, VirtualTupleSlot* result,
             absl::Status* status) const override;
 
+  bool AppendBytecode(BytecodeBuilder* builder,
+                      int* result_reg) const override;
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
@@ -2619,6 +2792,9 @@ class IfExpr : public ValueExpr {
             EvaluationContext* context, VirtualTupleSlot* result,
             absl::Status* status) const override;
 
+  bool AppendBytecode(BytecodeBuilder* builder,
+                      int* result_reg) const override;
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
@@ -3329,19 +3505,25 @@ class DMLInsertValueExpr : public DMLValueExpr {
       absl::Span<const TupleData* const> params, EvaluationContext* context,
       std::vector<std::vector<Value>>* columns_to_insert) const;
 
-  // Populates 'original_rows' with the rows in the table before insertion. Each
-  // Value has type 'table_array_type_->element_type()'.
+  // Populates 'original_rows' with the rows in the table before insertion and
+  // sets 'num_original_rows' to the number of rows in the table. Each Value has
+  // type 'table_array_type_->element_type()'. If 'keys_to_keep' is non-NULL,
+  // only the rows whose primary keys are in 'keys_to_keep' are returned.
   absl::Status PopulateRowsInOriginalTable(
       absl::Span<const TupleData* const> params, EvaluationContext* context,
-      std::vector<std::vector<Value>>* original_rows) const;
+      const std::unordered_set<Value, ValueHasher>* keys_to_keep,
+      std::vector<std::vector<Value>>* original_rows,
+      int64_t* num_original_rows) const;
 
   // Adds the rows in 'rows_to_insert' to 'row_map' and returns the number of
   // rows modified. Handles all the various insert modes and possibly generates
-  // an error if there is a primary key collision.
+  // an error if there is a primary key collision. New rows are numbered after
+  // the 'num_original_rows' rows in the table.
   ::zetasql_base::StatusOr<int64_t> InsertRows(
       const InsertColumnMap& insert_column_map,
       const std::vector<std::vector<Value>>& rows_to_insert,
-      EvaluationContext* context, PrimaryKeyRowMap* row_map) const;
+      int64_t num_original_rows, EvaluationContext* context,
+      PrimaryKeyRowMap* row_map) const;
 
   // Returns the DML output value corresponding to the arguments.
   ::zetasql_base::StatusOr<Value> GetDMLOutputValue(int64_t num_rows_modified,
@@ -3372,13 +3554,14 @@ class RootOp : public RelationalOp {
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override;
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> params, int num_extra_slots,
       EvaluationContext* context) const override;
 
   std::unique_ptr<TupleSchema> CreateOutputSchema() const override;
 
   std::string IteratorDebugString() const override;
+  std::string OpName() const override { return "RootOp"; }
 
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
@@ -3414,6 +3597,9 @@ class RootExpr : public ValueExpr {
             EvaluationContext* context, VirtualTupleSlot* result,
             absl::Status* status) const override;
 
+  bool AppendBytecode(BytecodeBuilder* builder,
+                      int* result_reg) const override;
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override;
 
@@ -0,0 +1,147 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "zetasql/reference_impl/regexp_cache.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/functions/like.h"
+#include "zetasql/reference_impl/tuple.h"
+#include "absl/memory/memory.h"
+#include "zetasql/base/ret_check.h"
+#include "zetasql/base/status.h"
+#include "zetasql/base/status_macros.h"
+
+namespace zetasql {
+
+// Rough number of bytes used by a compiled RE2 per unit of
+// RE2::ProgramSize(). This does not cover the DFA state caches, which RE2
+// bounds separately.
+static constexpr int64_t kBytesPerProgramUnit = 32;
+
+// Returns an estimate of the number of bytes used by 'regexp' for 'pattern'.
+static int64_t EstimateRegexpBytes(absl::string_view pattern,
+                                   const RE2& regexp) {
+  return sizeof(RE2) + 2 * pattern.size() +
+         kBytesPerProgramUnit * std::max(regexp.ProgramSize(), 0);
+}
+
+RegexpCache::RegexpCache(int max_entries, int64_t max_bytes,
+                         MemoryAccountant* accountant)
+    : max_entries_(std::max(max_entries, 1)),
+      max_bytes_(max_bytes),
+      accountant_(accountant) {}
+
+RegexpCache::~RegexpCache() { Clear(); }
+
+void RegexpCache::Clear() {
+  while (!entries_.empty()) {
+    EvictOne();
+  }
+}
+
+zetasql_base::StatusOr<const RE2*> RegexpCache::GetLikeRegexp(
+    absl::string_view pattern, TypeKind type_kind) {
+  ZETASQL_RET_CHECK(type_kind == TYPE_STRING || type_kind == TYPE_BYTES);
+  const Kind kind =
+      type_kind == TYPE_STRING ? Kind::kLikeString : Kind::kLikeBytes;
+  if (Entry* entry = Lookup(KeyView(kind, pattern))) {
+    return entry->like_regexp.get();
+  }
+
+  Entry entry;
+  ZETASQL_RETURN_IF_ERROR(
+      functions::CreateLikeRegexp(pattern, type_kind, &entry.like_regexp));
+  entry.num_bytes = sizeof(Entry) + pattern.size() +
+                    EstimateRegexpBytes(pattern, *entry.like_regexp);
+  entry.kind = kind;
+  entry.pattern = std::string(pattern);
+  ZETASQL_ASSIGN_OR_RETURN(Entry * cached, Insert(std::move(entry)));
+  return cached->like_regexp.get();
+}
+
+zetasql_base::StatusOr<functions::RegExp*> RegexpCache::GetRegExp(
+    const Value& pattern) {
+  ZETASQL_RET_CHECK(!pattern.is_null());
+  ZETASQL_RET_CHECK(pattern.type_kind() == TYPE_STRING ||
+            pattern.type_kind() == TYPE_BYTES);
+  const bool is_utf8 = pattern.type_kind() == TYPE_STRING;
+  const std::string& pattern_string =
+      is_utf8 ? pattern.string_value() : pattern.bytes_value();
+  const Kind kind = is_utf8 ? Kind::kRegexpUtf8 : Kind::kRegexpBytes;
+  if (Entry* entry = Lookup(KeyView(kind, pattern_string))) {
+    return entry->regexp.get();
+  }
+
+  Entry entry;
+  entry.regexp = absl::make_unique<functions::RegExp>();
+  absl::Status status;
+  const bool initialized =
+      is_utf8 ? entry.regexp->InitializePatternUtf8(pattern_string, &status)
+              : entry.regexp->InitializePatternBytes(pattern_string, &status);
+  if (!initialized) {
+    return status;
+  }
+  entry.num_bytes = sizeof(Entry) + sizeof(functions::RegExp) +
+                    pattern_string.size() +
+                    EstimateRegexpBytes(pattern_string, entry.regexp->re());
+  entry.kind = kind;
+  entry.pattern = pattern_string;
+  ZETASQL_ASSIGN_OR_RETURN(Entry * cached, Insert(std::move(entry)));
+  return cached->regexp.get();
+}
+
+RegexpCache::Entry* RegexpCache::Lookup(const KeyView& key) {
+  const auto it = entry_by_key_.find(key);
+  if (it == entry_by_key_.end()) {
+    ++num_misses_;
+    return nullptr;
+  }
+  ++num_hits_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return &entries_.front();
+}
+
+zetasql_base::StatusOr<RegexpCache::Entry*> RegexpCache::Insert(Entry entry) {
+  absl::Status status;
+  while (!accountant_->RequestBytes(entry.num_bytes, &status)) {
+    if (entries_.empty()) {
+      return status;
+    }
+    EvictOne();
+  }
+  num_bytes_ += entry.num_bytes;
+  entries_.push_front(std::move(entry));
+  const Entry& front = entries_.front();
+  entry_by_key_[KeyView(front.kind, front.pattern)] = entries_.begin();
+  while (num_entries() > 1 &&
+         (num_entries() > max_entries_ || num_bytes_ > max_bytes_)) {
+    EvictOne();
+  }
+  return &entries_.front();
+}
+
+void RegexpCache::EvictOne() {
+  const Entry& entry = entries_.back();
+  accountant_->ReturnBytes(entry.num_bytes);
+  num_bytes_ -= entry.num_bytes;
+  entry_by_key_.erase(KeyView(entry.kind, entry.pattern));
+  entries_.pop_back();
+}
+
+}  // namespace zetasql
@@ -0,0 +1,123 @@
+//
+// Copyright 2019 ZetaSQL Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef ZETASQL_REFERENCE_IMPL_REGEXP_CACHE_H_
+#define ZETASQL_REFERENCE_IMPL_REGEXP_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "zetasql/public/functions/regexp.h"
+#include "zetasql/public/type.h"
+#include "zetasql/public/value.h"
+#include <cstdint>
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "re2/re2.h"
+#include "zetasql/base/statusor.h"
+
+namespace zetasql {
+
+class MemoryAccountant;
+
+// A bounded LRU cache of the regexps compiled for LIKE and REGEXP_* patterns
+// that are not constant at prepare time (e.g., patterns that come from a column
+// or a parameter). Without the cache, the pattern is compiled for every row
+// even if it takes only a few distinct values.
+//
+// The memory used by the cached regexps is tracked by a MemoryAccountant. The
+// least recently used regexps are evicted when the cache holds more than
+// 'max_entries' regexps or 'max_bytes' bytes, or when the accountant runs out
+// of memory. 'max_bytes' should be well below the limit of the accountant, so
+// that the cache does not take the memory needed by sorts and hash tables.
+//
+// A pointer returned by GetLikeRegexp() or GetRegExp() is only valid until the
+// next call to either method. Not thread-safe.
+class RegexpCache {
+ public:
+  // 'accountant' must outlive this object. The most recently used regexp is
+  // always retained (even if 'max_entries' or 'max_bytes' is 0) so that the
+  // pointer returned for it stays valid.
+  RegexpCache(int max_entries, int64_t max_bytes,
+              MemoryAccountant* accountant);
+  RegexpCache(const RegexpCache&) = delete;
+  RegexpCache& operator=(const RegexpCache&) = delete;
+  ~RegexpCache();
+
+  // Returns the regexp created by functions::CreateLikeRegexp() for 'pattern'
+  // and 'type_kind' (TYPE_STRING or TYPE_BYTES).
+  zetasql_base::StatusOr<const RE2*> GetLikeRegexp(absl::string_view pattern,
+                                           TypeKind type_kind);
+
+  // Returns a functions::RegExp initialized with 'pattern', which must be a
+  // non-NULL STRING or BYTES value.
+  zetasql_base::StatusOr<functions::RegExp*> GetRegExp(const Value& pattern);
+
+  // Drops all the cached regexps. Does not reset the counters.
+  void Clear();
+
+  int num_entries() const { return static_cast<int>(entries_.size()); }
+  int64_t num_bytes() const { return num_bytes_; }
+  int64_t num_hits() const { return num_hits_; }
+  int64_t num_misses() const { return num_misses_; }
+
+ private:
+  enum class Kind { kLikeString, kLikeBytes, kRegexpUtf8, kRegexpBytes };
+  // Refers to the pattern of an Entry, or to the pattern being looked up, so
+  // that lookups do not copy the pattern.
+  using KeyView = std::pair<Kind, absl::string_view>;
+
+  struct Entry {
+    Kind kind;
+    std::string pattern;
+    // Exactly one of these is non-NULL depending on 'kind'.
+    std::unique_ptr<RE2> like_regexp;
+    std::unique_ptr<functions::RegExp> regexp;
+    // The number of bytes requested from the MemoryAccountant.
+    int64_t num_bytes = 0;
+  };
+
+  // Returns the entry for 'key' and moves it to the front of 'entries_', or
+  // returns nullptr.
+  Entry* Lookup(const KeyView& key);
+
+  // Accounts for 'entry', adds it to the front of 'entries_', and evicts
+  // entries as necessary. Returns the cached entry.
+  zetasql_base::StatusOr<Entry*> Insert(Entry entry);
+
+  // Removes the least recently used entry.
+  void EvictOne();
+
+  const int max_entries_;
+  const int64_t max_bytes_;
+  MemoryAccountant* accountant_;
+
+  // Most recently used first. The nodes of the list do not move, so the keys
+  // of 'entry_by_key_' can refer to their patterns.
+  std::list<Entry> entries_;
+  absl::flat_hash_map<KeyView, std::list<Entry>::iterator> entry_by_key_;
+  // The sum of the 'num_bytes' of 'entries_'.
+  int64_t num_bytes_ = 0;
+
+  int64_t num_hits_ = 0;
+  int64_t num_misses_ = 0;
+};
+
+}  // namespace zetasql
+
+#endif  // ZETASQL_REFERENCE_IMPL_REGEXP_CACHE_H_
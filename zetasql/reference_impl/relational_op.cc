@@ -18,9 +18,12 @@
 // warrant their own files.
 
 #include <algorithm>
+#include <cmath>
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -46,6 +49,9 @@
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "zetasql/base/source_location.h"
@@ -103,6 +109,157 @@ absl::Status RelationalOp::set_is_order_preserving(bool is_order_preserving) {
   return iter;
 }
 
+namespace {
+// Charges the time from construction to destruction to 'profile', excluding
+// the time charged to nested scopes from the exclusive time. Likewise charges
+// the change in the bytes in use by the MemoryAccountant, excluding the change
+// charged to nested scopes.
+class RelationalOpProfileScope {
+ public:
+  RelationalOpProfileScope(RelationalOpProfile* profile,
+                           EvaluationContext* context)
+      : profile_(profile),
+        context_(context),
+        parent_(context->active_profile_scope()),
+        start_(absl::Now()),
+        start_bytes_in_use_(BytesInUse()) {
+    context_->set_active_profile_scope(&scope_);
+  }
+
+  RelationalOpProfileScope(const RelationalOpProfileScope&) = delete;
+  RelationalOpProfileScope& operator=(const RelationalOpProfileScope&) = delete;
+
+  ~RelationalOpProfileScope() {
+    const absl::Duration elapsed = absl::Now() - start_;
+    profile_->inclusive_time += elapsed;
+    profile_->exclusive_time += elapsed - scope_.nested_time;
+    if (parent_ != nullptr) {
+      parent_->nested_time += elapsed;
+    }
+    context_->set_active_profile_scope(parent_);
+
+    const int64_t memory_delta = BytesInUse() - start_bytes_in_use_;
+    profile_->memory_bytes += memory_delta - scope_.nested_memory_bytes;
+    profile_->peak_memory_bytes =
+        std::max(profile_->peak_memory_bytes, profile_->memory_bytes);
+    if (parent_ != nullptr) {
+      parent_->nested_memory_bytes += memory_delta;
+    }
+  }
+
+ private:
+  int64_t BytesInUse() const {
+    return context_->options().max_intermediate_byte_size -
+           context_->memory_accountant()->remaining_bytes();
+  }
+
+  RelationalOpProfile* profile_;
+  EvaluationContext* context_;
+  EvaluationContext::ActiveProfileScope* parent_;
+  EvaluationContext::ActiveProfileScope scope_;
+  const absl::Time start_;
+  const int64_t start_bytes_in_use_;
+};
+
+// Wraps the iterator of a RelationalOp to record its work in 'profile'.
+class ProfilingTupleIterator : public TupleIterator {
+ public:
+  ProfilingTupleIterator(std::unique_ptr<TupleIterator> iter,
+                         RelationalOpProfile* profile,
+                         EvaluationContext* context)
+      : iter_(std::move(iter)), profile_(profile), context_(context) {}
+
+  ProfilingTupleIterator(const ProfilingTupleIterator&) = delete;
+  ProfilingTupleIterator& operator=(const ProfilingTupleIterator&) = delete;
+
+  const TupleSchema& Schema() const override { return iter_->Schema(); }
+
+  TupleData* Next() override {
+    RelationalOpProfileScope scope(profile_, context_);
+    TupleData* next = iter_->Next();
+    if (next != nullptr) {
+      ++profile_->num_rows;
+    }
+    return next;
+  }
+
+  absl::Status Status() const override { return iter_->Status(); }
+
+  bool PreservesOrder() const override { return iter_->PreservesOrder(); }
+
+  absl::Status DisableReordering() override {
+    return iter_->DisableReordering();
+  }
+
+  // Profiling does not change the debug strings of the iterators.
+  std::string DebugString() const override { return iter_->DebugString(); }
+
+ private:
+  std::unique_ptr<TupleIterator> iter_;
+  RelationalOpProfile* profile_;
+  EvaluationContext* context_;
+};
+
+// Appends a line for each RelationalOp in the tree rooted at 'node' to 'lines'.
+// The RelationalOps are indented according to their nesting.
+void AppendRelationalOpProfileLines(const AlgebraNode& node,
+                                    const EvaluationContext& context,
+                                    int depth,
+                                    std::vector<std::string>* lines) {
+  const RelationalOp* op = node.AsRelationalOp();
+  if (op != nullptr) {
+    std::string line =
+        absl::StrCat(std::string(2 * depth, ' '), op->OpName(), ": ");
+    const RelationalOpProfile* profile = context.GetRelationalOpProfile(op);
+    if (profile == nullptr) {
+      absl::StrAppend(&line, "not evaluated");
+    } else {
+      absl::StrAppend(
+          &line, "iterators=", profile->num_iterators,
+          " rows=", profile->num_rows,
+          " time=", absl::FormatDuration(profile->inclusive_time),
+          " self_time=", absl::FormatDuration(profile->exclusive_time),
+          " peak_memory_bytes=", profile->peak_memory_bytes);
+    }
+    lines->push_back(line);
+    ++depth;
+  }
+  for (const AlgebraArg* arg : node.GetArgs()) {
+    if (arg != nullptr && arg->has_node()) {
+      AppendRelationalOpProfileLines(*arg->node(), context, depth, lines);
+    }
+  }
+}
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RelationalOp::CreateIterator(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
+  if (!context->options().profile_relational_ops) {
+    return CreateIteratorInternal(params, num_extra_slots, context);
+  }
+
+  RelationalOpProfile* profile = context->GetMutableRelationalOpProfile(this);
+  ++profile->num_iterators;
+  std::unique_ptr<TupleIterator> iter;
+  {
+    // Some operators (e.g., AggregateOp) consume their inputs here.
+    RelationalOpProfileScope scope(profile, context);
+    ZETASQL_ASSIGN_OR_RETURN(iter, CreateIteratorInternal(params, num_extra_slots,
+                                                  context));
+  }
+  iter = absl::make_unique<ProfilingTupleIterator>(std::move(iter), profile,
+                                                   context);
+  return iter;
+}
+
+std::string RelationalOpProfileDebugString(const AlgebraNode& root,
+                                           const EvaluationContext& context) {
+  std::vector<std::string> lines;
+  AppendRelationalOpProfileLines(root, context, /*depth=*/0, &lines);
+  return absl::StrJoin(lines, "\n");
+}
+
 ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RelationalOp::MaybeReorder(
     std::unique_ptr<TupleIterator> iter, EvaluationContext* context) const {
   if (context->options().scramble_undefined_orderings) {
@@ -494,9 +651,9 @@ class EvaluatorTableTupleIterator : public TupleIterator {
 }  // namespace
 
 ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>>
-EvaluatorTableScanOp::CreateIterator(absl::Span<const TupleData* const> params,
-                                     int num_extra_slots,
-                                     EvaluationContext* context) const {
+EvaluatorTableScanOp::CreateIteratorInternal(
+    absl::Span<const TupleData* const> params, int num_extra_slots,
+    EvaluationContext* context) const {
   absl::optional<absl::Time> read_time;
   if (read_time_ != nullptr) {
     std::shared_ptr<TupleSlot::SharedProtoState> shared_state;
@@ -674,7 +831,7 @@ class LetOpTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LetOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LetOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   // Initialize 'all_params' with 'params', then extend 'all_params' with new
@@ -940,7 +1097,7 @@ class SortTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> SortOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> SortOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   Value limit_value;   // Invalid if no limit set.
@@ -1009,12 +1166,19 @@ class SortTupleIterator : public TupleIterator {
   // If 'limit_offset' is set, 'top_n_outputs' contains the top
   // 'limit_offset.limit + limit_offset.offset' rows. Otherwise, 'outputs'
   // contains all the rows.
-  auto top_n_outputs = absl::make_unique<TupleDataOrderedQueue>(
+  auto top_n_outputs = absl::make_unique<TupleDataTopN>(
+      limit_offset.has_value() ? limit_offset->limit + limit_offset->offset
+                               : 0,
       *comparator, context->memory_accountant());
   auto outputs =
       absl::make_unique<TupleDataDeque>(context->memory_accountant());
   absl::Status status;
-  while (true) {
+  const int64_t verify_not_aborted_period =
+      absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period);
+  for (int64_t num_inputs = 0;; ++num_inputs) {
+    if (num_inputs % verify_not_aborted_period == 0) {
+      ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+    }
     const TupleData* next_input = input_iter->Next();
     if (next_input == nullptr) {
       ZETASQL_RETURN_IF_ERROR(input_iter->Status());
@@ -1045,10 +1209,6 @@ class SortTupleIterator : public TupleIterator {
       if (!top_n_outputs->Insert(std::move(next_output), &status)) {
         return status;
       }
-      if (top_n_outputs->GetSize() >
-          limit_offset->limit + limit_offset->offset) {
-        top_n_outputs->PopBack();
-      }
     } else {
       if (!outputs->PushBack(std::move(next_output), &status)) {
         return status;
@@ -1061,12 +1221,10 @@ class SortTupleIterator : public TupleIterator {
   bool is_uniquely_ordered;
   if (limit_offset.has_value()) {
     ZETASQL_RET_CHECK(outputs->IsEmpty());
-    for (int i = 0; i < limit_offset->offset && !top_n_outputs->IsEmpty();
-         ++i) {
-      top_n_outputs->PopFront();
-    }
-    while (!top_n_outputs->IsEmpty()) {
-      if (!outputs->PushBack(top_n_outputs->PopFront(), &status)) {
+    std::vector<std::unique_ptr<TupleData>> top_n =
+        top_n_outputs->ExtractSorted();
+    for (int64_t i = limit_offset->offset; i < top_n.size(); ++i) {
+      if (!outputs->PushBack(std::move(top_n[i]), &status)) {
         return status;
       }
     }
@@ -1312,7 +1470,7 @@ class ComputeTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ComputeOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ComputeOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(
@@ -1447,7 +1605,7 @@ class FilterTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> FilterOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> FilterOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
@@ -1613,7 +1771,7 @@ class LimitTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LimitOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> LimitOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   TupleSlot count_slot;
@@ -1767,7 +1925,7 @@ class EnumerateTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> EnumerateOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> EnumerateOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   TupleSlot count_slot;
@@ -1863,6 +2021,35 @@ const std::string& JoinOp::JoinKindToString(JoinOp::JoinKind kind) {
       std::move(right_outputs)));
 }
 
+bool JoinOp::CanUseMergeJoin() const {
+  if (hash_join_equality_left_exprs().empty()) return false;
+  for (int i = 0; i < hash_join_equality_left_exprs().size(); ++i) {
+    const Type* left_type = hash_join_equality_left_exprs()[i]->type();
+    const Type* right_type = hash_join_equality_right_exprs()[i]->type();
+    if (!left_type->IsSimpleType() || !left_type->SupportsEquality() ||
+        !left_type->Equals(right_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+absl::Status JoinOp::set_use_merge_join(bool use_merge_join) {
+  merge_join_keys_.clear();
+  if (use_merge_join) {
+    ZETASQL_RET_CHECK(CanUseMergeJoin()) << "Join does not support merge join";
+    for (const ExprArg* right_expr : hash_join_equality_right_exprs()) {
+      ZETASQL_ASSIGN_OR_RETURN(
+          std::unique_ptr<DerefExpr> deref_expr,
+          DerefExpr::Create(right_expr->variable(), right_expr->type()));
+      merge_join_keys_.push_back(absl::make_unique<KeyArg>(
+          right_expr->variable(), std::move(deref_expr), KeyArg::kAscending));
+    }
+  }
+  use_merge_join_ = use_merge_join;
+  return absl::OkStatus();
+}
+
 absl::Status JoinOp::SetSchemasForEvaluation(
     absl::Span<const TupleSchema* const> params_schemas) {
   ZETASQL_RETURN_IF_ERROR(
@@ -2234,6 +2421,789 @@ class UncorrelatedHashedRightInput : public RightInputForJoin {
   EvaluationContext* context_;
 };
 
+// Target number of bytes in one partition of the build side of an
+// UncorrelatedPartitionedHashedRightInput. Chosen so that the open addressing
+// table, groups, and keys of a partition fit in a typical L2 cache.
+static constexpr int64_t kPartitionedHashJoinTargetBytes = 256 * 1024;
+
+// Upper bound on the number of radix bits used to partition the build side of
+// an UncorrelatedPartitionedHashedRightInput.
+static constexpr int kPartitionedHashJoinMaxRadixBits = 10;
+
+// The result of appending the normalized encoding of a value to a join key.
+enum class NormalizedJoinKeyResult {
+  kOk,
+  // The value is NULL, so the key cannot join with anything.
+  kNull,
+  // The type of the value has no normalized encoding.
+  kUnsupported
+};
+
+template <typename T>
+static void AppendFixedWidthJoinKeyPart(TypeKind kind, T value,
+                                        std::string* key) {
+  key->push_back(static_cast<char>(kind));
+  key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Appends a compact byte encoding of 'value' to 'key'. Two non-NULL values have
+// the same encoding if and only if they are equal according to
+// UncorrelatedHashedRightInput. In particular, non-negative INT64 values are
+// encoded as UINT64 values to support equalities of the form INT64 = UINT64.
+//
+// Floating point types are not supported because SQL equality does not match
+// bitwise equality for NaN and signed zeros. Compound types, protos, and the
+// remaining scalar types are not supported to keep the encoding simple.
+static NormalizedJoinKeyResult AppendNormalizedJoinKey(const Value& value,
+                                                       std::string* key) {
+  if (value.is_null()) return NormalizedJoinKeyResult::kNull;
+  switch (value.type_kind()) {
+    case TYPE_INT32:
+      AppendFixedWidthJoinKeyPart(TYPE_INT32, value.int32_value(), key);
+      break;
+    case TYPE_INT64: {
+      const int64_t int64_value = value.int64_value();
+      if (int64_value >= 0) {
+        AppendFixedWidthJoinKeyPart(TYPE_UINT64,
+                                    static_cast<uint64_t>(int64_value), key);
+      } else {
+        AppendFixedWidthJoinKeyPart(TYPE_INT64, int64_value, key);
+      }
+      break;
+    }
+    case TYPE_UINT32:
+      AppendFixedWidthJoinKeyPart(TYPE_UINT32, value.uint32_value(), key);
+      break;
+    case TYPE_UINT64:
+      AppendFixedWidthJoinKeyPart(TYPE_UINT64, value.uint64_value(), key);
+      break;
+    case TYPE_BOOL:
+      AppendFixedWidthJoinKeyPart(TYPE_BOOL, value.bool_value(), key);
+      break;
+    case TYPE_DATE:
+      AppendFixedWidthJoinKeyPart(TYPE_DATE, value.date_value(), key);
+      break;
+    case TYPE_STRING:
+    case TYPE_BYTES: {
+      const std::string& str = value.type_kind() == TYPE_STRING
+                                   ? value.string_value()
+                                   : value.bytes_value();
+      // The length prefix keeps multi-part keys unambiguous.
+      AppendFixedWidthJoinKeyPart(value.type_kind(),
+                                  static_cast<uint64_t>(str.size()), key);
+      key->append(str);
+      break;
+    }
+    default:
+      return NormalizedJoinKeyResult::kUnsupported;
+  }
+  return NormalizedJoinKeyResult::kOk;
+}
+
+// Returns true if values of type 'type' may have a normalized join key
+// encoding. Used to avoid materializing keys when a join can never use
+// UncorrelatedPartitionedHashedRightInput.
+static bool MaySupportNormalizedJoinKey(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_BOOL:
+    case TYPE_DATE:
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Represents the right-hand input side of a hash join whose equality keys all
+// have normalized encodings (see AppendNormalizedJoinKey()). This is faster
+// than UncorrelatedHashedRightInput, which hashes and compares TupleDatas of
+// boxed Values.
+//
+// The keys of each right tuple are encoded into a single byte string whose hash
+// is computed once. The right tuples are then radix-partitioned on the high
+// bits of their hashes such that each partition fits in L2, and each partition
+// gets its own open addressing table over flat arrays. Right tuples with equal
+// keys form a group whose tuples are stored contiguously in their original
+// order, so the join output is the same as with UncorrelatedHashedRightInput.
+// Each left tuple is encoded the same way, and probes only the partition
+// identified by its hash.
+class UncorrelatedPartitionedHashedRightInput : public RightInputForJoin {
+ public:
+  // Returns NULL if some right-hand side key does not have a normalized
+  // encoding, in which case the caller should fall back to
+  // UncorrelatedHashedRightInput. Otherwise takes ownership of '*right_tuples'
+  // and '*iter_for_debug_string'.
+  static zetasql_base::StatusOr<
+      std::unique_ptr<UncorrelatedPartitionedHashedRightInput>>
+  Create(absl::Span<const TupleData* const> params,
+         absl::Span<const ExprArg* const> left_equality_exprs,
+         absl::Span<const ExprArg* const> right_equality_exprs,
+         std::unique_ptr<TupleSchema> schema,
+         std::unique_ptr<TupleDataDeque>* right_tuples,
+         std::unique_ptr<TupleIterator>* iter_for_debug_string,
+         EvaluationContext* context) {
+    ZETASQL_RET_CHECK_EQ(left_equality_exprs.size(), right_equality_exprs.size());
+    for (const ExprArg* arg : right_equality_exprs) {
+      if (!MaySupportNormalizedJoinKey(arg->value_expr()->output_type())) {
+        return std::unique_ptr<UncorrelatedPartitionedHashedRightInput>();
+      }
+    }
+
+    std::vector<RightTupleAndJoinedBit> right_tuples_and_bits =
+        WrapWithJoinedBits((*right_tuples)->GetTuplePtrs());
+    std::string key_bytes;
+    std::vector<BuildEntry> entries;
+    bool supported = true;
+    int64_t num_accounted_bytes = 0;
+    const absl::Status status = EncodeBuildSide(
+        params, right_equality_exprs, right_tuples_and_bits, context,
+        &key_bytes, &entries, &supported, &num_accounted_bytes);
+    if (!status.ok() || !supported) {
+      context->memory_accountant()->ReturnBytes(num_accounted_bytes);
+      ZETASQL_RETURN_IF_ERROR(status);
+      return std::unique_ptr<UncorrelatedPartitionedHashedRightInput>();
+    }
+
+    // From here on, the destructor of 'input' returns the accounted bytes.
+    auto input = absl::WrapUnique(new UncorrelatedPartitionedHashedRightInput(
+        params, left_equality_exprs, std::move(schema),
+        std::move(*right_tuples), std::move(right_tuples_and_bits),
+        std::move(key_bytes), num_accounted_bytes,
+        std::move(*iter_for_debug_string), context));
+    ZETASQL_RETURN_IF_ERROR(input->Build(std::move(entries)));
+    return input;
+  }
+
+  UncorrelatedPartitionedHashedRightInput(
+      const UncorrelatedPartitionedHashedRightInput&) = delete;
+  UncorrelatedPartitionedHashedRightInput& operator=(
+      const UncorrelatedPartitionedHashedRightInput&) = delete;
+
+  ~UncorrelatedPartitionedHashedRightInput() override {
+    context_->memory_accountant()->ReturnBytes(num_accounted_bytes_);
+  }
+
+  bool IsCorrelated() const override { return false; }
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  absl::Status ResetForLeftInput(const Tuple* left_input) override {
+    if (left_input == nullptr) {
+      // Iterate over everything.
+      iterate_over_everything_ = true;
+      return absl::OkStatus();
+    }
+    iterate_over_everything_ = false;
+    match_begin_ = 0;
+    match_end_ = 0;
+
+    probe_key_.clear();
+    ZETASQL_ASSIGN_OR_RETURN(const NormalizedJoinKeyResult result,
+                     EncodeJoinKey(params_, *left_input->data,
+                                   left_equality_exprs_, context_, &probe_key_));
+    if (result != NormalizedJoinKeyResult::kOk) {
+      // Either the left key is NULL, or it has a type that does not appear on
+      // the right-hand side. Either way, there are no matches.
+      return absl::OkStatus();
+    }
+
+    const uint64_t hash = HashJoinKey(probe_key_);
+    const Partition& partition = partitions_[PartitionIndex(hash)];
+    for (uint64_t i = hash & partition.mask;; i = (i + 1) & partition.mask) {
+      const int64_t group_index = slots_[partition.slot_offset + i];
+      if (group_index < 0) break;
+      const Group& group = groups_[group_index];
+      if (group.hash == hash && GroupKey(group) == probe_key_) {
+        match_begin_ = group.begin;
+        match_end_ = group.end;
+        break;
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  int64_t GetNumMatchingTuples() const override {
+    if (iterate_over_everything_) return right_tuples_and_bits_.size();
+    return match_end_ - match_begin_;
+  }
+
+  const TupleData& GetMatchingTuple(int64_t index) const override {
+    return *GetTupleAndBit(index).tuple;
+  }
+
+  absl::Status RecordMatchingTupleJoined(int64_t index) override {
+    if (iterate_over_everything_) {
+      right_tuples_and_bits_[index].joined = true;
+    } else {
+      matches_[match_begin_ + index]->joined = true;
+    }
+    return absl::OkStatus();
+  }
+
+  zetasql_base::StatusOr<bool> DidMatchingTupleJoin(int64_t index) const override {
+    return GetTupleAndBit(index).joined;
+  }
+
+  std::string DebugString() const override {
+    return iter_for_debug_string_->DebugString();
+  }
+
+ private:
+  // A right tuple with a non-NULL key.
+  struct BuildEntry {
+    uint64_t hash;
+    int64_t key_offset;  // Into 'key_bytes_'.
+    int64_t key_size;
+    int64_t tuple_index;  // Into 'right_tuples_and_bits_'.
+  };
+
+  // The right tuples sharing a key. 'begin' and 'end' delimit the tuples in
+  // 'matches_'.
+  struct Group {
+    uint64_t hash;
+    int64_t key_offset;  // Into 'key_bytes_'.
+    int64_t key_size;
+    int64_t begin;
+    int64_t end;
+  };
+
+  // The open addressing table of a partition occupies
+  // slots_[slot_offset, slot_offset + mask].
+  struct Partition {
+    int64_t slot_offset = 0;
+    uint64_t mask = 0;
+  };
+
+  UncorrelatedPartitionedHashedRightInput(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> left_equality_exprs,
+      std::unique_ptr<TupleSchema> schema,
+      std::unique_ptr<TupleDataDeque> right_tuples,
+      // The TupleDatas in here are owned by 'right_tuples'.
+      std::vector<RightTupleAndJoinedBit> right_tuples_and_bits,
+      std::string key_bytes, int64_t num_accounted_bytes,
+      std::unique_ptr<TupleIterator> iter_for_debug_string,
+      EvaluationContext* context)
+      : params_(params.begin(), params.end()),
+        left_equality_exprs_(left_equality_exprs.begin(),
+                             left_equality_exprs.end()),
+        schema_(std::move(schema)),
+        right_tuples_(std::move(right_tuples)),
+        right_tuples_and_bits_(std::move(right_tuples_and_bits)),
+        key_bytes_(std::move(key_bytes)),
+        num_accounted_bytes_(num_accounted_bytes),
+        iter_for_debug_string_(std::move(iter_for_debug_string)),
+        context_(context) {}
+
+  // Encodes the keys of 'right_tuples_and_bits' into 'key_bytes' and
+  // 'entries'. Tuples with NULL keys never join, so they get no entry, but they
+  // still appear in 'right_tuples_and_bits' for outer joins. Sets 'supported'
+  // to false if some key has no normalized encoding. The bytes of 'key_bytes'
+  // and 'entries' are requested from the MemoryAccountant before they are
+  // allocated and added to 'num_accounted_bytes', which the caller must
+  // return, even on error.
+  static absl::Status EncodeBuildSide(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> right_equality_exprs,
+      const std::vector<RightTupleAndJoinedBit>& right_tuples_and_bits,
+      EvaluationContext* context, std::string* key_bytes,
+      std::vector<BuildEntry>* entries, bool* supported,
+      int64_t* num_accounted_bytes) {
+    MemoryAccountant* accountant = context->memory_accountant();
+    absl::Status status;
+    const int64_t entries_bytes =
+        right_tuples_and_bits.size() * sizeof(BuildEntry);
+    if (!accountant->RequestBytes(entries_bytes, &status)) return status;
+    *num_accounted_bytes += entries_bytes;
+    entries->reserve(right_tuples_and_bits.size());
+
+    std::string key;
+    for (int64_t i = 0; i < right_tuples_and_bits.size(); ++i) {
+      key.clear();
+      ZETASQL_ASSIGN_OR_RETURN(
+          const NormalizedJoinKeyResult result,
+          EncodeJoinKey(params, *right_tuples_and_bits[i].tuple,
+                        right_equality_exprs, context, &key));
+      if (result == NormalizedJoinKeyResult::kUnsupported) {
+        *supported = false;
+        return absl::OkStatus();
+      }
+      if (result == NormalizedJoinKeyResult::kNull) continue;
+
+      if (!accountant->RequestBytes(key.size(), &status)) return status;
+      *num_accounted_bytes += key.size();
+      BuildEntry entry;
+      entry.hash = HashJoinKey(key);
+      entry.key_offset = key_bytes->size();
+      entry.key_size = key.size();
+      entry.tuple_index = i;
+      entries->push_back(entry);
+      key_bytes->append(key);
+    }
+    return absl::OkStatus();
+  }
+
+  // Requests 'num_bytes' from the MemoryAccountant and adds them to
+  // 'num_accounted_bytes_'.
+  bool RequestBytes(int64_t num_bytes, absl::Status* status) {
+    if (!context_->memory_accountant()->RequestBytes(num_bytes, status)) {
+      return false;
+    }
+    num_accounted_bytes_ += num_bytes;
+    return true;
+  }
+
+  // Returns 'num_bytes' of 'num_accounted_bytes_' to the MemoryAccountant.
+  void ReturnBytes(int64_t num_bytes) {
+    context_->memory_accountant()->ReturnBytes(num_bytes);
+    num_accounted_bytes_ -= num_bytes;
+  }
+
+  // Encodes the values of 'args' for 'row' into 'key'.
+  static zetasql_base::StatusOr<NormalizedJoinKeyResult> EncodeJoinKey(
+      absl::Span<const TupleData* const> params, const TupleData& row,
+      absl::Span<const ExprArg* const> args, EvaluationContext* context,
+      std::string* key) {
+    const std::vector<const TupleData*> all_params =
+        ConcatSpans(params, {&row});
+    for (const ExprArg* arg : args) {
+      TupleSlot slot;
+      absl::Status status;
+      if (!arg->value_expr()->EvalSimple(all_params, context, &slot,
+                                         &status)) {
+        return status;
+      }
+      const NormalizedJoinKeyResult result =
+          AppendNormalizedJoinKey(slot.value(), key);
+      if (result != NormalizedJoinKeyResult::kOk) return result;
+    }
+    return NormalizedJoinKeyResult::kOk;
+  }
+
+  static uint64_t HashJoinKey(absl::string_view key) {
+    return absl::Hash<absl::string_view>()(key);
+  }
+
+  int64_t PartitionIndex(uint64_t hash) const {
+    return num_radix_bits_ == 0 ? 0 : hash >> (64 - num_radix_bits_);
+  }
+
+  absl::string_view GroupKey(const Group& group) const {
+    return absl::string_view(key_bytes_).substr(group.key_offset,
+                                                group.key_size);
+  }
+
+  const RightTupleAndJoinedBit& GetTupleAndBit(int64_t index) const {
+    if (iterate_over_everything_) return right_tuples_and_bits_[index];
+    return *matches_[match_begin_ + index];
+  }
+
+  // Partitions 'entries' and populates the open addressing tables, 'groups_',
+  // and 'matches_'. Each of them is requested from the MemoryAccountant before
+  // it is allocated. The bytes of 'entries', which were requested by
+  // EncodeBuildSide(), and of the temporary arrays are returned at the end.
+  absl::Status Build(std::vector<BuildEntry> entries) {
+    absl::Status status;
+    // Choose the number of partitions based on an estimate of the size of the
+    // build side.
+    const int64_t estimated_bytes =
+        key_bytes_.size() +
+        entries.size() * (sizeof(Group) + 2 * sizeof(int64_t) +
+                          sizeof(RightTupleAndJoinedBit*));
+    while (num_radix_bits_ < kPartitionedHashJoinMaxRadixBits &&
+           (estimated_bytes >> num_radix_bits_) >
+               kPartitionedHashJoinTargetBytes) {
+      ++num_radix_bits_;
+    }
+    const int64_t num_partitions = int64_t{1} << num_radix_bits_;
+    const int64_t temporary_bytes =
+        entries.size() * (sizeof(BuildEntry*) + sizeof(int64_t)) +
+        2 * (num_partitions + 1) * sizeof(int64_t);
+    if (!RequestBytes(temporary_bytes + num_partitions * sizeof(Partition),
+                      &status)) {
+      return status;
+    }
+
+    // Radix-partition the entries. This is a stable counting sort, so the
+    // entries in each partition remain in the order of the right tuples.
+    std::vector<int64_t> partition_begins(num_partitions + 1, 0);
+    for (const BuildEntry& entry : entries) {
+      ++partition_begins[PartitionIndex(entry.hash) + 1];
+    }
+    for (int64_t p = 0; p < num_partitions; ++p) {
+      partition_begins[p + 1] += partition_begins[p];
+    }
+    std::vector<const BuildEntry*> partitioned_entries(entries.size());
+    {
+      std::vector<int64_t> next_positions(partition_begins.begin(),
+                                          partition_begins.end() - 1);
+      for (const BuildEntry& entry : entries) {
+        partitioned_entries[next_positions[PartitionIndex(entry.hash)]++] =
+            &entry;
+      }
+    }
+
+    // Build each partition's open addressing table with linear probing, and
+    // count the number of tuples in each group.
+    partitions_.resize(num_partitions);
+    std::vector<int64_t> entry_groups(partitioned_entries.size());
+    for (int64_t p = 0; p < num_partitions; ++p) {
+      const int64_t begin = partition_begins[p];
+      const int64_t end = partition_begins[p + 1];
+      // Keep the load factor at or below 1/2.
+      uint64_t num_slots = 1;
+      while (num_slots < static_cast<uint64_t>(2 * (end - begin))) {
+        num_slots <<= 1;
+      }
+
+      if (!RequestBytes(num_slots * sizeof(int64_t), &status)) return status;
+      Partition& partition = partitions_[p];
+      partition.slot_offset = slots_.size();
+      partition.mask = num_slots - 1;
+      slots_.resize(slots_.size() + num_slots, -1);
+
+      for (int64_t e = begin; e < end; ++e) {
+        const BuildEntry& entry = *partitioned_entries[e];
+        const absl::string_view key = absl::string_view(key_bytes_).substr(
+            entry.key_offset, entry.key_size);
+        for (uint64_t i = entry.hash & partition.mask;;
+             i = (i + 1) & partition.mask) {
+          int64_t& group_index = slots_[partition.slot_offset + i];
+          if (group_index < 0) {
+            if (!RequestBytes(sizeof(Group), &status)) return status;
+            group_index = groups_.size();
+            Group group;
+            group.hash = entry.hash;
+            group.key_offset = entry.key_offset;
+            group.key_size = entry.key_size;
+            group.begin = 0;
+            group.end = 0;
+            groups_.push_back(group);
+          }
+          Group& group = groups_[group_index];
+          if (group.hash == entry.hash && GroupKey(group) == key) {
+            ++group.end;
+            entry_groups[e] = group_index;
+            break;
+          }
+        }
+      }
+    }
+
+    // Lay out the tuples of each group contiguously in 'matches_'.
+    int64_t num_matches = 0;
+    for (Group& group : groups_) {
+      const int64_t group_size = group.end;
+      group.begin = num_matches;
+      group.end = num_matches;
+      num_matches += group_size;
+    }
+    if (!RequestBytes(num_matches * sizeof(RightTupleAndJoinedBit*),
+                      &status)) {
+      return status;
+    }
+    matches_.resize(num_matches);
+    for (int64_t e = 0; e < partitioned_entries.size(); ++e) {
+      Group& group = groups_[entry_groups[e]];
+      matches_[group.end++] =
+          &right_tuples_and_bits_[partitioned_entries[e]->tuple_index];
+    }
+
+    // 'entries' and the temporary arrays are freed on return.
+    ReturnBytes(temporary_bytes +
+                right_tuples_and_bits_.size() * sizeof(BuildEntry));
+    context_->set_used_partitioned_hash_join(true);
+    return absl::OkStatus();
+  }
+
+  const std::vector<const TupleData*> params_;
+  const std::vector<const ExprArg*> left_equality_exprs_;
+  const std::unique_ptr<TupleSchema> schema_;
+
+  std::unique_ptr<TupleDataDeque> right_tuples_;
+  // The TupleDatas in here are owned by 'right_tuples_'.
+  std::vector<RightTupleAndJoinedBit> right_tuples_and_bits_;
+
+  // The concatenated encoded keys of the right tuples.
+  const std::string key_bytes_;
+  int num_radix_bits_ = 0;
+  std::vector<Partition> partitions_;
+  // The open addressing tables of all the partitions. Each slot is either an
+  // index into 'groups_' or -1 if the slot is empty.
+  std::vector<int64_t> slots_;
+  std::vector<Group> groups_;
+  // Points into 'right_tuples_and_bits_'.
+  std::vector<RightTupleAndJoinedBit*> matches_;
+  // The number of bytes requested from the MemoryAccountant for the above
+  // data structures.
+  int64_t num_accounted_bytes_ = 0;
+
+  // The encoded key of the left tuple in the last call to ResetForLeftInput().
+  // Reused across calls to avoid allocations.
+  std::string probe_key_;
+  // True if the left tuple in the last call to ResetForLeftInput() was NULL and
+  // therefore GetNumMatchingTuples()/etc. should iterate over everything.
+  // Otherwise, the matching tuples are matches_[match_begin_, match_end_).
+  bool iterate_over_everything_ = false;
+  int64_t match_begin_ = 0;
+  int64_t match_end_ = 0;
+
+  // We store a TupleIterator instead of the debug string to avoid computing the
+  // debug string unnecessarily.
+  const std::unique_ptr<TupleIterator> iter_for_debug_string_;
+
+  EvaluationContext* context_;
+};
+
+// Represents the right-hand input side of a sort-merge join. The right tuples
+// are sorted on the values of their equality expressions (unless they are
+// already sorted). Each left tuple finds its matches by advancing a cursor over
+// the sorted right tuples if its key is not less than the key of the previous
+// left tuple, and by binary search otherwise. Thus, if the left-hand side is
+// ordered on the join keys, the join is a single merge pass over both sides.
+//
+// Right tuples with equal keys keep their original relative order, so the join
+// output is the same as with UncorrelatedHashedRightInput.
+class UncorrelatedSortedRightInput : public RightInputForJoin {
+ public:
+  // 'keys' must be ascending and correspond to 'right_equality_exprs'.
+  static zetasql_base::StatusOr<std::unique_ptr<UncorrelatedSortedRightInput>> Create(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> left_equality_exprs,
+      absl::Span<const ExprArg* const> right_equality_exprs,
+      absl::Span<const KeyArg* const> keys, std::unique_ptr<TupleSchema> schema,
+      std::unique_ptr<TupleDataDeque> right_tuples,
+      std::unique_ptr<TupleIterator> iter_for_debug_string,
+      EvaluationContext* context) {
+    ZETASQL_RET_CHECK_EQ(left_equality_exprs.size(), right_equality_exprs.size());
+    ZETASQL_RET_CHECK_EQ(keys.size(), right_equality_exprs.size());
+
+    std::vector<int> slots_for_keys(keys.size());
+    for (int i = 0; i < keys.size(); ++i) {
+      slots_for_keys[i] = i;
+    }
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleComparator> comparator,
+        TupleComparator::Create(keys, slots_for_keys, params, context));
+
+    std::vector<RightTupleAndJoinedBit> right_tuples_and_bits =
+        WrapWithJoinedBits(right_tuples->GetTuplePtrs());
+
+    // Tuples whose keys can never join are omitted from 'entries', but they
+    // still appear in 'right_tuples_and_bits' for outer joins.
+    auto right_keys =
+        absl::make_unique<TupleDataDeque>(context->memory_accountant());
+    std::vector<SortedEntry> entries;
+    entries.reserve(right_tuples_and_bits.size());
+    for (RightTupleAndJoinedBit& tuple_and_bit : right_tuples_and_bits) {
+      ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
+                       CreateMergeJoinKey(params, *tuple_and_bit.tuple,
+                                          right_equality_exprs, context));
+      if (key == nullptr) continue;
+
+      SortedEntry entry;
+      entry.key = key.get();
+      entry.tuple_and_bit = &tuple_and_bit;
+      entries.push_back(entry);
+
+      absl::Status status;
+      if (!right_keys->PushBack(std::move(key), &status)) {
+        return status;
+      }
+    }
+
+    const auto entry_less = [&comparator](const SortedEntry& e1,
+                                          const SortedEntry& e2) {
+      return (*comparator)(*e1.key, *e2.key);
+    };
+    if (!std::is_sorted(entries.begin(), entries.end(), entry_less)) {
+      std::stable_sort(entries.begin(), entries.end(), entry_less);
+    }
+
+    return absl::WrapUnique(new UncorrelatedSortedRightInput(
+        params, left_equality_exprs, std::move(comparator), std::move(schema),
+        std::move(right_tuples), std::move(right_tuples_and_bits),
+        std::move(right_keys), std::move(entries),
+        std::move(iter_for_debug_string), context));
+  }
+
+  UncorrelatedSortedRightInput(const UncorrelatedSortedRightInput&) = delete;
+  UncorrelatedSortedRightInput& operator=(const UncorrelatedSortedRightInput&) =
+      delete;
+
+  bool IsCorrelated() const override { return false; }
+
+  const TupleSchema& Schema() const override { return *schema_; }
+
+  absl::Status ResetForLeftInput(const Tuple* left_input) override {
+    if (left_input == nullptr) {
+      // Iterate over everything.
+      iterate_over_everything_ = true;
+      return absl::OkStatus();
+    }
+    iterate_over_everything_ = false;
+    match_begin_ = 0;
+    match_end_ = 0;
+
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleData> key,
+                     CreateMergeJoinKey(params_, *left_input->data,
+                                        left_equality_exprs_, context_));
+    if (key == nullptr) {
+      // No matching tuples.
+      return absl::OkStatus();
+    }
+
+    const TupleComparator& less = *comparator_;
+    int64_t begin;
+    if (previous_left_key_ != nullptr && !less(*key, *previous_left_key_)) {
+      // Merge: advance from the first match for the previous left key.
+      begin = cursor_;
+      while (begin < entries_.size() && less(*entries_[begin].key, *key)) {
+        ++begin;
+      }
+    } else {
+      // The left-hand side is not ordered on the join keys here, so we fall
+      // back to binary search.
+      begin = std::lower_bound(entries_.begin(), entries_.end(), key.get(),
+                               [&less](const SortedEntry& entry,
+                                       const TupleData* probe) {
+                                 return less(*entry.key, *probe);
+                               }) -
+              entries_.begin();
+    }
+    int64_t end = begin;
+    while (end < entries_.size() && !less(*key, *entries_[end].key)) {
+      ++end;
+    }
+
+    cursor_ = begin;
+    previous_left_key_ = std::move(key);
+    match_begin_ = begin;
+    match_end_ = end;
+    return absl::OkStatus();
+  }
+
+  int64_t GetNumMatchingTuples() const override {
+    if (iterate_over_everything_) return right_tuples_and_bits_.size();
+    return match_end_ - match_begin_;
+  }
+
+  const TupleData& GetMatchingTuple(int64_t index) const override {
+    if (iterate_over_everything_) return *right_tuples_and_bits_[index].tuple;
+    return *entries_[match_begin_ + index].tuple_and_bit->tuple;
+  }
+
+  absl::Status RecordMatchingTupleJoined(int64_t index) override {
+    if (iterate_over_everything_) {
+      right_tuples_and_bits_[index].joined = true;
+    } else {
+      entries_[match_begin_ + index].tuple_and_bit->joined = true;
+    }
+    return absl::OkStatus();
+  }
+
+  zetasql_base::StatusOr<bool> DidMatchingTupleJoin(int64_t index) const override {
+    if (iterate_over_everything_) return right_tuples_and_bits_[index].joined;
+    return entries_[match_begin_ + index].tuple_and_bit->joined;
+  }
+
+  std::string DebugString() const override {
+    return iter_for_debug_string_->DebugString();
+  }
+
+ private:
+  // A right tuple whose key can join with something.
+  struct SortedEntry {
+    const TupleData* key;  // Owned by 'right_keys_'.
+    RightTupleAndJoinedBit* tuple_and_bit;  // Points into
+                                            // 'right_tuples_and_bits_'.
+  };
+
+  UncorrelatedSortedRightInput(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const ExprArg* const> left_equality_exprs,
+      std::unique_ptr<TupleComparator> comparator,
+      std::unique_ptr<TupleSchema> schema,
+      std::unique_ptr<TupleDataDeque> right_tuples,
+      // The TupleDatas in here are owned by 'right_tuples'.
+      std::vector<RightTupleAndJoinedBit> right_tuples_and_bits,
+      std::unique_ptr<TupleDataDeque> right_keys,
+      std::vector<SortedEntry> entries,
+      std::unique_ptr<TupleIterator> iter_for_debug_string,
+      EvaluationContext* context)
+      : params_(params.begin(), params.end()),
+        left_equality_exprs_(left_equality_exprs.begin(),
+                             left_equality_exprs.end()),
+        comparator_(std::move(comparator)),
+        schema_(std::move(schema)),
+        right_tuples_(std::move(right_tuples)),
+        right_tuples_and_bits_(std::move(right_tuples_and_bits)),
+        right_keys_(std::move(right_keys)),
+        entries_(std::move(entries)),
+        iter_for_debug_string_(std::move(iter_for_debug_string)),
+        context_(context) {}
+
+  // Returns a TupleData containing the values of 'args' for 'row', or NULL if
+  // some value is NULL or NaN, in which case 'row' cannot join with anything.
+  static zetasql_base::StatusOr<std::unique_ptr<TupleData>> CreateMergeJoinKey(
+      absl::Span<const TupleData* const> params, const TupleData& row,
+      absl::Span<const ExprArg* const> args, EvaluationContext* context) {
+    auto key = absl::make_unique<TupleData>(args.size());
+    for (int i = 0; i < args.size(); ++i) {
+      TupleSlot* slot = key->mutable_slot(i);
+      absl::Status status;
+      if (!args[i]->value_expr()->EvalSimple(ConcatSpans(params, {&row}),
+                                             context, slot, &status)) {
+        return status;
+      }
+      const Value& value = slot->value();
+      if (value.is_null() ||
+          (value.type_kind() == TYPE_DOUBLE &&
+           std::isnan(value.double_value())) ||
+          (value.type_kind() == TYPE_FLOAT &&
+           std::isnan(value.float_value()))) {
+        return std::unique_ptr<TupleData>();
+      }
+    }
+    return key;
+  }
+
+  const std::vector<const TupleData*> params_;
+  const std::vector<const ExprArg*> left_equality_exprs_;
+  const std::unique_ptr<TupleComparator> comparator_;
+  const std::unique_ptr<TupleSchema> schema_;
+
+  std::unique_ptr<TupleDataDeque> right_tuples_;
+  // The TupleDatas in here are owned by 'right_tuples_'.
+  std::vector<RightTupleAndJoinedBit> right_tuples_and_bits_;
+  std::unique_ptr<TupleDataDeque> right_keys_;
+  // Sorted by 'comparator_'.
+  std::vector<SortedEntry> entries_;
+
+  // The key of the left tuple in the last call to ResetForLeftInput() that had
+  // a key that can join with something, and the index of the first entry in
+  // 'entries_' that is not less than that key.
+  std::unique_ptr<TupleData> previous_left_key_;
+  int64_t cursor_ = 0;
+  // True if the left tuple in the last call to ResetForLeftInput() was NULL and
+  // therefore GetNumMatchingTuples()/etc. should iterate over everything.
+  // Otherwise, the matching tuples are entries_[match_begin_, match_end_).
+  bool iterate_over_everything_ = false;
+  int64_t match_begin_ = 0;
+  int64_t match_end_ = 0;
+
+  // We store a TupleIterator instead of the debug string to avoid computing the
+  // debug string unnecessarily.
+  const std::unique_ptr<TupleIterator> iter_for_debug_string_;
+
+  EvaluationContext* context_;
+};
+
 // Reads the input tuples from 'op' and populates them in 'tuples'. If
 // 'iter_for_debug_string' is non-NULL, populates it with the iterator. (We pass
 // around the iterator instead of the debug string to avoid computing the debug
@@ -2246,7 +3216,12 @@ absl::Status ExtractFromRelationalOp(
                    op->CreateIterator(params, /*num_extra_slots=*/0, context));
   tuples->Clear();
   absl::Status status;
-  while (true) {
+  const int64_t verify_not_aborted_period =
+      absl::GetFlag(FLAGS_zetasql_call_verify_not_aborted_rows_period);
+  for (int64_t num_tuples = 0;; ++num_tuples) {
+    if (num_tuples % verify_not_aborted_period == 0) {
+      ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+    }
     TupleData* tuple = iter->Next();
     if (tuple == nullptr) {
       ZETASQL_RETURN_IF_ERROR(iter->Status());
@@ -2835,7 +3810,7 @@ class JoinTupleIterator : public TupleIterator {
 
 }  // namespace
 
-zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIterator(
+zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   std::unique_ptr<RightInputForJoin> right_hand_side;
@@ -2854,14 +3829,38 @@ zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> JoinOp::CreateIterator(
         right_hand_side = absl::make_unique<UncorrelatedRightInput>(
             right_input()->CreateOutputSchema(), std::move(tuples),
             std::move(iter_for_right_debug_string));
-      } else {
+      } else if (use_merge_join_) {
+        std::vector<const KeyArg*> keys;
+        keys.reserve(merge_join_keys_.size());
+        for (const std::unique_ptr<KeyArg>& key : merge_join_keys_) {
+          keys.push_back(key.get());
+        }
         ZETASQL_ASSIGN_OR_RETURN(
             right_hand_side,
-            UncorrelatedHashedRightInput::Create(
+            UncorrelatedSortedRightInput::Create(
                 params, hash_join_equality_left_exprs(),
-                hash_join_equality_right_exprs(),
+                hash_join_equality_right_exprs(), keys,
                 right_input()->CreateOutputSchema(), std::move(tuples),
                 std::move(iter_for_right_debug_string), context));
+      } else {
+        ZETASQL_ASSIGN_OR_RETURN(
+            right_hand_side,
+            UncorrelatedPartitionedHashedRightInput::Create(
+                params, hash_join_equality_left_exprs(),
+                hash_join_equality_right_exprs(),
+                right_input()->CreateOutputSchema(), &tuples,
+                &iter_for_right_debug_string, context));
+        if (right_hand_side == nullptr) {
+          // Some key does not have a normalized encoding, so 'tuples' was not
+          // consumed.
+          ZETASQL_ASSIGN_OR_RETURN(
+              right_hand_side,
+              UncorrelatedHashedRightInput::Create(
+                  params, hash_join_equality_left_exprs(),
+                  hash_join_equality_right_exprs(),
+                  right_input()->CreateOutputSchema(), std::move(tuples),
+                  std::move(iter_for_right_debug_string), context));
+        }
       }
       break;
     }
@@ -2970,6 +3969,7 @@ std::string JoinOp::DebugInternal(const std::string& indent,
       (join_kind_ == kInnerJoin || join_kind_ == kCrossApply) ? k0 : kN;
   return absl::StrCat(
       "JoinOp(", JoinKindToString(join_kind_),
+      use_merge_join_ ? " MERGE" : "",
       ArgDebugString(*arg_names,
                      {left_output_mode, right_output_mode, kN, kN, k1, k1, k1},
                      indent, verbose),
@@ -3188,7 +4188,7 @@ class ArrayScanTupleIterator : public TupleIterator {
 };
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ArrayScanOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> ArrayScanOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   TupleSlot array_slot;
@@ -3338,6 +4338,22 @@ absl::Status UnionAllOp::SetSchemasForEvaluation(
 }
 
 namespace {
+// Populates the first values.size() slots of 'output' by evaluating 'values'
+// on 'params' and 'input'. Returns false and populates 'status' on error.
+bool EvalUnionAllValues(absl::Span<const TupleData* const> params,
+                        absl::Span<const ExprArg* const> values,
+                        const TupleData* input, EvaluationContext* context,
+                        TupleData* output, absl::Status* status) {
+  for (int i = 0; i < values.size(); ++i) {
+    TupleSlot* slot = output->mutable_slot(i);
+    if (!values[i]->value_expr()->EvalSimple(ConcatSpans(params, {input}),
+                                             context, slot, status)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Iterates over the tuples from 'iters'. For each one, produces an output tuple
 // with values given by evaluating the ValueExprs in the corresponding element
 // of 'values'.
@@ -3377,18 +4393,10 @@ class UnionAllTupleIterator : public TupleIterator {
       return nullptr;
     }
 
-    for (int i = 0; i < values.size(); ++i) {
-      TupleSlot* slot = data_.mutable_slot(i);
-      absl::Status status;
-      if (!values[i]->value_expr()->EvalSimple(
-              ConcatSpans(absl::Span<const TupleData* const>(params_),
-                          {next_input}),
-              context_, slot, &status)) {
-        status_ = status;
-        return nullptr;
-      }
+    if (!EvalUnionAllValues(params_, values, next_input, context_, &data_,
+                            &status_)) {
+      return nullptr;
     }
-
     return &data_;
   }
 
@@ -3434,9 +4442,258 @@ class UnionAllTupleIterator : public TupleIterator {
   absl::Status status_;
   EvaluationContext* context_;
 };
+
+// Returns a copy of the values of 'data' without their SharedProtoState, which
+// is not safe to share across threads.
+TupleData CopyValuesForOtherThread(const TupleData& data) {
+  TupleData copy(data.num_slots());
+  for (int i = 0; i < data.num_slots(); ++i) {
+    copy.mutable_slot(i)->SetValue(data.slot(i).value());
+  }
+  return copy;
+}
+
+// Like UnionAllTupleIterator, but evaluates the inputs 'rels' concurrently on
+// up to 'num_threads' threads. Each input has its own EvaluationContext from
+// EvaluationContext::MakeChildContext(), its own copy of the parameters (see
+// CopyValuesForOtherThread()) and its own bounded queue of tuples. The worker
+// threads create the iterators of the inputs, in order, so inputs that do most
+// of their work in RelationalOp::CreateIterator() or before producing their
+// first tuple (e.g., sorts and aggregations) run concurrently. The inputs are
+// returned in order, so the output is the same as that of
+// UnionAllTupleIterator, and the other inputs run ahead of the consumer by at
+// most the queue capacity.
+class ParallelUnionAllTupleIterator : public TupleIterator {
+ public:
+  // The maximum number of tuples buffered for each input.
+  static constexpr int kQueueCapacity = 1024;
+
+  // 'reserved_bytes' were requested from the memory accountant of 'context'
+  // for 'input_contexts', and are returned by the destructor.
+  ParallelUnionAllTupleIterator(
+      absl::Span<const TupleData* const> params,
+      absl::Span<const absl::Span<const ExprArg* const>> values,
+      std::unique_ptr<TupleSchema> output_schema, int num_extra_slots,
+      std::vector<const RelationalOp*> rels,
+      std::vector<std::unique_ptr<EvaluationContext>> input_contexts,
+      std::vector<std::unique_ptr<TupleData>> input_params,
+      int64_t reserved_bytes, int num_threads, EvaluationContext* context)
+      : params_(params.begin(), params.end()),
+        values_(values.begin(), values.end()),
+        output_schema_(std::move(output_schema)),
+        rels_(std::move(rels)),
+        reserved_bytes_(reserved_bytes),
+        input_contexts_(std::move(input_contexts)),
+        input_params_(std::move(input_params)),
+        iters_(rels_.size()),
+        queues_(rels_.size()),
+        num_threads_(num_threads),
+        data_(output_schema_->num_variables() + num_extra_slots),
+        context_(context) {}
+
+  ParallelUnionAllTupleIterator(const ParallelUnionAllTupleIterator&) = delete;
+  ParallelUnionAllTupleIterator& operator=(
+      const ParallelUnionAllTupleIterator&) = delete;
+
+  ~ParallelUnionAllTupleIterator() override {
+    {
+      absl::MutexLock lock(&mu_);
+      shutting_down_ = true;
+      for (InputQueue& queue : queues_) {
+        queue.closed = true;
+      }
+    }
+    // Interrupts the inputs that are still being evaluated, so that the
+    // destructor does not wait for them to finish.
+    for (int i = iter_idx_; i < input_contexts_.size(); ++i) {
+      input_contexts_[i]->CancelStatement().IgnoreError();
+    }
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    // Next() only merges the contexts of the inputs that it consumed entirely,
+    // but the other inputs may also have recorded state (e.g., non-determinism)
+    // before the consumer stopped reading.
+    for (int i = iter_idx_; i < input_contexts_.size(); ++i) {
+      context_->MergeChildContext(*input_contexts_[i]);
+    }
+    iters_.clear();
+    input_contexts_.clear();
+    context_->memory_accountant()->ReturnBytes(reserved_bytes_);
+  }
+
+  const TupleSchema& Schema() const override { return *output_schema_; }
+
+  TupleData* Next() override {
+    if (threads_.empty()) {
+      for (int i = 0; i < num_threads_; ++i) {
+        threads_.emplace_back([this] { RunWorker(); });
+      }
+    }
+
+    while (iter_idx_ < rels_.size()) {
+      InputQueue& queue = queues_[iter_idx_];
+      {
+        absl::MutexLock lock(&mu_);
+        mu_.Await(absl::Condition(&InputQueue::CanPop, &queue));
+        if (!queue.tuples.empty()) {
+          current_input_ = std::move(queue.tuples.front());
+          queue.tuples.pop_front();
+        } else if (!queue.status.ok()) {
+          status_ = queue.status;
+          return nullptr;
+        } else {
+          // The worker is done with the input, so its context is safe to read.
+          context_->MergeChildContext(*input_contexts_[iter_idx_]);
+          ++iter_idx_;
+          continue;
+        }
+      }
+
+      absl::Span<const ExprArg* const> values = values_[iter_idx_];
+      if (values.size() != output_schema_->num_variables()) {
+        status_ = zetasql_base::InternalErrorBuilder()
+                  << "ParallelUnionAllTupleIterator::Next() expected "
+                  << output_schema_->num_variables() << " values, but found "
+                  << values.size();
+        return nullptr;
+      }
+      if (!EvalUnionAllValues(params_, values, &current_input_, context_,
+                              &data_, &status_)) {
+        return nullptr;
+      }
+      return &data_;
+    }
+    return nullptr;
+  }
+
+  absl::Status Status() const override { return status_; }
+
+  std::string DebugString() const override {
+    std::vector<std::string> iter_strings;
+    iter_strings.reserve(rels_.size());
+    for (const RelationalOp* rel : rels_) {
+      iter_strings.push_back(rel->IteratorDebugString());
+    }
+    return absl::StrCat("ParallelUnionAllTupleIterator(",
+                        absl::StrJoin(iter_strings, ","), ")");
+  }
+
+ private:
+  struct InputQueue {
+    std::deque<TupleData> tuples;
+    // True if the input has no more tuples, in which case 'status' is its
+    // final status.
+    bool done = false;
+    absl::Status status;
+    // True if the consumer no longer reads the queue.
+    bool closed = false;
+
+    static bool CanPop(InputQueue* queue) {
+      return !queue->tuples.empty() || queue->done;
+    }
+    static bool CanPush(InputQueue* queue) {
+      return queue->closed || queue->tuples.size() < kQueueCapacity;
+    }
+  };
+
+  // Repeatedly claims the next input that has not been started and drains it
+  // into its queue, until there are no more inputs or this object is being
+  // destroyed.
+  void RunWorker() {
+    while (true) {
+      int input_idx;
+      {
+        absl::MutexLock lock(&mu_);
+        if (shutting_down_ || next_input_idx_ == rels_.size()) return;
+        input_idx = next_input_idx_++;
+      }
+      if (!DrainInput(input_idx)) return;
+    }
+  }
+
+  // Creates the iterator for input 'input_idx' and pushes its tuples into its
+  // queue. Returns false if this object is being destroyed.
+  bool DrainInput(int input_idx) {
+    InputQueue& queue = queues_[input_idx];
+    const std::vector<const TupleData*> input_params =
+        GetInputParams(input_idx);
+    zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> status_or_iter =
+        rels_[input_idx]->CreateIterator(input_params, /*num_extra_slots=*/0,
+                                         input_contexts_[input_idx].get());
+    if (!status_or_iter.ok()) {
+      absl::MutexLock lock(&mu_);
+      queue.done = true;
+      queue.status = status_or_iter.status();
+      return true;
+    }
+    iters_[input_idx] = std::move(status_or_iter).value();
+    TupleIterator* iter = iters_[input_idx].get();
+    while (true) {
+      const TupleData* next = iter->Next();
+      if (next == nullptr) {
+        absl::MutexLock lock(&mu_);
+        queue.done = true;
+        queue.status = iter->Status();
+        return true;
+      }
+
+      TupleData tuple = CopyValuesForOtherThread(*next);
+
+      absl::MutexLock lock(&mu_);
+      mu_.Await(absl::Condition(&InputQueue::CanPush, &queue));
+      if (queue.closed) return false;
+      queue.tuples.push_back(std::move(tuple));
+    }
+  }
+
+  // Returns the copies of the parameters for input 'input_idx'.
+  std::vector<const TupleData*> GetInputParams(int input_idx) const {
+    std::vector<const TupleData*> input_params;
+    input_params.reserve(params_.size());
+    for (int i = 0; i < params_.size(); ++i) {
+      input_params.push_back(
+          input_params_[input_idx * params_.size() + i].get());
+    }
+    return input_params;
+  }
+
+  const std::vector<const TupleData*> params_;
+  const std::vector<absl::Span<const ExprArg* const>> values_;
+  const std::unique_ptr<TupleSchema> output_schema_;
+  const std::vector<const RelationalOp*> rels_;
+  const int64_t reserved_bytes_;
+
+  // Declared before 'iters_' so that the iterators are destroyed before their
+  // contexts and parameters. Each iterator is created and used by the worker
+  // thread that claimed its input.
+  std::vector<std::unique_ptr<EvaluationContext>> input_contexts_;
+  // The copies of 'params_' read by the inputs, 'params_.size()' per input, so
+  // that the worker threads do not share the SharedProtoState of the
+  // parameters.
+  std::vector<std::unique_ptr<TupleData>> input_params_;
+  std::vector<std::unique_ptr<TupleIterator>> iters_;
+
+  absl::Mutex mu_;
+  // The contents of the queues are guarded by 'mu_'.
+  std::vector<InputQueue> queues_;
+  // Index of the next input for a worker thread to claim.
+  int next_input_idx_ ABSL_GUARDED_BY(mu_) = 0;
+  bool shutting_down_ ABSL_GUARDED_BY(mu_) = false;
+
+  const int num_threads_;
+  std::vector<std::thread> threads_;
+
+  // The remaining members are only used by the thread calling Next().
+  int iter_idx_ = 0;  // Index of the current input.
+  TupleData current_input_;
+  TupleData data_;
+  absl::Status status_;
+  EvaluationContext* context_;
+};
 }  // namespace
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> UnionAllOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> UnionAllOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   std::vector<absl::Span<const ExprArg* const>> tuple_values;
@@ -3445,15 +4702,51 @@ class UnionAllTupleIterator : public TupleIterator {
     tuple_values.push_back(values(i));
   }
 
+  // Only the first iterator in an evaluation uses threads. The others (e.g.,
+  // one per outer row in a correlated subquery) would mostly pay for starting
+  // the threads.
+  const int num_threads =
+      std::min(context->options().max_parallelism, num_rel());
+  if (num_threads > 1 && context->ClaimParallelExecution(this)) {
+    // The inputs share the memory that is left in 'context' with the
+    // consumer, so that the memory limit holds for the whole evaluation.
+    MemoryAccountant* accountant = context->memory_accountant();
+    const int64_t input_bytes = accountant->remaining_bytes() / (num_rel() + 1);
+    const int64_t reserved_bytes = input_bytes * num_rel();
+    absl::Status status;
+    if (!accountant->RequestBytes(reserved_bytes, &status)) {
+      return status;
+    }
+    std::vector<const RelationalOp*> rels;
+    std::vector<std::unique_ptr<EvaluationContext>> input_contexts;
+    std::vector<std::unique_ptr<TupleData>> input_params;
+    rels.reserve(num_rel());
+    input_contexts.reserve(num_rel());
+    input_params.reserve(num_rel() * params.size());
+    for (int i = 0; i < num_rel(); ++i) {
+      rels.push_back(rel(i));
+      input_contexts.push_back(context->MakeChildContext(input_bytes));
+      for (const TupleData* param : params) {
+        input_params.push_back(
+            absl::make_unique<TupleData>(CopyValuesForOtherThread(*param)));
+      }
+    }
+    std::unique_ptr<TupleIterator> iter =
+        absl::make_unique<ParallelUnionAllTupleIterator>(
+            params, tuple_values, CreateOutputSchema(), num_extra_slots,
+            std::move(rels), std::move(input_contexts),
+            std::move(input_params), reserved_bytes, num_threads, context);
+    return MaybeReorder(std::move(iter), context);
+  }
+
   std::vector<std::unique_ptr<TupleIterator>> iters;
   iters.reserve(num_rel());
   for (int i = 0; i < num_rel(); ++i) {
-    ZETASQL_ASSIGN_OR_RETURN(
-        std::unique_ptr<TupleIterator> iter,
-        rel(i)->CreateIterator(params, /*num_extra_slots=*/0, context));
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
+                     rel(i)->CreateIterator(params, /*num_extra_slots=*/0,
+                                            context));
     iters.push_back(std::move(iter));
   }
-
   std::unique_ptr<TupleIterator> iter =
       absl::make_unique<UnionAllTupleIterator>(
           params, tuple_values, CreateOutputSchema(), num_extra_slots,
@@ -3551,7 +4844,7 @@ absl::Status RootOp::SetSchemasForEvaluation(
   return mutable_input()->SetSchemasForEvaluation(params_schemas);
 }
 
-::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RootOp::CreateIterator(
+::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> RootOp::CreateIteratorInternal(
     absl::Span<const TupleData* const> params, int num_extra_slots,
     EvaluationContext* context) const {
   return input()->CreateIterator(params, num_extra_slots, context);
@@ -53,6 +53,9 @@
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "zetasql/base/source_location.h"
@@ -61,8 +64,6 @@
 #include "zetasql/base/statusor.h"
 #include "zetasql/base/clock.h"
 
-using absl::nullopt;
-
 using google::protobuf::internal::WireFormatLite;
 
 using testing::_;
@@ -233,7 +234,7 @@ TEST_F(EvalRelationalOpTest, TestRelationalOp) {
       const SharedProtoState* shared_state = shared_states[i][j];
       EXPECT_TRUE(actual_slot.mutable_shared_proto_state()->get() ==
                   shared_state);
-      EXPECT_TRUE(!shared_state->has_value());
+      EXPECT_TRUE(!shared_state->value_map.has_value());
     }
   }
 }
@@ -658,12 +659,14 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOp) {
   EXPECT_THAT(
       data[0].slots(),
       ElementsAre(IsTupleSlotWith(String("foo1"), IsNull()),
-                  IsTupleSlotWith(GetProtoValue(0), Pointee(Eq(nullopt))),
+                  IsTupleSlotWith(GetProtoValue(0),
+                                  Pointee(HasNoFieldValues())),
                   IsTupleSlotWith(Int64(100), IsNull()), _));
   EXPECT_THAT(
       data[1].slots(),
       ElementsAre(IsTupleSlotWith(String("foo2"), IsNull()),
-                  IsTupleSlotWith(GetProtoValue(1), Pointee(Eq(nullopt))),
+                  IsTupleSlotWith(GetProtoValue(1),
+                                  Pointee(HasNoFieldValues())),
                   IsTupleSlotWith(Int64(200), IsNull()), _));
 
   EvaluationContext scramble_context(GetScramblingEvaluationOptions());
@@ -726,7 +729,8 @@ TEST_F(CreateIteratorTest, EvaluatorTableScanOpWithColumnFilter) {
   EXPECT_THAT(
       data[0].slots(),
       ElementsAre(IsTupleSlotWith(String("foo1"), IsNull()),
-                  IsTupleSlotWith(GetProtoValue(0), Pointee(Eq(nullopt))),
+                  IsTupleSlotWith(GetProtoValue(0),
+                                  Pointee(HasNoFieldValues())),
                   IsTupleSlotWith(Int64(100), IsNull()), _));
 }
 
@@ -1178,7 +1182,9 @@ TEST_F(CreateIteratorTest, LeftOuterJoin) {
           IsTupleSlotWith(GetProtoValue(4),
                           HasRawPointer(shared_states1[1][1])),
           IsTupleSlotWith(NullInt64(), IsNull()),
-          IsTupleSlotWith(Value::Null(proto_type_), Pointee(Eq(nullopt))), _));
+          IsTupleSlotWith(Value::Null(proto_type_),
+                          Pointee(HasNoFieldValues())),
+          _));
 
   // Do it again with cancellation.
   context.ClearDeadlineAndCancellationState();
@@ -1334,7 +1340,8 @@ TEST_F(CreateIteratorTest, RightOuterJoin) {
       data[2].slots(),
       ElementsAre(
           IsTupleSlotWith(NullInt64(), IsNull()),
-          IsTupleSlotWith(Value::Null(proto_type_), Pointee(Eq(nullopt))),
+          IsTupleSlotWith(Value::Null(proto_type_),
+                          Pointee(HasNoFieldValues())),
           IsTupleSlotWith(Int64(4), IsNull()),
           IsTupleSlotWith(GetProtoValue(4),
                           HasRawPointer(shared_states_right[1][1])),
@@ -1490,7 +1497,9 @@ TEST_F(CreateIteratorTest, FullOuterJoin) {
           IsTupleSlotWith(GetProtoValue(1),
                           HasRawPointer(shared_states1[0][1])),
           IsTupleSlotWith(NullInt64(), IsNull()),
-          IsTupleSlotWith(Value::Null(proto_type_), Pointee(Eq(nullopt))), _));
+          IsTupleSlotWith(Value::Null(proto_type_),
+                          Pointee(HasNoFieldValues())),
+          _));
   EXPECT_THAT(data[1].slots(),
               ElementsAre(IsTupleSlotWith(Int64(2), IsNull()),
                           IsTupleSlotWith(GetProtoValue(2),
@@ -1502,7 +1511,7 @@ TEST_F(CreateIteratorTest, FullOuterJoin) {
   EXPECT_THAT(data[2].slots(),
               ElementsAre(IsTupleSlotWith(NullInt64(), IsNull()),
                           IsTupleSlotWith(Value::Null(proto_type_),
-                                          Pointee(Eq(nullopt))),
+                                          Pointee(HasNoFieldValues())),
                           IsTupleSlotWith(Int64(3), IsNull()),
                           IsTupleSlotWith(GetProtoValue(3),
                                           HasRawPointer(shared_states2[1][1])),
@@ -2272,11 +2281,13 @@ TEST_F(CreateIteratorTest, FullOuterHashJoin) {
           IsTupleSlotWith(GetProtoValue(1),
                           HasRawPointer(shared_states1[1][1])),
           IsTupleSlotWith(NullInt64(), IsNull()),
-          IsTupleSlotWith(Value::Null(proto_type_), Pointee(Eq(nullopt))), _));
+          IsTupleSlotWith(Value::Null(proto_type_),
+                          Pointee(HasNoFieldValues())),
+          _));
   EXPECT_THAT(data[3].slots(),
               ElementsAre(IsTupleSlotWith(NullInt64(), IsNull()),
                           IsTupleSlotWith(Value::Null(proto_type_),
-                                          Pointee(Eq(nullopt))),
+                                          Pointee(HasNoFieldValues())),
                           IsTupleSlotWith(Int64(3), IsNull()),
                           IsTupleSlotWith(GetProtoValue(1),
                                           HasRawPointer(shared_states2[2][1])),
@@ -2322,6 +2333,307 @@ TEST_F(CreateIteratorTest, FullOuterHashJoin) {
                        HasSubstr("Out of memory")));
 }
 
+TEST_F(CreateIteratorTest, PartitionedHashJoin) {
+  VariableId x1("x1"), x2("x2"), y1("y1"), y2("y2"), a1("a1"), a2("a2"),
+      b1("b1"), b2("b2");
+
+  auto input1 = absl::WrapUnique(new TestRelationalOp(
+      {x1, x2},
+      CreateTestTupleDatas({{Int64(3), String("b")},
+                            {Int64(3), String("a")},
+                            {NullInt64(), String("a")},
+                            {Int64(-1), String("a")},
+                            {Int64(4998), String("a")}}),
+      /*preserves_order=*/true));
+
+  // Enough right tuples to require more than one partition. Tuples i and
+  // i + 5000 have the same key.
+  std::vector<std::vector<Value>> right_values;
+  for (int i = 0; i < 10000; ++i) {
+    right_values.push_back(
+        {Uint64(i % 5000), String(i % 2 == 0 ? "a" : "b"), Int64(i)});
+  }
+  VariableId y3("y3");
+  auto input2 = absl::WrapUnique(
+      new TestRelationalOp({y1, y2, y3}, CreateTestTupleDatas(right_values),
+                           /*preserves_order=*/true));
+
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs(2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x1, DerefExpr::Create(x1, Int64Type()));
+  equality_exprs[0].left_expr =
+      absl::make_unique<ExprArg>(a1, std::move(deref_x1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y1, DerefExpr::Create(y1, Uint64Type()));
+  equality_exprs[0].right_expr =
+      absl::make_unique<ExprArg>(b1, std::move(deref_y1));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x2, DerefExpr::Create(x2, StringType()));
+  equality_exprs[1].left_expr =
+      absl::make_unique<ExprArg>(a2, std::move(deref_x2));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y2, DerefExpr::Create(y2, StringType()));
+  equality_exprs[1].right_expr =
+      absl::make_unique<ExprArg>(b2, std::move(deref_y2));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto join_op,
+      JoinOp::Create(JoinOp::kInnerJoin, std::move(equality_exprs),
+                     std::move(true_expr), std::move(input1), std::move(input2),
+                     /*left_outputs=*/{}, /*right_outputs=*/{}));
+  ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationContext context((EvaluationOptions()));
+  const int64_t initial_remaining_bytes =
+      context.memory_accountant()->remaining_bytes();
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  EXPECT_TRUE(context.used_partitioned_hash_join());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 4);
+  // Right tuples with the same key are returned in their original order.
+  EXPECT_THAT(data[0].slots(),
+              ElementsAre(IsTupleSlotWith(Int64(3), _),
+                          IsTupleSlotWith(String("b"), _),
+                          IsTupleSlotWith(Uint64(3), _),
+                          IsTupleSlotWith(String("b"), _),
+                          IsTupleSlotWith(Int64(3), _)));
+  EXPECT_THAT(data[1].slots(),
+              ElementsAre(IsTupleSlotWith(Int64(3), _),
+                          IsTupleSlotWith(String("b"), _),
+                          IsTupleSlotWith(Uint64(3), _),
+                          IsTupleSlotWith(String("b"), _),
+                          IsTupleSlotWith(Int64(5003), _)));
+  EXPECT_THAT(data[2].slots(),
+              ElementsAre(IsTupleSlotWith(Int64(4998), _),
+                          IsTupleSlotWith(String("a"), _),
+                          IsTupleSlotWith(Uint64(4998), _),
+                          IsTupleSlotWith(String("a"), _),
+                          IsTupleSlotWith(Int64(4998), _)));
+  EXPECT_THAT(data[3].slots(),
+              ElementsAre(IsTupleSlotWith(Int64(4998), _),
+                          IsTupleSlotWith(String("a"), _),
+                          IsTupleSlotWith(Uint64(4998), _),
+                          IsTupleSlotWith(String("a"), _),
+                          IsTupleSlotWith(Int64(9998), _)));
+
+  // The build side returns all of its bytes.
+  iter.reset();
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(),
+            initial_remaining_bytes);
+}
+
+TEST_F(CreateIteratorTest, PartitionedHashJoinFallsBackForDoubles) {
+  VariableId x("x"), y("y"), a("a"), b("b");
+
+  auto input1 = absl::WrapUnique(new TestRelationalOp(
+      {x}, CreateTestTupleDatas({{Double(1)}, {Double(0.0 / 0.0)}}),
+      /*preserves_order=*/true));
+  auto input2 = absl::WrapUnique(new TestRelationalOp(
+      {y}, CreateTestTupleDatas({{Double(0.0 / 0.0)}, {Double(1)}}),
+      /*preserves_order=*/true));
+
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs(1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, DoubleType()));
+  equality_exprs[0].left_expr =
+      absl::make_unique<ExprArg>(a, std::move(deref_x));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, DoubleType()));
+  equality_exprs[0].right_expr =
+      absl::make_unique<ExprArg>(b, std::move(deref_y));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto join_op,
+      JoinOp::Create(JoinOp::kInnerJoin, std::move(equality_exprs),
+                     std::move(true_expr), std::move(input1), std::move(input2),
+                     /*left_outputs=*/{}, /*right_outputs=*/{}));
+  ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  EXPECT_FALSE(context.used_partitioned_hash_join());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  // NaN does not join with NaN.
+  ASSERT_EQ(data.size(), 1);
+  EXPECT_THAT(data[0].slots(), ElementsAre(IsTupleSlotWith(Double(1), _),
+                                           IsTupleSlotWith(Double(1), _)));
+}
+
+TEST_F(CreateIteratorTest, FullOuterMergeJoin) {
+  VariableId x("x"), x_prime("x'"), y("y"), y_prime("y'"), z("z"),
+      z_prime("z'"), a("a"), b("b");
+
+  // The left-hand side is only partially ordered on the join key, which
+  // exercises both merging and binary search.
+  auto input1 = absl::WrapUnique(new TestRelationalOp(
+      {x},
+      CreateTestTupleDatas(
+          {{Int64(1)}, {Int64(3)}, {NullInt64()}, {Int64(0)}, {Int64(3)}}),
+      /*preserves_order=*/true));
+  auto input2 = absl::WrapUnique(
+      new TestRelationalOp({y, z},
+                           CreateTestTupleDatas({{Int64(3), Int64(10)},
+                                                 {Int64(1), Int64(11)},
+                                                 {Int64(3), Int64(12)},
+                                                 {NullInt64(), Int64(13)},
+                                                 {Int64(4), Int64(14)}}),
+                           /*preserves_order=*/true));
+
+  std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs(1);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+  equality_exprs[0].left_expr =
+      absl::make_unique<ExprArg>(a, std::move(deref_x));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+  equality_exprs[0].right_expr =
+      absl::make_unique<ExprArg>(b, std::move(deref_y));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto true_expr, ConstExpr::Create(Bool(true)));
+
+  std::vector<std::unique_ptr<ExprArg>> left_outputs;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_x_output,
+                       DerefExpr::Create(x, Int64Type()));
+  left_outputs.push_back(
+      absl::make_unique<ExprArg>(x_prime, std::move(deref_x_output)));
+
+  std::vector<std::unique_ptr<ExprArg>> right_outputs;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_y_output,
+                       DerefExpr::Create(y, Int64Type()));
+  right_outputs.push_back(
+      absl::make_unique<ExprArg>(y_prime, std::move(deref_y_output)));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_z_output,
+                       DerefExpr::Create(z, Int64Type()));
+  right_outputs.push_back(
+      absl::make_unique<ExprArg>(z_prime, std::move(deref_z_output)));
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      auto join_op,
+      JoinOp::Create(JoinOp::kFullOuterJoin, std::move(equality_exprs),
+                     std::move(true_expr), std::move(input1), std::move(input2),
+                     std::move(left_outputs), std::move(right_outputs)));
+  ASSERT_TRUE(join_op->CanUseMergeJoin());
+  ZETASQL_ASSERT_OK(join_op->set_use_merge_join(true));
+  EXPECT_THAT(join_op->DebugString(), HasSubstr("JoinOp(FULL OUTER MERGE\n"));
+  std::unique_ptr<TupleSchema> output_schema = join_op->CreateOutputSchema();
+  EXPECT_THAT(output_schema->variables(),
+              ElementsAre(x_prime, y_prime, z_prime));
+
+  ZETASQL_ASSERT_OK(join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0, &context));
+  EXPECT_EQ(iter->DebugString(),
+            "JoinTupleIterator(FULL OUTER, "
+            "left=TestTupleIterator, right=TestTupleIterator)");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  std::vector<std::vector<Value>> values;
+  for (const TupleData& tuple : data) {
+    std::vector<Value> tuple_values;
+    for (const TupleSlot& slot : tuple.slots()) {
+      tuple_values.push_back(slot.value());
+    }
+    values.push_back(tuple_values);
+  }
+  // The output is the same as for a hash join.
+  EXPECT_THAT(
+      values,
+      ElementsAre(ElementsAre(Int64(1), Int64(1), Int64(11)),
+                  ElementsAre(Int64(3), Int64(3), Int64(10)),
+                  ElementsAre(Int64(3), Int64(3), Int64(12)),
+                  ElementsAre(NullInt64(), NullInt64(), NullInt64()),
+                  ElementsAre(Int64(0), NullInt64(), NullInt64()),
+                  ElementsAre(Int64(3), Int64(3), Int64(10)),
+                  ElementsAre(Int64(3), Int64(3), Int64(12)),
+                  ElementsAre(NullInt64(), NullInt64(), Int64(13)),
+                  ElementsAre(NullInt64(), Int64(4), Int64(14))));
+}
+
+TEST_F(CreateIteratorTest, MergeJoinMatchesHashJoin) {
+  VariableId x("x"), y("y"), z("z"), a("a"), b("b");
+
+  // Evaluates a join of the inputs of FullOuterMergeJoin with 'join_kind'.
+  auto evaluate_join = [&](JoinOp::JoinKind join_kind, bool use_merge_join)
+      -> zetasql_base::StatusOr<std::vector<std::vector<Value>>> {
+    auto input1 = absl::WrapUnique(new TestRelationalOp(
+        {x},
+        CreateTestTupleDatas(
+            {{Int64(1)}, {Int64(3)}, {NullInt64()}, {Int64(0)}, {Int64(3)}}),
+        /*preserves_order=*/true));
+    auto input2 = absl::WrapUnique(
+        new TestRelationalOp({y, z},
+                             CreateTestTupleDatas({{Int64(3), Int64(10)},
+                                                   {Int64(1), Int64(11)},
+                                                   {Int64(3), Int64(12)},
+                                                   {NullInt64(), Int64(13)},
+                                                   {Int64(4), Int64(14)}}),
+                             /*preserves_order=*/true));
+
+    std::vector<JoinOp::HashJoinEqualityExprs> equality_exprs(1);
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_x, DerefExpr::Create(x, Int64Type()));
+    equality_exprs[0].left_expr =
+        absl::make_unique<ExprArg>(a, std::move(deref_x));
+    ZETASQL_ASSIGN_OR_RETURN(auto deref_y, DerefExpr::Create(y, Int64Type()));
+    equality_exprs[0].right_expr =
+        absl::make_unique<ExprArg>(b, std::move(deref_y));
+    ZETASQL_ASSIGN_OR_RETURN(auto true_expr, ConstExpr::Create(Bool(true)));
+
+    ZETASQL_ASSIGN_OR_RETURN(
+        auto join_op,
+        JoinOp::Create(join_kind, std::move(equality_exprs),
+                       std::move(true_expr), std::move(input1),
+                       std::move(input2), /*left_outputs=*/{},
+                       /*right_outputs=*/{}));
+    ZETASQL_RET_CHECK(join_op->CanUseMergeJoin());
+    ZETASQL_RETURN_IF_ERROR(join_op->set_use_merge_join(use_merge_join));
+    ZETASQL_RETURN_IF_ERROR(
+        join_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+
+    EvaluationContext context((EvaluationOptions()));
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<TupleIterator> iter,
+        join_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                &context));
+    ZETASQL_ASSIGN_OR_RETURN(std::vector<TupleData> data,
+                     ReadFromTupleIterator(iter.get()));
+    std::vector<std::vector<Value>> values;
+    for (const TupleData& tuple : data) {
+      std::vector<Value> tuple_values;
+      for (const TupleSlot& slot : tuple.slots()) {
+        tuple_values.push_back(slot.value());
+      }
+      values.push_back(tuple_values);
+    }
+    return values;
+  };
+
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::vector<Value>> inner_values,
+      evaluate_join(JoinOp::kInnerJoin, /*use_merge_join=*/true));
+  EXPECT_THAT(inner_values,
+              ElementsAre(ElementsAre(Int64(1), Int64(1), Int64(11)),
+                          ElementsAre(Int64(3), Int64(3), Int64(10)),
+                          ElementsAre(Int64(3), Int64(3), Int64(12)),
+                          ElementsAre(Int64(3), Int64(3), Int64(10)),
+                          ElementsAre(Int64(3), Int64(3), Int64(12))));
+
+  for (JoinOp::JoinKind join_kind :
+       {JoinOp::kInnerJoin, JoinOp::kLeftOuterJoin, JoinOp::kRightOuterJoin}) {
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<std::vector<Value>> merge_values,
+                         evaluate_join(join_kind, /*use_merge_join=*/true));
+    ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<std::vector<Value>> hash_values,
+                         evaluate_join(join_kind, /*use_merge_join=*/false));
+    EXPECT_EQ(merge_values, hash_values) << join_kind;
+    // Every left tuple, or every right tuple, appears in an outer join.
+    EXPECT_EQ(merge_values.size(), join_kind == JoinOp::kInnerJoin ? 5 : 7)
+        << join_kind;
+  }
+}
+
 TEST_F(CreateIteratorTest, SortOpTotalOrder) {
   VariableId a("a"), b("b"), c("c"), param("param"), k("k"), v1("v1"), v2("v2"),
       v3("v3");
@@ -2500,6 +2812,27 @@ TEST_F(CreateIteratorTest, SortOpIgnoresOrder) {
   EXPECT_EQ(data[0].num_slots(), 2);
   EXPECT_EQ(data[1].num_slots(), 2);
 
+  // Profiling charges the buffered tuples to the SortOp, not to its input.
+  EvaluationOptions profile_options;
+  profile_options.profile_relational_ops = true;
+  EvaluationContext profile_context(profile_options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      iter, sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                    &profile_context));
+  const RelationalOpProfile* sort_profile =
+      profile_context.GetRelationalOpProfile(sort_op.get());
+  ASSERT_NE(sort_profile, nullptr);
+  EXPECT_GT(sort_profile->peak_memory_bytes, 0);
+  const RelationalOpProfile* input_profile =
+      profile_context.GetRelationalOpProfile(sort_op->input());
+  ASSERT_NE(input_profile, nullptr);
+  EXPECT_EQ(input_profile->peak_memory_bytes, 0);
+  const std::string profile_string =
+      RelationalOpProfileDebugString(*sort_op, profile_context);
+  EXPECT_THAT(profile_string, HasSubstr("SortOp: iterators=1 rows=0"));
+  EXPECT_THAT(profile_string,
+              HasSubstr("\n  TestRelationalOp: iterators=1 rows=2"));
+
   EvaluationContext scramble_context(GetScramblingEvaluationOptions());
   ZETASQL_ASSERT_OK_AND_ASSIGN(
       iter, sort_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
@@ -3047,11 +3380,13 @@ TEST_F(CreateIteratorTest, ArrayScanOp) {
   ASSERT_EQ(data.size(), 2);
   EXPECT_THAT(
       data[0].slots(),
-      ElementsAre(IsTupleSlotWith(GetProtoValue(1), Pointee(Eq(nullopt))),
+      ElementsAre(IsTupleSlotWith(GetProtoValue(1),
+                                  Pointee(HasNoFieldValues())),
                   IsTupleSlotWith(Int64(0), IsNull()), _));
   EXPECT_THAT(
       data[1].slots(),
-      ElementsAre(IsTupleSlotWith(GetProtoValue(2), Pointee(Eq(nullopt))),
+      ElementsAre(IsTupleSlotWith(GetProtoValue(2),
+                                  Pointee(HasNoFieldValues())),
                   IsTupleSlotWith(Int64(1), IsNull()), _));
   // Ordered arrays always have deterministic output.
   EXPECT_TRUE(context.IsDeterministicOutput());
@@ -3311,6 +3646,50 @@ TEST_F(CreateIteratorTest, UnionAllOp) {
                                           HasRawPointer(shared_states[3][1])),
                           _));
 
+  // Check that parallel evaluation returns the same tuples in the same order.
+  EvaluationOptions parallel_options;
+  parallel_options.max_parallelism = 2;
+  EvaluationContext parallel_context(parallel_options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, union_all_op->CreateIterator(EmptyParams(),
+                                                          /*num_extra_slots=*/1,
+                                                          &parallel_context));
+  EXPECT_EQ(iter->DebugString(),
+            "ParallelUnionAllTupleIterator(TestTupleIterator,"
+            "TestTupleIterator)");
+  EXPECT_TRUE(iter->PreservesOrder());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(data, ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 4);
+  for (int i = 0; i < data.size(); ++i) {
+    EXPECT_THAT(data[i].slots(),
+                ElementsAre(IsTupleSlotWith(Int64(i + 1), IsNull()),
+                            IsTupleSlotWith(GetProtoValue(i + 1), _), _));
+  }
+  EXPECT_TRUE(parallel_context.IsDeterministicOutput());
+
+  // Later iterators in the same evaluation (e.g., for the other outer rows of a
+  // correlated subquery) do not start threads.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, union_all_op->CreateIterator(EmptyParams(),
+                                                          /*num_extra_slots=*/1,
+                                                          &parallel_context));
+  EXPECT_EQ(iter->DebugString(),
+            "UnionAllTupleIterator(TestTupleIterator,TestTupleIterator)");
+
+  // The state recorded for the inputs is kept if the consumer stops early.
+  EvaluationOptions profile_options = parallel_options;
+  profile_options.profile_relational_ops = true;
+  EvaluationContext profile_context(profile_options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(iter, union_all_op->CreateIterator(EmptyParams(),
+                                                          /*num_extra_slots=*/1,
+                                                          &profile_context));
+  ASSERT_NE(iter->Next(), nullptr);
+  iter.reset();
+  // The second input may not have been started before the iterator was
+  // destroyed.
+  const RelationalOpProfile* profile =
+      profile_context.GetRelationalOpProfile(union_all_op->rel(0));
+  ASSERT_NE(profile, nullptr);
+  EXPECT_EQ(profile->num_iterators, 1);
+
   // Check that scrambling works.
   EvaluationContext scramble_context(GetScramblingEvaluationOptions());
   ZETASQL_ASSERT_OK_AND_ASSIGN(iter, union_all_op->CreateIterator(EmptyParams(),
@@ -3322,6 +3701,128 @@ TEST_F(CreateIteratorTest, UnionAllOp) {
   EXPECT_FALSE(iter->PreservesOrder());
 }
 
+// Returns a UNION ALL of 'inputs', which must each produce a single INT64
+// variable.
+static std::unique_ptr<UnionAllOp> CreateUnionAllOfInt64s(
+    const VariableId& output,
+    std::vector<std::unique_ptr<TestRelationalOp>> inputs) {
+  std::vector<UnionAllOp::Input> union_inputs;
+  for (std::unique_ptr<TestRelationalOp>& input : inputs) {
+    const VariableId var = input->CreateOutputSchema()->variable(0);
+    UnionAllOp::Input union_input;
+    union_input.first = std::move(input);
+    union_input.second.push_back(absl::make_unique<ExprArg>(
+        output, DerefExpr::Create(var, Int64Type()).value()));
+    union_inputs.push_back(std::move(union_input));
+  }
+  std::unique_ptr<UnionAllOp> union_all_op =
+      UnionAllOp::Create(std::move(union_inputs)).value();
+  ZETASQL_CHECK_OK(union_all_op->SetSchemasForEvaluation(EmptyParamsSchemas()));
+  return union_all_op;
+}
+
+static bool BothInputsStarted(int* num_started) { return *num_started == 2; }
+
+TEST_F(CreateIteratorTest, ParallelUnionAllOpWithBlockingInputs) {
+  VariableId a("a"), a1("a1"), a2("a2");
+  std::vector<std::unique_ptr<TestRelationalOp>> inputs;
+  inputs.push_back(absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a1}, CreateTestTupleDatas({{Int64(1)}}),
+      /*preserves_order=*/true));
+  inputs.push_back(absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a2}, CreateTestTupleDatas({{Int64(2)}}),
+      /*preserves_order=*/true));
+
+  // Each input blocks in CreateIterator() (like a sort or an aggregation)
+  // until both inputs have started, which requires them to be created on
+  // different threads.
+  absl::Mutex mutex;
+  int num_started = 0;
+  std::vector<int64_t> input_byte_limits;
+  for (const std::unique_ptr<TestRelationalOp>& input : inputs) {
+    input->set_create_iterator_cb([&](EvaluationContext* input_context) {
+      absl::MutexLock lock(&mutex);
+      ++num_started;
+      input_byte_limits.push_back(
+          input_context->memory_accountant()->remaining_bytes());
+      if (!mutex.AwaitWithTimeout(
+              absl::Condition(&BothInputsStarted, &num_started),
+              absl::Seconds(30))) {
+        return absl::Status(absl::StatusCode::kDeadlineExceeded,
+                            "The inputs were not created concurrently");
+      }
+      return absl::OkStatus();
+    });
+  }
+  std::unique_ptr<UnionAllOp> union_all_op =
+      CreateUnionAllOfInt64s(a, std::move(inputs));
+
+  EvaluationOptions options;
+  options.max_parallelism = 2;
+  options.max_intermediate_byte_size = 3000;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      union_all_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                   &context));
+  // The inputs are not created before the first call to Next().
+  EXPECT_EQ(num_started, 0);
+  // The inputs and the consumer share the memory limit.
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(), 1000);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::vector<TupleData> data,
+                       ReadFromTupleIterator(iter.get()));
+  ASSERT_EQ(data.size(), 2);
+  EXPECT_EQ(data[0].slot(0).value(), Int64(1));
+  EXPECT_EQ(data[1].slot(0).value(), Int64(2));
+  EXPECT_THAT(input_byte_limits, ElementsAre(1000, 1000));
+  iter.reset();
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(), 3000);
+}
+
+TEST_F(CreateIteratorTest, ParallelUnionAllOpCancelsInputsWhenDestroyed) {
+  VariableId a("a"), a1("a1"), a2("a2");
+  std::vector<std::unique_ptr<TestRelationalOp>> inputs;
+  inputs.push_back(absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a1}, CreateTestTupleDatas({{Int64(1)}}),
+      /*preserves_order=*/true));
+  inputs.push_back(absl::make_unique<TestRelationalOp>(
+      std::vector<VariableId>{a2}, CreateTestTupleDatas({{Int64(2)}}),
+      /*preserves_order=*/true));
+  // The second input runs until it is cancelled.
+  absl::Notification second_input_started;
+  bool second_input_cancelled = false;
+  inputs[1]->set_create_iterator_cb([&](EvaluationContext* input_context) {
+    second_input_started.Notify();
+    const absl::Time deadline = absl::Now() + absl::Seconds(30);
+    while (absl::Now() < deadline) {
+      const absl::Status status = input_context->VerifyNotAborted();
+      if (!status.ok()) {
+        second_input_cancelled = true;
+        return status;
+      }
+      absl::SleepFor(absl::Milliseconds(1));
+    }
+    return absl::OkStatus();
+  });
+  std::unique_ptr<UnionAllOp> union_all_op =
+      CreateUnionAllOfInt64s(a, std::move(inputs));
+
+  EvaluationOptions options;
+  options.max_parallelism = 2;
+  EvaluationContext context(options);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleIterator> iter,
+      union_all_op->CreateIterator(EmptyParams(), /*num_extra_slots=*/0,
+                                   &context));
+  const TupleData* first = iter->Next();
+  ASSERT_NE(first, nullptr);
+  EXPECT_EQ(first->slot(0).value(), Int64(1));
+  second_input_started.WaitForNotification();
+  iter.reset();
+  EXPECT_TRUE(second_input_cancelled);
+  ZETASQL_EXPECT_OK(context.VerifyNotAborted());
+}
+
 TEST_F(CreateIteratorTest, ComputeOp) {
   VariableId a("a"), b("b"), param("param"), minus("minus"), plus("plus");
   std::vector<TupleData> test_values =
@@ -18,6 +18,8 @@
 #ifndef ZETASQL_REFERENCE_IMPL_TEST_RELATIONAL_OP_H_
 #define ZETASQL_REFERENCE_IMPL_TEST_RELATIONAL_OP_H_
 
+#include <functional>
+
 #include "zetasql/reference_impl/operator.h"
 #include "zetasql/reference_impl/tuple_test_util.h"
 
@@ -34,15 +36,26 @@ class TestRelationalOp : public RelationalOp {
   TestRelationalOp(const TestRelationalOp&) = delete;
   TestRelationalOp& operator=(const TestRelationalOp&) = delete;
 
+  // Sets a callback that CreateIteratorInternal() calls with its context before
+  // creating the iterator, e.g., to simulate an operator that reads its whole
+  // input there. An error from the callback is returned by CreateIterator().
+  void set_create_iterator_cb(
+      std::function<absl::Status(EvaluationContext*)> cb) {
+    create_iterator_cb_ = std::move(cb);
+  }
+
   absl::Status SetSchemasForEvaluation(
       absl::Span<const TupleSchema* const> params_schemas) override {
     // Eval() ignores the parameters.
     return absl::OkStatus();
   }
 
-  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIterator(
+  ::zetasql_base::StatusOr<std::unique_ptr<TupleIterator>> CreateIteratorInternal(
       absl::Span<const TupleData* const> /*params*/, int num_extra_slots,
       EvaluationContext* context) const override {
+    if (create_iterator_cb_ != nullptr) {
+      ZETASQL_RETURN_IF_ERROR(create_iterator_cb_(context));
+    }
     std::vector<TupleData> iter_values = values_;
     for (TupleData& data : iter_values) {
       ZETASQL_RET_CHECK_EQ(data.num_slots(), variables_.size());
@@ -63,6 +76,8 @@ class TestRelationalOp : public RelationalOp {
     return TestTupleIterator::GetDebugString();
   }
 
+  std::string OpName() const override { return "TestRelationalOp"; }
+
   std::string DebugInternal(const std::string& indent,
                             bool verbose) const override {
     return absl::StrCat("TestRelationalOp");
@@ -72,6 +87,7 @@ class TestRelationalOp : public RelationalOp {
   const std::vector<VariableId> variables_;
   const std::vector<TupleData> values_;
   const bool preserves_order_;
+  std::function<absl::Status(EvaluationContext*)> create_iterator_cb_;
 };
 
 }  // namespace zetasql
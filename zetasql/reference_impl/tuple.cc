@@ -17,12 +17,19 @@
 #include "zetasql/reference_impl/tuple.h"
 
 #include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <string>
+#include <vector>
 
 #include "zetasql/base/logging.h"
 #include "zetasql/public/value.h"
+#include "absl/base/casts.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/map_util.h"
 
 namespace zetasql {
@@ -62,14 +69,21 @@ std::string TupleSchema::DebugString() const {
 // TupleSlot
 // -------------------------------------------------------
 
+TupleSlot::SharedProtoState::~SharedProtoState() {
+  if (accountant != nullptr) {
+    accountant->ReturnBytes(offset_index_bytes);
+  }
+}
+
 int64_t TupleSlot::GetPhysicalByteSize() const {
   if (!value_.is_valid()) return sizeof(TupleSlot);
   int64_t num_bytes = value_.physical_byte_size() + sizeof(shared_proto_state_);
   if (shared_proto_state_ != nullptr) {
     num_bytes += sizeof(*shared_proto_state_);
-    if (shared_proto_state_->has_value()) {
-      num_bytes += sizeof(**shared_proto_state_);
-      for (const auto& entry : **shared_proto_state_) {
+    const absl::optional<ProtoFieldValueMap>& value_map =
+        shared_proto_state_->value_map;
+    if (value_map.has_value()) {
+      for (const auto& entry : *value_map) {
         num_bytes += sizeof(entry);
         const std::unique_ptr<ProtoFieldValueList>& values = entry.second;
         if (values != nullptr) {
@@ -151,6 +165,10 @@ absl::Status TupleDataDeque::SetSlot(int slot_idx, std::vector<Value> values) {
 
 void TupleDataDeque::Sort(const TupleComparator& comparator,
                           bool use_stable_sort) {
+  if (comparator.HasNormalizedKeys() &&
+      SortWithNormalizedKeys(comparator, use_stable_sort)) {
+    return;
+  }
   auto entry_comparator = [&comparator](const Entry& entry1,
                                         const Entry& entry2) {
     return comparator(entry1.second, entry2.second);
@@ -162,6 +180,242 @@ void TupleDataDeque::Sort(const TupleComparator& comparator,
   }
 }
 
+bool TupleDataDeque::SortWithNormalizedKeys(const TupleComparator& comparator,
+                                            bool use_stable_sort) {
+  // Identifies the normalized key of datas_[index] in 'key_bytes'. 'prefix'
+  // holds the first (up to) eight bytes of the key in big-endian order, padded
+  // with zeros, so that most comparisons only compare integers.
+  struct KeyEntry {
+    uint64_t prefix;
+    int64_t key_offset;
+    int64_t key_size;
+    int64_t index;
+  };
+
+  // The keys are charged to 'accountant_' as they are encoded, one request per
+  // tuple like PushBack(). If the accountant runs out of memory, the caller
+  // falls back to comparing Values, which needs no extra memory.
+  int64_t key_num_bytes = 0;
+  auto return_key_bytes = [this, &key_num_bytes]() {
+    accountant_->ReturnBytes(key_num_bytes);
+  };
+  std::string key_bytes;
+  std::vector<KeyEntry> key_entries;
+  key_entries.reserve(datas_.size());
+  for (int64_t i = 0; i < datas_.size(); ++i) {
+    const int64_t key_offset = key_bytes.size();
+    if (!comparator.AppendNormalizedKey(*datas_[i].second, &key_bytes)) {
+      return_key_bytes();
+      return false;
+    }
+    const int64_t byte_size =
+        key_bytes.size() - key_offset + sizeof(KeyEntry);
+    absl::Status status;
+    if (!accountant_->RequestBytes(byte_size, &status)) {
+      return_key_bytes();
+      return false;
+    }
+    key_num_bytes += byte_size;
+    KeyEntry entry;
+    entry.prefix = 0;
+    entry.key_offset = key_offset;
+    entry.key_size = key_bytes.size() - key_offset;
+    entry.index = i;
+    for (int j = 0; j < sizeof(uint64_t); ++j) {
+      entry.prefix <<= 8;
+      if (j < entry.key_size) {
+        entry.prefix |= static_cast<uint8_t>(key_bytes[key_offset + j]);
+      }
+    }
+    key_entries.push_back(entry);
+  }
+
+  const absl::string_view all_keys = key_bytes;
+  auto key_entry_comparator = [all_keys](const KeyEntry& entry1,
+                                         const KeyEntry& entry2) {
+    if (entry1.prefix != entry2.prefix) return entry1.prefix < entry2.prefix;
+    return all_keys.substr(entry1.key_offset, entry1.key_size) <
+           all_keys.substr(entry2.key_offset, entry2.key_size);
+  };
+  if (use_stable_sort) {
+    std::stable_sort(key_entries.begin(), key_entries.end(),
+                     key_entry_comparator);
+  } else {
+    std::sort(key_entries.begin(), key_entries.end(), key_entry_comparator);
+  }
+
+  std::deque<Entry> sorted_datas;
+  for (const KeyEntry& entry : key_entries) {
+    sorted_datas.push_back(std::move(datas_[entry.index]));
+  }
+  datas_.swap(sorted_datas);
+  return_key_bytes();
+  return true;
+}
+
+bool TupleDataTopN::Insert(std::unique_ptr<TupleData> data,
+                           absl::Status* status) {
+  const int64_t insertion_index = num_insertions_++;
+  if (capacity_ <= 0) return true;
+
+  const auto entry_less = [this](const Entry& entry1, const Entry& entry2) {
+    return EntryLess(entry1, entry2);
+  };
+  Entry entry{std::move(data), insertion_index, /*byte_size=*/0};
+  const bool is_full = heap_.size() >= capacity_;
+  // 'entry' was inserted last, so it does not displace an equal TupleData.
+  if (is_full && !EntryLess(entry, heap_.front())) return true;
+
+  entry.byte_size = entry.data->GetPhysicalByteSize() + sizeof(Entry);
+  if (!accountant_->RequestBytes(entry.byte_size, status)) {
+    return false;
+  }
+  if (is_full) {
+    std::pop_heap(heap_.begin(), heap_.end(), entry_less);
+    accountant_->ReturnBytes(heap_.back().byte_size);
+    heap_.back() = std::move(entry);
+  } else {
+    heap_.push_back(std::move(entry));
+  }
+  std::push_heap(heap_.begin(), heap_.end(), entry_less);
+  return true;
+}
+
+std::vector<std::unique_ptr<TupleData>> TupleDataTopN::ExtractSorted() {
+  std::sort_heap(heap_.begin(), heap_.end(),
+                 [this](const Entry& entry1, const Entry& entry2) {
+                   return EntryLess(entry1, entry2);
+                 });
+  std::vector<std::unique_ptr<TupleData>> sorted;
+  sorted.reserve(heap_.size());
+  for (Entry& entry : heap_) {
+    accountant_->ReturnBytes(entry.byte_size);
+    sorted.push_back(std::move(entry.data));
+  }
+  heap_.clear();
+  num_insertions_ = 0;
+  return sorted;
+}
+
+void TupleDataTopN::Clear() {
+  for (const Entry& entry : heap_) {
+    accountant_->ReturnBytes(entry.byte_size);
+  }
+  heap_.clear();
+  num_insertions_ = 0;
+}
+
+// -------------------------------------------------------
+// ValueHashSet
+// -------------------------------------------------------
+
+ValueHashSet::KeyKind ValueHashSet::GetKeyKind(TypeKind kind) {
+  switch (kind) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_BOOL:
+    case TYPE_DATE:
+    case TYPE_ENUM:
+      return KeyKind::kInt64;
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+      return KeyKind::kDouble;
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return KeyKind::kString;
+    default:
+      return KeyKind::kValue;
+  }
+}
+
+uint64_t ValueHashSet::GetDoubleKey(const Value& value) {
+  const double d = value.type_kind() == TYPE_FLOAT ? value.float_value()
+                                                   : value.double_value();
+  if (std::isnan(d)) {
+    return absl::bit_cast<uint64_t>(std::numeric_limits<double>::quiet_NaN());
+  }
+  // Maps -0.0 to 0.0.
+  return absl::bit_cast<uint64_t>(d == 0 ? 0.0 : d);
+}
+
+bool ValueHashSet::Insert(const Value& value, bool* inserted,
+                          absl::Status* status) {
+  *inserted = false;
+  if (key_kind_ == KeyKind::kUnknown && !value.is_null()) {
+    key_type_ = value.type();
+    key_kind_ = GetKeyKind(key_type_->kind());
+  }
+  const KeyKind key_kind =
+      !value.is_null() &&
+              (value.type() == key_type_ || value.type()->Equals(key_type_))
+          ? key_kind_
+          : KeyKind::kValue;
+
+  // For fixed-width keys, we insert the key before requesting its bytes (and
+  // erase it if the request fails) to only hash it once in the common case.
+  int64_t byte_size;
+  switch (key_kind) {
+    case KeyKind::kInt64: {
+      const int64_t key = value.type_kind() == TYPE_UINT64
+                              ? static_cast<int64_t>(value.uint64_value())
+                              : value.ToInt64();
+      if (!int64_keys_.insert(key).second) return true;
+      byte_size = sizeof(key);
+      if (!accountant_->RequestBytes(byte_size, status)) {
+        int64_keys_.erase(key);
+        return false;
+      }
+      break;
+    }
+    case KeyKind::kDouble: {
+      const uint64_t key = GetDoubleKey(value);
+      if (!double_keys_.insert(key).second) return true;
+      byte_size = sizeof(key);
+      if (!accountant_->RequestBytes(byte_size, status)) {
+        double_keys_.erase(key);
+        return false;
+      }
+      break;
+    }
+    case KeyKind::kString: {
+      const absl::string_view key = value.type_kind() == TYPE_STRING
+                                        ? value.string_value()
+                                        : value.bytes_value();
+      if (string_keys_.contains(key)) return true;
+      byte_size = sizeof(key) + value.physical_byte_size();
+      if (!accountant_->RequestBytes(byte_size, status)) return false;
+      // 'key' points into the string shared by all copies of 'value'.
+      string_values_.push_back(value);
+      string_keys_.insert(key);
+      break;
+    }
+    case KeyKind::kUnknown:
+    case KeyKind::kValue:
+      if (values_.contains(value)) return true;
+      byte_size = value.physical_byte_size();
+      if (!accountant_->RequestBytes(byte_size, status)) return false;
+      values_.insert(value);
+      break;
+  }
+  num_bytes_ += byte_size;
+  *inserted = true;
+  return true;
+}
+
+void ValueHashSet::Clear() {
+  accountant_->ReturnBytes(num_bytes_);
+  num_bytes_ = 0;
+  key_type_ = nullptr;
+  key_kind_ = KeyKind::kUnknown;
+  int64_keys_.clear();
+  double_keys_.clear();
+  string_keys_.clear();
+  string_values_.clear();
+  values_.clear();
+}
+
 // -------------------------------------------------------
 // ReorderingTupleIterator
 // -------------------------------------------------------
@@ -22,7 +22,6 @@
 #include <stddef.h>
 
 #include <iterator>
-#include <map>
 #include <memory>
 #include <string>
 #include <utility>
@@ -38,6 +37,7 @@
 #include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "zetasql/base/flat_set.h"
@@ -48,6 +48,8 @@
 
 namespace zetasql {
 
+class MemoryAccountant;
+
 // Stores the mapping of variables (which must all be distinct) to slots in a
 // tuple.
 class TupleSchema {
@@ -251,7 +253,31 @@ class TupleSlot {
   // call to GetFieldExpr::Eval() looks up the ProtoFieldValueMap entry (it
   // has all the information to construct the key) and uses the
   // ProtoFieldValueMap stored in that entry to determine the value of field2.
-  using SharedProtoState = absl::optional<ProtoFieldValueMap>;
+  //
+  // Proto Values may also be read through more than one FieldRegistry (e.g.,
+  // when the algebrizer cannot tell that two expressions have the same value).
+  // To avoid scanning the wire format of such a proto from the start for each
+  // later registry, the second read builds a ProtoFieldOffsetIndex for it,
+  // which is stored alongside the ProtoFieldValueMap and used by later reads to
+  // decode only the fields of their registries. The memory of the indexes is
+  // charged to 'accountant' until the SharedProtoState is destroyed.
+  struct SharedProtoState {
+    SharedProtoState() {}
+    SharedProtoState(const SharedProtoState&) = delete;
+    SharedProtoState& operator=(const SharedProtoState&) = delete;
+    // Returns 'offset_index_bytes' to 'accountant'.
+    ~SharedProtoState();
+
+    absl::optional<ProtoFieldValueMap> value_map;
+    absl::flat_hash_map<const InternalValue::ProtoRep*,
+                        std::unique_ptr<const ProtoFieldOffsetIndex>>
+        offset_indexes;
+    // Set when the first index is added to 'offset_indexes'. Only indexes
+    // charged to this accountant may be added.
+    std::shared_ptr<MemoryAccountant> accountant;
+    // The bytes of 'offset_indexes' requested from 'accountant'.
+    int64_t offset_index_bytes = 0;
+  };
 
   // For performance reasons, we only store SharedProtoState for PROTOs and
   // STRUCTs (which may contain protos).
@@ -690,94 +716,101 @@ class TupleDataDeque {
   // into the appropriate slots. Also updates the memory accountant accordingly.
   absl::Status SetSlot(int slot_idx, std::vector<Value> values);
 
-  // Sorts the deque using std::sort or std::stable_sort.
+  // Sorts the deque using std::sort or std::stable_sort. If
+  // 'comparator.HasNormalizedKeys()', sorts on normalized keys instead of
+  // comparing Values.
   void Sort(const TupleComparator& comparator, bool use_stable_sort);
 
  private:
   // Stores a TupleData and its memory size.
   using Entry = std::pair<int64_t, std::unique_ptr<TupleData>>;
 
+  // Implementation of Sort() for the case where 'comparator' has normalized
+  // keys. Encodes the normalized key of each TupleData once and sorts (key
+  // prefix, index) pairs, only comparing the rest of the keys when the
+  // prefixes are equal. The keys are charged to the MemoryAccountant while the
+  // sort runs. Returns false without modifying the deque if some TupleData
+  // cannot be encoded or the accountant runs out of memory for the keys.
+  bool SortWithNormalizedKeys(const TupleComparator& comparator,
+                              bool use_stable_sort);
+
   MemoryAccountant* accountant_;
 
   // Stores TupleDatas and their memory sizes.
   std::deque<Entry> datas_;
 };
 
-// Represents an ordered queue of TupleDatas whose memory usage is tracked by a
+// Retains the first 'capacity' TupleDatas (according to a TupleComparator) out
+// of all the TupleDatas passed to Insert(). Memory usage is tracked by a
 // MemoryAccountant, which is not owned by this object.
-class TupleDataOrderedQueue {
+//
+// The retained TupleDatas are stored in a contiguous max-heap whose root is the
+// last retained TupleData. Once the heap is full, a TupleData that does not
+// belong in the top 'capacity' is rejected with a single comparison, and one
+// that does replaces the root in O(log(capacity)) comparisons. Ties are broken
+// in favor of the TupleData that was inserted first.
+class TupleDataTopN {
  public:
-  TupleDataOrderedQueue(const TupleComparator& comparator,
-                        MemoryAccountant* accountant)
-      : accountant_(accountant),
-        entries_(Comparator(
-            [comparator](const TupleData* data1, const TupleData* data2) {
-              return comparator(*data1, *data2);
-            })) {}
+  TupleDataTopN(int64_t capacity, const TupleComparator& comparator,
+                MemoryAccountant* accountant)
+      : capacity_(capacity), comparator_(comparator), accountant_(accountant) {}
 
-  TupleDataOrderedQueue(const TupleDataOrderedQueue&) = delete;
-  TupleDataOrderedQueue& operator=(const TupleDataOrderedQueue&) = delete;
+  TupleDataTopN(const TupleDataTopN&) = delete;
+  TupleDataTopN& operator=(const TupleDataTopN&) = delete;
 
-  ~TupleDataOrderedQueue() { Clear(); }
+  ~TupleDataTopN() { Clear(); }
 
-  bool IsEmpty() const { return entries_.empty(); }
+  bool IsEmpty() const { return heap_.empty(); }
 
-  int64_t GetSize() const { return entries_.size(); }
+  int64_t GetSize() const { return heap_.size(); }
 
-  // Adds 'data' to the queue. Returns true on success. On failure, returns
-  // false and populates 'status'. Any modifications to 'data' while it is in
-  // this object are unaccounted for. This method does not return absl::Status
-  // for performance reasons.
-  bool Insert(std::unique_ptr<TupleData> data, absl::Status* status) {
-    const int64_t byte_size = data->GetPhysicalByteSize() +
-                            sizeof(std::pair<const TupleData*, ValueEntry>);
-    if (!accountant_->RequestBytes(byte_size, status)) {
-      return false;
-    }
-    TupleData* ptr = data.get();
-    entries_.emplace(ptr, std::make_pair(byte_size, std::move(data)));
-    return true;
-  }
+  // Offers 'data' to the top N, which drops either 'data' or the TupleData
+  // that 'data' displaces if there are already 'capacity' TupleDatas. Returns
+  // true on success. On failure, returns false and populates 'status'. Any
+  // modifications to 'data' while it is in this object are unaccounted
+  // for. This method does not return absl::Status for performance reasons.
+  bool Insert(std::unique_ptr<TupleData> data, absl::Status* status);
 
-  // Returns the first element of the queue, which must be non-empty.
-  std::unique_ptr<TupleData> PopFront() {
-    auto iter = entries_.begin();
-    ValueEntry value_entry = std::move(iter->second);
-    entries_.erase(iter);
-    accountant_->ReturnBytes(value_entry.first);
-    return std::move(value_entry.second);
-  }
+  // Returns the retained TupleDatas in order and clears this object.
+  std::vector<std::unique_ptr<TupleData>> ExtractSorted();
 
-  // Returns the last element of the queue, which must be non-empty.
-  std::unique_ptr<TupleData> PopBack() {
-    auto iter = entries_.end();
-    --iter;
-    ValueEntry value_entry = std::move(iter->second);
-    entries_.erase(iter);
-    accountant_->ReturnBytes(value_entry.first);
-    return std::move(value_entry.second);
-  }
+  // Drops all the retained TupleDatas.
+  void Clear();
 
-  // Clears the queue.
-  void Clear() {
-    while (!IsEmpty()) {
-      PopFront();
-    }
+ private:
+  struct Entry {
+    std::unique_ptr<TupleData> data;
+    // The number of calls to Insert() before the one that passed 'data'.
+    int64_t insertion_index;
+    // The memory reservation of 'data' for 'accountant_'.
+    int64_t byte_size;
+  };
+
+  // Returns true if 'entry1' comes before 'entry2' in the output.
+  bool EntryLess(const Entry& entry1, const Entry& entry2) const {
+    if (comparator_(*entry1.data, *entry2.data)) return true;
+    if (comparator_(*entry2.data, *entry1.data)) return false;
+    return entry1.insertion_index < entry2.insertion_index;
   }
 
- private:
+  const int64_t capacity_;
+  const TupleComparator comparator_;
   MemoryAccountant* accountant_;
-
-  using Comparator = std::function<bool(const TupleData*, const TupleData*)>;
-  // The key and value TupleData are the same. The int64_t is the memory
-  // reservation of the TupleData for 'accountant_'.
-  using ValueEntry = std::pair<int64_t, std::unique_ptr<TupleData>>;
-  // We use multimap because it is a sorted container that allows duplicates
-  // and allows us to associate a payload for each item.
-  std::multimap<const TupleData*, ValueEntry, Comparator> entries_;
+  int64_t num_insertions_ = 0;
+  // A max-heap with respect to EntryLess().
+  std::vector<Entry> heap_;
 };
 
 // Represents a hash set of values with memory tracked by a MemoryAccountant.
+//
+// Non-NULL values of simple types are stored as normalized keys instead of
+// Values, which avoids the type dispatch in hashing and comparing Values:
+// - Integers, BOOLs, DATEs and ENUMs are stored as int64_t.
+// - FLOATs and DOUBLEs are stored as the bits of a double, with a single
+//   representation for NaNs and for zeros (matching Value::Equals()).
+// - STRINGs and BYTES are stored as string_views into the inserted Values.
+// Normalized keys are only used for values of the type of the first non-NULL
+// value passed to Insert(). All other values are stored as Values.
 class ValueHashSet {
  public:
   explicit ValueHashSet(MemoryAccountant* accountant)
@@ -792,29 +825,37 @@ class ValueHashSet {
   // true. Otherwise requests bytes. If that succeeds, inserts 'value' into the
   // underlying set, sets 'inserted' to true, and returns false. Otherwise,
   // populates 'status' and returns false.
-  bool Insert(const Value& value, bool* inserted, absl::Status* status) {
-    *inserted = false;
-    if (values_.contains(value)) {
-      return true;
-    }
-    if (!accountant_->RequestBytes(value.physical_byte_size(), status)) {
-      return false;
-    }
-    values_.insert(value);
-    *inserted = true;
-    return true;
-  }
+  bool Insert(const Value& value, bool* inserted, absl::Status* status);
 
   // Clear the hash set.
-  void Clear() {
-    for (const Value& value : values_) {
-      accountant_->ReturnBytes(value.physical_byte_size());
-    }
-    values_.clear();
-  }
+  void Clear();
 
  private:
+  enum class KeyKind { kUnknown, kInt64, kDouble, kString, kValue };
+
+  // Returns the kind of normalized key used for values of 'kind'.
+  static KeyKind GetKeyKind(TypeKind kind);
+
+  // Returns the normalized key of 'value', which must be a non-NULL FLOAT or
+  // DOUBLE.
+  static uint64_t GetDoubleKey(const Value& value);
+
   MemoryAccountant* accountant_;
+  // The number of bytes requested from 'accountant_'.
+  int64_t num_bytes_ = 0;
+
+  // The type of the values that are stored as normalized keys of kind
+  // 'key_kind_'. NULL until the first non-NULL value is inserted.
+  const Type* key_type_ = nullptr;
+  KeyKind key_kind_ = KeyKind::kUnknown;
+
+  absl::flat_hash_set<int64_t> int64_keys_;
+  absl::flat_hash_set<uint64_t> double_keys_;
+  absl::flat_hash_set<absl::string_view> string_keys_;
+  // Keeps the strings that 'string_keys_' points to alive.
+  std::vector<Value> string_values_;
+
+  // The values that are not stored as normalized keys.
   absl::flat_hash_set<Value> values_;
 };
 
@@ -16,6 +16,8 @@
 
 #include "zetasql/reference_impl/tuple_comparator.h"
 
+#include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,6 +30,7 @@
 #include "zetasql/reference_impl/tuple.h"
 #include <cstdint>
 #include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 #include "zetasql/base/source_location.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/status_macros.h"
@@ -68,6 +71,25 @@ static absl::Status GetZetaSqlCollators(
   return absl::OkStatus();
 }
 
+// Returns true if values of 'type' have a normalized key encoding.
+static bool HasNormalizedKeyEncoding(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_BOOL:
+    case TYPE_DATE:
+    case TYPE_FLOAT:
+    case TYPE_DOUBLE:
+    case TYPE_STRING:
+    case TYPE_BYTES:
+      return true;
+    default:
+      return false;
+  }
+}
+
 zetasql_base::StatusOr<std::unique_ptr<TupleComparator>> TupleComparator::Create(
     absl::Span<const KeyArg* const> keys, absl::Span<const int> slots_for_keys,
     absl::Span<const TupleData* const> params, EvaluationContext* context) {
@@ -75,7 +97,18 @@ zetasql_base::StatusOr<std::unique_ptr<TupleComparator>> TupleComparator::Create
       std::make_shared<Collators>(Collators());
   ZETASQL_RETURN_IF_ERROR(
       GetZetaSqlCollators(keys, params, context, collators.get()));
-  return absl::WrapUnique(new TupleComparator(keys, slots_for_keys, collators));
+
+  bool has_normalized_keys = true;
+  for (int i = 0; i < keys.size(); ++i) {
+    const ZetaSqlCollator* collator = (*collators)[i].get();
+    if (!HasNormalizedKeyEncoding(keys[i]->type()) ||
+        (collator != nullptr && !collator->IsBinaryComparison())) {
+      has_normalized_keys = false;
+      break;
+    }
+  }
+  return absl::WrapUnique(new TupleComparator(keys, slots_for_keys, collators,
+                                              has_normalized_keys));
 }
 
 bool TupleComparator::operator()(const TupleData& t1,
@@ -133,6 +166,108 @@ bool TupleComparator::operator()(const TupleData& t1,
   return false;
 }
 
+// Appends the 'num_bytes' low-order bytes of 'value' to 'key' in big-endian
+// order, inverting each byte if 'invert' is true.
+static void AppendBigEndian(uint64_t value, int num_bytes, bool invert,
+                            std::string* key) {
+  for (int i = num_bytes - 1; i >= 0; --i) {
+    const uint8_t byte = static_cast<uint8_t>(value >> (8 * i));
+    key->push_back(static_cast<char>(invert ? ~byte : byte));
+  }
+}
+
+// Appends an encoding of 'str' that is memcmp()-comparable even when followed
+// by other keys: 0x00 bytes are escaped as 0x00 0xFF, and the string is
+// terminated by 0x00 0x01.
+static void AppendEscapedString(absl::string_view str, bool invert,
+                                std::string* key) {
+  const uint8_t mask = invert ? 0xFF : 0x00;
+  for (const char c : str) {
+    key->push_back(static_cast<char>(static_cast<uint8_t>(c) ^ mask));
+    if (c == '\0') key->push_back(static_cast<char>(0xFF ^ mask));
+  }
+  key->push_back(static_cast<char>(0x00 ^ mask));
+  key->push_back(static_cast<char>(0x01 ^ mask));
+}
+
+// Maps a floating point value to an unsigned integer of the same width with the
+// same order as Value::LessThan(). NaN sorts before everything else, and -0.0
+// is encoded as 0.0 because they are Equals().
+template <typename T, typename UInt>
+static UInt NormalizeFloatingPoint(T value) {
+  constexpr UInt kSignBit = UInt{1} << (sizeof(UInt) * 8 - 1);
+  if (std::isnan(value)) return 0;
+  if (value == 0) value = 0;
+  UInt bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits & kSignBit) != 0 ? ~bits : (bits | kSignBit);
+}
+
+bool TupleComparator::AppendNormalizedKey(const TupleData& tuple,
+                                          std::string* key) const {
+  DCHECK(has_normalized_keys_);
+  for (int i = 0; i < keys_.size(); ++i) {
+    const KeyArg* key_arg = keys_[i];
+    const Value& value = tuple.slot(slots_for_keys_[i]).value();
+
+    // The NULL marker is not inverted for descending keys because the NULL
+    // order is specified independently of the sort order.
+    const bool nulls_first =
+        key_arg->is_descending() ? key_arg->null_order() == KeyArg::kNullsFirst
+                                 : key_arg->null_order() != KeyArg::kNullsLast;
+    if (value.is_null()) {
+      key->push_back(nulls_first ? '\x00' : '\x02');
+      continue;
+    }
+    key->push_back('\x01');
+
+    const bool invert = key_arg->is_descending();
+    switch (value.type_kind()) {
+      case TYPE_INT32:
+        AppendBigEndian(static_cast<uint32_t>(value.int32_value()) ^ 0x80000000u,
+                        sizeof(int32_t), invert, key);
+        break;
+      case TYPE_INT64:
+        AppendBigEndian(static_cast<uint64_t>(value.int64_value()) ^
+                            0x8000000000000000ull,
+                        sizeof(int64_t), invert, key);
+        break;
+      case TYPE_UINT32:
+        AppendBigEndian(value.uint32_value(), sizeof(uint32_t), invert, key);
+        break;
+      case TYPE_UINT64:
+        AppendBigEndian(value.uint64_value(), sizeof(uint64_t), invert, key);
+        break;
+      case TYPE_BOOL:
+        AppendBigEndian(value.bool_value() ? 1 : 0, 1, invert, key);
+        break;
+      case TYPE_DATE:
+        AppendBigEndian(static_cast<uint32_t>(value.date_value()) ^ 0x80000000u,
+                        sizeof(int32_t), invert, key);
+        break;
+      case TYPE_FLOAT:
+        AppendBigEndian(
+            NormalizeFloatingPoint<float, uint32_t>(value.float_value()),
+            sizeof(uint32_t), invert, key);
+        break;
+      case TYPE_DOUBLE:
+        AppendBigEndian(
+            NormalizeFloatingPoint<double, uint64_t>(value.double_value()),
+            sizeof(uint64_t), invert, key);
+        break;
+      case TYPE_STRING:
+        AppendEscapedString(value.string_value(), invert, key);
+        break;
+      case TYPE_BYTES:
+        AppendEscapedString(value.bytes_value(), invert, key);
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
 bool TupleComparator::IsUniquelyOrdered(
     absl::Span<const TupleData* const> tuples,
     absl::Span<const int> slot_idxs_for_values) const {
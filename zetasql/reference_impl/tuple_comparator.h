@@ -18,6 +18,7 @@
 #define ZETASQL_REFERENCE_IMPL_TUPLE_COMPARATOR_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "zetasql/common/internal_value.h"
@@ -66,15 +67,31 @@ class TupleComparator {
 
   const std::vector<const KeyArg*>& keys() const { return keys_; }
 
+  // Returns true if the type of every key has a normalized key encoding (see
+  // AppendNormalizedKey()). This is false for collated strings unless the
+  // collation uses binary comparison, and for types other than integers,
+  // BOOL, DATE, FLOAT, DOUBLE, STRING, and BYTES.
+  bool HasNormalizedKeys() const { return has_normalized_keys_; }
+
+  // Appends the normalized key of 'tuple' to 'key'. For any two tuples t1 and
+  // t2, t1 < t2 according to operator() if and only if the normalized key of
+  // t1 is less than that of t2 in memcmp() order, so sorting on normalized
+  // keys avoids comparing Values. Returns false if some value in 'tuple' cannot
+  // be encoded, in which case the contents of 'key' are unspecified. Requires
+  // HasNormalizedKeys().
+  bool AppendNormalizedKey(const TupleData& tuple, std::string* key) const;
+
  private:
   using Collators = std::vector<std::unique_ptr<const ZetaSqlCollator>>;
 
   TupleComparator(absl::Span<const KeyArg* const> keys,
                   absl::Span<const int> slots_for_keys,
-                  std::shared_ptr<const Collators> collators)
+                  std::shared_ptr<const Collators> collators,
+                  bool has_normalized_keys)
       : keys_(keys.begin(), keys.end()),
         slots_for_keys_(slots_for_keys.begin(), slots_for_keys.end()),
-        collators_(collators) {}
+        collators_(collators),
+        has_normalized_keys_(has_normalized_keys) {}
 
   const std::vector<const KeyArg*> keys_;
   const std::vector<int> slots_for_keys_;
@@ -84,6 +101,7 @@ class TupleComparator {
   // compared based on their UTF-8 encoding.
   // We use std::shared_ptr<const ...> to allow the comparator to be copied.
   const std::shared_ptr<const Collators> collators_;
+  const bool has_normalized_keys_;
 };
 
 }  // namespace zetasql
@@ -16,6 +16,12 @@
 
 #include "zetasql/reference_impl/tuple.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
 #include "google/protobuf/descriptor.h"
 #include "zetasql/base/testing/status_matchers.h"
 #include "zetasql/reference_impl/operator.h"
@@ -92,7 +98,7 @@ TEST(TupleSlotTest, GetPhysicalByteSize) {
   value_list->push_back(Int64(20));
   ProtoFieldValueMap value_map;
   value_map.emplace(ProtoFieldValueMapKey(), std::move(value_list));
-  *shared_state = std::move(value_map);
+  shared_state->value_map = std::move(value_map);
   EXPECT_GT(shared_state_slot.GetPhysicalByteSize(), last_byte_size);
 }
 
@@ -409,9 +415,79 @@ TEST(TupleDataDeque, SetSlotTest) {
   }
 }
 
-TEST(TupleDataOrderedQueue, InsertAndPopTest) {
+TEST(TupleDataDeque, SortWithNormalizedKeysTest) {
+  VariableId k1("k1"), k2("k2"), k3("k3"), k4("k4");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k1,
+                       DerefExpr::Create(k1, DoubleType()));
+  KeyArg key_arg1(k3, std::move(deref_k1), KeyArg::kDescending);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> deref_k2,
+                       DerefExpr::Create(k2, StringType()));
+  KeyArg key_arg2(k4, std::move(deref_k2), KeyArg::kAscending,
+                  KeyArg::kNullsLast);
+
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key_arg1, &key_arg2},
+                              /*slots_for_keys=*/{0, 1},
+                              /*params=*/{}, &context));
+  EXPECT_TRUE(comparator->HasNormalizedKeys());
+
+  const std::vector<Value> doubles = {
+      NullDouble(), Double(0.0 / 0.0), Double(-1), Double(-0.0), Double(0),
+      Double(2.5)};
+  const std::vector<Value> strings = {NullString(), String(""), String("a"),
+                                      String(std::string("a\0", 2)),
+                                      String("ab"), String("b")};
+  std::vector<TupleData> datas;
+  for (int i = 0; i < 3; ++i) {
+    for (const Value& d : doubles) {
+      for (const Value& s : strings) {
+        datas.push_back(CreateTupleDataFromValues({d, s, Int64(datas.size())}));
+      }
+    }
+  }
+  // Start from a scrambled order.
+  std::reverse(datas.begin(), datas.begin() + datas.size() / 2);
+
+  MemoryAccountant accountant(/*total_num_bytes=*/1000000);
+  TupleDataDeque deque(&accountant);
+  for (const TupleData& data : datas) {
+    absl::Status status;
+    ASSERT_TRUE(deque.PushBack(absl::make_unique<TupleData>(data), &status));
+  }
+  // The keys are only charged to the accountant while sorting.
+  const int64_t remaining_bytes = accountant.remaining_bytes();
+  deque.Sort(*comparator, /*use_stable_sort=*/true);
+  EXPECT_EQ(accountant.remaining_bytes(), remaining_bytes);
+
+  // If there is no memory left for the keys, the Values are compared instead.
+  MemoryAccountant tight_accountant(
+      /*total_num_bytes=*/1000000 - remaining_bytes);
+  TupleDataDeque tight_deque(&tight_accountant);
+  for (const TupleData& data : datas) {
+    absl::Status status;
+    ASSERT_TRUE(
+        tight_deque.PushBack(absl::make_unique<TupleData>(data), &status));
+  }
+  EXPECT_EQ(tight_accountant.remaining_bytes(), 0);
+  tight_deque.Sort(*comparator, /*use_stable_sort=*/true);
+  EXPECT_EQ(tight_accountant.remaining_bytes(), 0);
+
+  std::stable_sort(datas.begin(), datas.end(), *comparator);
+  for (const TupleDataDeque* sorted_deque : {&deque, &tight_deque}) {
+    const std::vector<const TupleData*> sorted = sorted_deque->GetTuplePtrs();
+    ASSERT_EQ(sorted.size(), datas.size());
+    for (int i = 0; i < datas.size(); ++i) {
+      EXPECT_TRUE(sorted[i]->Equals(datas[i]))
+          << i << ": " << sorted[i]->DebugString() << " vs "
+          << datas[i].DebugString();
+    }
+  }
+}
+
+TEST(TupleDataTopN, InsertAndExtractTest) {
   VariableId k1("k1"), k2("k2");
-  TupleSchema schema({k1});
   ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
                        DerefExpr::Create(k1, Int64Type()));
   KeyArg key_arg(k2, std::move(key), KeyArg::kDescending);
@@ -423,64 +499,88 @@ TEST(TupleDataOrderedQueue, InsertAndPopTest) {
                               /*params=*/{}, &context));
 
   MemoryAccountant accountant(/*total_num_bytes=*/1000);
-  TupleDataOrderedQueue q(*comparator, &accountant);
+  TupleDataTopN top_n(/*capacity=*/3, *comparator, &accountant);
 
-  for (const bool pop_back : {false, true}) {
-    LOG(INFO) << "Testing with pop_back: " << pop_back;
+  // The second slot records the insertion order.
+  const std::vector<std::pair<int64_t, int64_t>> inputs = {
+      {5, 0}, {1, 1}, {7, 2}, {5, 3}, {2, 4}, {7, 5}, {9, 6}, {5, 7}};
+  absl::Status status;
+  for (const auto& input : inputs) {
+    ASSERT_TRUE(top_n.Insert(
+        absl::make_unique<TupleData>(CreateTupleDataFromValues(
+            {Int64(input.first), Int64(input.second)})),
+        &status));
+    EXPECT_LE(top_n.GetSize(), 3);
+  }
+  EXPECT_EQ(top_n.GetSize(), 3);
+  EXPECT_LT(accountant.remaining_bytes(), 1000);
 
-    // Insert a few tuples.
-    int num_tuples = 0;
-    while (true) {
-      EXPECT_EQ(q.IsEmpty(), num_tuples == 0);
-      EXPECT_EQ(q.GetSize(), num_tuples);
+  // Descending order, ties broken by insertion order.
+  const std::vector<std::unique_ptr<TupleData>> sorted = top_n.ExtractSorted();
+  EXPECT_TRUE(top_n.IsEmpty());
+  EXPECT_EQ(accountant.remaining_bytes(), 1000);
+  const std::vector<std::pair<int64_t, int64_t>> expected = {
+      {9, 6}, {7, 2}, {7, 5}};
+  ASSERT_EQ(sorted.size(), expected.size());
+  for (int i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(sorted[i]->slot(0).value(), Int64(expected[i].first));
+    EXPECT_EQ(sorted[i]->slot(1).value(), Int64(expected[i].second));
+  }
 
-      const int64_t remaining_bytes = accountant.remaining_bytes();
+  // Nothing is retained with a capacity of 0.
+  TupleDataTopN empty_top_n(/*capacity=*/0, *comparator, &accountant);
+  ASSERT_TRUE(empty_top_n.Insert(
+      absl::make_unique<TupleData>(CreateTupleDataFromValues({Int64(1)})),
+      &status));
+  EXPECT_TRUE(empty_top_n.IsEmpty());
+  EXPECT_EQ(accountant.remaining_bytes(), 1000);
+}
 
-      TupleData data = CreateTupleDataFromValues({Int64(num_tuples)});
+TEST(TupleDataTopN, OutOfMemoryTest) {
+  VariableId k1("k1"), k2("k2");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
+                       DerefExpr::Create(k1, Int64Type()));
+  KeyArg key_arg(k2, std::move(key), KeyArg::kAscending);
 
-      // The queue should reverse the order of the tuples.
-      absl::Status status;
-      if (!q.Insert(absl::make_unique<TupleData>(data), &status)) {
-        ASSERT_THAT(status, StatusIs(absl::StatusCode::kResourceExhausted));
-        EXPECT_EQ(remaining_bytes, accountant.remaining_bytes());
-        break;
-      }
+  EvaluationContext context((EvaluationOptions()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<TupleComparator> comparator,
+      TupleComparator::Create({&key_arg}, /*slots_for_keys=*/{0},
+                              /*params=*/{}, &context));
 
-      ++num_tuples;
+  MemoryAccountant accountant(/*total_num_bytes=*/1000);
+  TupleDataTopN top_n(/*capacity=*/1000, *comparator, &accountant);
 
-      EXPECT_LE(accountant.remaining_bytes() + sizeof(int64_t), remaining_bytes);
+  // Insert decreasing values so that every TupleData is retained.
+  int num_tuples = 0;
+  while (true) {
+    const int64_t remaining_bytes = accountant.remaining_bytes();
+    absl::Status status;
+    if (!top_n.Insert(absl::make_unique<TupleData>(
+                          CreateTupleDataFromValues({Int64(-num_tuples)})),
+                      &status)) {
+      ASSERT_THAT(status, StatusIs(absl::StatusCode::kResourceExhausted));
+      EXPECT_EQ(remaining_bytes, accountant.remaining_bytes());
+      break;
     }
+    ++num_tuples;
+  }
+  ASSERT_GE(num_tuples, 5);
+  EXPECT_EQ(top_n.GetSize(), num_tuples);
 
-    // Make sure a few tuples were inserted.
-    ASSERT_GE(num_tuples, 10);
-
-    for (int i = 0; i < num_tuples; ++i) {
-      ASSERT_FALSE(q.IsEmpty());
-      const int64_t remaining_bytes = accountant.remaining_bytes();
-
-      if (pop_back) {
-        std::unique_ptr<TupleData> data = q.PopBack();
-        ASSERT_EQ(data->num_slots(), 1);
-        EXPECT_EQ(data->slot(0).value(), Int64(i));
-      } else {
-        std::unique_ptr<TupleData> data = q.PopFront();
-        ASSERT_EQ(data->num_slots(), 1);
-        EXPECT_EQ(data->slot(0).value(), Int64(num_tuples - 1 - i));
-      }
-
-      EXPECT_GE(accountant.remaining_bytes(), remaining_bytes + sizeof(int64_t));
-    }
 
-    EXPECT_TRUE(q.IsEmpty());
-    EXPECT_EQ(accountant.remaining_bytes(), 1000);
+  const std::vector<std::unique_ptr<TupleData>> sorted = top_n.ExtractSorted();
+  ASSERT_EQ(sorted.size(), num_tuples);
+  for (int i = 0; i < num_tuples; ++i) {
+    EXPECT_EQ(sorted[i]->slot(0).value(), Int64(i - num_tuples + 1));
   }
+  EXPECT_EQ(accountant.remaining_bytes(), 1000);
 }
 
-TEST(TupleDataOrderedQueue, DestructorTest) {
+TEST(TupleDataTopN, DestructorTest) {
   MemoryAccountant accountant(/*total_num_bytes=*/1000);
   {
     VariableId k1("k1"), k2("k2");
-    TupleSchema schema({k1});
     ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<ValueExpr> key,
                          DerefExpr::Create(k1, Int64Type()));
     KeyArg key_arg(k2, std::move(key), KeyArg::kAscending);
@@ -491,12 +591,13 @@ TEST(TupleDataOrderedQueue, DestructorTest) {
         TupleComparator::Create({&key_arg}, /*slots_for_keys=*/{0},
                                 /*params=*/{}, &context));
 
-    TupleDataOrderedQueue q(*comparator, &accountant);
+    TupleDataTopN top_n(/*capacity=*/2, *comparator, &accountant);
     TupleData data = CreateTupleDataFromValues({Int64(10)});
     absl::Status status;
-    ASSERT_TRUE(q.Insert(absl::make_unique<TupleData>(data), &status));
-    ASSERT_TRUE(q.Insert(absl::make_unique<TupleData>(data), &status));
-    ASSERT_TRUE(q.Insert(absl::make_unique<TupleData>(data), &status));
+    ASSERT_TRUE(top_n.Insert(absl::make_unique<TupleData>(data), &status));
+    ASSERT_TRUE(top_n.Insert(absl::make_unique<TupleData>(data), &status));
+    ASSERT_TRUE(top_n.Insert(absl::make_unique<TupleData>(data), &status));
+    EXPECT_EQ(top_n.GetSize(), 2);
     EXPECT_LT(accountant.remaining_bytes(), 1000);
   }
   EXPECT_EQ(accountant.remaining_bytes(), 1000);
@@ -538,6 +639,48 @@ TEST(ValueHashSet, BasicTest) {
   EXPECT_EQ(accountant.remaining_bytes(), 1000);
 }
 
+TEST(ValueHashSet, NormalizedKeysTest) {
+  MemoryAccountant accountant(/*total_num_bytes=*/10000);
+  ValueHashSet set(&accountant);
+
+  // Returns whether 'value' was inserted.
+  auto insert = [&set](const Value& value) {
+    bool inserted;
+    absl::Status status;
+    EXPECT_TRUE(set.Insert(value, &inserted, &status)) << status;
+    return inserted;
+  };
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  EXPECT_TRUE(insert(values::Double(nan)));
+  EXPECT_FALSE(insert(values::Double(-nan)));
+  EXPECT_TRUE(insert(values::Double(0.0)));
+  EXPECT_FALSE(insert(values::Double(-0.0)));
+  EXPECT_TRUE(insert(values::Double(1.5)));
+  EXPECT_FALSE(insert(values::Double(1.5)));
+  // Values of other types are never equal to the DOUBLEs.
+  EXPECT_TRUE(insert(values::Float(1.5)));
+  EXPECT_TRUE(insert(values::NullDouble()));
+  EXPECT_FALSE(insert(values::NullDouble()));
+  EXPECT_TRUE(insert(values::NullInt64()));
+  set.Clear();
+  EXPECT_EQ(accountant.remaining_bytes(), 10000);
+
+  EXPECT_TRUE(insert(values::Uint64(std::numeric_limits<uint64_t>::max())));
+  EXPECT_TRUE(insert(values::Uint64(0)));
+  EXPECT_FALSE(insert(values::Uint64(std::numeric_limits<uint64_t>::max())));
+  EXPECT_TRUE(insert(values::Int64(-1)));
+  set.Clear();
+
+  EXPECT_TRUE(insert(values::String("foo")));
+  EXPECT_FALSE(insert(values::String(std::string("fo") + "o")));
+  EXPECT_TRUE(insert(values::String("")));
+  EXPECT_TRUE(insert(values::Bytes("foo")));
+  EXPECT_FALSE(insert(values::Bytes("foo")));
+  set.Clear();
+  EXPECT_EQ(accountant.remaining_bytes(), 10000);
+}
+
 TEST(ValueHashSet, DestructorTest) {
   MemoryAccountant accountant(/*total_num_bytes=*/1000);
   {
@@ -157,6 +157,9 @@ inline std::vector<TupleData> CreateTestTupleDatas(
 // Matches a std::shared_pointer<SharedProtoState> against its raw pointer.
 MATCHER_P(HasRawPointer, raw_pointer, "") { return arg.get() == raw_pointer; }
 
+// Matches a SharedProtoState that does not store any proto field values.
+MATCHER(HasNoFieldValues, "") { return !arg.value_map.has_value(); }
+
 // Teach googletest how to print TupleSlots.
 void PrintTo(const TupleSlot& slot, std::ostream* os) {
   std::shared_ptr<TupleSlot::SharedProtoState> shared_state =
@@ -42,6 +42,7 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/bytecode.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/operator.h"
 #include "zetasql/reference_impl/parameters.h"
@@ -237,25 +238,25 @@ bool NewArrayExpr::Eval(absl::Span<const TupleData* const> params,
                         EvaluationContext* context, VirtualTupleSlot* result,
                         absl::Status* status) const {
   int64_t values_size = 0;
-  std::vector<Value> values(elements().size());
+  Value::ArrayBuilder builder(output_type()->AsArray(), elements().size());
   for (int i = 0; i < elements().size(); ++i) {
-    Value* element = &values[i];
+    Value element;
     std::shared_ptr<TupleSlot::SharedProtoState> element_shared_state;
-    VirtualTupleSlot element_result(element, &element_shared_state);
+    VirtualTupleSlot element_result(&element, &element_shared_state);
     if (!elements()[i]->value_expr()->Eval(params, context, &element_result,
                                            status)) {
       return false;
     }
-    values_size += element->physical_byte_size();
+    values_size += element.physical_byte_size();
     if (values_size >= context->options().max_value_byte_size) {
       *status = zetasql_base::OutOfRangeErrorBuilder()
                 << "Cannot construct array Value larger than "
                 << context->options().max_value_byte_size << " bytes";
       return false;
     }
+    builder.Add(std::move(element));
   }
-  result->SetValue(
-      Value::UnsafeArray(output_type()->AsArray(), std::move(values)));
+  result->SetValue(builder.Build());
   return true;
 }
 
@@ -347,13 +348,14 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
   if (is_with_table_) {
     accountant = context->memory_accountant();
   }
-  std::vector<Value> output;
-  std::function<void()> return_bytes = [accountant, &output]() {
+  Value::ArrayBuilder output(output_type()->AsArray());
+  // The bytes requested from 'accountant' for the elements of 'output'.
+  int64_t accounted_byte_size = 0;
+  std::function<void()> return_bytes = [accountant, &accounted_byte_size]() {
     if (accountant != nullptr) {
-      for (const Value& value : output) {
-        accountant->ReturnBytes(value.physical_byte_size());
-      }
+      accountant->ReturnBytes(accounted_byte_size);
     }
+    accounted_byte_size = 0;
   };
   // If we fail early, return the accumulated bytes.
   auto cleanup = zetasql_base::MakeCleanup(return_bytes);
@@ -386,9 +388,10 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
       if (!accountant->RequestBytes(value.physical_byte_size(), status)) {
         return false;
       }
+      accounted_byte_size += value.physical_byte_size();
     }
 
-    output.push_back(std::move(value));
+    output.Add(std::move(value));
   }
 
   // Free the memory. Ideally we would not do this here and instead do it when
@@ -396,11 +399,9 @@ bool ArrayNestExpr::Eval(absl::Span<const TupleData* const> params,
   // to easily hold a MemoryAccountant reservation after this method returns. So
   // as a hack, we free the memory here and re-reserve it in the LetOp/LetExpr
   // that ends up holding the WITH table.
-  return_bytes();
-  result->SetValue(InternalValue::ArrayNotChecked(
-      output_type()->AsArray(), iter_originally_preserved_order,
-      std::move(output)));  // Invalidates 'output' (and therefore 'cleanup').
-  output.clear();           // Nothing for 'cleanup' to do.
+  return_bytes();  // Nothing left for 'cleanup' to do.
+  result->SetValue(
+      InternalValue::BuildArray(&output, iter_originally_preserved_order));
   return true;
 }
 
@@ -466,6 +467,16 @@ bool DerefExpr::Eval(absl::Span<const TupleData* const> params,
   return true;
 }
 
+bool DerefExpr::AppendBytecode(BytecodeBuilder* builder,
+                               int* result_reg) const {
+  DCHECK(idx_in_params_ >= 0 && slot_ >= 0)
+      << "You forgot to call SetSchemasForEvaluation() " << name_;
+  if (!BytecodeBuilder::IsSupportedType(output_type())) return false;
+  *result_reg =
+      builder->EmitLoad(output_type()->kind(), idx_in_params_, slot_);
+  return true;
+}
+
 std::string DerefExpr::DebugInternal(const std::string& indent,
                                      bool verbose) const {
   return verbose ? absl::StrCat("DerefExpr(", name().ToString(), ")")
@@ -497,6 +508,14 @@ bool ConstExpr::Eval(absl::Span<const TupleData* const> /* params */,
   return true;
 }
 
+bool ConstExpr::AppendBytecode(BytecodeBuilder* builder,
+                               int* result_reg) const {
+  const int reg = builder->AddConstant(value());
+  if (reg < 0) return false;
+  *result_reg = reg;
+  return true;
+}
+
 std::string ConstExpr::DebugInternal(const std::string& indent,
                                      bool verbose) const {
   return absl::StrCat("ConstExpr(", value().DebugString(verbose), ")");
@@ -579,6 +598,57 @@ ValueExpr* FieldValueExpr::mutable_input() {
 // ProtoFieldReader
 // -------------------------------------------------------
 
+bool ProtoFieldReader::GetOffsetIndex(
+    const Value& proto_value, const ProtoFieldValueMapKey& value_map_key,
+    EvaluationContext* context, TupleSlot::SharedProtoState* shared_state,
+    const ProtoFieldOffsetIndex** offset_index, absl::Status* status) {
+  *offset_index = nullptr;
+  const auto it = shared_state->offset_indexes.find(value_map_key.proto_rep);
+  if (it != shared_state->offset_indexes.end()) {
+    *offset_index = it->second.get();
+    return true;
+  }
+
+  // The first read scans the proto once either way, so only index it when
+  // another registry has already read it.
+  if (!shared_state->value_map.has_value()) return true;
+  bool read_by_other_registry = false;
+  for (const auto& entry : *shared_state->value_map) {
+    if (entry.first.proto_rep == value_map_key.proto_rep &&
+        entry.first.registry != value_map_key.registry) {
+      read_by_other_registry = true;
+      break;
+    }
+  }
+  if (!read_by_other_registry) return true;
+  if (shared_state->accountant != nullptr &&
+      shared_state->accountant != context->shared_memory_accountant()) {
+    return true;
+  }
+
+  zetasql_base::StatusOr<std::unique_ptr<const ProtoFieldOffsetIndex>>
+      status_or_index = ProtoFieldOffsetIndex::Create(
+          proto_value.type()->AsProto()->descriptor(), proto_value.ToCord());
+  if (!status_or_index.ok()) {
+    *status = status_or_index.status();
+    return false;
+  }
+  std::unique_ptr<const ProtoFieldOffsetIndex> index =
+      std::move(status_or_index).value();
+  const int64_t byte_size = index->GetPhysicalByteSize();
+  absl::Status request_status;
+  if (!context->memory_accountant()->RequestBytes(byte_size,
+                                                  &request_status)) {
+    // The index is only an optimization, so read the proto without it.
+    return true;
+  }
+  shared_state->accountant = context->shared_memory_accountant();
+  shared_state->offset_index_bytes += byte_size;
+  *offset_index = index.get();
+  shared_state->offset_indexes[value_map_key.proto_rep] = std::move(index);
+  return true;
+}
+
 bool ProtoFieldReader::GetFieldValue(const TupleSlot& proto_slot,
                                      EvaluationContext* context,
                                      Value* field_value,
@@ -615,10 +685,10 @@ bool ProtoFieldReader::GetFieldValue(const TupleSlot& proto_slot,
   std::unique_ptr<ProtoFieldValueList> value_list_owner;
   std::shared_ptr<TupleSlot::SharedProtoState>& shared_state =
       *proto_slot.mutable_shared_proto_state();
+  absl::optional<ProtoFieldValueMap>& value_map = shared_state->value_map;
   const std::unique_ptr<ProtoFieldValueList>* existing_value_list =
-      shared_state->has_value()
-          ? FindOrNull(shared_state->value(), value_map_key)
-          : nullptr;
+      value_map.has_value() ? FindOrNull(value_map.value(), value_map_key)
+                            : nullptr;
   const ProtoFieldValueList* value_list =
       existing_value_list == nullptr ? nullptr : existing_value_list->get();
   if (value_list == nullptr) {
@@ -636,8 +706,18 @@ bool ProtoFieldReader::GetFieldValue(const TupleSlot& proto_slot,
     value_list_owner = absl::make_unique<ProtoFieldValueList>();
     value_list = value_list_owner.get();
 
-    const absl::Status read_status = ReadProtoFields(
-        field_infos, proto_value.ToCord(), value_list_owner.get());
+    const ProtoFieldOffsetIndex* offset_index = nullptr;
+    if (context->options().store_proto_field_value_maps &&
+        !GetOffsetIndex(proto_value, value_map_key, context,
+                        shared_state.get(), &offset_index, status)) {
+      return false;
+    }
+    const absl::Status read_status =
+        offset_index != nullptr
+            ? ReadProtoFields(field_infos, *offset_index,
+                              value_list_owner.get())
+            : ReadProtoFields(field_infos, proto_value.ToCord(),
+                              value_list_owner.get());
     if (!read_status.ok()) {
       *status = read_status;
       return false;
@@ -646,10 +726,10 @@ bool ProtoFieldReader::GetFieldValue(const TupleSlot& proto_slot,
     // Store 'value_list' in 'proto_slot' if
     // EvaluationOptions::store_proto_field_value_maps is true.
     if (context->options().store_proto_field_value_maps) {
-      if (!shared_state->has_value()) {
-        *shared_state = ProtoFieldValueMap();
+      if (!value_map.has_value()) {
+        value_map = ProtoFieldValueMap();
       }
-      (shared_state->value())[value_map_key] = std::move(value_list_owner);
+      (*value_map)[value_map_key] = std::move(value_list_owner);
     }
   }
 
@@ -869,6 +949,234 @@ RelationalOp* ExistsExpr::mutable_input() {
   return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
 }
 
+// -------------------------------------------------------
+// MemoizedExpr
+// -------------------------------------------------------
+
+namespace {
+
+// The cached result of a MemoizedExpr.
+struct MemoizedValue : public EvaluationCacheEntry {
+  TupleSlot slot;
+};
+
+}  // namespace
+
+::zetasql_base::StatusOr<std::unique_ptr<MemoizedExpr>> MemoizedExpr::Create(
+    std::unique_ptr<ValueExpr> value) {
+  return absl::WrapUnique(new MemoizedExpr(std::move(value)));
+}
+
+absl::Status MemoizedExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  return mutable_value()->SetSchemasForEvaluation(params_schemas);
+}
+
+bool MemoizedExpr::Eval(absl::Span<const TupleData* const> params,
+                        EvaluationContext* context, VirtualTupleSlot* result,
+                        absl::Status* status) const {
+  const EvaluationCacheEntry* entry = context->GetCachedData(this);
+  if (entry != nullptr) {
+    result->CopyFromSlot(static_cast<const MemoizedValue*>(entry)->slot);
+    return true;
+  }
+
+  auto memoized = absl::make_unique<MemoizedValue>();
+  if (!value()->EvalSimple(params, context, &memoized->slot, status)) {
+    return false;
+  }
+  result->CopyFromSlot(memoized->slot);
+
+  const int64_t byte_size = memoized->slot.GetPhysicalByteSize();
+  absl::Status memory_status;
+  if (context->memory_accountant()->RequestBytes(byte_size, &memory_status)) {
+    context->AddCachedData(this, std::move(memoized), byte_size);
+  }
+  return true;
+}
+
+std::string MemoizedExpr::DebugInternal(const std::string& indent,
+                                        bool verbose) const {
+  return absl::StrCat("MemoizedExpr(",
+                      ArgDebugString({"value"}, {k1}, indent, verbose), ")");
+}
+
+MemoizedExpr::MemoizedExpr(std::unique_ptr<ValueExpr> value)
+    : ValueExpr(value->output_type()) {
+  SetArg(kValue, absl::make_unique<ExprArg>(std::move(value)));
+}
+
+const ValueExpr* MemoizedExpr::value() const {
+  return GetArg(kValue)->node()->AsValueExpr();
+}
+
+ValueExpr* MemoizedExpr::mutable_value() {
+  return GetMutableArg(kValue)->mutable_node()->AsMutableValueExpr();
+}
+
+// -------------------------------------------------------
+// HashInExpr
+// -------------------------------------------------------
+
+namespace {
+
+// The values of the haystack of a HashInExpr.
+struct HashInHaystack : public EvaluationCacheEntry {
+  // The distinct non-NULL values.
+  absl::flat_hash_set<Value> values;
+  bool is_empty = true;
+  bool has_null = false;
+};
+
+}  // namespace
+
+bool HashInExpr::SupportsType(const Type* type) {
+  switch (type->kind()) {
+    case TYPE_INT32:
+    case TYPE_INT64:
+    case TYPE_UINT32:
+    case TYPE_UINT64:
+    case TYPE_BOOL:
+    case TYPE_STRING:
+    case TYPE_BYTES:
+    case TYPE_DATE:
+    case TYPE_ENUM:
+      return true;
+    default:
+      return false;
+  }
+}
+
+::zetasql_base::StatusOr<std::unique_ptr<HashInExpr>> HashInExpr::Create(
+    std::unique_ptr<ValueExpr> needle, std::unique_ptr<ValueExpr> haystack,
+    std::unique_ptr<RelationalOp> input) {
+  ZETASQL_RET_CHECK(SupportsType(needle->output_type()));
+  ZETASQL_RET_CHECK(needle->output_type()->Equals(haystack->output_type()));
+  return absl::WrapUnique(
+      new HashInExpr(std::move(needle), std::move(haystack), std::move(input)));
+}
+
+absl::Status HashInExpr::SetSchemasForEvaluation(
+    absl::Span<const TupleSchema* const> params_schemas) {
+  ZETASQL_RETURN_IF_ERROR(mutable_needle()->SetSchemasForEvaluation(params_schemas));
+  ZETASQL_RETURN_IF_ERROR(mutable_input()->SetSchemasForEvaluation(params_schemas));
+  const std::unique_ptr<const TupleSchema> input_schema =
+      input()->CreateOutputSchema();
+  return mutable_haystack()->SetSchemasForEvaluation(
+      ConcatSpans(params_schemas, {input_schema.get()}));
+}
+
+bool HashInExpr::Eval(absl::Span<const TupleData* const> params,
+                      EvaluationContext* context, VirtualTupleSlot* result,
+                      absl::Status* status) const {
+  TupleSlot needle_slot;
+  if (!needle()->EvalSimple(params, context, &needle_slot, status)) {
+    return false;
+  }
+
+  const HashInHaystack* cached =
+      static_cast<const HashInHaystack*>(context->GetCachedData(this));
+  if (cached == nullptr) {
+    auto status_or_iter =
+        input()->CreateIterator(params, /*num_extra_slots=*/0, context);
+    if (!status_or_iter.ok()) {
+      *status = status_or_iter.status();
+      return false;
+    }
+    std::unique_ptr<TupleIterator> iter = std::move(status_or_iter).value();
+
+    auto new_haystack = absl::make_unique<HashInHaystack>();
+    int64_t byte_size = 0;
+    auto cleanup = zetasql_base::MakeCleanup([context, &byte_size] {
+      context->memory_accountant()->ReturnBytes(byte_size);
+    });
+    while (true) {
+      const TupleData* tuple = iter->Next();
+      if (tuple == nullptr) {
+        *status = iter->Status();
+        if (!status->ok()) return false;
+        break;
+      }
+      new_haystack->is_empty = false;
+
+      TupleSlot slot;
+      if (!haystack()->EvalSimple(ConcatSpans(params, {tuple}), context, &slot,
+                                  status)) {
+        return false;
+      }
+      const Value& value = slot.value();
+      if (value.is_null()) {
+        new_haystack->has_null = true;
+        continue;
+      }
+      if (new_haystack->values.contains(value)) continue;
+      const int64_t value_byte_size = value.physical_byte_size();
+      if (!context->memory_accountant()->RequestBytes(value_byte_size,
+                                                      status)) {
+        return false;
+      }
+      byte_size += value_byte_size;
+      new_haystack->values.insert(value);
+    }
+    cached = new_haystack.get();
+    context->AddCachedData(this, std::move(new_haystack), byte_size);
+    byte_size = 0;
+  }
+
+  const Value& needle_value = needle_slot.value();
+  if (cached->is_empty) {
+    result->SetValue(Bool(false));
+  } else if (needle_value.is_null()) {
+    result->SetValue(Value::NullBool());
+  } else if (cached->values.contains(needle_value)) {
+    result->SetValue(Bool(true));
+  } else {
+    result->SetValue(cached->has_null ? Value::NullBool() : Bool(false));
+  }
+  return true;
+}
+
+std::string HashInExpr::DebugInternal(const std::string& indent,
+                                      bool verbose) const {
+  return absl::StrCat("HashInExpr(",
+                      ArgDebugString({"needle", "haystack", "input"},
+                                     {k1, k1, k1}, indent, verbose),
+                      ")");
+}
+
+HashInExpr::HashInExpr(std::unique_ptr<ValueExpr> needle,
+                       std::unique_ptr<ValueExpr> haystack,
+                       std::unique_ptr<RelationalOp> input)
+    : ValueExpr(types::BoolType()) {
+  SetArg(kNeedle, absl::make_unique<ExprArg>(std::move(needle)));
+  SetArg(kHaystack, absl::make_unique<ExprArg>(std::move(haystack)));
+  SetArg(kInput, absl::make_unique<RelationalArg>(std::move(input)));
+}
+
+const ValueExpr* HashInExpr::needle() const {
+  return GetArg(kNeedle)->node()->AsValueExpr();
+}
+
+ValueExpr* HashInExpr::mutable_needle() {
+  return GetMutableArg(kNeedle)->mutable_node()->AsMutableValueExpr();
+}
+
+const ValueExpr* HashInExpr::haystack() const {
+  return GetArg(kHaystack)->node()->AsValueExpr();
+}
+
+ValueExpr* HashInExpr::mutable_haystack() {
+  return GetMutableArg(kHaystack)->mutable_node()->AsMutableValueExpr();
+}
+
+const RelationalOp* HashInExpr::input() const {
+  return GetArg(kInput)->node()->AsRelationalOp();
+}
+
+RelationalOp* HashInExpr::mutable_input() {
+  return GetMutableArg(kInput)->mutable_node()->AsMutableRelationalOp();
+}
+
 // -------------------------------------------------------
 // ScalarFunctionCallExpr
 // -------------------------------------------------------
@@ -919,6 +1227,20 @@ bool ScalarFunctionCallExpr::Eval(absl::Span<const TupleData* const> params,
   return true;
 }
 
+bool ScalarFunctionCallExpr::AppendBytecode(BytecodeBuilder* builder,
+                                            int* result_reg) const {
+  // Errors, including those suppressed by 'error_mode_', make the bytecode
+  // fall back to Eval(), so the error mode needs no special handling here.
+  std::vector<int> arg_regs;
+  arg_regs.reserve(GetArgs().size());
+  for (const AlgebraArg* arg : GetArgs()) {
+    int arg_reg;
+    if (!arg->value_expr()->AppendBytecode(builder, &arg_reg)) return false;
+    arg_regs.push_back(arg_reg);
+  }
+  return function_->AppendBytecode(arg_regs, builder, result_reg);
+}
+
 std::string ScalarFunctionCallExpr::DebugInternal(const std::string& indent,
                                                   bool verbose) const {
   std::vector<std::string> sarg;
@@ -1123,6 +1445,38 @@ bool IfExpr::Eval(absl::Span<const TupleData* const> params,
   }
 }
 
+bool IfExpr::AppendBytecode(BytecodeBuilder* builder, int* result_reg) const {
+  if (!BytecodeBuilder::IsSupportedType(output_type())) return false;
+  int condition_reg;
+  if (!join_expr()->AppendBytecode(builder, &condition_reg) ||
+      builder->register_kind(condition_reg) != TYPE_BOOL) {
+    return false;
+  }
+  const TypeKind kind = output_type()->kind();
+  *result_reg = builder->AllocateRegister(kind);
+
+  // Like Eval(), only evaluates the branch selected by the condition.
+  const int jump_to_false = builder->EmitJump(
+      BytecodeOpcode::kJumpIfNotTrue, condition_reg);
+  int true_reg;
+  if (!true_value()->AppendBytecode(builder, &true_reg) ||
+      builder->register_kind(true_reg) != kind) {
+    return false;
+  }
+  builder->Emit(BytecodeOpcode::kMove, *result_reg, true_reg);
+  const int jump_to_end = builder->EmitJump(BytecodeOpcode::kJump);
+
+  builder->BindJumpToNextInstruction(jump_to_false);
+  int false_reg;
+  if (!false_value()->AppendBytecode(builder, &false_reg) ||
+      builder->register_kind(false_reg) != kind) {
+    return false;
+  }
+  builder->Emit(BytecodeOpcode::kMove, *result_reg, false_reg);
+  builder->BindJumpToNextInstruction(jump_to_end);
+  return true;
+}
+
 std::string IfExpr::DebugInternal(const std::string& indent,
                                   bool verbose) const {
   return absl::StrCat("IfExpr(",
@@ -1523,6 +1877,30 @@ static absl::Status EvalRelationalOp(
   return absl::OkStatus();
 }
 
+// Evaluates 'op' on 'params' and calls 'fn' on each output tuple. Unlike
+// EvalRelationalOp(), this does not copy the tuples, which are only valid during
+// the call to 'fn'. This allows DML statements that only return the modified
+// rows to use memory proportional to the number of modified rows.
+static absl::Status ForEachTuple(
+    const RelationalOp& op, absl::Span<const TupleData* const> params,
+    EvaluationContext* context,
+    const std::function<absl::Status(const Tuple&)>& fn) {
+  ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<TupleIterator> iter,
+                   op.CreateIterator(params, /*num_extra_slots=*/0, context));
+  // See EvalRelationalOp() for why we disable reordering.
+  ZETASQL_RETURN_IF_ERROR(iter->DisableReordering());
+  while (true) {
+    const TupleData* data = iter->Next();
+    if (data == nullptr) {
+      return iter->Status();
+    }
+    // It is expensive to call this for every row, but this code is only used
+    // for compliance testing, so it's ok.
+    ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
+    ZETASQL_RETURN_IF_ERROR(fn(Tuple(&iter->Schema(), data)));
+  }
+}
+
 // -------------------------------------------------------
 // DMLDeleteValueExpr
 // -------------------------------------------------------
@@ -1575,36 +1953,28 @@ absl::Status DMLDeleteValueExpr::SetSchemasForEvaluation(
   ZETASQL_ASSIGN_OR_RETURN(const RelationalOp* relational_op,
                    LookupResolvedScan(stmt()->table_scan()));
 
-  std::unique_ptr<TupleSchema> tuple_schema;
-  std::vector<std::unique_ptr<TupleData>> tuple_datas;
-  ZETASQL_RETURN_IF_ERROR(EvalRelationalOp(*relational_op, params, context,
-                                   &tuple_schema, &tuple_datas));
-  for (const std::unique_ptr<TupleData>& tuple_data : tuple_datas) {
-    // It is expensive to call this for every row, but this code is only used
-    // for compliance testing, so it's ok.
-    ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
-
-    const Tuple tuple(tuple_schema.get(), tuple_data.get());
-    ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> tuple_as_values,
-                     GetScannedTupleAsColumnValues(*column_list_, tuple));
-
-    // The WHERE clause can reference column values and statement parameters.
-    ZETASQL_ASSIGN_OR_RETURN(
-        const Value where_value,
-        EvalExpr(*where_expr, ConcatSpans(params, {tuple.data}), context));
-    const bool deleted = (where_value == Bool(true));
-    if (deleted) {
-      ++num_rows_deleted;
-      if (!context->options().return_all_rows_for_dml) {
-        dml_output_rows.push_back(tuple_as_values);
-      }
-    } else {
-      // In all_rows mode,the output contains the remaining rows.
-      if (context->options().return_all_rows_for_dml) {
-        dml_output_rows.push_back(tuple_as_values);
-      }
-    }
-  }
+  ZETASQL_RETURN_IF_ERROR(ForEachTuple(
+      *relational_op, params, context,
+      [&](const Tuple& tuple) -> absl::Status {
+        // The WHERE clause can reference column values and statement
+        // parameters.
+        ZETASQL_ASSIGN_OR_RETURN(
+            const Value where_value,
+            EvalExpr(*where_expr, ConcatSpans(params, {tuple.data}), context));
+        const bool deleted = (where_value == Bool(true));
+        if (deleted) {
+          ++num_rows_deleted;
+        }
+        // In all_rows mode, the output contains the remaining rows. Otherwise
+        // it only contains the deleted rows, and the other rows are never
+        // copied.
+        if (deleted != context->options().return_all_rows_for_dml) {
+          ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> tuple_as_values,
+                           GetScannedTupleAsColumnValues(*column_list_, tuple));
+          dml_output_rows.push_back(std::move(tuple_as_values));
+        }
+        return absl::OkStatus();
+      }));
 
   ZETASQL_RETURN_IF_ERROR(VerifyNumRowsModified(stmt()->assert_rows_modified(), params,
                                         num_rows_deleted, context));
@@ -1718,45 +2088,41 @@ absl::Status DMLUpdateValueExpr::SetSchemasForEvaluation(
   ZETASQL_ASSIGN_OR_RETURN(const RelationalOp* relational_op,
                    LookupResolvedScan(stmt()->table_scan()));
 
-  std::unique_ptr<TupleSchema> tuple_schema;
-  std::vector<std::unique_ptr<TupleData>> tuples;
-  ZETASQL_RETURN_IF_ERROR(EvalRelationalOp(*relational_op, params, context,
-                                   &tuple_schema, &tuples));
-  for (const std::unique_ptr<TupleData>& tuple_data : tuples) {
-    // It is expensive to call this for every row, but this code is only used
-    // for compliance testing, so it's ok.
-    ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
-
-    const Tuple tuple(tuple_schema.get(), tuple_data.get());
-    std::vector<const TupleData*> joined_tuple_datas;
-    ZETASQL_RETURN_IF_ERROR(GetJoinedTupleDatas(params, tuple_data.get(),
-                                        from_tuples.get(), where_expr, context,
-                                        &joined_tuple_datas));
-    if (joined_tuple_datas.empty()) {
-      ZETASQL_ASSIGN_OR_RETURN(const std::vector<Value> dml_output_row,
-                       GetScannedTupleAsColumnValues(*column_list_, tuple));
-      if (context->options().return_all_rows_for_dml) {
-        dml_output_rows.push_back(dml_output_row);
-      }
-      continue;
-    }
+  ZETASQL_RETURN_IF_ERROR(ForEachTuple(
+      *relational_op, params, context,
+      [&](const Tuple& tuple) -> absl::Status {
+        std::vector<const TupleData*> joined_tuple_datas;
+        ZETASQL_RETURN_IF_ERROR(GetJoinedTupleDatas(params, tuple.data,
+                                            from_tuples.get(), where_expr,
+                                            context, &joined_tuple_datas));
+        if (joined_tuple_datas.empty()) {
+          // Unmodified rows are only copied in all_rows mode.
+          if (context->options().return_all_rows_for_dml) {
+            ZETASQL_ASSIGN_OR_RETURN(
+                std::vector<Value> dml_output_row,
+                GetScannedTupleAsColumnValues(*column_list_, tuple));
+            dml_output_rows.push_back(std::move(dml_output_row));
+          }
+          return absl::OkStatus();
+        }
 
-    ++num_rows_modified;
+        ++num_rows_modified;
 
-    UpdateMap update_map;
-    for (const std::unique_ptr<const ResolvedUpdateItem>& update_item :
-         stmt()->update_item_list()) {
-      ResolvedColumn update_column, update_target_column;
-      std::vector<UpdatePathComponent> prefix_components;
-      ZETASQL_RETURN_IF_ERROR(AddToUpdateMap(
-          update_item.get(), joined_tuple_datas, context, &update_column,
-          &update_target_column, &prefix_components, &update_map));
-    }
+        UpdateMap update_map;
+        for (const std::unique_ptr<const ResolvedUpdateItem>& update_item :
+             stmt()->update_item_list()) {
+          ResolvedColumn update_column, update_target_column;
+          std::vector<UpdatePathComponent> prefix_components;
+          ZETASQL_RETURN_IF_ERROR(AddToUpdateMap(
+              update_item.get(), joined_tuple_datas, context, &update_column,
+              &update_target_column, &prefix_components, &update_map));
+        }
 
-    ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> dml_output_row,
-                     GetDMLOutputRow(tuple, update_map, context));
-    dml_output_rows.push_back(dml_output_row);
-  }
+        ZETASQL_ASSIGN_OR_RETURN(std::vector<Value> dml_output_row,
+                         GetDMLOutputRow(tuple, update_map, context));
+        dml_output_rows.push_back(std::move(dml_output_row));
+        return absl::OkStatus();
+      }));
 
   // Verify that there are no duplicate primary keys in the modified table.
   absl::string_view duplicate_primary_key_error_prefix =
@@ -2659,17 +3025,41 @@ absl::Status DMLInsertValueExpr::SetSchemasForEvaluation(
   ZETASQL_RETURN_IF_ERROR(PopulateRowsToInsert(insert_column_map, params, context,
                                        &rows_to_insert));
 
+  // If we are only returning the new rows, the only original rows that matter
+  // are the ones that collide with a row to insert, so we don't copy the
+  // others. Rows of a table without a primary key never collide with new rows,
+  // which are numbered after the original rows.
+  std::unique_ptr<std::unordered_set<Value, ValueHasher>> keys_to_keep;
+  if (!context->options().return_all_rows_for_dml) {
+    keys_to_keep = absl::make_unique<std::unordered_set<Value, ValueHasher>>();
+    ZETASQL_ASSIGN_OR_RETURN(
+        const absl::optional<std::vector<int>> primary_key_indexes,
+        GetPrimaryKeyColumnIndexes(context));
+    if (primary_key_indexes.has_value()) {
+      for (const std::vector<Value>& row_to_insert : rows_to_insert) {
+        RowNumberAndValues row_number_and_values;
+        row_number_and_values.values = row_to_insert;
+        ZETASQL_ASSIGN_OR_RETURN(
+            const Value primary_key,
+            GetPrimaryKeyOrRowNumber(row_number_and_values, context));
+        keys_to_keep->insert(primary_key);
+      }
+    }
+  }
+
   std::vector<std::vector<Value>> original_rows;
-  ZETASQL_RETURN_IF_ERROR(PopulateRowsInOriginalTable(params, context, &original_rows));
+  int64_t num_original_rows;
+  ZETASQL_RETURN_IF_ERROR(PopulateRowsInOriginalTable(params, context,
+                                              keys_to_keep.get(),
+                                              &original_rows,
+                                              &num_original_rows));
 
   absl::string_view duplicate_primary_key_error_prefix =
       "Found two rows with primary key";
 
-  // We currently store all old rows into `row_map` even in the case where we
-  // are only returning new rows. This is because we have to do the error
-  // checking that we do not cause a primary key collision. A future
-  // optimization might do this checking without materializing the entire
-  // updated PrimaryKeyRowMap in this case.
+  // In all_rows mode, we store all old rows into `row_map`. Otherwise we only
+  // store the old rows that collide with new rows, and duplicate primary keys
+  // in the original table are only detected among those rows.
   PrimaryKeyRowMap row_map;
   bool has_primary_key;
   // Duplicate primary keys in the original table can only result from a problem
@@ -2686,7 +3076,8 @@ absl::Status DMLInsertValueExpr::SetSchemasForEvaluation(
 
   ZETASQL_ASSIGN_OR_RETURN(
       int64_t num_rows_modified,
-      InsertRows(insert_column_map, rows_to_insert, context, &row_map));
+      InsertRows(insert_column_map, rows_to_insert, num_original_rows,
+                 context, &row_map));
 
   ZETASQL_RETURN_IF_ERROR(VerifyNumRowsModified(stmt()->assert_rows_modified(), params,
                                         num_rows_modified, context));
@@ -2837,35 +3228,40 @@ absl::Status DMLInsertValueExpr::PopulateColumnsToInsert(
 
 absl::Status DMLInsertValueExpr::PopulateRowsInOriginalTable(
     absl::Span<const TupleData* const> params, EvaluationContext* context,
-    std::vector<std::vector<Value>>* original_rows) const {
+    const std::unordered_set<Value, ValueHasher>* keys_to_keep,
+    std::vector<std::vector<Value>>* original_rows,
+    int64_t* num_original_rows) const {
   ZETASQL_ASSIGN_OR_RETURN(const RelationalOp* relational_op,
                    LookupResolvedScan(stmt()->table_scan()));
 
-  std::unique_ptr<TupleSchema> tuple_schema;
-  std::vector<std::unique_ptr<TupleData>> tuples;
-  ZETASQL_RETURN_IF_ERROR(EvalRelationalOp(*relational_op, params, context,
-                                   &tuple_schema, &tuples));
-
-  for (const std::unique_ptr<TupleData>& tuple : tuples) {
-    // It is expensive to call this for every row, but this code is only used
-    // for compliance testing, so it's ok.
-    ZETASQL_RETURN_IF_ERROR(context->VerifyNotAborted());
-    ZETASQL_ASSIGN_OR_RETURN(
-        const std::vector<Value> column_values,
-        GetScannedTupleAsColumnValues(*column_list_,
-                                      Tuple(tuple_schema.get(), tuple.get())));
-    original_rows->push_back(column_values);
-  }
-
-  return absl::OkStatus();
+  *num_original_rows = 0;
+  return ForEachTuple(
+      *relational_op, params, context, [&](const Tuple& tuple) -> absl::Status {
+        RowNumberAndValues row_number_and_values;
+        row_number_and_values.row_number = (*num_original_rows)++;
+        ZETASQL_ASSIGN_OR_RETURN(row_number_and_values.values,
+                         GetScannedTupleAsColumnValues(*column_list_, tuple));
+        if (keys_to_keep != nullptr) {
+          ZETASQL_ASSIGN_OR_RETURN(
+              const Value primary_key,
+              GetPrimaryKeyOrRowNumber(row_number_and_values, context));
+          if (keys_to_keep->find(primary_key) == keys_to_keep->end()) {
+            return absl::OkStatus();
+          }
+        }
+        original_rows->push_back(std::move(row_number_and_values.values));
+        return absl::OkStatus();
+      });
 }
 
 ::zetasql_base::StatusOr<int64_t> DMLInsertValueExpr::InsertRows(
     const InsertColumnMap& insert_column_map,
     const std::vector<std::vector<Value>>& rows_to_insert,
-    EvaluationContext* context, PrimaryKeyRowMap* row_map) const {
+    int64_t num_original_rows, EvaluationContext* context,
+    PrimaryKeyRowMap* row_map) const {
   std::unordered_set<Value, ValueHasher> modified_primary_keys;
-  const int64_t max_original_row_number = row_map->size() - 1;
+  const int64_t max_original_row_number = num_original_rows - 1;
+  int64_t next_row_number = num_original_rows;
   bool found_primary_key_collision = false;
   for (int i = 0; i < rows_to_insert.size(); ++i) {
     // It is expensive to call this for every row, but this code is only used
@@ -2878,7 +3274,7 @@ absl::Status DMLInsertValueExpr::PopulateRowsInOriginalTable(
     row_number_and_values.values = row_to_insert;
     // The only use of this row number is as the primary key if the table does
     // not have a real primary key, so we set it to the next row number.
-    row_number_and_values.row_number = row_map->size();
+    row_number_and_values.row_number = next_row_number;
 
     ZETASQL_ASSIGN_OR_RETURN(const Value primary_key,
                      GetPrimaryKeyOrRowNumber(row_number_and_values, context));
@@ -2908,6 +3304,7 @@ absl::Status DMLInsertValueExpr::PopulateRowsInOriginalTable(
         row_map->insert(std::make_pair(primary_key, row_number_and_values));
     if (insert_result.second) {
       // The row was successfully inserted.
+      ++next_row_number;
       ZETASQL_RET_CHECK(modified_primary_keys.insert(primary_key).second);
     } else {
       // The primary key of the new row is in the table, possibly corresponding
@@ -3002,6 +3399,11 @@ bool RootExpr::Eval(absl::Span<const TupleData* const> params,
   return value_expr()->Eval(params, context, result, status);
 }
 
+bool RootExpr::AppendBytecode(BytecodeBuilder* builder,
+                              int* result_reg) const {
+  return value_expr()->AppendBytecode(builder, result_reg);
+}
+
 std::string RootExpr::DebugInternal(const std::string& indent,
                                     bool verbose) const {
   return absl::StrCat("RootExpr(", value_expr()->DebugInternal(indent, verbose),
@@ -16,6 +16,7 @@
 
 // Tests for ValueExprs not covered by other tests.
 
+#include <limits>
 #include <memory>
 #include <set>
 #include <string>
@@ -44,6 +45,7 @@
 #include "zetasql/public/type.h"
 #include "zetasql/public/type.pb.h"
 #include "zetasql/public/value.h"
+#include "zetasql/reference_impl/bytecode.h"
 #include "zetasql/reference_impl/evaluation.h"
 #include "zetasql/reference_impl/function.h"
 #include "zetasql/reference_impl/operator.h"
@@ -68,15 +70,16 @@
 #include "absl/status/status.h"
 #include "absl/strings/cord.h"
 #include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "zetasql/base/canonical_errors.h"
+#include "zetasql/base/clock.h"
 #include "zetasql/base/ret_check.h"
 #include "zetasql/base/status.h"
 #include "zetasql/base/status_macros.h"
 #include "zetasql/base/statusor.h"
 
-using absl::nullopt;
 
 using google::protobuf::internal::WireFormatLite;
 
@@ -597,6 +600,211 @@ TEST_F(EvalTest, LetExpr) {
               StatusIs(absl::StatusCode::kResourceExhausted));
 }
 
+static std::unique_ptr<ValueExpr> BinaryCallExpr(
+    FunctionKind kind, const Type* output_type, std::unique_ptr<ValueExpr> lhs,
+    std::unique_ptr<ValueExpr> rhs) {
+  std::vector<std::unique_ptr<ValueExpr>> args;
+  args.push_back(std::move(lhs));
+  args.push_back(std::move(rhs));
+  return ScalarFunctionCallExpr::Create(CreateFunction(kind, output_type),
+                                        std::move(args), DEFAULT_ERROR_MODE)
+      .value();
+}
+
+TEST_F(EvalTest, BytecodeMatchesTreeInterpreter) {
+  VariableId a("a"), b("b"), c("c");
+  auto deref = [](const VariableId& var) {
+    return DerefExpr::Create(var, Int64Type()).value();
+  };
+
+  // IF(a < b, a * b + c, c - 1)
+  auto condition =
+      BinaryCallExpr(FunctionKind::kLess, BoolType(), deref(a), deref(b));
+  auto product =
+      BinaryCallExpr(FunctionKind::kMultiply, Int64Type(), deref(a), deref(b));
+  auto sum = BinaryCallExpr(FunctionKind::kAdd, Int64Type(), std::move(product),
+                            deref(c));
+  auto difference =
+      BinaryCallExpr(FunctionKind::kSubtract, Int64Type(), deref(c),
+                     ConstExpr::Create(Int64(1)).value());
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto if_expr,
+                       IfExpr::Create(std::move(condition), std::move(sum),
+                                      std::move(difference)));
+
+  const TupleSchema params_schema({a, b, c});
+  ZETASQL_ASSERT_OK(if_expr->SetSchemasForEvaluation({&params_schema}));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<BytecodeProgram> program,
+                       BytecodeProgram::Compile(if_expr.get()));
+  ASSERT_NE(program, nullptr);
+
+  const std::vector<std::vector<Value>> rows = {
+      {Int64(2), Int64(3), Int64(4)},
+      {Int64(3), Int64(2), Int64(4)},
+      {NullInt64(), Int64(2), Int64(4)},
+      {Int64(1), Int64(2), NullInt64()}};
+  for (const std::vector<Value>& row : rows) {
+    const TupleData params_data = CreateTestTupleData(row);
+    ZETASQL_ASSERT_OK_AND_ASSIGN(const Value expected,
+                         EvalExpr(*if_expr, {&params_data}));
+    Value result;
+    ASSERT_TRUE(program->Eval({&params_data}, &result))
+        << program->DebugString();
+    EXPECT_EQ(expected, result) << program->DebugString();
+  }
+
+  // Errors make the bytecode bail out so that the tree interpreter can report
+  // them.
+  const int64_t max = std::numeric_limits<int64_t>::max();
+  const TupleData overflow_data =
+      CreateTestTupleData({Int64(1), Int64(max), Int64(max)});
+  Value result;
+  EXPECT_FALSE(program->Eval({&overflow_data}, &result));
+  EXPECT_THAT(EvalExpr(*if_expr, {&overflow_data}),
+              StatusIs(absl::StatusCode::kOutOfRange));
+
+  // So do values whose type does not match the compiled register type.
+  const TupleData string_data =
+      CreateTestTupleData({String("foo"), Int64(1), Int64(1)});
+  EXPECT_FALSE(program->Eval({&string_data}, &result));
+
+  // Trees with unsupported types are not compiled.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto string_expr, ConstExpr::Create(String("foo")));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<BytecodeProgram> string_program,
+                       BytecodeProgram::Compile(string_expr.get()));
+  EXPECT_EQ(string_program, nullptr);
+}
+
+TEST_F(EvalTest, NonConstantRegexpPatternsAreCached) {
+  VariableId text("text"), pattern("pattern");
+  auto create_call = [&](FunctionKind kind) {
+    std::vector<std::unique_ptr<ValueExpr>> args;
+    args.push_back(DerefExpr::Create(text, StringType()).value());
+    args.push_back(DerefExpr::Create(pattern, StringType()).value());
+    return BuiltinScalarFunction::CreateCall(kind, LanguageOptions(),
+                                             BoolType(), std::move(args))
+        .value();
+  };
+  auto like_expr = create_call(FunctionKind::kLike);
+  auto contains_expr = create_call(FunctionKind::kRegexpContains);
+  const TupleSchema params_schema({text, pattern});
+  ZETASQL_ASSERT_OK(like_expr->SetSchemasForEvaluation({&params_schema}));
+  ZETASQL_ASSERT_OK(contains_expr->SetSchemasForEvaluation({&params_schema}));
+
+  EvaluationOptions options;
+  options.max_regexp_cache_entries = 2;
+  EvaluationContext context(options);
+  const int64_t initial_remaining_bytes =
+      context.memory_accountant()->remaining_bytes();
+  const std::vector<std::vector<Value>> rows = {
+      {String("abc"), String("a%")}, {String("xbc"), String("a%")},
+      {String("abc"), String("%c")}, {String("abd"), String("%c")},
+      {String("abc"), String("a%")}};
+  const std::vector<bool> expected = {true, false, true, false, true};
+  for (int i = 0; i < rows.size(); ++i) {
+    const TupleData params_data = CreateTestTupleData(rows[i]);
+    EXPECT_THAT(EvalExpr(*like_expr, {&params_data}, &context),
+                IsOkAndHolds(Bool(expected[i])));
+  }
+  EXPECT_EQ(3, context.regexp_cache()->num_hits());
+  EXPECT_EQ(2, context.regexp_cache()->num_misses());
+  EXPECT_EQ(2, context.regexp_cache()->num_entries());
+  EXPECT_LT(context.memory_accountant()->remaining_bytes(),
+            initial_remaining_bytes);
+
+  // LIKE and REGEXP_CONTAINS patterns are cached separately, and the least
+  // recently used regexp is evicted.
+  const TupleData params_data = CreateTestTupleData({String("abc"),
+                                                     String("a%")});
+  EXPECT_THAT(EvalExpr(*contains_expr, {&params_data}, &context),
+              IsOkAndHolds(Bool(false)));
+  EXPECT_EQ(3, context.regexp_cache()->num_misses());
+  EXPECT_EQ(2, context.regexp_cache()->num_entries());
+
+  // Invalid patterns are reported and not cached.
+  const TupleData invalid_data = CreateTestTupleData({String("abc"),
+                                                      String("(")});
+  EXPECT_THAT(EvalExpr(*contains_expr, {&invalid_data}, &context),
+              StatusIs(absl::StatusCode::kOutOfRange));
+  EXPECT_EQ(2, context.regexp_cache()->num_entries());
+
+  context.regexp_cache()->Clear();
+  EXPECT_EQ(initial_remaining_bytes,
+            context.memory_accountant()->remaining_bytes());
+}
+
+TEST(RegexpCacheTest, EvictsWhenOverByteLimit) {
+  MemoryAccountant accountant(/*total_num_bytes=*/1 << 20);
+  RegexpCache cache(/*max_entries=*/10, /*max_bytes=*/1, &accountant);
+  ZETASQL_ASSERT_OK(cache.GetLikeRegexp("a%", TYPE_STRING).status());
+  ZETASQL_ASSERT_OK(cache.GetLikeRegexp("b%", TYPE_STRING).status());
+  // Only the most recently used regexp is retained.
+  EXPECT_EQ(cache.num_entries(), 1);
+  EXPECT_GT(cache.num_bytes(), 1);
+  EXPECT_EQ(accountant.remaining_bytes(), (1 << 20) - cache.num_bytes());
+  ZETASQL_ASSERT_OK(cache.GetLikeRegexp("b%", TYPE_STRING).status());
+  EXPECT_EQ(cache.num_hits(), 1);
+  ZETASQL_ASSERT_OK(cache.GetLikeRegexp("a%", TYPE_STRING).status());
+  EXPECT_EQ(cache.num_misses(), 3);
+
+  cache.Clear();
+  EXPECT_EQ(cache.num_bytes(), 0);
+  EXPECT_EQ(accountant.remaining_bytes(), 1 << 20);
+}
+
+TEST(EvaluationContextTest, CancelCallbackRegistersCallback) {
+  EvaluationContext context((EvaluationOptions()));
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks]() {
+    ++num_callbacks;
+    return absl::OkStatus();
+  };
+  // Must not deadlock.
+  context.RegisterCancelCallback([&context, &callback]() {
+    context.RegisterCancelCallback(callback);
+    return absl::OkStatus();
+  });
+  ZETASQL_EXPECT_OK(context.CancelStatement());
+  EXPECT_EQ(num_callbacks, 0);
+  ZETASQL_EXPECT_OK(context.CancelStatement());
+  EXPECT_EQ(num_callbacks, 1);
+}
+
+TEST(EvaluationContextTest, Reset) {
+  zetasql_base::SimulatedClock clock(absl::FromUnixSeconds(1000));
+  EvaluationContext context((EvaluationOptions()));
+  context.SetClockAndClearCurrentTimestamp(&clock);
+  const int64_t initial_remaining_bytes =
+      context.memory_accountant()->remaining_bytes();
+
+  ZETASQL_ASSERT_OK(
+      context.regexp_cache()->GetLikeRegexp("a%", TYPE_STRING).status());
+  EXPECT_EQ(context.GetCurrentTimestamp(), 1000 * 1000 * 1000);
+  context.SetNonDeterministicOutput();
+  int num_callbacks = 0;
+  context.RegisterCancelCallback([&num_callbacks]() {
+    ++num_callbacks;
+    return absl::OkStatus();
+  });
+  ZETASQL_EXPECT_OK(context.CancelStatement());
+  EXPECT_THAT(context.VerifyNotAborted(),
+              StatusIs(absl::StatusCode::kCancelled));
+  EXPECT_LT(context.memory_accountant()->remaining_bytes(),
+            initial_remaining_bytes);
+
+  clock.AdvanceTime(absl::Seconds(1));
+  context.Reset();
+  EXPECT_TRUE(context.IsDeterministicOutput());
+  ZETASQL_EXPECT_OK(context.VerifyNotAborted());
+  EXPECT_EQ(context.regexp_cache()->num_entries(), 0);
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(),
+            initial_remaining_bytes);
+  // The current timestamp is read from the clock again.
+  EXPECT_EQ(context.GetCurrentTimestamp(), 1001 * 1000 * 1000);
+  // The cancel callbacks of the previous statement are dropped.
+  ZETASQL_EXPECT_OK(context.CancelStatement());
+  EXPECT_EQ(num_callbacks, 1);
+}
+
 TEST_F(EvalTest, ArrayAtOffsetNonDeterminism) {
   VariableId arr("arr"), pos("pos");
 
@@ -802,7 +1010,7 @@ TEST_F(EvalTest, SingleValueExpr) {
   EXPECT_EQ(result.value(), GetProtoValue(1));
   const std::shared_ptr<SharedProtoState> result_shared_state =
       *result.mutable_shared_proto_state();
-  EXPECT_THAT(result_shared_state, Pointee(Eq(nullopt)));
+  EXPECT_THAT(result_shared_state, Pointee(HasNoFieldValues()));
   EXPECT_THAT(result_shared_state, HasRawPointer(shared_states1[0][0]));
 
   // More than one element.
@@ -859,6 +1067,90 @@ TEST_F(EvalTest, ExistsExpr) {
   EXPECT_THAT(EvalExpr(*exists2, EmptyParams()), IsOkAndHolds(Bool(true)));
 }
 
+TEST_F(EvalTest, MemoizedExpr) {
+  VariableId p("p");
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto deref_p, DerefExpr::Create(p, Int64Type()));
+  ZETASQL_ASSERT_OK_AND_ASSIGN(auto memoized,
+                       MemoizedExpr::Create(std::move(deref_p)));
+  const TupleSchema params_schema({p});
+  ZETASQL_ASSERT_OK(memoized->SetSchemasForEvaluation({&params_schema}));
+  EXPECT_EQ("MemoizedExpr($p)", memoized->DebugString());
+
+  // The value is computed once per EvaluationContext.
+  const TupleData params1 = CreateTestTupleData({Int64(1)});
+  const TupleData params2 = CreateTestTupleData({Int64(2)});
+  EvaluationContext context((EvaluationOptions()));
+  const int64_t initial_remaining_bytes =
+      context.memory_accountant()->remaining_bytes();
+  EXPECT_THAT(EvalExpr(*memoized, {&params1}, &context),
+              IsOkAndHolds(Int64(1)));
+  EXPECT_LT(context.memory_accountant()->remaining_bytes(),
+            initial_remaining_bytes);
+  EXPECT_THAT(EvalExpr(*memoized, {&params2}, &context),
+              IsOkAndHolds(Int64(1)));
+
+  EvaluationContext other_context((EvaluationOptions()));
+  EXPECT_THAT(EvalExpr(*memoized, {&params2}, &other_context),
+              IsOkAndHolds(Int64(2)));
+}
+
+TEST_F(EvalTest, HashInExpr) {
+  EXPECT_TRUE(HashInExpr::SupportsType(Int64Type()));
+  EXPECT_TRUE(HashInExpr::SupportsType(StringType()));
+  EXPECT_FALSE(HashInExpr::SupportsType(DoubleType()));
+
+  VariableId a("a"), n("n");
+  auto create_in_expr = [&](std::vector<std::vector<Value>> rows) {
+    auto input = absl::WrapUnique(new TestRelationalOp(
+        {a}, CreateTestTupleDatas(rows), /*preserves_order=*/true));
+    auto in_expr = HashInExpr::Create(DerefExpr::Create(n, Int64Type()).value(),
+                                      DerefExpr::Create(a, Int64Type()).value(),
+                                      std::move(input))
+                       .value();
+    const TupleSchema params_schema({n});
+    ZETASQL_CHECK_OK(in_expr->SetSchemasForEvaluation({&params_schema}));
+    return in_expr;
+  };
+  auto eval_in = [&](const HashInExpr& in_expr, const Value& needle) {
+    const TupleData params = CreateTestTupleData({needle});
+    return EvalExpr(in_expr, {&params});
+  };
+
+  auto in_expr = create_in_expr({{Int64(1)}, {Int64(2)}, {Int64(1)}});
+  EXPECT_EQ(
+      "HashInExpr(\n"
+      "+-needle: $n,\n"
+      "+-haystack: $a,\n"
+      "+-input: TestRelationalOp)",
+      in_expr->DebugString());
+  EXPECT_THAT(eval_in(*in_expr, Int64(2)), IsOkAndHolds(Bool(true)));
+  EXPECT_THAT(eval_in(*in_expr, Int64(3)), IsOkAndHolds(Bool(false)));
+  EXPECT_THAT(eval_in(*in_expr, NullInt64()), IsOkAndHolds(NullBool()));
+
+  auto in_with_null = create_in_expr({{Int64(1)}, {NullInt64()}});
+  EXPECT_THAT(eval_in(*in_with_null, Int64(1)), IsOkAndHolds(Bool(true)));
+  EXPECT_THAT(eval_in(*in_with_null, Int64(3)), IsOkAndHolds(NullBool()));
+
+  auto in_empty = create_in_expr({});
+  EXPECT_THAT(eval_in(*in_empty, NullInt64()), IsOkAndHolds(Bool(false)));
+
+  // The hash set is built once per EvaluationContext and accounted for.
+  EvaluationContext context((EvaluationOptions()));
+  const int64_t initial_remaining_bytes =
+      context.memory_accountant()->remaining_bytes();
+  const TupleData params = CreateTestTupleData({Int64(1)});
+  EXPECT_THAT(EvalExpr(*in_expr, {&params}, &context),
+              IsOkAndHolds(Bool(true)));
+  EXPECT_LT(context.memory_accountant()->remaining_bytes(),
+            initial_remaining_bytes);
+
+  EvaluationOptions options;
+  options.max_intermediate_byte_size = 1;
+  EvaluationContext memory_context(options);
+  EXPECT_THAT(EvalExpr(*in_expr, {&params}, &memory_context),
+              StatusIs(absl::StatusCode::kResourceExhausted));
+}
+
 TEST_F(EvalTest, DerefExprDuplicateIds) {
   const VariableId v("v");
   const VariableId w("w");
@@ -911,7 +1203,7 @@ TEST_F(EvalTest, RootExpr) {
   EXPECT_EQ(result.value(), GetProtoValue(1));
   const std::shared_ptr<SharedProtoState> result_shared_state =
       *result.mutable_shared_proto_state();
-  EXPECT_THAT(result_shared_state, Pointee(Eq(nullopt)));
+  EXPECT_THAT(result_shared_state, Pointee(HasNoFieldValues()));
   EXPECT_THAT(result_shared_state, HasRawPointer(params_shared_states[0]));
 }
 
@@ -929,6 +1221,121 @@ class DMLValueExprEvalTest : public EvalTest {
     return functions_[name].get();
   }
 
+  // Returns the columns of a scan of the test table.
+  static ResolvedColumnList TableColumns() {
+    return {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
+            ResolvedColumn{2, "test_table", "str_val", StringType()}};
+  }
+
+  // Returns a DMLInsertValueExpr that inserts 'rows' into the test table, and
+  // the statement it is built from in 'stmt', which must outlive it.
+  zetasql_base::StatusOr<std::unique_ptr<DMLInsertValueExpr>> CreateInsertExpr(
+      const std::vector<std::vector<Value>>& rows,
+      std::unique_ptr<ResolvedInsertStmt>* stmt) {
+    std::vector<std::unique_ptr<const ResolvedInsertRow>> row_list;
+    for (const std::vector<Value>& row : rows) {
+      std::vector<std::unique_ptr<const ResolvedDMLValue>> row_values;
+      for (const Value& value : row) {
+        row_values.push_back(MakeResolvedDMLValue(
+            MakeResolvedLiteral(value.type(), value, /*has_explicit_type=*/
+                                true, /*float_literal_id=*/0)));
+      }
+      row_list.push_back(MakeResolvedInsertRow(std::move(row_values)));
+    }
+    *stmt = MakeResolvedInsertStmt(
+        MakeResolvedTableScan(TableColumns(), table(),
+                              /*for_system_time_expr=*/nullptr),
+        ResolvedInsertStmt::OR_ERROR, /*assert_rows_modified=*/nullptr,
+        TableColumns(), /*query_parameter_list=*/{}, /*query=*/nullptr,
+        /*query_output_column_list=*/{}, std::move(row_list));
+    const ResolvedTableScan* table_scan = (*stmt)->table_scan();
+
+    // Create output types.
+    ZETASQL_ASSIGN_OR_RETURN(
+        const ArrayType* table_array_type,
+        CreateTableArrayType(table_scan->column_list(),
+                             table_scan->table()->IsValueTable(),
+                             type_factory()));
+    ZETASQL_ASSIGN_OR_RETURN(
+        const StructType* primary_key_type,
+        CreatePrimaryKeyType(table_scan->column_list(),
+                             table_scan->table()->PrimaryKey().value(),
+                             type_factory()));
+    ZETASQL_ASSIGN_OR_RETURN(const StructType* dml_output_type,
+                     CreateDMLOutputType(table_array_type, type_factory()));
+
+    // Create a ColumnToVariableMapping.
+    auto column_to_variable_mapping =
+        absl::make_unique<ColumnToVariableMapping>(
+            absl::make_unique<VariableGenerator>());
+
+    // Build a ResolvedScanMap and a ResolvedExprMap from the AST.
+    auto resolved_scan_map = absl::make_unique<ResolvedScanMap>();
+    ZETASQL_ASSIGN_OR_RETURN(std::unique_ptr<ValueExpr> table_as_array_expr,
+                     TableAsArrayExpr::Create(table_scan->table()->Name(),
+                                              table_array_type));
+    ZETASQL_ASSIGN_OR_RETURN(
+        std::unique_ptr<RelationalOp> relation_op,
+        ArrayScanOp::Create(
+            /*element=*/VariableId(),
+            /*position=*/VariableId(),
+            {std::make_pair(
+                 column_to_variable_mapping->GetVariableNameFromColumn(
+                     &table_scan->column_list()[0]),
+                 0),
+             std::make_pair(
+                 column_to_variable_mapping->GetVariableNameFromColumn(
+                     &table_scan->column_list()[1]),
+                 1)},
+            std::move(table_as_array_expr)));
+    (*resolved_scan_map)[table_scan] = std::move(relation_op);
+    auto resolved_expr_map = absl::make_unique<ResolvedExprMap>();
+    for (const auto& row : (*stmt)->row_list()) {
+      for (const auto& value : row->value_list()) {
+        ZETASQL_ASSIGN_OR_RETURN(
+            std::unique_ptr<ValueExpr> const_expr,
+            ConstExpr::Create(
+                value->value()->GetAs<ResolvedLiteral>()->value()));
+        (*resolved_expr_map)[value->value()] = std::move(const_expr);
+      }
+    }
+
+    return DMLInsertValueExpr::Create(
+        table_scan->table(), table_array_type, primary_key_type,
+        dml_output_type, stmt->get(), &table_scan->column_list(),
+        std::move(column_to_variable_mapping), std::move(resolved_scan_map),
+        std::move(resolved_expr_map));
+  }
+
+  // Evaluates 'expr' against the rows (1, "one"), (2, NULL) and (4, NULL) of
+  // the test table, and returns the DML output.
+  zetasql_base::StatusOr<Value> EvalDML(
+      const ValueExpr& expr, bool return_all_rows_for_dml,
+      const LanguageOptions& language_options = LanguageOptions()) {
+    ZETASQL_ASSIGN_OR_RETURN(const ArrayType* table_array_type,
+                     CreateTableArrayType(TableColumns(),
+                                          /*is_value_table=*/false,
+                                          type_factory()));
+    const StructType* row_type = table_array_type->element_type()->AsStruct();
+    EvaluationOptions options{};
+    options.return_all_rows_for_dml = return_all_rows_for_dml;
+    EvaluationContext context{options};
+    context.SetLanguageOptions(language_options);
+    ZETASQL_RETURN_IF_ERROR(context.AddTableAsArray(
+        "test_table", /*is_value_table=*/false,
+        Value::Array(table_array_type,
+                     {Value::Struct(row_type, {Int64(1), String("one")}),
+                      Value::Struct(row_type, {Int64(2), NullString()}),
+                      Value::Struct(row_type, {Int64(4), NullString()})}),
+        language_options));
+    TupleSlot result;
+    absl::Status status;
+    if (!expr.EvalSimple({}, &context, &result, &status)) {
+      return status;
+    }
+    return result.value();
+  }
+
  private:
   SimpleTable table_{"test_table",
                      {{"int_val", Int64Type()}, {"str_val", StringType()}}};
@@ -936,212 +1343,75 @@ class DMLValueExprEvalTest : public EvalTest {
 };
 
 TEST_F(DMLValueExprEvalTest, DMLInsertValueExpr) {
-  // Build a resolved AST for inserting a new row (3, "three") into the table.
-  std::unique_ptr<ResolvedTableScan> table_scan = MakeResolvedTableScan(
-      {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
-       ResolvedColumn{2, "test_table", "str_val", StringType()}},
-      table(), /*for_system_time_expr=*/nullptr);
-  std::vector<std::unique_ptr<const ResolvedDMLValue>> row_values;
-  row_values.push_back(MakeResolvedDMLValue(
-      MakeResolvedLiteral(Int64Type(), Int64(3), /*has_explicit_type=*/
-                          true, /*float_literal_id=*/0)));
-  row_values.push_back(MakeResolvedDMLValue(
-      MakeResolvedLiteral(StringType(), String("three"), /*has_explicit_type=*/
-                          true, /*float_literal_id=*/0)));
-  std::vector<std::unique_ptr<const ResolvedInsertRow>> row_list;
-  row_list.push_back(MakeResolvedInsertRow(std::move(row_values)));
-  std::unique_ptr<ResolvedInsertStmt> stmt = MakeResolvedInsertStmt(
-      std::move(table_scan), ResolvedInsertStmt::OR_ERROR,
-      /*assert_rows_modified=*/nullptr,
-      {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
-       ResolvedColumn{2, "test_table", "str_val", StringType()}},
-      /*query_parameter_list=*/{}, /*query=*/nullptr,
-      /*query_output_column_list=*/{}, std::move(row_list));
+  // Insert a new row (3, "three") into the table.
+  std::unique_ptr<ResolvedInsertStmt> stmt;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DMLInsertValueExpr> expr,
+                       CreateInsertExpr({{Int64(3), String("three")}}, &stmt));
+  ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
 
-  // Create output types.
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      const ArrayType* table_array_type,
-      CreateTableArrayType(stmt->table_scan()->column_list(),
-                           stmt->table_scan()->table()->IsValueTable(),
-                           type_factory()));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      const StructType* primary_key_type,
-      CreatePrimaryKeyType(stmt->table_scan()->column_list(),
-                           stmt->table_scan()->table()->PrimaryKey().value(),
-                           type_factory()));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(const StructType* dml_output_type,
-                       CreateDMLOutputType(table_array_type, type_factory()));
+  // Only the new row is returned when returning only the modified rows.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(Value result,
+                       EvalDML(*expr, /*return_all_rows_for_dml=*/false));
+  EXPECT_EQ(result.field(0).int64_value(), 1);
+  EXPECT_THAT(result.field(1).elements(),
+              UnorderedElementsAre(Property(
+                  &Value::fields, ElementsAre(Int64(3), String("three")))));
 
-  // Create a ColumnToVariableMapping.
-  auto column_to_variable_mapping = absl::make_unique<ColumnToVariableMapping>(
-      absl::make_unique<VariableGenerator>());
+  // Otherwise the original rows are returned too.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(result,
+                       EvalDML(*expr, /*return_all_rows_for_dml=*/true));
+  EXPECT_EQ(result.field(0).int64_value(), 1);
+  EXPECT_THAT(
+      result.field(1).elements(),
+      UnorderedElementsAre(
+          Property(&Value::fields, ElementsAre(Int64(1), String("one"))),
+          Property(&Value::fields, ElementsAre(Int64(2), NullString())),
+          Property(&Value::fields, ElementsAre(Int64(3), String("three"))),
+          Property(&Value::fields, ElementsAre(Int64(4), NullString()))));
+}
 
-  // Build a ResolvedScanMap and a ResolvedExprMap from the AST.
-  auto resolved_scan_map = absl::make_unique<ResolvedScanMap>();
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      std::unique_ptr<ValueExpr> table_as_array_expr,
-      TableAsArrayExpr::Create(stmt->table_scan()->table()->Name(),
-                               table_array_type));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      std::unique_ptr<RelationalOp> relation_op,
-      ArrayScanOp::Create(
-          /*element=*/VariableId(),
-          /*position=*/VariableId(),
-          {std::make_pair(column_to_variable_mapping->GetVariableNameFromColumn(
-                              &stmt->table_scan()->column_list()[0]),
-                          0),
-           std::make_pair(column_to_variable_mapping->GetVariableNameFromColumn(
-                              &stmt->table_scan()->column_list()[1]),
-                          1)},
-          std::move(table_as_array_expr)));
-  (*resolved_scan_map)[stmt->table_scan()] = std::move(relation_op);
-  auto resolved_expr_map = absl::make_unique<ResolvedExprMap>();
-  for (const auto& value : stmt->row_list(0)->value_list()) {
-    ZETASQL_ASSERT_OK_AND_ASSIGN(
-        std::unique_ptr<ValueExpr> const_expr,
-        ConstExpr::Create(value->value()->GetAs<ResolvedLiteral>()->value()));
-    (*resolved_expr_map)[value->value()] = std::move(const_expr);
-  }
+TEST_F(DMLValueExprEvalTest, DMLInsertValueExprCollidesWithExistingRow) {
+  // Insert a row (2, "two") into the table, which already has a row with
+  // primary key 2. Only that row of the original table is copied when
+  // returning only the modified rows.
+  std::unique_ptr<ResolvedInsertStmt> stmt;
+  ZETASQL_ASSERT_OK_AND_ASSIGN(std::unique_ptr<DMLInsertValueExpr> expr,
+                       CreateInsertExpr({{Int64(2), String("two")}}, &stmt));
+  ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
+  EXPECT_THAT(EvalDML(*expr, /*return_all_rows_for_dml=*/false),
+              StatusIs(absl::StatusCode::kOutOfRange,
+                       HasSubstr("due to previously existing row")));
+}
 
-  // Create the DMLInsertValueExpr to be tested.
+TEST_F(DMLValueExprEvalTest,
+       DMLInsertValueExprNumbersNewRowsAfterOriginalRows) {
+  // Insert two rows with the same new primary key 3. The second one collides
+  // with the first one, which must be numbered after the three original rows
+  // even though they are not copied when returning only the modified rows.
+  std::unique_ptr<ResolvedInsertStmt> stmt;
   ZETASQL_ASSERT_OK_AND_ASSIGN(
       std::unique_ptr<DMLInsertValueExpr> expr,
-      DMLInsertValueExpr::Create(
-          stmt->table_scan()->table(), table_array_type, primary_key_type,
-          dml_output_type, stmt.get(), &stmt->table_scan()->column_list(),
-          std::move(column_to_variable_mapping), std::move(resolved_scan_map),
-          std::move(resolved_expr_map)));
-
-  // Evaluate and check.
-  TupleSlot result;
-  absl::Status status;
-  // the case for return_all_rows_for_dml = true is covered by the reference
-  // implementation compliance tests
-  EvaluationOptions options{};
-  options.return_all_rows_for_dml = false;
-  EvaluationContext context{options};
-  ZETASQL_CHECK_OK(context.AddTableAsArray(
-      "test_table", /*is_value_table=*/false,
-      Value::Array(table_array_type,
-                   {Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(1), String("one")}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(2), NullString()}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(4), NullString()})}),
-      LanguageOptions{}));
+      CreateInsertExpr({{Int64(3), String("a")}, {Int64(3), String("b")}},
+                       &stmt));
   ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
-  EXPECT_TRUE(expr->EvalSimple({}, &context, &result, &status));
-  ZETASQL_ASSERT_OK(status);
-  EXPECT_EQ(result.value().field(0).int64_value(), 1);
-  EXPECT_THAT(result.value().field(1).elements(),
-              UnorderedElementsAre(Property(
-                  &Value::fields, ElementsAre(Int64(3), String("three")))));
+  EXPECT_THAT(EvalDML(*expr, /*return_all_rows_for_dml=*/false),
+              StatusIs(absl::StatusCode::kOutOfRange,
+                       HasSubstr("due to previously inserted row")));
 }
 
 TEST_F(DMLValueExprEvalTest,
        DMLInsertValueExprSetsPrimaryKeyValuesToNullWhenDisallowed) {
-  // Build a resolved AST for inserting a new row (3, "three") into the table.
-  std::unique_ptr<ResolvedTableScan> table_scan = MakeResolvedTableScan(
-      {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
-       ResolvedColumn{2, "test_table", "str_val", StringType()}},
-      table(), /*for_system_time_expr=*/nullptr);
-  std::vector<std::unique_ptr<const ResolvedDMLValue>> row_values;
-  row_values.push_back(MakeResolvedDMLValue(
-      MakeResolvedLiteral(Int64Type(), NullInt64(), /*has_explicit_type=*/
-                          true, /*float_literal_id=*/0)));
-  row_values.push_back(MakeResolvedDMLValue(
-      MakeResolvedLiteral(StringType(), String("three"), /*has_explicit_type=*/
-                          true, /*float_literal_id=*/0)));
-  std::vector<std::unique_ptr<const ResolvedInsertRow>> row_list;
-  row_list.push_back(MakeResolvedInsertRow(std::move(row_values)));
-  std::unique_ptr<ResolvedInsertStmt> stmt = MakeResolvedInsertStmt(
-      std::move(table_scan), ResolvedInsertStmt::OR_ERROR,
-      /*assert_rows_modified=*/nullptr,
-      {ResolvedColumn{1, "test_table", "int_val", Int64Type()},
-       ResolvedColumn{2, "test_table", "str_val", StringType()}},
-      /*query_parameter_list=*/{}, /*query=*/nullptr,
-      /*query_output_column_list=*/{}, std::move(row_list));
-
-  // Create output types.
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      const ArrayType* table_array_type,
-      CreateTableArrayType(stmt->table_scan()->column_list(),
-                           stmt->table_scan()->table()->IsValueTable(),
-                           type_factory()));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      const StructType* primary_key_type,
-      CreatePrimaryKeyType(stmt->table_scan()->column_list(),
-                           stmt->table_scan()->table()->PrimaryKey().value(),
-                           type_factory()));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(const StructType* dml_output_type,
-                       CreateDMLOutputType(table_array_type, type_factory()));
-
-  // Create a ColumnToVariableMapping.
-  auto column_to_variable_mapping = absl::make_unique<ColumnToVariableMapping>(
-      absl::make_unique<VariableGenerator>());
-
-  // Build a ResolvedScanMap and a ResolvedExprMap from the AST.
-  auto resolved_scan_map = absl::make_unique<ResolvedScanMap>();
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      std::unique_ptr<ValueExpr> table_as_array_expr,
-      TableAsArrayExpr::Create(stmt->table_scan()->table()->Name(),
-                               table_array_type));
-  ZETASQL_ASSERT_OK_AND_ASSIGN(
-      std::unique_ptr<RelationalOp> relation_op,
-      ArrayScanOp::Create(
-          /*element=*/VariableId(),
-          /*position=*/VariableId(),
-          {std::make_pair(column_to_variable_mapping->GetVariableNameFromColumn(
-                              &stmt->table_scan()->column_list()[0]),
-                          0),
-           std::make_pair(column_to_variable_mapping->GetVariableNameFromColumn(
-                              &stmt->table_scan()->column_list()[1]),
-                          1)},
-          std::move(table_as_array_expr)));
-  (*resolved_scan_map)[stmt->table_scan()] = std::move(relation_op);
-  auto resolved_expr_map = absl::make_unique<ResolvedExprMap>();
-  for (const auto& value : stmt->row_list(0)->value_list()) {
-    ZETASQL_ASSERT_OK_AND_ASSIGN(
-        std::unique_ptr<ValueExpr> const_expr,
-        ConstExpr::Create(value->value()->GetAs<ResolvedLiteral>()->value()));
-    (*resolved_expr_map)[value->value()] = std::move(const_expr);
-  }
-
-  // Create the DMLInsertValueExpr to be tested.
+  // Insert a new row (NULL, "three") into the table.
+  std::unique_ptr<ResolvedInsertStmt> stmt;
   ZETASQL_ASSERT_OK_AND_ASSIGN(
       std::unique_ptr<DMLInsertValueExpr> expr,
-      DMLInsertValueExpr::Create(
-          stmt->table_scan()->table(), table_array_type, primary_key_type,
-          dml_output_type, stmt.get(), &stmt->table_scan()->column_list(),
-          std::move(column_to_variable_mapping), std::move(resolved_scan_map),
-          std::move(resolved_expr_map)));
+      CreateInsertExpr({{NullInt64(), String("three")}}, &stmt));
+  ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
 
-  // Evaluate and check.
-  TupleSlot result;
-  absl::Status status;
-  // the case for return_all_rows_for_dml = true is covered by the reference
-  // implementation compliance tests
-  EvaluationOptions options{};
-  options.return_all_rows_for_dml = false;
-  EvaluationContext context{options};;
   LanguageOptions language_options;
   language_options.EnableLanguageFeature(FEATURE_DISALLOW_NULL_PRIMARY_KEYS);
-  context.SetLanguageOptions(language_options);
-  ZETASQL_CHECK_OK(context.AddTableAsArray(
-      "test_table", /*is_value_table=*/false,
-      Value::Array(table_array_type,
-                   {Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(1), String("one")}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(2), NullString()}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(4), NullString()})}),
-      language_options));
-  ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
-  EXPECT_FALSE(expr->EvalSimple({}, &context, &result, &status));
   EXPECT_THAT(
-      status,
+      EvalDML(*expr, /*return_all_rows_for_dml=*/false, language_options),
       StatusIs(absl::StatusCode::kOutOfRange,
                HasSubstr("INSERT a NULL value into a primary key column")));
 }
@@ -1243,33 +1513,25 @@ TEST_F(DMLValueExprEvalTest, DMLDeleteValueExpr) {
           std::move(column_to_variable_mapping), std::move(resolved_scan_map),
           std::move(resolved_expr_map)));
 
-  // Evaluate and check.
-  TupleSlot result;
-  absl::Status status;
-  // the case for return_all_rows_for_dml = true is covered by the reference
-  // implementation compliance tests
-  EvaluationOptions options{};
-  options.return_all_rows_for_dml = false;
-  EvaluationContext context{options};
-  ZETASQL_CHECK_OK(context.AddTableAsArray(
-      "test_table", /*is_value_table=*/false,
-      Value::Array(table_array_type,
-                   {Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(1), String("one")}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(2), NullString()}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(4), NullString()})}),
-      LanguageOptions{}));
+  // Evaluate and check. Only the deleted rows are returned when returning
+  // only the modified rows.
   ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
-  EXPECT_TRUE(expr->EvalSimple({}, &context, &result, &status));
-  ZETASQL_ASSERT_OK(status);
-  EXPECT_EQ(result.value().field(0).int64_value(), 2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(Value result,
+                       EvalDML(*expr, /*return_all_rows_for_dml=*/false));
+  EXPECT_EQ(result.field(0).int64_value(), 2);
   EXPECT_THAT(
-      result.value().field(1).elements(),
+      result.field(1).elements(),
       UnorderedElementsAre(
           Property(&Value::fields, ElementsAre(Int64(2), NullString())),
           Property(&Value::fields, ElementsAre(Int64(4), NullString()))));
+
+  // Otherwise the remaining rows are returned.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(result,
+                       EvalDML(*expr, /*return_all_rows_for_dml=*/true));
+  EXPECT_EQ(result.field(0).int64_value(), 2);
+  EXPECT_THAT(result.field(1).elements(),
+              UnorderedElementsAre(Property(
+                  &Value::fields, ElementsAre(Int64(1), String("one")))));
 }
 
 TEST_F(DMLValueExprEvalTest, DMLUpdateValueExpr) {
@@ -1406,31 +1668,26 @@ TEST_F(DMLValueExprEvalTest, DMLUpdateValueExpr) {
           std::move(column_to_variable_mapping), std::move(resolved_scan_map),
           std::move(resolved_expr_map)));
 
-  // Evaluate and check.
-  TupleSlot result;
-  absl::Status status;
-  // the case for return_all_rows_for_dml = true is covered by the reference
-  // implementation compliance tests
-  EvaluationOptions options{};
-  options.return_all_rows_for_dml = false;
-  EvaluationContext context{options};
-  ZETASQL_CHECK_OK(context.AddTableAsArray(
-      "test_table", /*is_value_table=*/false,
-      Value::Array(table_array_type,
-                   {Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(1), String("one")}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(2), NullString()}),
-                    Value::Struct(table_array_type->element_type()->AsStruct(),
-                                  {Int64(4), NullString()})}),
-      LanguageOptions{}));
+  // Evaluate and check. Only the updated rows are returned when returning
+  // only the modified rows.
   ZETASQL_ASSERT_OK(expr->SetSchemasForEvaluation({}));
-  EXPECT_TRUE(expr->EvalSimple({}, &context, &result, &status));
-  ZETASQL_ASSERT_OK(status);
-  EXPECT_EQ(result.value().field(0).int64_value(), 2);
+  ZETASQL_ASSERT_OK_AND_ASSIGN(Value result,
+                       EvalDML(*expr, /*return_all_rows_for_dml=*/false));
+  EXPECT_EQ(result.field(0).int64_value(), 2);
+  EXPECT_THAT(
+      result.field(1).elements(),
+      UnorderedElementsAre(
+          Property(&Value::fields, ElementsAre(Int64(2), String("unknown"))),
+          Property(&Value::fields, ElementsAre(Int64(4), String("unknown")))));
+
+  // Otherwise the unmodified row is returned too.
+  ZETASQL_ASSERT_OK_AND_ASSIGN(result,
+                       EvalDML(*expr, /*return_all_rows_for_dml=*/true));
+  EXPECT_EQ(result.field(0).int64_value(), 2);
   EXPECT_THAT(
-      result.value().field(1).elements(),
+      result.field(1).elements(),
       UnorderedElementsAre(
+          Property(&Value::fields, ElementsAre(Int64(1), String("one"))),
           Property(&Value::fields, ElementsAre(Int64(2), String("unknown"))),
           Property(&Value::fields, ElementsAre(Int64(4), String("unknown")))));
 }
@@ -3088,10 +3345,13 @@ TEST_F(ProtoEvalTest, GetProtoFieldExprsMultipleFieldsMultipleRows) {
 
       for (int i = 0; i < 3; ++i) {
         const SharedProtoState& shared_state = *shared_states[i];
-        ASSERT_TRUE(shared_state.has_value());
-        ASSERT_EQ(shared_state.value().size(), 1);
-        const auto& entry = *shared_state.value().begin();
+        ASSERT_TRUE(shared_state.value_map.has_value());
+        ASSERT_EQ(shared_state.value_map->size(), 1);
+        const auto& entry = *shared_state.value_map->begin();
         EXPECT_EQ(entry.first.proto_rep, InternalValue::GetProtoRep(v[i]));
+        // Only one registry reads each proto, so no offset index is built.
+        EXPECT_FALSE(
+            shared_state.offset_indexes.contains(entry.first.proto_rep));
         const ProtoFieldValueList& value_list = *entry.second;
 
         const int first_field_values[] = {1, 10, 100};
@@ -3108,12 +3368,70 @@ TEST_F(ProtoEvalTest, GetProtoFieldExprsMultipleFieldsMultipleRows) {
                                 IsOkAndHolds(nested_value)));
       }
     } else {
-      EXPECT_THAT(s1, IsTupleSlotWith(v[0], Pointee(Eq(nullopt))));
-      EXPECT_THAT(s2, IsTupleSlotWith(v[1], Pointee(Eq(nullopt))));
-      EXPECT_THAT(s3, IsTupleSlotWith(v[2], Pointee(Eq(nullopt))));
+      EXPECT_THAT(s1, IsTupleSlotWith(v[0], Pointee(HasNoFieldValues())));
+      EXPECT_THAT(s2, IsTupleSlotWith(v[1], Pointee(HasNoFieldValues())));
+      EXPECT_THAT(s3, IsTupleSlotWith(v[2], Pointee(HasNoFieldValues())));
     }
   }
 }
 
+TEST_F(ProtoEvalTest, GetProtoFieldExprBuildsOffsetIndexForSecondRegistry) {
+  zetasql_test::KitchenSinkPB p;
+  p.set_int64_key_1(1);
+  p.set_int64_key_2(2);
+  const Value proto_value =
+      Value::Proto(MakeProtoType(&p), SerializeToCord(p));
+
+  ProtoFieldAccessInfo access_info1;
+  ProtoFieldInfo* info1 = &access_info1.field_info;
+  info1->descriptor = p.GetDescriptor()->FindFieldByName("int64_key_1");
+  ZETASQL_ASSERT_OK(GetProtoFieldTypeAndDefault(info1->descriptor, type_factory_,
+                                        &info1->type, &info1->default_value));
+  info1->format = ProtoType::GetFormatAnnotation(info1->descriptor);
+
+  ProtoFieldAccessInfo access_info2;
+  ProtoFieldInfo* info2 = &access_info2.field_info;
+  info2->descriptor = p.GetDescriptor()->FindFieldByName("int64_key_2");
+  ZETASQL_ASSERT_OK(GetProtoFieldTypeAndDefault(info2->descriptor, type_factory_,
+                                        &info2->type, &info2->default_value));
+  info2->format = ProtoType::GetFormatAnnotation(info2->descriptor);
+
+  ProtoFieldRegistry registry1(/*id=*/1);
+  ProtoFieldRegistry registry2(/*id=*/2);
+  ProtoFieldReader reader1(/*id=*/1, access_info1, &registry1);
+  ProtoFieldReader reader2(/*id=*/2, access_info2, &registry2);
+
+  EvaluationOptions options;
+  options.store_proto_field_value_maps = true;
+  EvaluationContext context(options);
+  const int64_t initial_bytes = context.memory_accountant()->remaining_bytes();
+  {
+    TupleSlot slot;
+    slot.SetValue(proto_value);
+    const SharedProtoState& shared_state =
+        **slot.mutable_shared_proto_state();
+
+    // The first read scans the proto without building an index.
+    Value value;
+    absl::Status status;
+    ASSERT_TRUE(reader1.GetFieldValue(slot, &context, &value, &status))
+        << status;
+    EXPECT_EQ(value, Int64(1));
+    EXPECT_TRUE(shared_state.offset_indexes.empty());
+    EXPECT_EQ(context.memory_accountant()->remaining_bytes(), initial_bytes);
+
+    // The read through the second registry builds and charges the index.
+    ASSERT_TRUE(reader2.GetFieldValue(slot, &context, &value, &status))
+        << status;
+    EXPECT_EQ(value, Int64(2));
+    ASSERT_EQ(shared_state.offset_indexes.size(), 1);
+    EXPECT_GT(shared_state.offset_index_bytes, 0);
+    EXPECT_EQ(context.memory_accountant()->remaining_bytes(),
+              initial_bytes - shared_state.offset_index_bytes);
+  }
+  // Releasing the slot returns the bytes of the index.
+  EXPECT_EQ(context.memory_accountant()->remaining_bytes(), initial_bytes);
+}
+
 }  // namespace
 }  // namespace zetasql
@@ -348,6 +348,11 @@ TEST(ResolvedAST, CheckOptionalFieldsAccessed) {
   EXPECT_FALSE(value_expr->CheckFieldsAccessed().ok());
   EXPECT_FALSE(hint->CheckFieldsAccessed().ok());
   EXPECT_FALSE(scan->CheckFieldsAccessed().ok());
+
+  scan->MarkFieldsAccessed();
+  ZETASQL_EXPECT_OK(value_expr->CheckFieldsAccessed());
+  ZETASQL_EXPECT_OK(hint->CheckFieldsAccessed());
+  ZETASQL_EXPECT_OK(scan->CheckFieldsAccessed());
 }
 
 // This is a minimal test for the Validator based on the old test for the
@@ -156,6 +156,9 @@ absl::Status ResolvedNode::CheckFieldsAccessed() const {
 void ResolvedNode::ClearFieldsAccessed() const {
 }
 
+void ResolvedNode::MarkFieldsAccessed() const {
+}
+
 // NOTE: An equivalent method on ASTNodes exists in ../parser/parse_tree.cc.
 void ResolvedNode::GetDescendantsWithKinds(
     const std::set<ResolvedNodeKind>& node_kinds,
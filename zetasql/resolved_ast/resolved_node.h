@@ -178,6 +178,11 @@ class ResolvedNode {
   // Reset the field accessed markers in this node and its children.
   virtual void ClearFieldsAccessed() const;
 
+  // Set the field accessed markers in this node and its children, e.g., for
+  // a subtree that an engine knows to be equivalent to one it has already
+  // interpreted.
+  virtual void MarkFieldsAccessed() const;
+
   // Returns in 'child_nodes' all non-NULL ResolvedNodes that are children of
   // this node. The order of 'child_nodes' is deterministic, but callers should
   // not depend on how the roles (fields) correspond to locations, especially